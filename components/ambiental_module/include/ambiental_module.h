@@ -16,6 +16,31 @@
  * This file is part of the SMEM-MP project and is licensed under the MIT License.
  */
 
+/*
+ * Sensors are kept in a registry of CONFIG_AMBIENTAL_MAX_SENSORS slots. The bus is searched
+ * at start and then every CONFIG_AMBIENTAL_RESCAN_INTERVAL_MS between two read cycles: new
+ * DS18B20 take a free slot, and a sensor missing from two complete searches in a row is
+ * removed. Each sensor has a name, used as the last level of its MQTT topic. The name is
+ * looked up once, when the sensor is added: first in NVS (set with
+ * ambiental_set_sensor_name()), then in the CONFIG_AMBIENTAL_SENSOR_NAMES list, and otherwise
+ * it is the ROM ID in hex. Every reading carries the name of its slot.
+ *
+ * Every sensor is programmed with alarm thresholds (TH/TL, whole degrees). After each
+ * conversion the DS18B20 compares the integer part of the temperature with them and raises its
+ * alarm flag at or beyond a threshold. With CONFIG_AMBIENTAL_ALARM_SEARCH the read cycle uses
+ * the 1-Wire ALARM SEARCH (ECh) after the conversion and only reads the sensors out of their
+ * band (and those that were out in the previous cycle, to report their return). Its bus time
+ * depends on the sensors in alarm, not on the length of the chain. A full sweep that reads
+ * every sensor still runs every CONFIG_AMBIENTAL_SWEEP_INTERVAL_MS for trending.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "esp_err.h"
+
 /**
  * @brief Callback type for temperature notifications.
  * @details This callback is invoked when a temperature reading is available.
@@ -25,6 +50,19 @@
  */
 typedef void (*hookCallback_onTemperatureRead)(void *data, ssize_t size);
 
+/**
+ * @brief Callback type for sensors dropped from the registry.
+ * @details Invoked from the read task when a sensor has been missing from
+ *          consecutive complete ROM searches and its slot is freed.
+ * @param data Pointer to an ambiental_callback_data_t with the sensor_id and name
+ *        of the sensor; temperature_celsius and alarm are not meaningful.
+ * @param size Size of the structure data.
+ * @return void No return value.
+ */
+typedef void (*hookCallback_onSensorRemoved)(void *data, ssize_t size);
+
+#define AMBIENTAL_NAME_MAX 24  /**< Longest sensor name, with the terminator */
+
 /**
  * @brief Data structure for temperature callback data.
  * @details This structure holds information about a DS18B20 sensor and its
@@ -33,8 +71,22 @@ typedef void (*hookCallback_onTemperatureRead)(void *data, ssize_t size);
 typedef struct {
     uint64_t sensor_id;        /**< Unique identifier for the DS18B20 sensor */
     float temperature_celsius; /**< Temperature in Celsius */
+    char name[AMBIENTAL_NAME_MAX]; /**< Name of the sensor (last level of its topic) */
+    bool alarm;                /**< Temperature at or beyond an alarm threshold */
 } ambiental_callback_data_t;
 
+/**
+ * @brief Registered sensor.
+ */
+typedef struct {
+    uint64_t sensor_id;            /**< ROM ID of the sensor */
+    char name[AMBIENTAL_NAME_MAX]; /**< Name of the sensor */
+    uint8_t bits;                  /**< Requested resolution, 9 to 12 bits */
+    int8_t alarm_low;              /**< Low alarm threshold (TL), °C */
+    int8_t alarm_high;             /**< High alarm threshold (TH), °C */
+    bool alarm;                    /**< Alarm state of the last reading */
+} ambiental_sensor_info_t;
+
 /**
  * @brief Set the callback function for temperature read events.
  * @details This function allows the user to register a callback that will be
@@ -44,6 +96,13 @@ typedef struct {
  */
 void ambiental_set_hookCallback_onTemperatureRead(hookCallback_onTemperatureRead cb);
 
+/**
+ * @brief Set the callback function for sensors dropped from the registry.
+ * @param cb The callback function to be set.
+ * @return void No return value.
+ */
+void ambiental_set_hookCallback_onSensorRemoved(hookCallback_onSensorRemoved cb);
+
 /**
  * @brief Start the Ambiental Module component.
  * @details This function initializes and starts the Ambiental Module component,
@@ -52,4 +111,67 @@ void ambiental_set_hookCallback_onTemperatureRead(hookCallback_onTemperatureRead
  */
 esp_err_t ambiental_module_start(void);
 
+/**
+ * @brief Set the resolution of a DS18B20 sensor.
+ * @details Each sample is a split-phase cycle: one CONVERT T for the whole bus, a timer for
+ *          the conversion time of the highest resolution in use (93.75 ms at 9 bits, 187.5 ms
+ *          at 10, 375 ms at 11, 750 ms at 12) and then one scratchpad read per sensor. Lower
+ *          resolutions (0.5, 0.25, 0.125 °C against 0.0625 °C) shorten the cycle. The read task
+ *          writes the new resolution to the sensor in the next cycle; sensors start with
+ *          CONFIG_AMBIENTAL_DS18B20_RESOLUTION.
+ * @param sensor_id ROM ID of the sensor.
+ * @param bits Resolution, 9 to 12 bits.
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for a bad resolution, or ESP_ERR_NOT_FOUND
+ *         if the sensor is not registered.
+ */
+esp_err_t ambiental_set_resolution(uint64_t sensor_id, uint8_t bits);
+
+/**
+ * @brief Get the resolution requested for a DS18B20 sensor.
+ * @param sensor_id ROM ID of the sensor.
+ * @param bits Where the resolution (9 to 12 bits) is stored.
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG, or ESP_ERR_NOT_FOUND if the sensor is not
+ *         registered.
+ */
+esp_err_t ambiental_get_resolution(uint64_t sensor_id, uint8_t *bits);
+
+/**
+ * @brief Set the alarm thresholds of a DS18B20 sensor.
+ * @details The read task writes them to the sensor before the next conversion; sensors start
+ *          with CONFIG_AMBIENTAL_ALARM_LOW_C and CONFIG_AMBIENTAL_ALARM_HIGH_C. The sensor is in
+ *          alarm when the integer part of its temperature is <= low_c or >= high_c.
+ * @param sensor_id ROM ID of the sensor.
+ * @param low_c Low threshold, °C (-55 to 125).
+ * @param high_c High threshold, °C, above low_c.
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for bad thresholds, or ESP_ERR_NOT_FOUND if
+ *         the sensor is not registered.
+ */
+esp_err_t ambiental_set_alarm_thresholds(uint64_t sensor_id, int8_t low_c, int8_t high_c);
+
+/**
+ * @brief Set the name of a DS18B20 sensor and store it in NVS.
+ * @details The sensor does not need to be on the bus: the name is used when it shows up.
+ *          A registered sensor uses the new name from its next reading.
+ * @param sensor_id ROM ID of the sensor (DS18B20 family code).
+ * @param name Up to AMBIENTAL_NAME_MAX - 1 letters, digits, '_', '-' or '.'. NULL or an empty
+ *        string removes the stored name, and the default one is used again.
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for a bad ROM ID or name, or an NVS error.
+ */
+esp_err_t ambiental_set_sensor_name(uint64_t sensor_id, const char *name);
+
+/**
+ * @brief Get the number of registered sensors.
+ * @return Number of sensors.
+ */
+size_t ambiental_sensors_count(void);
+
+/**
+ * @brief Copy the data of a registered sensor.
+ * @param index Sensor index, from 0 to ambiental_sensors_count() - 1. The order may change
+ *        when sensors are added or removed.
+ * @param info Where the data is copied.
+ * @return ESP_OK on success, or ESP_ERR_INVALID_ARG.
+ */
+esp_err_t ambiental_sensor_get(size_t index, ambiental_sensor_info_t *info);
+
 #endif // AMBIENTAL_MODULE_H
\ No newline at end of file
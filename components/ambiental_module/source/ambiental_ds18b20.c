@@ -0,0 +1,185 @@
+#include "onewire_cmd.h"
+#include "onewire_crc.h"
+
+#include "ambiental_ds18b20_priv.h"
+
+#define DS18B20_CMD_CONVERT_T        0x44
+#define DS18B20_CMD_WRITE_SCRATCHPAD 0x4E
+#define DS18B20_CMD_READ_SCRATCHPAD  0xBE
+
+#define DS18B20_SCRATCHPAD_SIZE 9
+#define DS18B20_CFG_FIXED_MASK  0x9F   // bit 7 en 0 y bits 0..4 en 1, según el datasheet
+#define DS18B20_CFG_FIXED       0x1F
+#define DS18B20_RESERVED_5      0xFF   // byte 5 del scratchpad, siempre FFh
+
+static const uint32_t CONVERSION_US[] = { 93750, 187500, 375000, 750000 };
+
+uint32_t ambiental_ds18b20_conversion_us(uint8_t bits)
+{
+    if (bits < AMBIENTAL_DS18B20_BITS_MIN || bits > AMBIENTAL_DS18B20_BITS_MAX)
+        bits = AMBIENTAL_DS18B20_BITS_MAX;
+    return CONVERSION_US[bits - AMBIENTAL_DS18B20_BITS_MIN];
+}
+
+// Reset, Match ROM con la dirección (el byte bajo va primero) y el comando de función
+static esp_err_t select_device(onewire_bus_handle_t bus, uint64_t addr, uint8_t cmd)
+{
+    esp_err_t err = onewire_bus_reset(bus);
+    if (err != ESP_OK)
+        return err;
+
+    uint8_t tx[10];
+    tx[0] = ONEWIRE_CMD_MATCH_ROM;
+    for (int i = 0; i < 8; ++i)
+        tx[1 + i] = (uint8_t)(addr >> (8 * i));
+    tx[9] = cmd;
+    return onewire_bus_write_bytes(bus, tx, sizeof(tx));
+}
+
+esp_err_t ambiental_ds18b20_convert_all(onewire_bus_handle_t bus)
+{
+    if (bus == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    esp_err_t err = onewire_bus_reset(bus);
+    if (err != ESP_OK)
+        return err;
+
+    const uint8_t tx[] = { ONEWIRE_CMD_SKIP_ROM, DS18B20_CMD_CONVERT_T };
+    return onewire_bus_write_bytes(bus, tx, sizeof(tx));
+}
+
+esp_err_t ambiental_ds18b20_read(onewire_bus_handle_t bus, uint64_t addr, ambiental_ds18b20_scratchpad_t *pad)
+{
+    if (bus == NULL || pad == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    esp_err_t err = select_device(bus, addr, DS18B20_CMD_READ_SCRATCHPAD);
+    if (err != ESP_OK)
+        return err;
+
+    uint8_t rx[DS18B20_SCRATCHPAD_SIZE];
+    err = onewire_bus_read_bytes(bus, rx, sizeof(rx));
+    if (err != ESP_OK)
+        return err;
+
+    if (onewire_crc8(0, rx, DS18B20_SCRATCHPAD_SIZE - 1) != rx[DS18B20_SCRATCHPAD_SIZE - 1])
+        return ESP_ERR_INVALID_CRC;
+
+    // Un bus en corto lee todo en cero y el CRC de ceros también es cero: se validan los
+    // bits fijos del registro de configuración y el byte reservado
+    if ((rx[4] & DS18B20_CFG_FIXED_MASK) != DS18B20_CFG_FIXED || rx[5] != DS18B20_RESERVED_5)
+        return ESP_ERR_INVALID_RESPONSE;
+
+    pad->bits = AMBIENTAL_DS18B20_BITS_MIN + ((rx[4] >> 5) & 0x03);
+    // Con menos de 12 bits los bits bajos quedan indefinidos
+    uint16_t mask = (uint16_t)~((1u << (AMBIENTAL_DS18B20_BITS_MAX - pad->bits)) - 1u);
+    pad->raw = (int16_t)((((uint16_t)rx[1] << 8) | rx[0]) & mask);
+    pad->th = (int8_t)rx[2];
+    pad->tl = (int8_t)rx[3];
+    return ESP_OK;
+}
+
+esp_err_t ambiental_ds18b20_write(onewire_bus_handle_t bus, uint64_t addr, int8_t th, int8_t tl, uint8_t bits)
+{
+    if (bus == NULL || bits < AMBIENTAL_DS18B20_BITS_MIN || bits > AMBIENTAL_DS18B20_BITS_MAX)
+        return ESP_ERR_INVALID_ARG;
+
+    esp_err_t err = select_device(bus, addr, DS18B20_CMD_WRITE_SCRATCHPAD);
+    if (err != ESP_OK)
+        return err;
+
+    const uint8_t tx[] = {
+        (uint8_t)th,
+        (uint8_t)tl,
+        (uint8_t)(DS18B20_CFG_FIXED | ((bits - AMBIENTAL_DS18B20_BITS_MIN) << 5))
+    };
+    return onewire_bus_write_bytes(bus, tx, sizeof(tx));
+}
+
+esp_err_t ambiental_ds18b20_search(onewire_bus_handle_t bus, ambiental_ds18b20_search_t type,
+                                   uint64_t *ids, size_t max, size_t *count)
+{
+    if (bus == NULL || ids == NULL || count == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    const uint8_t cmd = (type == AMBIENTAL_DS18B20_SEARCH_ALARM) ? ONEWIRE_CMD_SEARCH_ALARM : ONEWIRE_CMD_SEARCH_NORMAL;
+    uint8_t rom[8] = { 0 };
+    int last_discrepancy = 0;
+    size_t passes = 0;
+    esp_err_t result = ESP_OK;
+
+    *count = 0;
+
+    do
+    {
+        // Cada pasada encuentra un ROM ID; con el bus en corto todo se lee en 0 y las
+        // pasadas no terminarían nunca
+        if (passes++ >= max)
+            return ESP_ERR_NO_MEM;
+
+        // Sin pulso de presencia no hay nadie en el bus
+        esp_err_t err = onewire_bus_reset(bus);
+        if (err == ESP_ERR_NOT_FOUND)
+            return result;
+        if (err != ESP_OK)
+            return err;
+
+        err = onewire_bus_write_bytes(bus, &cmd, 1);
+        if (err != ESP_OK)
+            return err;
+
+        int last_zero = 0;
+        for (int bit = 1; bit <= 64; bit++)
+        {
+            uint8_t id_bit, cmp_bit;
+            uint8_t mask = 1u << ((bit - 1) % 8);
+            uint8_t *byte = &rom[(bit - 1) / 8];
+
+            err = onewire_bus_read_bit(bus, &id_bit);
+            if (err == ESP_OK)
+                err = onewire_bus_read_bit(bus, &cmp_bit);
+            if (err != ESP_OK)
+                return err;
+
+            // Ambos en 1: nadie participa. En el primer bit es el final normal de una búsqueda
+            // de alarma sin sensores en alarma; más adelante, un dispositivo que se fue del bus
+            if (id_bit && cmp_bit)
+                return (bit == 1 && *count == 0) ? result : ESP_ERR_INVALID_RESPONSE;
+
+            uint8_t direction;
+            if (id_bit != cmp_bit)
+                direction = id_bit;
+            else if (bit < last_discrepancy)
+                direction = (*byte & mask) ? 1 : 0;
+            else
+                direction = (bit == last_discrepancy) ? 1 : 0;
+
+            if (id_bit == cmp_bit && direction == 0)
+                last_zero = bit;
+
+            if (direction)
+                *byte |= mask;
+            else
+                *byte &= ~mask;
+
+            err = onewire_bus_write_bit(bus, direction);
+            if (err != ESP_OK)
+                return err;
+        }
+        last_discrepancy = last_zero;
+
+        if (onewire_crc8(0, rom, 7) != rom[7])
+        {
+            result = ESP_ERR_INVALID_CRC;
+            continue;
+        }
+
+        uint64_t id = 0;
+        for (int i = 7; i >= 0; i--)
+            id = (id << 8) | rom[i];
+        ids[(*count)++] = id;
+    } while (last_discrepancy != 0);
+
+    return result;
+}
@@ -0,0 +1,93 @@
+#ifndef AMBIENTAL_DS18B20_PRIV_H
+#define AMBIENTAL_DS18B20_PRIV_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "onewire_bus.h"
+
+#define AMBIENTAL_DS18B20_FAMILY   0x28   // Código de familia del ROM ID (byte bajo)
+#define AMBIENTAL_DS18B20_BITS_MIN 9
+#define AMBIENTAL_DS18B20_BITS_MAX 12
+#define AMBIENTAL_DS18B20_TEMP_MIN -55   // Rango de medición, °C
+#define AMBIENTAL_DS18B20_TEMP_MAX 125
+
+/**
+ * @brief Tipo de búsqueda de ROM.
+ */
+typedef enum {
+    AMBIENTAL_DS18B20_SEARCH_ALL,    // Search ROM (F0h): todos los dispositivos
+    AMBIENTAL_DS18B20_SEARCH_ALARM   // Alarm Search (ECh): sólo los que tienen la bandera de alarma
+} ambiental_ds18b20_search_t;
+
+/**
+ * @brief Contenido útil del scratchpad de un DS18B20.
+ * @details La temperatura queda en dieciseisavos de grado, con los bits que no define la
+ *          resolución ya en cero.
+ */
+typedef struct {
+    int16_t raw;     // Temperatura, 1/16 °C
+    int8_t th;       // Registro TH (umbral alto de alarma, °C)
+    int8_t tl;       // Registro TL (umbral bajo de alarma, °C)
+    uint8_t bits;    // Resolución configurada, 9 a 12
+} ambiental_ds18b20_scratchpad_t;
+
+/**
+ * @brief Tiempo máximo de conversión según el datasheet (93.75 ms a 750 ms).
+ * @param bits Resolución, 9 a 12; fuera de rango se toma la de 12 bits.
+ * @return Tiempo en microsegundos.
+ */
+uint32_t ambiental_ds18b20_conversion_us(uint8_t bits);
+
+/**
+ * @brief Inicia la conversión de todos los sensores del bus (Skip ROM + CONVERT T).
+ * @details No espera: el resultado queda en el scratchpad de cada sensor una vez
+ *          transcurrido ambiental_ds18b20_conversion_us() de su resolución.
+ * @param bus Bus 1-Wire.
+ * @return ESP_OK, ESP_ERR_NOT_FOUND si nadie responde al reset, u otro error del bus.
+ */
+esp_err_t ambiental_ds18b20_convert_all(onewire_bus_handle_t bus);
+
+/**
+ * @brief Lee y valida el scratchpad de un sensor (Match ROM + READ SCRATCHPAD).
+ * @param bus Bus 1-Wire.
+ * @param addr ROM ID del sensor.
+ * @param pad Donde se copia el contenido.
+ * @return ESP_OK, ESP_ERR_INVALID_CRC si el CRC no coincide, ESP_ERR_INVALID_RESPONSE si los
+ *         bytes fijos no son los de un DS18B20 (bus en corto o sensor ausente), u otro error
+ *         del bus.
+ */
+esp_err_t ambiental_ds18b20_read(onewire_bus_handle_t bus, uint64_t addr, ambiental_ds18b20_scratchpad_t *pad);
+
+/**
+ * @brief Escribe TH, TL y la resolución de un sensor (Match ROM + WRITE SCRATCHPAD).
+ * @details Los valores quedan en RAM: rigen desde la próxima conversión y se pierden si el
+ *          sensor se queda sin alimentación.
+ * @param bus Bus 1-Wire.
+ * @param addr ROM ID del sensor.
+ * @param th Umbral alto de alarma, °C.
+ * @param tl Umbral bajo de alarma, °C.
+ * @param bits Resolución, 9 a 12.
+ * @return ESP_OK, ESP_ERR_INVALID_ARG o un error del bus.
+ */
+esp_err_t ambiental_ds18b20_write(onewire_bus_handle_t bus, uint64_t addr, int8_t th, int8_t tl, uint8_t bits);
+
+/**
+ * @brief Búsqueda de ROM del bus (algoritmo de la nota de aplicación 187 de Maxim).
+ * @details En la búsqueda de alarma sólo participan los DS18B20 cuya última conversión quedó
+ *          en o fuera de sus umbrales (parte entera de la temperatura >= TH o <= TL), así que
+ *          su duración depende de cuántos sensores están en alarma y no del largo del bus.
+ * @param bus Bus 1-Wire.
+ * @param type Búsqueda completa o de alarma.
+ * @param ids Donde se copian los ROM IDs encontrados (de cualquier familia).
+ * @param max Capacidad de ids.
+ * @param count Cantidad de ROM IDs copiados.
+ * @return ESP_OK si se recorrió todo el bus (count puede ser 0), ESP_ERR_INVALID_CRC si se
+ *         descartó algún ROM ID con CRC inválido, ESP_ERR_NO_MEM si había más de max, u otro
+ *         error del bus. Salvo ESP_OK, la lista puede estar incompleta.
+ */
+esp_err_t ambiental_ds18b20_search(onewire_bus_handle_t bus, ambiental_ds18b20_search_t type,
+                                   uint64_t *ids, size_t max, size_t *count);
+
+#endif // AMBIENTAL_DS18B20_PRIV_H
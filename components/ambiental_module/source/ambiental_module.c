@@ -1,76 +1,623 @@
+#include <ctype.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "esp_log.h"
 #include "esp_err.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "nvs.h"
 #include "onewire_bus.h"
-#include "ds18b20.h"
 
 #include "ambiental_module.h"
+#include "ambiental_ds18b20_priv.h"
 
-#define ONEWIRE_BUS_GPIO    20
-#define ONEWIRE_MAX_DS18B20 2
-#define TEMPERATURE_READ_INTERVAL_MS 60000
+#ifndef CONFIG_AMBIENTAL_READ_INTERVAL_MS
+#define CONFIG_AMBIENTAL_READ_INTERVAL_MS 60000
+#endif
+
+#ifndef CONFIG_AMBIENTAL_DS18B20_RESOLUTION
+#define CONFIG_AMBIENTAL_DS18B20_RESOLUTION 12
+#endif
+
+#ifndef CONFIG_AMBIENTAL_DS18B20_READ_RETRIES
+#define CONFIG_AMBIENTAL_DS18B20_READ_RETRIES 2
+#endif
+
+#ifndef CONFIG_AMBIENTAL_MAX_SENSORS
+#define CONFIG_AMBIENTAL_MAX_SENSORS 32
+#endif
+
+#ifndef CONFIG_AMBIENTAL_RESCAN_INTERVAL_MS
+#define CONFIG_AMBIENTAL_RESCAN_INTERVAL_MS 300000
+#endif
+
+#ifndef CONFIG_AMBIENTAL_ALARM_LOW_C
+#define CONFIG_AMBIENTAL_ALARM_LOW_C 0
+#endif
+
+#ifndef CONFIG_AMBIENTAL_ALARM_HIGH_C
+#define CONFIG_AMBIENTAL_ALARM_HIGH_C 50
+#endif
+
+#ifndef CONFIG_AMBIENTAL_ALARM_SEARCH
+#define CONFIG_AMBIENTAL_ALARM_SEARCH 0
+#endif
+
+#ifndef CONFIG_AMBIENTAL_SWEEP_INTERVAL_MS
+#define CONFIG_AMBIENTAL_SWEEP_INTERVAL_MS 600000
+#endif
+
+#ifndef CONFIG_AMBIENTAL_SENSOR_NAMES
+#define CONFIG_AMBIENTAL_SENSOR_NAMES "A079510087D31C28=External,9624300087EFEF28=Internal"
+#endif
+
+#define ONEWIRE_BUS_GPIO     20
+#define CONVERSION_MARGIN_MS 250   // si el timer no avisa, la conversión igual terminó
+#define RESCAN_MISSES        2     // búsquedas completas seguidas sin un sensor para darlo de baja
+#define SEARCH_MAX           (2 * CONFIG_AMBIENTAL_MAX_SENSORS)   // dispositivos por búsqueda
+#define NAMES_NVS_NAMESPACE  "amb_names"
+#define NAMES_NVS_KEY_SIZE   16    // 14 dígitos hex y el terminador
+
+_Static_assert(CONFIG_AMBIENTAL_ALARM_LOW_C < CONFIG_AMBIENTAL_ALARM_HIGH_C, "AMBIENTAL_ALARM_LOW_C must be below AMBIENTAL_ALARM_HIGH_C");
+
+/**
+ * @brief Slot del registro de sensores.
+ * @details id en 0 indica un slot libre. bits, th y tl son la configuración pedida; pending
+ *          indica que hay que escribirla, lo que hace la tarea antes de la próxima conversión.
+ *          applied es la resolución que tiene el sensor (0 mientras no se sabe). Si un
+ *          scratchpad leído no coincide con lo pedido (p.ej. el sensor se reinició con su
+ *          EEPROM), se vuelve a escribir. Sólo la tarea de lectura (y el arranque, antes de
+ *          crearla) ocupa o libera slots; el resto de las tareas cambia name, bits, th, tl y
+ *          pending bajo sensors_lock.
+ */
+typedef struct {
+    uint64_t id;
+    char name[AMBIENTAL_NAME_MAX];
+    uint8_t bits;
+    int8_t th;
+    int8_t tl;
+    bool pending;
+    bool alarm;
+    uint8_t applied;
+    uint8_t missed;
+} sensor_t;
 
 static onewire_bus_handle_t bus = NULL;
-static ds18b20_device_handle_t ds18b20s[ONEWIRE_MAX_DS18B20] = { NULL };
-static uint8_t ds18b20_device_num = 0;
+static sensor_t sensors[CONFIG_AMBIENTAL_MAX_SENSORS] = { 0 };
+static size_t sensors_count = 0;
+static portMUX_TYPE sensors_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint64_t search_ids[SEARCH_MAX];
+static TaskHandle_t read_task = NULL;
+static esp_timer_handle_t conversion_timer = NULL;
 
 static hookCallback_onTemperatureRead hookCallback = NULL;
-static ambiental_callback_data_t callback_data[ONEWIRE_MAX_DS18B20] = { 0 };
+static hookCallback_onSensorRemoved removedCallback = NULL;
 
 static const char *TAG = "ambiental_module";
 
+static void conversion_done(void *arg)
+{
+    xTaskNotifyGive(read_task);
+}
+
+// Sólo caracteres válidos en un nivel de tópico MQTT, sin comodines ni separadores
+static bool valid_name(const char *name)
+{
+    size_t len = strlen(name);
+    if (len == 0 || len >= AMBIENTAL_NAME_MAX)
+        return false;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        char c = name[i];
+        if (!isalnum((unsigned char)c) && c != '_' && c != '-' && c != '.')
+            return false;
+    }
+    return true;
+}
+
+// Los DS18B20 comparten el código de familia: la clave es el número de serie y el CRC
+static void names_key(uint64_t id, char key[NAMES_NVS_KEY_SIZE])
+{
+    snprintf(key, NAMES_NVS_KEY_SIZE, "%014llX", id >> 8);
+}
+
+// Lista "ROMID=Nombre,..." de CONFIG_AMBIENTAL_SENSOR_NAMES; sin entrada, el ROM ID en hex
+static void default_name(uint64_t id, char name[AMBIENTAL_NAME_MAX])
+{
+    const char *p = CONFIG_AMBIENTAL_SENSOR_NAMES;
+
+    while (*p != '\0')
+    {
+        size_t len = strcspn(p, ",");
+        char *end = NULL;
+        uint64_t entry = strtoull(p, &end, 16);
+
+        if (end > p && end < p + len && *end == '=' && entry == id)
+        {
+            size_t name_len = len - (size_t)(end + 1 - p);
+            if (name_len > 0 && name_len < AMBIENTAL_NAME_MAX)
+            {
+                memcpy(name, end + 1, name_len);
+                name[name_len] = '\0';
+                if (valid_name(name))
+                    return;
+            }
+            ESP_LOGW(TAG, "Ignoring default name of %016llX", id);
+        }
+
+        p += len;
+        if (*p == ',')
+            p++;
+    }
+
+    snprintf(name, AMBIENTAL_NAME_MAX, "%016llX", id);
+}
+
+static void lookup_name(uint64_t id, char name[AMBIENTAL_NAME_MAX])
+{
+    char key[NAMES_NVS_KEY_SIZE];
+    nvs_handle_t nvs;
+
+    names_key(id, key);
+    if (nvs_open(NAMES_NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK)
+    {
+        size_t len = AMBIENTAL_NAME_MAX;
+        esp_err_t err = nvs_get_str(nvs, key, name, &len);
+        nvs_close(nvs);
+        if (err == ESP_OK)
+            return;
+    }
+    default_name(id, name);
+}
+
+// Llamar con sensors_lock tomado (o desde la tarea de lectura, que es la que cambia los id)
+static int find_slot(uint64_t id)
+{
+    for (int i = 0; i < CONFIG_AMBIENTAL_MAX_SENSORS; i++)
+    {
+        if (sensors[i].id == id)
+            return i;
+    }
+    return -1;
+}
+
+static bool search_found(uint64_t id, size_t found)
+{
+    for (size_t i = 0; i < found; i++)
+    {
+        if (search_ids[i] == id)
+            return true;
+    }
+    return false;
+}
+
+// Búsqueda de ROM de todo el bus. Los DS18B20 nuevos toman un slot libre; los que faltan en
+// RESCAN_MISSES búsquedas completas seguidas se dan de baja. Una búsqueda interrumpida
+// (error del bus o de CRC) sólo agrega, para no dar de baja sensores por ruido
+static void registry_scan(void)
+{
+    size_t devices = 0;
+    size_t found = 0;
+
+    esp_err_t err = ambiental_ds18b20_search(bus, AMBIENTAL_DS18B20_SEARCH_ALL, search_ids, SEARCH_MAX, &devices);
+    bool complete = (err == ESP_OK);
+    if (!complete)
+        ESP_LOGW(TAG, "ROM search incomplete: %s", esp_err_to_name(err));
+
+    for (size_t n = 0; n < devices; n++)
+    {
+        if ((search_ids[n] & 0xFF) == AMBIENTAL_DS18B20_FAMILY)
+            search_ids[found++] = search_ids[n];
+        else
+            ESP_LOGD(TAG, "Ignoring 1-Wire device %016llX", search_ids[n]);
+    }
+
+    for (int i = 0; i < CONFIG_AMBIENTAL_MAX_SENSORS; i++)
+    {
+        uint64_t id = sensors[i].id;
+        if (id == 0)
+            continue;
+
+        if (search_found(id, found))
+        {
+            sensors[i].missed = 0;
+            continue;
+        }
+
+        if (!complete || ++sensors[i].missed < RESCAN_MISSES)
+            continue;
+
+        ambiental_callback_data_t data = { .sensor_id = id };
+
+        portENTER_CRITICAL(&sensors_lock);
+        memcpy(data.name, sensors[i].name, sizeof(data.name));
+        sensors[i].id = 0;
+        sensors_count--;
+        portEXIT_CRITICAL(&sensors_lock);
+        ESP_LOGW(TAG, "DS18B20 %016llX removed from the bus", id);
+
+        if (removedCallback != NULL)
+            removedCallback((void *)&data, sizeof(ambiental_callback_data_t));
+    }
+
+    for (size_t n = 0; n < found; n++)
+    {
+        uint64_t id = search_ids[n];
+        if (find_slot(id) >= 0)
+            continue;
+
+        int slot = find_slot(0);
+        if (slot < 0)
+        {
+            ESP_LOGW(TAG, "Sensor registry full, DS18B20 %016llX ignored", id);
+            continue;
+        }
+
+        sensor_t sensor = {
+            .id = id,
+            .bits = CONFIG_AMBIENTAL_DS18B20_RESOLUTION,
+            .th = CONFIG_AMBIENTAL_ALARM_HIGH_C,
+            .tl = CONFIG_AMBIENTAL_ALARM_LOW_C,
+            .pending = true
+        };
+        lookup_name(id, sensor.name);
+
+        portENTER_CRITICAL(&sensors_lock);
+        sensors[slot] = sensor;
+        sensors_count++;
+        portEXIT_CRITICAL(&sensors_lock);
+        ESP_LOGI(TAG, "DS18B20 %016llX added as \"%s\"", id, sensor.name);
+    }
+
+    ESP_LOGI(TAG, "ROM search done, %u DS18B20 on the bus, %u registered", (unsigned)found, (unsigned)sensors_count);
+}
+
+// La conversión dura lo que pide la mayor resolución del bus; una resolución desconocida
+// (sensor aún no leído) se toma como la de 12 bits
+static uint8_t conversion_bits(void)
+{
+    uint8_t bits = AMBIENTAL_DS18B20_BITS_MIN;
+
+    for (int i = 0; i < CONFIG_AMBIENTAL_MAX_SENSORS; i++)
+    {
+        if (sensors[i].id == 0)
+            continue;
+
+        uint8_t applied = sensors[i].applied ? sensors[i].applied : AMBIENTAL_DS18B20_BITS_MAX;
+        if (applied > bits)
+            bits = applied;
+    }
+    return bits;
+}
+
+// Resolución y umbrales nuevos (sensor recién registrado o cambio pedido); rigen desde la
+// próxima conversión. Un error deja la escritura pendiente para el ciclo siguiente
+static void write_pending(void)
+{
+    for (int i = 0; i < CONFIG_AMBIENTAL_MAX_SENSORS; i++)
+    {
+        if (sensors[i].id == 0 || !sensors[i].pending)
+            continue;
+
+        portENTER_CRITICAL(&sensors_lock);
+        uint8_t bits = sensors[i].bits;
+        int8_t th = sensors[i].th;
+        int8_t tl = sensors[i].tl;
+        sensors[i].pending = false;
+        portEXIT_CRITICAL(&sensors_lock);
+
+        esp_err_t err = ambiental_ds18b20_write(bus, sensors[i].id, th, tl, bits);
+        if (err == ESP_OK)
+        {
+            sensors[i].applied = bits;
+            ESP_LOGI(TAG, "DS18B20 %016llX set to %u bits, alarm below %d or above %d °C", sensors[i].id, bits, tl, th);
+        }
+        else
+        {
+            sensors[i].pending = true;
+            ESP_LOGE(TAG, "Failed to configure DS18B20 %016llX: %s", sensors[i].id, esp_err_to_name(err));
+        }
+    }
+}
+
+// El scratchpad conserva la última conversión hasta el próximo CONVERT T: un sensor con
+// error de CRC se vuelve a leer sin repetir la conversión del bus
+static void read_sensor(int slot, uint8_t waited_bits)
+{
+    ambiental_callback_data_t data = { 0 };
+    ambiental_ds18b20_scratchpad_t pad;
+    esp_err_t err;
+    int attempt = 0;
+
+    // El nombre se copia en cada muestra: el tópico sale del slot sin buscar el ROM ID
+    portENTER_CRITICAL(&sensors_lock);
+    data.sensor_id = sensors[slot].id;
+    memcpy(data.name, sensors[slot].name, sizeof(data.name));
+    uint8_t bits = sensors[slot].bits;
+    int8_t th = sensors[slot].th;
+    int8_t tl = sensors[slot].tl;
+    bool pending = sensors[slot].pending;
+    portEXIT_CRITICAL(&sensors_lock);
+
+    do
+    {
+        err = ambiental_ds18b20_read(bus, data.sensor_id, &pad);
+        if (err != ESP_OK)
+            ESP_LOGD(TAG, "Scratchpad of %016llX, attempt %d: %s", data.sensor_id, attempt + 1, esp_err_to_name(err));
+    } while (err != ESP_OK && attempt++ < CONFIG_AMBIENTAL_DS18B20_READ_RETRIES);
+
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to read temperature from DS18B20 %016llX: %s", data.sensor_id, esp_err_to_name(err));
+        return;
+    }
+
+    sensors[slot].applied = pad.bits;
+
+    // Un sensor que perdió la configuración se reescribe antes de la próxima conversión
+    if (!pending && (pad.bits != bits || pad.th != th || pad.tl != tl))
+    {
+        ESP_LOGW(TAG, "DS18B20 %016llX lost its configuration", data.sensor_id);
+        sensors[slot].pending = true;
+    }
+
+    // Un sensor que volvió a su resolución de EEPROM (p.ej. tras un corte) pudo no terminar
+    if (pad.bits > waited_bits)
+    {
+        ESP_LOGW(TAG, "DS18B20 %016llX converts at %u bits, reading discarded", data.sensor_id, pad.bits);
+        return;
+    }
+
+    // El sensor compara la parte entera (bits 11..4, redondeo hacia abajo) con sus umbrales
+    int integer = pad.raw >> 4;
+    data.temperature_celsius = pad.raw / 16.0f;
+    data.alarm = (integer >= pad.th || integer <= pad.tl);
+    sensors[slot].alarm = data.alarm;
+
+    ESP_LOGI(TAG, "Sensor %s (%016llX), Temperature: %.2f °C (%u bits)%s",
+             data.name, data.sensor_id, data.temperature_celsius, pad.bits, data.alarm ? ", ALARM" : "");
+
+    if (hookCallback != NULL)
+        hookCallback((void *)&data, sizeof(ambiental_callback_data_t));
+}
+
+// Búsqueda de alarma tras la conversión: se leen los sensores en alarma y los que lo estaban
+// en el ciclo anterior, para informar que volvieron a su banda. Si la búsqueda no recorre
+// todo el bus se leen todos
+static void read_alarmed(uint8_t bits)
+{
+    size_t found = 0;
+    esp_err_t err = ambiental_ds18b20_search(bus, AMBIENTAL_DS18B20_SEARCH_ALARM, search_ids, SEARCH_MAX, &found);
+
+    if (err != ESP_OK)
+        ESP_LOGW(TAG, "Alarm search incomplete (%s), reading every sensor", esp_err_to_name(err));
+    else
+        ESP_LOGD(TAG, "Alarm search: %u sensor(s) out of band", (unsigned)found);
+
+    for (int i = 0; i < CONFIG_AMBIENTAL_MAX_SENSORS; i++)
+    {
+        if (sensors[i].id != 0 && (err != ESP_OK || sensors[i].alarm || search_found(sensors[i].id, found)))
+            read_sensor(i, bits);
+    }
+}
+
+// Ciclo en dos fases: CONVERT T para todo el bus y un timer por el tiempo de conversión
+// de la resolución en uso; mientras tanto la tarea duerme y el bus queda libre. Después
+// se leen todos los sensores o, con CONFIG_AMBIENTAL_ALARM_SEARCH, sólo los que están fuera
+// de sus umbrales, con un barrido completo cada CONFIG_AMBIENTAL_SWEEP_INTERVAL_MS. Las
+// búsquedas de sensores agregados o quitados se hacen entre ciclos, en la misma tarea
 static void temperatureRead_task(void *arg)
 {
+    TickType_t last_wake = xTaskGetTickCount();
+    int64_t next_scan_us = esp_timer_get_time() + (int64_t)CONFIG_AMBIENTAL_RESCAN_INTERVAL_MS * 1000;
+    int64_t next_sweep_us = 0;
+
     while (1)
-    {   
-        esp_err_t err = ds18b20_trigger_temperature_conversion_for_all(bus);
+    {
+        if (CONFIG_AMBIENTAL_RESCAN_INTERVAL_MS > 0 && esp_timer_get_time() >= next_scan_us)
+        {
+            registry_scan();
+            next_scan_us = esp_timer_get_time() + (int64_t)CONFIG_AMBIENTAL_RESCAN_INTERVAL_MS * 1000;
+        }
+
+        if (sensors_count == 0)
+        {
+            vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(CONFIG_AMBIENTAL_READ_INTERVAL_MS));
+            continue;
+        }
+
+        write_pending();
+
+        uint8_t bits = conversion_bits();
+        uint32_t conversion_us = ambiental_ds18b20_conversion_us(bits);
+
+        (void)ulTaskNotifyTake(pdTRUE, 0);
+        esp_err_t err = ambiental_ds18b20_convert_all(bus);
 
         if (err == ESP_OK)
         {
-            for (uint8_t i = 0; i < ds18b20_device_num; i++)
-            {
-                float temperature;
-                if (ds18b20_get_temperature(ds18b20s[i], &temperature) == ESP_OK)
-                {
-                    // Prepare callback data
-                    ds18b20_get_device_address(ds18b20s[i], (onewire_device_address_t *)&callback_data[i].sensor_id);
-                    callback_data[i].temperature_celsius = temperature;
+            if (esp_timer_start_once(conversion_timer, conversion_us) != ESP_OK)
+                ESP_LOGW(TAG, "Failed to arm the conversion timer");
 
-                    ESP_LOGI(TAG, "Sensor ID: %016llX, Temperature: %.2f °C",
-                             callback_data[i].sensor_id,
-                             callback_data[i].temperature_celsius);
+            if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(conversion_us / 1000 + CONVERSION_MARGIN_MS)) == 0)
+                ESP_LOGW(TAG, "Conversion timer did not fire");
 
-                    // Invoke the registered callback
-                    if (hookCallback != NULL)
-                        hookCallback((void *)&callback_data[i], sizeof(ambiental_callback_data_t));
-                }
-                else
+            if (CONFIG_AMBIENTAL_ALARM_SEARCH && esp_timer_get_time() < next_sweep_us)
+            {
+                read_alarmed(bits);
+            }
+            else
+            {
+                for (int i = 0; i < CONFIG_AMBIENTAL_MAX_SENSORS; i++)
                 {
-                    ESP_LOGE(TAG, "Failed to read temperature from DS18B20[%d]", i);
+                    if (sensors[i].id != 0)
+                        read_sensor(i, bits);
                 }
+                next_sweep_us = esp_timer_get_time() + (int64_t)CONFIG_AMBIENTAL_SWEEP_INTERVAL_MS * 1000;
             }
         }
         else
         {
-            ESP_LOGE(TAG, "Failed to trigger temperature conversion for all DS18B20 sensors");
+            ESP_LOGE(TAG, "Failed to trigger temperature conversion for all DS18B20 sensors: %s", esp_err_to_name(err));
         }
 
-        vTaskDelay(pdMS_TO_TICKS(TEMPERATURE_READ_INTERVAL_MS));
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(CONFIG_AMBIENTAL_READ_INTERVAL_MS));
     }
 }
 
+esp_err_t ambiental_set_resolution(uint64_t sensor_id, uint8_t bits)
+{
+    if (sensor_id == 0 || bits < AMBIENTAL_DS18B20_BITS_MIN || bits > AMBIENTAL_DS18B20_BITS_MAX)
+        return ESP_ERR_INVALID_ARG;
+
+    // La escritura al sensor la hace la tarea de lectura, dueña del bus
+    portENTER_CRITICAL(&sensors_lock);
+    int slot = find_slot(sensor_id);
+    if (slot >= 0)
+    {
+        sensors[slot].bits = bits;
+        sensors[slot].pending = true;
+    }
+    portEXIT_CRITICAL(&sensors_lock);
+
+    return slot >= 0 ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t ambiental_get_resolution(uint64_t sensor_id, uint8_t *bits)
+{
+    if (sensor_id == 0 || bits == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    portENTER_CRITICAL(&sensors_lock);
+    int slot = find_slot(sensor_id);
+    if (slot >= 0)
+        *bits = sensors[slot].bits;
+    portEXIT_CRITICAL(&sensors_lock);
+
+    return slot >= 0 ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t ambiental_set_alarm_thresholds(uint64_t sensor_id, int8_t low_c, int8_t high_c)
+{
+    if (sensor_id == 0 || low_c >= high_c || low_c < AMBIENTAL_DS18B20_TEMP_MIN || high_c > AMBIENTAL_DS18B20_TEMP_MAX)
+        return ESP_ERR_INVALID_ARG;
+
+    portENTER_CRITICAL(&sensors_lock);
+    int slot = find_slot(sensor_id);
+    if (slot >= 0)
+    {
+        sensors[slot].tl = low_c;
+        sensors[slot].th = high_c;
+        sensors[slot].pending = true;
+    }
+    portEXIT_CRITICAL(&sensors_lock);
+
+    return slot >= 0 ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t ambiental_set_sensor_name(uint64_t sensor_id, const char *name)
+{
+    bool clear = (name == NULL || name[0] == '\0');
+
+    if ((sensor_id & 0xFF) != AMBIENTAL_DS18B20_FAMILY || (!clear && !valid_name(name)))
+        return ESP_ERR_INVALID_ARG;
+
+    char key[NAMES_NVS_KEY_SIZE];
+    nvs_handle_t nvs;
+
+    names_key(sensor_id, key);
+    esp_err_t err = nvs_open(NAMES_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK)
+        return err;
+
+    if (clear)
+    {
+        err = nvs_erase_key(nvs, key);
+        if (err == ESP_ERR_NVS_NOT_FOUND)
+            err = ESP_OK;
+    }
+    else
+    {
+        err = nvs_set_str(nvs, key, name);
+    }
+
+    if (err == ESP_OK)
+        err = nvs_commit(nvs);
+    nvs_close(nvs);
+
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to store the name of %016llX: %s", sensor_id, esp_err_to_name(err));
+        return err;
+    }
+
+    // Un sensor presente toma el nombre en la próxima muestra; uno ausente, cuando aparezca
+    char resolved[AMBIENTAL_NAME_MAX];
+    if (clear)
+        default_name(sensor_id, resolved);
+    else
+        snprintf(resolved, sizeof(resolved), "%s", name);
+
+    portENTER_CRITICAL(&sensors_lock);
+    int slot = find_slot(sensor_id);
+    if (slot >= 0)
+        memcpy(sensors[slot].name, resolved, sizeof(resolved));
+    portEXIT_CRITICAL(&sensors_lock);
+
+    ESP_LOGI(TAG, "DS18B20 %016llX named \"%s\"", sensor_id, resolved);
+    return ESP_OK;
+}
+
+size_t ambiental_sensors_count(void)
+{
+    return sensors_count;
+}
+
+esp_err_t ambiental_sensor_get(size_t index, ambiental_sensor_info_t *info)
+{
+    if (info == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    esp_err_t err = ESP_ERR_INVALID_ARG;
+
+    portENTER_CRITICAL(&sensors_lock);
+    for (int i = 0; i < CONFIG_AMBIENTAL_MAX_SENSORS; i++)
+    {
+        if (sensors[i].id == 0 || index-- > 0)
+            continue;
+
+        info->sensor_id = sensors[i].id;
+        memcpy(info->name, sensors[i].name, sizeof(info->name));
+        info->bits = sensors[i].bits;
+        info->alarm_low = sensors[i].tl;
+        info->alarm_high = sensors[i].th;
+        info->alarm = sensors[i].alarm;
+        err = ESP_OK;
+        break;
+    }
+    portEXIT_CRITICAL(&sensors_lock);
+
+    return err;
+}
+
 void ambiental_set_hookCallback_onTemperatureRead(hookCallback_onTemperatureRead cb)
 {
     hookCallback = cb;
 }
 
+void ambiental_set_hookCallback_onSensorRemoved(hookCallback_onSensorRemoved cb)
+{
+    removedCallback = cb;
+}
+
 esp_err_t ambiental_module_start(void)
 {
      // install 1-wire bus
-    
+
     onewire_bus_config_t bus_config = {
         .bus_gpio_num = ONEWIRE_BUS_GPIO,
         .flags = {
@@ -80,7 +627,7 @@ esp_err_t ambiental_module_start(void)
     onewire_bus_rmt_config_t rmt_config = {
         .max_rx_bytes = 10, // 1byte ROM command + 8byte ROM number + 1byte device command
     };
-    
+
     if (onewire_new_bus_rmt(&bus_config, &rmt_config, &bus) != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to install 1-Wire bus");
@@ -88,53 +635,25 @@ esp_err_t ambiental_module_start(void)
     }
 
     ESP_LOGI(TAG, "1-Wire bus installed on GPIO%d", ONEWIRE_BUS_GPIO);
-    
-    // search for DS18B20 devices on the bus   
-    
-    onewire_device_iter_handle_t iter = NULL;
-    onewire_device_t next_onewire_device;
-    esp_err_t search_result = ESP_OK;
-    onewire_device_address_t address;
-
-    // create 1-wire device iterator, which is used for device search
-    ESP_ERROR_CHECK(onewire_new_device_iter(bus, &iter));
-    ESP_LOGI(TAG, "Device iterator created, start searching...");
-
-    while (search_result != ESP_ERR_NOT_FOUND) 
-    {
-        search_result = onewire_device_iter_get_next(iter, &next_onewire_device);
-        if (search_result == ESP_OK) 
-        { // found a new device, let's check if we can upgrade it to a DS18B20
-            ds18b20_config_t ds_cfg = {};
-            // check if the device is a DS18B20, if so, return the ds18b20 handle
-            if (ds18b20_new_device_from_enumeration(&next_onewire_device, &ds_cfg, &ds18b20s[ds18b20_device_num]) == ESP_OK)
-            {
-                ds18b20_get_device_address(ds18b20s[ds18b20_device_num], &address);
-                ESP_LOGI(TAG, "Found a DS18B20[%d], address: %016llX", ds18b20_device_num, address);
-                ds18b20_device_num++;
-                if (ds18b20_device_num >= ONEWIRE_MAX_DS18B20)
-                {
-                    ESP_LOGI(TAG, "Max DS18B20 number reached, stop searching...");
-                    break;
-                }
-            } 
-            else 
-            {
-                ESP_LOGI(TAG, "Found an unknown device, address: %016llX", next_onewire_device.address);
-            }
-        }
-    } 
 
-    ESP_ERROR_CHECK(onewire_del_device_iter(iter));
-    ESP_LOGI(TAG, "Searching done, %d DS18B20 device(s) found", ds18b20_device_num);
+    // Primera búsqueda; las siguientes las hace la tarea cada CONFIG_AMBIENTAL_RESCAN_INTERVAL_MS
+    registry_scan();
+
+    if (sensors_count == 0)
+        ESP_LOGW(TAG, "No DS18B20 device found on the bus yet");
 
-    if(ds18b20_device_num == 0) 
+    const esp_timer_create_args_t timer_args = {
+        .callback = conversion_done,
+        .name = "ds18b20_conv"
+    };
+
+    if (esp_timer_create(&timer_args, &conversion_timer) != ESP_OK)
     {
-        ESP_LOGW(TAG, "No DS18B20 device found on the bus");
-        return ESP_ERR_NOT_FOUND;
+        ESP_LOGE(TAG, "Failed to create the conversion timer");
+        return ESP_FAIL;
     }
 
-    BaseType_t ok = xTaskCreate(temperatureRead_task, TAG, 6144, NULL, tskIDLE_PRIORITY + 1, NULL);
+    BaseType_t ok = xTaskCreate(temperatureRead_task, TAG, 6144, NULL, tskIDLE_PRIORITY + 1, &read_task);
 
     if(ok != pdPASS)
     {
@@ -142,5 +661,5 @@ esp_err_t ambiental_module_start(void)
         return ESP_FAIL;
     }
 
-    return ESP_OK;   
+    return ESP_OK;
 }
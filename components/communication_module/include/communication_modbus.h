@@ -0,0 +1,101 @@
+#ifndef COMMUNICATION_MODBUS_H
+#define COMMUNICATION_MODBUS_H
+
+/**
+ * @file communication_modbus.h
+ * @brief Local Modbus TCP server with the station measurements.
+ * @details The server listens on the Ethernet interface and answers from a register map kept
+ *          in RAM. The sampling paths write their values into the map as they produce them, so
+ *          a poll is served from memory without any MQTT round-trip. The same map is readable
+ *          as input registers (function 4) and as read-only holding registers (function 3).
+ *
+ *          32-bit values take two registers, high word first. Every section has a counter
+ *          that grows with each update, so a poller can tell fresh data from a stalled source.
+ *
+ *          | Register          | Content                                                     |
+ *          |-------------------|-------------------------------------------------------------|
+ *          | 0                 | Map version (COMMUNICATION_MODBUS_MAP_VERSION)              |
+ *          | 1, 2, 3           | Update counters: energy, temperature, security              |
+ *          | 10                | Security state (SEC_MONITORING_STATE ... SEC_NORMAL_STATE)  |
+ *          | 11                | Last security event (INTRUSION_DETECTED_EVENT ...)          |
+ *          | 12, 13            | Siren, lights (0 off, 1 on)                                 |
+ *          | 20, 22, 24        | DC voltage (mV), current (mA), power (mW), signed           |
+ *          | 26                | Zigbee device state                                         |
+ *          | 27                | Number of AC meters                                         |
+ *          | 100 + 16 m        | AC meter m (up to ENERGY_AC_MAX_METERS):                    |
+ *          |                   | +0 address, +1 valid, +2 voltage (mV), +4 current (mA),     |
+ *          |                   | +6 power (mW), +8 frequency (mHz), +10 power factor (x1000) |
+ *          |                   | +11 power alarm (0/1), +12 energy (Wh)                      |
+ *          | 300 + 8 t         | Temperature sensor t (up to CONFIG_AMBIENTAL_MAX_SENSORS,   |
+ *          |                   | at most 64): +0..3 sensor ROM ID (high word first),         |
+ *          |                   | +4 valid, +5 temperature (0.01 °C, signed), +6 alarm (0/1)  |
+ *          | 812 + 4 p         | Modbus point p (up to ENERGY_MAX_POINTS):                   |
+ *          |                   | +0 scaled value (signed), +2 valid                          |
+ *
+ *          A temperature sensor takes the first free slot the first time it reports and keeps
+ *          it until the ambiental module drops it from its registry; the slot is then cleared
+ *          (valid and ROM ID read 0) and free for the next new sensor.
+ *
+ * @author Roberto Axt
+ * @version 1.0
+ * @date 2025-11-21
+ *
+ * @par License
+ * This file is part of the SMEM-MP project and is licensed under the MIT License.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "energy_module.h"
+
+#define COMMUNICATION_MODBUS_MAP_VERSION 2
+
+/**
+ * @brief Start the Modbus TCP server on the Ethernet interface.
+ * @details The network must be up. Does nothing if CONFIG_COMMUNICATION_MODBUS_TCP is off.
+ * @return esp_err_t Returns ESP_OK on success, or an error code on failure.
+ */
+esp_err_t communication_modbus_start(void);
+
+/**
+ * @brief Write an energy reading into the register map.
+ * @param data Energy data of the last read cycle.
+ */
+void communication_modbus_energy_update(const energy_data_t *data);
+
+/**
+ * @brief Write a temperature reading into the register map.
+ * @param sensor_id ROM ID of the sensor.
+ * @param celsius Temperature in degrees Celsius.
+ * @param alarm Temperature at or beyond an alarm threshold of the sensor.
+ */
+void communication_modbus_temperature_update(uint64_t sensor_id, float celsius, bool alarm);
+
+/**
+ * @brief Clear the register slot of a temperature sensor and free it.
+ * @param sensor_id ROM ID of the sensor dropped from the registry.
+ */
+void communication_modbus_temperature_remove(uint64_t sensor_id);
+
+/**
+ * @brief Write a security event and the resulting state into the register map.
+ * @param event Security event (INTRUSION_DETECTED_EVENT ...).
+ * @param state State after the event (SEC_MONITORING_STATE ...).
+ */
+void communication_modbus_security_update(uint16_t event, uint16_t state);
+
+/**
+ * @brief Write the state of the siren into the register map.
+ * @param on true if the siren is on.
+ */
+void communication_modbus_siren_update(bool on);
+
+/**
+ * @brief Write the state of the lights into the register map.
+ * @param on true if the lights are on.
+ */
+void communication_modbus_lights_update(bool on);
+
+#endif // COMMUNICATION_MODBUS_H
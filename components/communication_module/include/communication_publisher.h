@@ -39,4 +39,28 @@ esp_err_t communication_siren_status_publish(const char* status);
  */
 esp_err_t communication_lights_status_publish(const char* status);
 
+/**
+ * @brief Publish the result of a tag list command.
+ * @details This function publishes the tag list status to the appropriate MQTT topic.
+ * @param status A string representing the command result.
+ * @return esp_err_t Returns ESP_OK on success, or an error code on failure.
+ */
+esp_err_t communication_tags_status_publish(const char* status);
+
+/**
+ * @brief Publish the result of a DC calibration command.
+ * @details This function publishes the calibration status to the appropriate MQTT topic.
+ * @param status A string representing the calibration result.
+ * @return esp_err_t Returns ESP_OK on success, or an error code on failure.
+ */
+esp_err_t communication_calibration_status_publish(const char* status);
+
+/**
+ * @brief Publish the result of a temperature sensor command.
+ * @details This function publishes the sensors status to the appropriate MQTT topic.
+ * @param status A string representing the command result.
+ * @return esp_err_t Returns ESP_OK on success, or an error code on failure.
+ */
+esp_err_t communication_sensors_status_publish(const char* status);
+
 #endif // COMMUNICATION_PUBLISHER_H
\ No newline at end of file
@@ -0,0 +1,315 @@
+#include <math.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "mbcontroller.h"
+
+#include "net_driver.h"
+#include "communication_modbus.h"
+
+#ifndef CONFIG_COMMUNICATION_MODBUS_TCP_PORT
+#define CONFIG_COMMUNICATION_MODBUS_TCP_PORT 502
+#endif
+
+#ifndef CONFIG_COMMUNICATION_MODBUS_TCP_UID
+#define CONFIG_COMMUNICATION_MODBUS_TCP_UID 1
+#endif
+
+#ifndef CONFIG_AMBIENTAL_MAX_SENSORS
+#define CONFIG_AMBIENTAL_MAX_SENSORS 32
+#endif
+
+// Mapa de registros, ver communication_modbus.h
+#define REG_VERSION          0
+#define REG_ENERGY_COUNT     1
+#define REG_TEMP_COUNT       2
+#define REG_SECURITY_COUNT   3
+#define REG_SEC_STATE        10
+#define REG_SEC_EVENT        11
+#define REG_SIREN            12
+#define REG_LIGHTS           13
+#define REG_DC_VOLTAGE       20
+#define REG_DC_CURRENT       22
+#define REG_DC_POWER         24
+#define REG_ZIGBEE_STATE     26
+#define REG_AC_COUNT         27
+#define REG_AC_BASE          100
+#define REG_AC_STRIDE        16
+#define REG_TEMP_BASE        300
+#define REG_TEMP_STRIDE      8
+#define REG_TEMP_SLOTS_MAX   64    // máximo de CONFIG_AMBIENTAL_MAX_SENSORS: el mapa no cambia con la configuración
+#define REG_POINT_BASE       (REG_TEMP_BASE + REG_TEMP_STRIDE * REG_TEMP_SLOTS_MAX)
+#define REG_POINT_STRIDE     4
+#define MAP_SIZE             (REG_POINT_BASE + REG_POINT_STRIDE * ENERGY_MAX_POINTS)
+
+_Static_assert(REG_AC_BASE + REG_AC_STRIDE * ENERGY_AC_MAX_METERS <= REG_TEMP_BASE, "AC meters overlap the temperatures");
+_Static_assert(CONFIG_AMBIENTAL_MAX_SENSORS <= REG_TEMP_SLOTS_MAX, "Temperatures overlap the points");
+
+#define SERVER_TASK_STACK    2560
+#define SERVER_TASK_PRIO     3
+#define SERVER_EVENT_WAIT_MS 1000
+
+static const char *TAG = "communication_modbus";
+
+static uint16_t map[MAP_SIZE] = { [REG_VERSION] = COMMUNICATION_MODBUS_MAP_VERSION };
+static uint64_t sensor_ids[CONFIG_AMBIENTAL_MAX_SENSORS] = {0};
+static void *slave_handle = NULL;
+
+// Antes de arrancar el servidor nadie más lee el mapa; después se usa el lock del stack, el
+// mismo que toma para copiar los registros a la respuesta
+static void map_lock(void)
+{
+    if (slave_handle != NULL)
+        (void)mbc_slave_lock(slave_handle);
+}
+
+static void map_unlock(void)
+{
+    if (slave_handle != NULL)
+        (void)mbc_slave_unlock(slave_handle);
+}
+
+static void put_u32(uint16_t reg, uint32_t value)
+{
+    map[reg] = (uint16_t)(value >> 16);
+    map[reg + 1] = (uint16_t)value;
+}
+
+static int32_t scaled(float value, float scale)
+{
+    float v = roundf(value * scale);
+    if (v >= 2147483647.0f) return INT32_MAX;
+    if (v <= -2147483648.0f) return INT32_MIN;
+    return (int32_t)v;
+}
+
+// El stack avisa cada acceso por una cola; si nadie la vacía, cada consulta espera a que
+// venza el envío. La tarea sólo la drena y deja el detalle en el log de depuración
+static void server_task(void *arg)
+{
+    mb_param_info_t info;
+
+    while (1)
+    {
+        if (mbc_slave_get_param_info(slave_handle, &info, SERVER_EVENT_WAIT_MS) == ESP_OK)
+            ESP_LOGD(TAG, "Read of %u registers at %u", (unsigned)info.size, (unsigned)info.mb_offset);
+    }
+}
+
+esp_err_t communication_modbus_start(void)
+{
+#if CONFIG_COMMUNICATION_MODBUS_TCP
+    esp_netif_t *netif = eth_net_netif();
+    if (netif == NULL)
+    {
+        ESP_LOGE(TAG, "Ethernet interface not started");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    mb_communication_info_t comm_info = {
+        .tcp_opts.mode = MB_TCP,
+        .tcp_opts.port = CONFIG_COMMUNICATION_MODBUS_TCP_PORT,
+        .tcp_opts.uid = CONFIG_COMMUNICATION_MODBUS_TCP_UID,
+        .tcp_opts.addr_type = MB_IPV4,
+        .tcp_opts.ip_addr_table = NULL,   // cualquier dirección de la interfaz
+        .tcp_opts.ip_netif_ptr = (void *)netif
+    };
+
+    void *handle = NULL;
+    esp_err_t err = mbc_slave_create_tcp(&comm_info, &handle);
+    if (err != ESP_OK || handle == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to create Modbus TCP server: %s", esp_err_to_name(err));
+        return err != ESP_OK ? err : ESP_ERR_INVALID_STATE;
+    }
+
+    // El mismo mapa se lee con la función 4 (input) y con la 3 (holding, sólo lectura)
+    const mb_param_type_t types[] = { MB_PARAM_INPUT, MB_PARAM_HOLDING };
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); ++i)
+    {
+        mb_register_area_descriptor_t area = {
+            .start_offset = 0,
+            .type = types[i],
+            .access = MB_ACCESS_RO,
+            .address = (void *)map,
+            .size = sizeof(map)
+        };
+
+        err = mbc_slave_set_descriptor(handle, area);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to set the register map: %s", esp_err_to_name(err));
+            mbc_slave_delete(handle);
+            return err;
+        }
+    }
+
+    err = mbc_slave_start(handle);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to start Modbus TCP server: %s", esp_err_to_name(err));
+        mbc_slave_delete(handle);
+        return err;
+    }
+
+    slave_handle = handle;
+
+    if (xTaskCreate(server_task, TAG, SERVER_TASK_STACK, NULL, SERVER_TASK_PRIO, NULL) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create Modbus TCP server task");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Modbus TCP server listening on port %d, %u registers", CONFIG_COMMUNICATION_MODBUS_TCP_PORT,
+             (unsigned)MAP_SIZE);
+#else
+    ESP_LOGI(TAG, "Modbus TCP server disabled");
+#endif
+    return ESP_OK;
+}
+
+void communication_modbus_energy_update(const energy_data_t *data)
+{
+    if (data == NULL)
+        return;
+
+    map_lock();
+
+    for (uint8_t i = 0; i < ENERGY_AC_MAX_METERS; ++i)
+    {
+        uint16_t reg = REG_AC_BASE + REG_AC_STRIDE * i;
+        const energy_ac_data_t *ac = &data->ac[i];
+
+        if (i >= data->ac_count)
+        {
+            memset(&map[reg], 0, REG_AC_STRIDE * sizeof(map[0]));
+            continue;
+        }
+
+        map[reg] = ac->address;
+        map[reg + 1] = ac->valid;
+        // Un medidor que no responde conserva sus últimos valores, marcados como no válidos
+        if (ac->valid)
+        {
+            put_u32(reg + 2, (uint32_t)scaled(ac->voltage, 1000.0f));
+            put_u32(reg + 4, (uint32_t)scaled(ac->current, 1000.0f));
+            put_u32(reg + 6, (uint32_t)scaled(ac->power, 1000.0f));
+            put_u32(reg + 8, (uint32_t)scaled(ac->frequency, 1000.0f));
+            map[reg + 10] = (uint16_t)scaled(ac->power_factor, 1000.0f);
+            map[reg + 11] = ac->alarm;
+            put_u32(reg + 12, (uint32_t)scaled(ac->energy, 1.0f));
+        }
+    }
+
+    for (uint8_t i = 0; i < ENERGY_MAX_POINTS; ++i)
+    {
+        uint16_t reg = REG_POINT_BASE + REG_POINT_STRIDE * i;
+        const energy_point_t *point = &data->points[i];
+
+        if (i >= data->point_count)
+        {
+            memset(&map[reg], 0, REG_POINT_STRIDE * sizeof(map[0]));
+            continue;
+        }
+
+        map[reg + 2] = point->valid;
+        if (point->valid)
+            put_u32(reg, (uint32_t)point->value);
+    }
+
+    put_u32(REG_DC_VOLTAGE, (uint32_t)scaled(data->dc_voltage, 1000.0f));
+    put_u32(REG_DC_CURRENT, (uint32_t)scaled(data->dc_current, 1000.0f));
+    put_u32(REG_DC_POWER, (uint32_t)scaled(data->dc_power, 1000.0f));
+    map[REG_ZIGBEE_STATE] = data->zigbee_device_state;
+    map[REG_AC_COUNT] = data->ac_count;
+    ++map[REG_ENERGY_COUNT];
+
+    map_unlock();
+}
+
+// Con slots liberados puede haber uno libre antes del propio: se busca primero el ROM ID
+static int find_sensor_slot(uint64_t sensor_id)
+{
+    for (int i = 0; i < CONFIG_AMBIENTAL_MAX_SENSORS; ++i)
+    {
+        if (sensor_ids[i] == sensor_id)
+            return i;
+    }
+    return -1;
+}
+
+void communication_modbus_temperature_update(uint64_t sensor_id, float celsius, bool alarm)
+{
+    if (sensor_id == 0)
+        return;
+
+    map_lock();
+
+    int slot = find_sensor_slot(sensor_id);
+    if (slot < 0)
+        slot = find_sensor_slot(0);
+
+    if (slot >= 0)
+    {
+        uint16_t reg = REG_TEMP_BASE + REG_TEMP_STRIDE * slot;
+
+        sensor_ids[slot] = sensor_id;
+        put_u32(reg, (uint32_t)(sensor_id >> 32));
+        put_u32(reg + 2, (uint32_t)sensor_id);
+        map[reg + 4] = 1;
+        map[reg + 5] = (uint16_t)(int16_t)scaled(celsius, 100.0f);
+        map[reg + 6] = alarm;
+        ++map[REG_TEMP_COUNT];
+    }
+
+    map_unlock();
+
+    if (slot < 0)
+        ESP_LOGW(TAG, "No register slot for sensor %016llX", sensor_id);
+}
+
+void communication_modbus_temperature_remove(uint64_t sensor_id)
+{
+    if (sensor_id == 0)
+        return;
+
+    map_lock();
+
+    int slot = find_sensor_slot(sensor_id);
+    if (slot >= 0)
+    {
+        sensor_ids[slot] = 0;
+        memset(&map[REG_TEMP_BASE + REG_TEMP_STRIDE * slot], 0, REG_TEMP_STRIDE * sizeof(map[0]));
+        ++map[REG_TEMP_COUNT];
+    }
+
+    map_unlock();
+}
+
+void communication_modbus_security_update(uint16_t event, uint16_t state)
+{
+    map_lock();
+    map[REG_SEC_EVENT] = event;
+    map[REG_SEC_STATE] = state;
+    ++map[REG_SECURITY_COUNT];
+    map_unlock();
+}
+
+void communication_modbus_siren_update(bool on)
+{
+    map_lock();
+    map[REG_SIREN] = on;
+    ++map[REG_SECURITY_COUNT];
+    map_unlock();
+}
+
+void communication_modbus_lights_update(bool on)
+{
+    map_lock();
+    map[REG_LIGHTS] = on;
+    ++map[REG_SECURITY_COUNT];
+    map_unlock();
+}
@@ -6,6 +6,7 @@
 #include "communication_module.h"
 #include "communication_suscriber.h"
 #include "communication_publisher.h"
+#include "communication_modbus.h"
 
 const char MQTT_BASE_TOPIC[MQTT_BASE_TOPIC_SIZE] = "TGN/Ferreyra/Comunicaciones/EMyR/N2440/";
 
@@ -31,6 +32,13 @@ esp_err_t communication_module_start(esp_ip4_addr_t ip, esp_ip4_addr_t gw, esp_i
         return ret;
     }
 
+    // El servidor Modbus no depende del broker: si falla, MQTT sigue funcionando
+    ret = communication_modbus_start();
+    if (ret != ESP_OK) 
+    {
+        ESP_LOGE(TAG, "Failed to start Modbus TCP server: %s", esp_err_to_name(ret));
+    }
+
     ret = sntp_client_start(ntp);
     if (ret != ESP_OK) 
     {
@@ -13,6 +13,7 @@
 #include "energy_module.h"
 #include "communication_module.h"
 #include "communication_suscriber.h"
+#include "communication_modbus.h"
 #include "mqtt_driver.h"
 #include "sntp_driver.h"
 
@@ -21,24 +22,32 @@ static const char *TAG = "communication_publisher";
 static const char *ALARM_STATUS_TOPIC  = "SECURITY/STATUS";
 static const char *SIREN_STATUS_TOPIC  = "SECURITY/Siren";
 static const char *LIGHTS_STATUS_TOPIC = "SECURITY/Lights";
+static const char *TAGS_STATUS_TOPIC   = "SECURITY/STATUS/Tags";
 
 static const char *ALARM_JSON_PAYLOAD  = "{\"TimeStamp\":\"%s\",\"Status\":\"%s\",\"State\":\"%s\"}";
 static const char *STATUS_JSON_PAYLOAD = "{\"TimeStamp\":\"%s\",\"Status\":\"%s\"}";
 
-static const char *AMBIENTAL_EXTERNAL_TOPIC = "AMBIENTAL/Temperature/External";
-static const char *AMBIENTAL_INTERNAL_TOPIC = "AMBIENTAL/Temperature/Internal";
+static const char *AMBIENTAL_TEMPERATURE_TOPIC = "AMBIENTAL/Temperature/";
+static const char *AMBIENTAL_ALARM_TOPIC = "AMBIENTAL/Alarm/";
+static const char *AMBIENTAL_SENSORS_STATUS_TOPIC = "AMBIENTAL/STATUS/Sensors";
 static const char *TEMPERATURE_JSON_PAYLOAD = "{\"TimeStamp\":\"%s\",\"SensorID\":\"%016llX\",\"Value\":%.2f,\"Unit\":\"°C\"}";
 
-static const char *VOLTAGE_AC_TOPIC = "ENERGY/AC/Voltage";
-static const char *CURRENT_AC_TOPIC = "ENERGY/AC/Current";
-static const char *POWER_AC_TOPIC = "ENERGY/AC/Power";
-static const char *FREQUENCY_AC_TOPIC = "ENERGY/AC/Frequency";
-static const char *POWERFACTOR_AC_TOPIC = "ENERGY/AC/PowerFactor";
+static const char *AC_TOPIC_PREFIX = "ENERGY/AC/";
+static const char *VOLTAGE_AC_TOPIC = "Voltage";
+static const char *CURRENT_AC_TOPIC = "Current";
+static const char *POWER_AC_TOPIC = "Power";
+static const char *FREQUENCY_AC_TOPIC = "Frequency";
+static const char *POWERFACTOR_AC_TOPIC = "PowerFactor";
+static const char *ENERGY_AC_TOPIC = "Energy";
+static const char *ALARM_AC_TOPIC = "Alarm";
 static const char *VOLTAGE_DC_TOPIC = "ENERGY/DC/Voltage";
 static const char *CURRENT_DC_TOPIC = "ENERGY/DC/Current";
 static const char *POWER_DC_TOPIC = "ENERGY/DC/Power";
 static const char *VALUE_PAYLOAD = "{\"TimeStamp\":\"%s\",\"Value\":%.2f,\"Unit\":\"%s\"}";
+static const char *POINTS_TOPIC_PREFIX = "ENERGY/POINTS/";
+static const char *POINT_PAYLOAD = "{\"TimeStamp\":\"%s\",\"Value\":%ld,\"Unit\":\"%s\"}";
 
+static const char *ENERGY_CALIBRATION_STATUS_TOPIC = "ENERGY/STATUS/Calibration";
 static const char *ENERGY_PROVIDER_STATUS_TOPIC = "ENERGY/STATUS/Provider";
 static const char *ENERGY_PROTECTION_STATUS_TOPIC = "ENERGY/STATUS/Protection";
 static const char *ENERGY_TAMPERING_STATUS_TOPIC = "ENERGY/STATUS/Tampering";
@@ -46,9 +55,6 @@ static const char *ENERGY_STATUS_NORMAL = "NORMAL";
 static const char *ENERGY_STATUS_FAULT = "FAULT";
 static const char *ENERGY_STATUS_TAMPERED = "TAMPERED";
 
-static const uint64_t EXTERNAL = 0xA079510087D31C28;
-static const uint64_t INTERNAL = 0x9624300087EFEF28;
-
 static esp_err_t publish_generic_event(const char *subTopic, const char *paylaodFormat, const char *status, const char *state)
 {
     char topic[MQTT_FULL_TOPIC_SIZE] = {0}; 
@@ -95,6 +101,7 @@ static esp_err_t publish_generic_event(const char *subTopic, const char *paylaod
 
 static void publish_intrusion_detected_event(void)
 {
+    communication_modbus_security_update(INTRUSION_DETECTED_EVENT, SEC_VALIDATION_STATE);
     publish_generic_event(ALARM_STATUS_TOPIC, ALARM_JSON_PAYLOAD, "INTRUSION_DETECTED", "VALIDATING");
 }
 
@@ -102,6 +109,7 @@ static void publish_intrusion_detected_event(void)
 
 static void publish_panic_button_pressed_event(void)
 {
+    communication_modbus_security_update(PANIC_BUTTON_PRESSED_EVENT, SEC_VALIDATION_STATE);
     publish_generic_event(ALARM_STATUS_TOPIC, ALARM_JSON_PAYLOAD, "PANIC_BUTTON_PRESSED", "VALIDATING");   
 }
 
@@ -109,6 +117,9 @@ static void publish_panic_button_pressed_event(void)
 
 static void publish_valid_tag_event(void)
 {
+    communication_modbus_security_update(VALID_TAG_EVENT, SEC_NORMAL_STATE);
+    communication_modbus_siren_update(false);
+    communication_modbus_lights_update(false);
     publish_generic_event(ALARM_STATUS_TOPIC, ALARM_JSON_PAYLOAD, "VALID_TAG", "NORMAL");
     publish_generic_event(SIREN_STATUS_TOPIC, STATUS_JSON_PAYLOAD, "SIREN_OFF", NULL);
     publish_generic_event(LIGHTS_STATUS_TOPIC, STATUS_JSON_PAYLOAD, "LIGHTS_OFF", NULL);        
@@ -118,6 +129,9 @@ static void publish_valid_tag_event(void)
 
 static void publish_invalid_tag_event(void)
 {
+    communication_modbus_security_update(INVALID_TAG_EVENT, SEC_ALARM_STATE);
+    communication_modbus_siren_update(true);
+    communication_modbus_lights_update(true);
     publish_generic_event(ALARM_STATUS_TOPIC, ALARM_JSON_PAYLOAD, "INVALID_TAG", "ALARM_TRIGGERED");
     publish_generic_event(SIREN_STATUS_TOPIC, STATUS_JSON_PAYLOAD, "SIREN_ON", NULL);
     publish_generic_event(LIGHTS_STATUS_TOPIC, STATUS_JSON_PAYLOAD, "LIGHTS_ON", NULL);  
@@ -127,6 +141,9 @@ static void publish_invalid_tag_event(void)
 
 static void publish_read_tag_timeout_event(void)
 {
+    communication_modbus_security_update(READ_TAG_TIMEOUT_EVENT, SEC_ALARM_STATE);
+    communication_modbus_siren_update(true);
+    communication_modbus_lights_update(true);
     publish_generic_event(ALARM_STATUS_TOPIC, ALARM_JSON_PAYLOAD, "READ_TAG_TIMEOUT","ALARM_TRIGGERED");
     publish_generic_event(SIREN_STATUS_TOPIC, STATUS_JSON_PAYLOAD, "SIREN_ON", NULL);
     publish_generic_event(LIGHTS_STATUS_TOPIC, STATUS_JSON_PAYLOAD, "LIGHTS_ON", NULL);
@@ -137,6 +154,9 @@ static void publish_read_tag_timeout_event(void)
 //-------------------------------------------------------------------
 static void publish_working_timeout_event(void)
 {
+    communication_modbus_security_update(WORKING_TIMEOUT_EVENT, SEC_MONITORING_STATE);
+    communication_modbus_siren_update(false);
+    communication_modbus_lights_update(false);
     publish_generic_event(ALARM_STATUS_TOPIC, ALARM_JSON_PAYLOAD, "WORKING_TIMEOUT", "MONITORING");
     publish_generic_event(SIREN_STATUS_TOPIC, STATUS_JSON_PAYLOAD, "SIREN_OFF", NULL);
     publish_generic_event(LIGHTS_STATUS_TOPIC, STATUS_JSON_PAYLOAD, "LIGHTS_OFF", NULL);
@@ -155,25 +175,17 @@ static void publish_temperature_read_event(void *data, ssize_t size)
 
     ambiental_callback_data_t *tempData = (ambiental_callback_data_t *)data;
 
+    // El mapa Modbus se actualiza primero: no depende de la hora ni del broker
+    communication_modbus_temperature_update(tempData->sensor_id, tempData->temperature_celsius, tempData->alarm);
+
     char topic[MQTT_FULL_TOPIC_SIZE] = {0}; 
     char timeString[ISO_TIMESTAMP_SIZE] = {0};
     char payload[MQTT_PAYLOAD_SIZE] = {0};
     
     if( sntp_client_isotime(timeString, sizeof(timeString)) == ESP_OK )
     {
-        if( tempData->sensor_id == EXTERNAL )
-        {
-            snprintf(topic, MQTT_FULL_TOPIC_SIZE, "%s%s", MQTT_BASE_TOPIC, AMBIENTAL_EXTERNAL_TOPIC);
-        }
-        else if( tempData->sensor_id == INTERNAL )
-        {
-            snprintf(topic, MQTT_FULL_TOPIC_SIZE, "%s%s", MQTT_BASE_TOPIC, AMBIENTAL_INTERNAL_TOPIC);
-        }
-        else
-        {
-            ESP_LOGE(TAG, "Unknown sensor ID: %016llX", tempData->sensor_id);
-            return;
-        }
+        // El nombre viene con la lectura, resuelto por el registro del módulo ambiental
+        snprintf(topic, MQTT_FULL_TOPIC_SIZE, "%s%s%s", MQTT_BASE_TOPIC, AMBIENTAL_TEMPERATURE_TOPIC, tempData->name);
 
         snprintf(payload, MQTT_PAYLOAD_SIZE, TEMPERATURE_JSON_PAYLOAD, timeString, tempData->sensor_id, tempData->temperature_celsius);
 
@@ -181,6 +193,13 @@ static void publish_temperature_read_event(void *data, ssize_t size)
             ESP_LOGE(TAG, "Fail to publish MQTT Temperature message");
         else
             ESP_LOGI(TAG, "Published Temperature Reading: %s", payload);
+
+        // Estado de los umbrales TH/TL del sensor, como la alarma de los medidores AC
+        snprintf(topic, MQTT_FULL_TOPIC_SIZE, "%s%s%s", MQTT_BASE_TOPIC, AMBIENTAL_ALARM_TOPIC, tempData->name);
+        snprintf(payload, MQTT_PAYLOAD_SIZE, VALUE_PAYLOAD, timeString, tempData->alarm ? 1.0f : 0.0f, "#");
+
+        if( mqtt_client_publish(topic, payload, QOS0) != ESP_OK )
+            ESP_LOGE(TAG, "Fail to publish MQTT Temperature Alarm message");
     }
     else
     {
@@ -188,6 +207,20 @@ static void publish_temperature_read_event(void *data, ssize_t size)
     }
 }
 
+static void remove_temperature_sensor_event(void *data, ssize_t size)
+{
+    if( data == NULL || size != sizeof(ambiental_callback_data_t) )
+    {
+        ESP_LOGE(TAG, "Invalid data in remove_temperature_sensor");
+        return;
+    }
+
+    ambiental_callback_data_t *tempData = (ambiental_callback_data_t *)data;
+
+    // El sensor dejó el registro: su slot del mapa Modbus queda sin validez y libre
+    communication_modbus_temperature_remove(tempData->sensor_id);
+}
+
 //-------------------------------------------------------------------
 
 //------------------------- Energy Publisher ------------------------
@@ -206,19 +239,62 @@ void generic_publish_energy_read(const char* timeString, const char* subTopic, c
     
 }
 
+// Tópico ENERGY/AC/[<dirección>/]<medida>
+static void publish_energy_ac_read(const char *timeString, const char *feeder, const char *measure, float value, const char *unit)
+{
+    char subTopic[MQTT_FULL_TOPIC_SIZE] = {0};
+
+    snprintf(subTopic, sizeof(subTopic), "%s%s%s", AC_TOPIC_PREFIX, feeder, measure);
+    generic_publish_energy_read(timeString, subTopic, VALUE_PAYLOAD, value, unit);
+}
+
+// Tópico ENERGY/POINTS/<key>, con el valor entero ya escalado
+static void publish_energy_point(const char *timeString, const energy_point_t *point)
+{
+    char topic[MQTT_FULL_TOPIC_SIZE] = {0};
+    char payload[MQTT_PAYLOAD_SIZE] = {0};
+
+    snprintf(topic, MQTT_FULL_TOPIC_SIZE, "%s%s%s", MQTT_BASE_TOPIC, POINTS_TOPIC_PREFIX, point->key);
+    snprintf(payload, MQTT_PAYLOAD_SIZE, POINT_PAYLOAD, timeString, (long)point->value, point->unit);
+
+    if( mqtt_client_publish(topic, payload, QOS0) != ESP_OK)
+        ESP_LOGE(TAG, "Fail to publish MQTT point %s", point->key);
+}
+
 static void publish_energy_read_event(energy_data_t *data)
 {
     if( data !=  NULL )
     {
+        communication_modbus_energy_update(data);
+
         char timeString[ISO_TIMESTAMP_SIZE] = {0};
 
         if( sntp_client_isotime(timeString, sizeof(timeString)) == ESP_OK )
         {
-            generic_publish_energy_read(timeString, VOLTAGE_AC_TOPIC, VALUE_PAYLOAD, data->ac_voltage, "V");
-            generic_publish_energy_read(timeString, CURRENT_AC_TOPIC, VALUE_PAYLOAD, data->ac_current, "A");
-            generic_publish_energy_read(timeString, POWER_AC_TOPIC, VALUE_PAYLOAD, data->ac_power, "W");
-            generic_publish_energy_read(timeString, FREQUENCY_AC_TOPIC, VALUE_PAYLOAD, data->ac_frequency, "Hz");
-            generic_publish_energy_read(timeString, POWERFACTOR_AC_TOPIC, VALUE_PAYLOAD, data->ac_power_factor, "#");
+            for (uint8_t i = 0; i < data->ac_count; ++i)
+            {
+                const energy_ac_data_t *ac = &data->ac[i];
+                if (!ac->valid)
+                    continue;
+
+                // Con un solo medidor se conservan los tópicos originales
+                char feeder[8] = "";
+                if (data->ac_count > 1)
+                    snprintf(feeder, sizeof(feeder), "%u/", ac->address);
+
+                publish_energy_ac_read(timeString, feeder, VOLTAGE_AC_TOPIC, ac->voltage, "V");
+                publish_energy_ac_read(timeString, feeder, CURRENT_AC_TOPIC, ac->current, "A");
+                publish_energy_ac_read(timeString, feeder, POWER_AC_TOPIC, ac->power, "W");
+                publish_energy_ac_read(timeString, feeder, FREQUENCY_AC_TOPIC, ac->frequency, "Hz");
+                publish_energy_ac_read(timeString, feeder, POWERFACTOR_AC_TOPIC, ac->power_factor, "#");
+                publish_energy_ac_read(timeString, feeder, ENERGY_AC_TOPIC, ac->energy, "Wh");
+                publish_energy_ac_read(timeString, feeder, ALARM_AC_TOPIC, ac->alarm ? 1.0f : 0.0f, "#");
+            }
+            for (uint8_t i = 0; i < data->point_count; ++i)
+            {
+                if (data->points[i].valid)
+                    publish_energy_point(timeString, &data->points[i]);
+            }
             generic_publish_energy_read(timeString, VOLTAGE_DC_TOPIC, VALUE_PAYLOAD, data->dc_voltage, "V");
             generic_publish_energy_read(timeString, CURRENT_DC_TOPIC, VALUE_PAYLOAD, data->dc_current, "A");
             generic_publish_energy_read(timeString, POWER_DC_TOPIC, VALUE_PAYLOAD, data->dc_power, "W");
@@ -234,6 +310,8 @@ static void publish_energy_state_event(energy_data_t *data)
 {
     if( data !=  NULL )
     {
+        communication_modbus_energy_update(data);
+
         char timeString[ISO_TIMESTAMP_SIZE] = {0};
 
         if( sntp_client_isotime(timeString, sizeof(timeString)) == ESP_OK )
@@ -263,6 +341,7 @@ esp_err_t communication_publisher_start(void)
     security_set_hookCallbak_OnEvent(WORKING_TIMEOUT_EVENT, publish_working_timeout_event);
 
     ambiental_set_hookCallback_onTemperatureRead(publish_temperature_read_event);
+    ambiental_set_hookCallback_onSensorRemoved(remove_temperature_sensor_event);
 
     energy_set_hookCallback_onEnergyRead(publish_energy_read_event);
     energy_set_hookCallback_onEnergyState(publish_energy_state_event);
@@ -279,4 +358,19 @@ esp_err_t communication_lights_status_publish(const char* status)
 esp_err_t communication_siren_status_publish(const char* status)
 {
     return publish_generic_event(SIREN_STATUS_TOPIC, STATUS_JSON_PAYLOAD, status, NULL);
+}
+
+esp_err_t communication_tags_status_publish(const char* status)
+{
+    return publish_generic_event(TAGS_STATUS_TOPIC, STATUS_JSON_PAYLOAD, status, NULL);
+}
+
+esp_err_t communication_calibration_status_publish(const char* status)
+{
+    return publish_generic_event(ENERGY_CALIBRATION_STATUS_TOPIC, STATUS_JSON_PAYLOAD, status, NULL);
+}
+
+esp_err_t communication_sensors_status_publish(const char* status)
+{
+    return publish_generic_event(AMBIENTAL_SENSORS_STATUS_TOPIC, STATUS_JSON_PAYLOAD, status, NULL);
 }
\ No newline at end of file
@@ -1,18 +1,28 @@
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 
 #include "esp_log.h"
 #include "esp_err.h"
 
 #include "security_watcher.h"
+#include "security_auth.h"
+#include "energy_dc.h"
+#include "ambiental_module.h"
 #include "communication_module.h"
 #include "communication_suscriber.h"
 #include "communication_publisher.h"
+#include "communication_modbus.h"
 #include "mqtt_driver.h"
 
 static const char *TAG = "communication_suscriber";
 
 static const char *SIREN_CMND_SUBTOPIC  = "SECURITY/CMND/Siren";
 static const char *LIGHTS_CMND_SUBTOPIC = "SECURITY/CMND/Lights";
+static const char *CALIBRATION_CMND_SUBTOPIC = "ENERGY/CMND/Calibration";
+static const char *TAGS_CMND_SUBTOPIC = "SECURITY/CMND/Tags";
+static const char *SENSORS_CMND_SUBTOPIC = "AMBIENTAL/CMND/Sensors";
 
 //------------------------------------------------------------------------------
 // MQTT TIME SUBSCRIPTION
@@ -29,11 +39,13 @@ static void mqtt_siren_callback(const char *topic, const char *payload)
     if (strcmp(payload, "ON") == 0 || strcmp(payload, "on") == 0)
     {
         security_turnSiren_on();
+        communication_modbus_siren_update(true);
         communication_siren_status_publish("SIREN_ON");
     }
     else if (strcmp(payload, "OFF") == 0 || strcmp(payload, "off") == 0)
     {
         security_turnSiren_off();
+        communication_modbus_siren_update(false);
         communication_siren_status_publish("SIREN_OFF");
     }
 }
@@ -49,15 +61,283 @@ static void mqtt_lights_callback(const char *topic, const char *payload)
     if (strcmp(payload, "ON") == 0 || strcmp(payload, "on") == 0)
     {
         security_turnLights_on();
+        communication_modbus_lights_update(true);
         communication_lights_status_publish("LIGHTS_ON");
     }
     else if (strcmp(payload, "OFF") == 0 || strcmp(payload, "off") == 0)
     {
         security_turnLights_off();
+        communication_modbus_lights_update(false);
         communication_lights_status_publish("LIGHTS_OFF");
     }
 }
 
+/**
+ * @brief MQTT message callback for DC Calibration Command topic.
+ * @details Payload: "<V|I> ZERO", "<V|I> SPAN <mV|mA>" or "<V|I> RESET".
+ * @param topic The topic on which the message was received.
+ * @param payload The payload of the received message.
+ */
+static void mqtt_calibration_callback(const char *topic, const char *payload)
+{
+    ESP_LOGI(TAG, "Received message on topic: %s, payload: %s", topic, payload);
+
+    energy_dc_channel_t channel;
+    if (payload[0] == 'V' || payload[0] == 'v')
+        channel = ENERGY_DC_VOLTAGE;
+    else if (payload[0] == 'I' || payload[0] == 'i')
+        channel = ENERGY_DC_CURRENT;
+    else
+    {
+        ESP_LOGW(TAG, "Unknown calibration channel: %s", payload);
+        communication_calibration_status_publish("CALIBRATION_INVALID");
+        return;
+    }
+
+    const char *cmd = payload + 1;
+    while (*cmd == ' ')
+        cmd++;
+
+    esp_err_t err = ESP_ERR_INVALID_ARG;
+    if (strncmp(cmd, "ZERO", 4) == 0)
+    {
+        err = energy_dc_calibrate_zero(channel);
+    }
+    else if (strncmp(cmd, "SPAN", 4) == 0)
+    {
+        char *end = NULL;
+        long reference = strtol(cmd + 4, &end, 10);
+        if (end != cmd + 4)
+            err = energy_dc_calibrate_span(channel, (int32_t)reference);
+    }
+    else if (strncmp(cmd, "RESET", 5) == 0)
+    {
+        err = energy_dc_calibration_reset(channel);
+    }
+
+    if (err != ESP_OK)
+        ESP_LOGE(TAG, "Calibration command failed: %s", esp_err_to_name(err));
+
+    communication_calibration_status_publish(err == ESP_OK ? "CALIBRATION_OK" :
+                                             err == ESP_ERR_INVALID_ARG ? "CALIBRATION_INVALID" : "CALIBRATION_FAILED");
+}
+
+/**
+ * @brief Parses a tag UID written in hex, with or without ':' between bytes.
+ * @param str Text with the UID. Advanced past the parsed UID.
+ * @param entry Entry where the UID is stored.
+ * @return true if a 4, 7 or 10 byte UID was parsed.
+ */
+static bool parse_tag_uid(const char **str, security_auth_entry_t *entry)
+{
+    const char *p = *str;
+    size_t len = 0;
+    while (*p && *p != ' ')
+    {
+        if (*p == ':')
+        {
+            p++;
+            continue;
+        }
+        unsigned int byte;
+        if (len >= SECURITY_AUTH_UID_MAX || !isxdigit((unsigned char)p[0]) ||
+            !isxdigit((unsigned char)p[1]) || sscanf(p, "%2x", &byte) != 1)
+            return false;
+        entry->uid[len++] = (uint8_t)byte;
+        p += 2;
+    }
+    *str = p;
+    entry->uid_len = (uint8_t)len;
+    return len == 4 || len == 7 || len == 10;
+}
+
+/**
+ * @brief Applies one tag command line.
+ * @param line "ADD <uid> [<from> <until>]", "DEL <uid>" or "CLEAR". The window is given in
+ *        UNIX time, 0 meaning no bound.
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for a malformed line, or the store error.
+ */
+static esp_err_t apply_tag_command(const char *line)
+{
+    security_auth_entry_t entry = {0};
+
+    if (strncmp(line, "CLEAR", 5) == 0)
+        return security_auth_clear();
+
+    if (strncmp(line, "ADD ", 4) == 0)
+    {
+        const char *p = line + 4;
+        if (!parse_tag_uid(&p, &entry))
+            return ESP_ERR_INVALID_ARG;
+
+        unsigned long from = 0, until = 0;
+        int n = sscanf(p, "%lu %lu", &from, &until);
+        if ((n != EOF && n != 2) || from > UINT32_MAX || until > UINT32_MAX)
+            return ESP_ERR_INVALID_ARG;
+        entry.valid_from = (uint32_t)from;
+        entry.valid_until = (uint32_t)until;
+        return security_auth_add(&entry);
+    }
+
+    if (strncmp(line, "DEL ", 4) == 0)
+    {
+        const char *p = line + 4;
+        if (!parse_tag_uid(&p, &entry))
+            return ESP_ERR_INVALID_ARG;
+        return security_auth_remove(entry.uid, entry.uid_len);
+    }
+
+    return ESP_ERR_INVALID_ARG;
+}
+
+/**
+ * @brief MQTT message callback for Tags Command topic.
+ * @details Payload: one or more commands separated by ';' or new lines, applied in order
+ *          (see apply_tag_command()). Changes take effect right away; the lines applied before
+ *          a failing one are kept, and the whole message is persisted with a single commit.
+ * @param topic The topic on which the message was received.
+ * @param payload The payload of the received message.
+ */
+static void mqtt_tags_callback(const char *topic, const char *payload)
+{
+    ESP_LOGI(TAG, "Received message on topic: %s, payload: %s", topic, payload);
+
+    char line[MAX_PAYLOAD_SIZE];
+    esp_err_t err = ESP_ERR_INVALID_ARG;
+    const char *p = payload;
+    security_auth_batch_begin();
+    while (*p)
+    {
+        size_t len = strcspn(p, ";\r\n");
+        if (len > 0)
+        {
+            snprintf(line, sizeof(line), "%.*s", (int)len, p);
+            err = apply_tag_command(line);
+            if (err != ESP_OK)
+            {
+                ESP_LOGE(TAG, "Tag command '%s' failed: %s", line, esp_err_to_name(err));
+                break;
+            }
+        }
+        p += len;
+        if (*p)
+            p++;
+    }
+
+    esp_err_t store_err = security_auth_batch_end();
+    if (err == ESP_OK)
+        err = store_err;
+
+    ESP_LOGI(TAG, "Authorized tags: %u", (unsigned)security_auth_count());
+    communication_tags_status_publish(err == ESP_OK ? "TAGS_OK" :
+                                      err == ESP_ERR_INVALID_ARG ? "TAGS_INVALID" : "TAGS_FAILED");
+}
+
+/**
+ * @brief Parses a sensor ROM ID written in hex.
+ * @param str Text with the ROM ID. Advanced past the parsed ROM ID and the spaces after it.
+ * @param sensor_id Where the ROM ID is stored.
+ * @return true if a non-zero ROM ID was parsed.
+ */
+static bool parse_sensor_id(const char **str, uint64_t *sensor_id)
+{
+    char *end = NULL;
+    *sensor_id = strtoull(*str, &end, 16);
+    if (end == *str || (*end != ' ' && *end != '\0') || *sensor_id == 0)
+        return false;
+
+    while (*end == ' ')
+        end++;
+    *str = end;
+    return true;
+}
+
+/**
+ * @brief Applies one temperature sensor command line.
+ * @param line "NAME <romid> [<name>]" (without a name, the stored one is removed),
+ *        "RES <romid> <bits>" or "ALARM <romid> <low> <high>" (thresholds in °C).
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for a malformed line, ESP_ERR_NOT_FOUND for
+ *         the resolution of a sensor that is not registered, or the store error.
+ */
+static esp_err_t apply_sensor_command(const char *line)
+{
+    uint64_t sensor_id;
+
+    if (strncmp(line, "NAME ", 5) == 0)
+    {
+        const char *p = line + 5;
+        if (!parse_sensor_id(&p, &sensor_id))
+            return ESP_ERR_INVALID_ARG;
+        return ambiental_set_sensor_name(sensor_id, p);
+    }
+
+    if (strncmp(line, "RES ", 4) == 0)
+    {
+        const char *p = line + 4;
+        if (!parse_sensor_id(&p, &sensor_id))
+            return ESP_ERR_INVALID_ARG;
+
+        char *end = NULL;
+        unsigned long bits = strtoul(p, &end, 10);
+        if (end == p || *end != '\0' || bits > UINT8_MAX)
+            return ESP_ERR_INVALID_ARG;
+        return ambiental_set_resolution(sensor_id, (uint8_t)bits);
+    }
+
+    if (strncmp(line, "ALARM ", 6) == 0)
+    {
+        const char *p = line + 6;
+        if (!parse_sensor_id(&p, &sensor_id))
+            return ESP_ERR_INVALID_ARG;
+
+        int low, high, used = 0;
+        if (sscanf(p, "%d %d%n", &low, &high, &used) != 2 || p[used] != '\0' ||
+            low < INT8_MIN || high > INT8_MAX)
+            return ESP_ERR_INVALID_ARG;
+        return ambiental_set_alarm_thresholds(sensor_id, (int8_t)low, (int8_t)high);
+    }
+
+    return ESP_ERR_INVALID_ARG;
+}
+
+/**
+ * @brief MQTT message callback for Sensors Command topic.
+ * @details Payload: one or more commands separated by ';' or new lines, applied in order
+ *          (see apply_sensor_command()). Names are persisted; resolutions and thresholds last
+ *          until reboot.
+ * @param topic The topic on which the message was received.
+ * @param payload The payload of the received message.
+ */
+static void mqtt_sensors_callback(const char *topic, const char *payload)
+{
+    ESP_LOGI(TAG, "Received message on topic: %s, payload: %s", topic, payload);
+
+    char line[MAX_PAYLOAD_SIZE];
+    esp_err_t err = ESP_ERR_INVALID_ARG;
+    const char *p = payload;
+    while (*p)
+    {
+        size_t len = strcspn(p, ";\r\n");
+        if (len > 0)
+        {
+            snprintf(line, sizeof(line), "%.*s", (int)len, p);
+            err = apply_sensor_command(line);
+            if (err != ESP_OK)
+            {
+                ESP_LOGE(TAG, "Sensor command '%s' failed: %s", line, esp_err_to_name(err));
+                break;
+            }
+        }
+        p += len;
+        if (*p)
+            p++;
+    }
+
+    communication_sensors_status_publish(err == ESP_OK ? "SENSORS_OK" :
+                                         err == ESP_ERR_INVALID_ARG ? "SENSORS_INVALID" :
+                                         err == ESP_ERR_NOT_FOUND ? "SENSORS_NOT_FOUND" : "SENSORS_FAILED");
+}
+
 //------------------------------------------------------------------------------
 
 static esp_err_t mqtt_generic_suscription(const char* subTopic, mqtt_msg_handler_t callback)
@@ -88,5 +368,26 @@ esp_err_t communication_suscriber_start(void)
         return ret;
     }
 
+    ret = mqtt_generic_suscription(CALIBRATION_CMND_SUBTOPIC, mqtt_calibration_callback);
+    if (ret != ESP_OK) 
+    {
+        ESP_LOGE(TAG, "Failed to set up MQTT Calibration Command Subscription: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = mqtt_generic_suscription(TAGS_CMND_SUBTOPIC, mqtt_tags_callback);
+    if (ret != ESP_OK) 
+    {
+        ESP_LOGE(TAG, "Failed to set up MQTT Tags Command Subscription: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = mqtt_generic_suscription(SENSORS_CMND_SUBTOPIC, mqtt_sensors_callback);
+    if (ret != ESP_OK) 
+    {
+        ESP_LOGE(TAG, "Failed to set up MQTT Sensors Command Subscription: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
     return ESP_OK;
 }
\ No newline at end of file
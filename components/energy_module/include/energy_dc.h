@@ -0,0 +1,102 @@
+#ifndef ENERGY_DC_H
+#define ENERGY_DC_H
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/**
+ * @file energy_dc.h
+ * @brief DC voltage/current acquisition pipeline on the ADS1115.
+ * @details Each reading is an oversampled scan: voltage and current are converted in
+ *          interleaved pairs at the highest data rate, summed per channel (boxcar
+ *          decimation) and scaled with a per-channel offset/gain calibration kept in NVS.
+ *          With CONFIG_ENERGY_DC_AUTORANGE each channel also picks its PGA from the peak
+ *          of the previous reading, so the results keep the same units on every range.
+ *          All the arithmetic is integer, since the ESP32-C6 has no FPU.
+ *
+ * @author Roberto Axt
+ * @version 1.0
+ * @date 2025-11-03
+ *
+ * @par License
+ * This file is part of the SMEM-MP project and is licensed under the MIT License.
+ */
+
+/**
+ * @brief DC measurement channels.
+ */
+typedef enum {
+    ENERGY_DC_VOLTAGE = 0,  /**< DC bus voltage, in mV */
+    ENERGY_DC_CURRENT = 1,  /**< DC bus current, in mA */
+    ENERGY_DC_CHANNELS
+} energy_dc_channel_t;
+
+/**
+ * @brief Calibration of a channel.
+ * @details value = (input_uV - offset_uv) * gain_num / gain_den, in mV or mA.
+ */
+typedef struct {
+    int32_t offset_uv;  /**< Input with zero applied, in microvolts at the ADC pins */
+    int32_t gain_num;   /**< Gain numerator (milli-units) */
+    int32_t gain_den;   /**< Gain denominator (microvolts), never 0 */
+} energy_dc_cal_t;
+
+/**
+ * @brief One DC reading.
+ */
+typedef struct {
+    int32_t voltage_mv;  /**< Calibrated voltage in mV */
+    int32_t current_ma;  /**< Calibrated current in mA */
+    int32_t power_mw;    /**< voltage * current, in mW */
+} energy_dc_reading_t;
+
+/**
+ * @brief Loads the calibration from NVS (or the defaults) and prepares the pipeline.
+ * @return ESP_OK on success, or an error code on failure.
+ * @note i2c_ads1115_start() must have been called before.
+ */
+esp_err_t energy_dc_start(void);
+
+/**
+ * @brief Takes an oversampled, calibrated DC reading.
+ * @param out Where the reading is stored.
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t energy_dc_read(energy_dc_reading_t *out);
+
+/**
+ * @brief Zero calibration: the current input of the channel becomes its offset.
+ * @details Apply 0 V / 0 A to the channel before calling. The result is stored in NVS.
+ * @param channel Channel to calibrate.
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t energy_dc_calibrate_zero(energy_dc_channel_t channel);
+
+/**
+ * @brief Span calibration: sets the gain so the current input reads as the reference.
+ * @details Apply a known voltage/current, well above zero, after the zero calibration.
+ *          The result is stored in NVS.
+ * @param channel Channel to calibrate.
+ * @param reference Applied value, in mV or mA (|reference| <= 1000000).
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if the input is too close to the offset,
+ *         or another error code on failure.
+ */
+esp_err_t energy_dc_calibrate_span(energy_dc_channel_t channel, int32_t reference);
+
+/**
+ * @brief Restores the default calibration of a channel and stores it in NVS.
+ * @param channel Channel to reset.
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t energy_dc_calibration_reset(energy_dc_channel_t channel);
+
+/**
+ * @brief Gets the calibration in use for a channel.
+ * @param channel Channel.
+ * @param out Where the calibration is copied.
+ * @return ESP_OK on success, or ESP_ERR_INVALID_ARG.
+ */
+esp_err_t energy_dc_get_calibration(energy_dc_channel_t channel, energy_dc_cal_t *out);
+
+#endif // ENERGY_DC_H
@@ -1,6 +1,9 @@
 #ifndef ENERGY_MODULE_H
 #define ENERGY_MODULE_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #include "esp_err.h"
 
 /**
@@ -17,17 +20,45 @@
  * This file is part of the SMEM-MP project and is licensed under the MIT License.
  */
 
+#define ENERGY_AC_MAX_METERS 8  /**< AC meters read by the module */
+
+/**
+ * @brief Measurements of one AC meter.
+ */
+typedef struct {
+    uint8_t address;       /**< Modbus address of the meter */
+    bool valid;            /**< false if the meter did not answer the last poll */
+    float voltage;         /**< AC Voltage in Volts */
+    float current;         /**< AC Current in Amperes */
+    float power;           /**< AC Power in Watts */
+    float frequency;       /**< AC Frequency in Hertz */
+    float power_factor;    /**< AC Power Factor (0 to 1) */
+    float energy;          /**< AC Energy in Watt-hours */
+    bool alarm;            /**< Power above the alarm threshold of the meter */
+} energy_ac_data_t;
+
+#define ENERGY_MAX_POINTS 16  /**< Extra Modbus points reported by the module */
+
+/**
+ * @brief Value of an extra Modbus point (see modbus_points.csv).
+ */
+typedef struct {
+    const char *key;       /**< Point key */
+    const char *unit;      /**< Unit of the value */
+    int32_t value;         /**< Scaled value */
+    bool valid;            /**< false if the slave did not answer the last read */
+} energy_point_t;
+
 /**
  * @brief Data structure for energy callback data
  * @details This structure holds energy-related parameters such as AC/DC voltage, 
  *          current, power, frequency, and power factor.  
  */ 
  typedef struct {
-    float ac_voltage;      /**< AC Voltage in Volts */
-    float ac_current;      /**< AC Current in Amperes */
-    float ac_power;        /**< AC Power in Watts */
-    float ac_frequency;    /**< AC Frequency in Hertz */
-    float ac_power_factor; /**< AC Power Factor (0 to 1) */
+    energy_ac_data_t ac[ENERGY_AC_MAX_METERS]; /**< AC meters, one per feeder */
+    uint8_t ac_count;      /**< Number of AC meters */
+    energy_point_t points[ENERGY_MAX_POINTS]; /**< Extra Modbus points */
+    uint8_t point_count;   /**< Number of extra points */
     float dc_voltage;      /**< DC Voltage in Volts */
     float dc_current;      /**< DC Current in Amperes */
     float dc_power;        /**< DC Power in Watts */
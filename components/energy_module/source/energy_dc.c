@@ -0,0 +1,256 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "nvs.h"
+
+#include "energy_dc.h"
+#include "i2c_ads1115.h"
+
+#ifndef CONFIG_ENERGY_DC_OVERSAMPLE
+#define CONFIG_ENERGY_DC_OVERSAMPLE 16
+#endif
+
+#ifndef CONFIG_ENERGY_DC_AUTORANGE
+#define CONFIG_ENERGY_DC_AUTORANGE 1
+#endif
+
+#define ENERGY_DC_MAX_OVERSAMPLE 64
+#define ENERGY_DC_NVS_NAMESPACE  "energy_dc"
+#define ENERGY_DC_NVS_KEY        "cal"
+#define ENERGY_DC_MIN_SPAN_UV    1000     // entrada mínima sobre el offset para calibrar la ganancia
+#define ENERGY_DC_MAX_REFERENCE  1000000  // 1000 V / 1000 A
+
+_Static_assert(CONFIG_ENERGY_DC_OVERSAMPLE >= 1 && CONFIG_ENERGY_DC_OVERSAMPLE <= ENERGY_DC_MAX_OVERSAMPLE,
+               "ENERGY_DC_OVERSAMPLE out of range");
+
+static const char *TAG = "energy_dc";
+
+/* Entradas del ADS1115 de cada canal; el PGA es el inicial si el auto-rango está activo */
+static const ads1115_scan_entry_t CHANNEL_INPUT[ENERGY_DC_CHANNELS] = {
+    [ENERGY_DC_VOLTAGE] = { .mux = ADS1115_MUX_SINGLE_0, .pga = ADS1115_PGA_2V048 },
+    [ENERGY_DC_CURRENT] = { .mux = ADS1115_MUX_SINGLE_1, .pga = ADS1115_PGA_2V048 },
+};
+
+/* Con VDD = 3.3 V las entradas no pueden superar ~3.6 V: el rango ±6.144 V no aporta */
+#define ENERGY_DC_LOWEST_GAIN  ADS1115_PGA_4V096
+#define ENERGY_DC_HIGHEST_GAIN ADS1115_PGA_0V256
+
+static ads1115_pga_t channel_pga[ENERGY_DC_CHANNELS];
+
+/* Por defecto 0.16 milésimas por µV: equivale a la escala histórica raw/100 con PGA ±2.048 V */
+static const energy_dc_cal_t DEFAULT_CAL = { .offset_uv = 0, .gain_num = 4, .gain_den = 25 };
+
+static energy_dc_cal_t cal[ENERGY_DC_CHANNELS];
+static SemaphoreHandle_t lock = NULL;   // serializa barridos y cambios de calibración
+
+/* Buffers del barrido: pares V/I intercalados */
+static ads1115_scan_entry_t scan_entries[ENERGY_DC_MAX_OVERSAMPLE * ENERGY_DC_CHANNELS];
+static int16_t scan_values[ENERGY_DC_MAX_OVERSAMPLE * ENERGY_DC_CHANNELS];
+
+/* División entera redondeando al más cercano */
+static int64_t div_round(int64_t num, int64_t den)
+{
+    if (den < 0) { num = -num; den = -den; }
+    return (num >= 0) ? (num + den / 2) / den : (num - den / 2) / den;
+}
+
+static esp_err_t save_calibration(void)
+{
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(ENERGY_DC_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) return err;
+
+    err = nvs_set_blob(nvs, ENERGY_DC_NVS_KEY, cal, sizeof(cal));
+    if (err == ESP_OK) err = nvs_commit(nvs);
+    nvs_close(nvs);
+    return err;
+}
+
+static void load_calibration(void)
+{
+    for (int ch = 0; ch < ENERGY_DC_CHANNELS; ++ch)
+        cal[ch] = DEFAULT_CAL;
+
+    nvs_handle_t nvs;
+    if (nvs_open(ENERGY_DC_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        ESP_LOGI(TAG, "No calibration stored, using defaults");
+        return;
+    }
+
+    energy_dc_cal_t stored[ENERGY_DC_CHANNELS];
+    size_t len = sizeof(stored);
+    esp_err_t err = nvs_get_blob(nvs, ENERGY_DC_NVS_KEY, stored, &len);
+    nvs_close(nvs);
+
+    if (err != ESP_OK || len != sizeof(stored)) {
+        ESP_LOGW(TAG, "Calibration in NVS missing or invalid, using defaults");
+        return;
+    }
+    for (int ch = 0; ch < ENERGY_DC_CHANNELS; ++ch) {
+        if (stored[ch].gain_den == 0) {
+            ESP_LOGW(TAG, "Invalid gain for channel %d in NVS, using default", ch);
+            continue;
+        }
+        cal[ch] = stored[ch];
+    }
+}
+
+/**
+ * @brief Barrido sobremuestreado: devuelve la entrada promedio de cada canal en nV.
+ * @details Las N conversiones de cada canal se suman (decimación boxcar) antes de escalar,
+ *          así el promedio conserva los bits extra que aporta el sobremuestreo.
+ */
+static esp_err_t acquire_nv(int64_t input_nv[ENERGY_DC_CHANNELS])
+{
+    const size_t n = CONFIG_ENERGY_DC_OVERSAMPLE;
+    for (size_t i = 0; i < n; ++i)
+        for (int ch = 0; ch < ENERGY_DC_CHANNELS; ++ch)
+            scan_entries[i * ENERGY_DC_CHANNELS + ch] = (ads1115_scan_entry_t){
+                .mux = CHANNEL_INPUT[ch].mux, .pga = channel_pga[ch] };
+
+    esp_err_t err = i2c_ads1115_scan(scan_entries, n * ENERGY_DC_CHANNELS, scan_values);
+    if (err != ESP_OK) return err;
+
+    for (int ch = 0; ch < ENERGY_DC_CHANNELS; ++ch) {
+        int32_t sum = 0;
+        int32_t peak = 0;
+        for (size_t i = 0; i < n; ++i) {
+            int32_t raw = scan_values[i * ENERGY_DC_CHANNELS + ch];
+            sum += raw;
+            if (abs(raw) > peak) peak = abs(raw);
+        }
+
+        // nV = sum * FSR[µV] * 1000 / (32768 * N): la escala sale del PGA usado, así
+        // el resultado queda en la misma unidad cualquiera sea el rango
+        int64_t fsr_uv = i2c_ads1115_fsr_uv(channel_pga[ch]);
+        input_nv[ch] = div_round((int64_t)sum * fsr_uv * 1000, 32768 * (int64_t)n);
+
+#if CONFIG_ENERGY_DC_AUTORANGE
+        // El rango de la próxima lectura sale de ésta: no hace falta una conversión extra
+        if (peak >= INT16_MAX)
+            ESP_LOGW(TAG, "Channel %d clipped at PGA %d", ch, (int)channel_pga[ch]);
+        ads1115_pga_t next = i2c_ads1115_autorange(channel_pga[ch], peak, ENERGY_DC_LOWEST_GAIN, ENERGY_DC_HIGHEST_GAIN);
+        if (next != channel_pga[ch]) {
+            ESP_LOGI(TAG, "Channel %d range: +-%ld mV -> +-%ld mV", ch,
+                     (long)(fsr_uv / 1000), (long)(i2c_ads1115_fsr_uv(next) / 1000));
+            channel_pga[ch] = next;
+        }
+#endif
+    }
+    return ESP_OK;
+}
+
+static int32_t apply_calibration(const energy_dc_cal_t *c, int64_t input_nv)
+{
+    int64_t net_nv = input_nv - (int64_t)c->offset_uv * 1000;
+    return (int32_t)div_round(net_nv * c->gain_num, (int64_t)c->gain_den * 1000);
+}
+
+esp_err_t energy_dc_start(void)
+{
+    if (!lock) {
+        lock = xSemaphoreCreateMutex();
+        if (!lock) return ESP_ERR_NO_MEM;
+    }
+
+    load_calibration();
+    for (int ch = 0; ch < ENERGY_DC_CHANNELS; ++ch) {
+        channel_pga[ch] = CHANNEL_INPUT[ch].pga;
+        ESP_LOGI(TAG, "Channel %d calibration: offset=%ld uV, gain=%ld/%ld", ch,
+                 (long)cal[ch].offset_uv, (long)cal[ch].gain_num, (long)cal[ch].gain_den);
+    }
+
+    ESP_LOGI(TAG, "DC pipeline ready (oversampling x%d, autorange %s)", CONFIG_ENERGY_DC_OVERSAMPLE,
+             CONFIG_ENERGY_DC_AUTORANGE ? "on" : "off");
+    return ESP_OK;
+}
+
+esp_err_t energy_dc_read(energy_dc_reading_t *out)
+{
+    if (!out) return ESP_ERR_INVALID_ARG;
+    if (!lock) return ESP_ERR_INVALID_STATE;
+
+    int64_t input_nv[ENERGY_DC_CHANNELS];
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    esp_err_t err = acquire_nv(input_nv);
+    if (err == ESP_OK) {
+        out->voltage_mv = apply_calibration(&cal[ENERGY_DC_VOLTAGE], input_nv[ENERGY_DC_VOLTAGE]);
+        out->current_ma = apply_calibration(&cal[ENERGY_DC_CURRENT], input_nv[ENERGY_DC_CURRENT]);
+        out->power_mw = (int32_t)div_round((int64_t)out->voltage_mv * out->current_ma, 1000);
+    }
+    xSemaphoreGive(lock);
+    return err;
+}
+
+esp_err_t energy_dc_calibrate_zero(energy_dc_channel_t channel)
+{
+    if (channel >= ENERGY_DC_CHANNELS) return ESP_ERR_INVALID_ARG;
+    if (!lock) return ESP_ERR_INVALID_STATE;
+
+    int64_t input_nv[ENERGY_DC_CHANNELS];
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    esp_err_t err = acquire_nv(input_nv);
+    if (err == ESP_OK) {
+        cal[channel].offset_uv = (int32_t)div_round(input_nv[channel], 1000);
+        err = save_calibration();
+        ESP_LOGI(TAG, "Channel %d zero: offset=%ld uV", (int)channel, (long)cal[channel].offset_uv);
+    }
+    xSemaphoreGive(lock);
+    return err;
+}
+
+esp_err_t energy_dc_calibrate_span(energy_dc_channel_t channel, int32_t reference)
+{
+    if (channel >= ENERGY_DC_CHANNELS || reference == 0 || labs(reference) > ENERGY_DC_MAX_REFERENCE)
+        return ESP_ERR_INVALID_ARG;
+    if (!lock) return ESP_ERR_INVALID_STATE;
+
+    int64_t input_nv[ENERGY_DC_CHANNELS];
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    esp_err_t err = acquire_nv(input_nv);
+    if (err == ESP_OK) {
+        int64_t net_uv = div_round(input_nv[channel], 1000) - cal[channel].offset_uv;
+        if (net_uv > -ENERGY_DC_MIN_SPAN_UV && net_uv < ENERGY_DC_MIN_SPAN_UV) {
+            ESP_LOGW(TAG, "Channel %d span: input too close to zero (%lld uV)", (int)channel, (long long)net_uv);
+            err = ESP_ERR_INVALID_STATE;
+        } else {
+            cal[channel].gain_num = reference;
+            cal[channel].gain_den = (int32_t)net_uv;
+            err = save_calibration();
+            ESP_LOGI(TAG, "Channel %d span: gain=%ld/%ld", (int)channel,
+                     (long)cal[channel].gain_num, (long)cal[channel].gain_den);
+        }
+    }
+    xSemaphoreGive(lock);
+    return err;
+}
+
+esp_err_t energy_dc_calibration_reset(energy_dc_channel_t channel)
+{
+    if (channel >= ENERGY_DC_CHANNELS) return ESP_ERR_INVALID_ARG;
+    if (!lock) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    cal[channel] = DEFAULT_CAL;
+    esp_err_t err = save_calibration();
+    xSemaphoreGive(lock);
+
+    ESP_LOGI(TAG, "Channel %d calibration reset", (int)channel);
+    return err;
+}
+
+esp_err_t energy_dc_get_calibration(energy_dc_channel_t channel, energy_dc_cal_t *out)
+{
+    if (channel >= ENERGY_DC_CHANNELS || !out) return ESP_ERR_INVALID_ARG;
+
+    if (lock) xSemaphoreTake(lock, portMAX_DELAY);
+    *out = cal[channel];
+    if (lock) xSemaphoreGive(lock);
+    return ESP_OK;
+}
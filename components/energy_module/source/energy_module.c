@@ -1,72 +1,184 @@
+#include <stdlib.h>
+
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
 #include "energy_module.h"
+#include "uart_mb_poller.h"
 #include "uart_pzem004t.h"
 #include "i2c_mgmt_driver.h"
 #include "i2c_ads1115.h"
+#include "energy_dc.h"
 #include "zigbee_gateway.h"
 
 #define ENERGY_READ_INTERVAL_MS 60000
 #define ENERGY_STATE_INTERVAL_MS 2000
+#define ENERGY_MB_BAUDRATE 9600
+
+#ifndef CONFIG_ENERGY_PZEM_ADDRESSES
+#define CONFIG_ENERGY_PZEM_ADDRESSES "1"
+#endif
+
+#ifndef CONFIG_ENERGY_PZEM_POLL_MS
+#define CONFIG_ENERGY_PZEM_POLL_MS 1000
+#endif
+
+#ifndef CONFIG_ENERGY_PZEM_ALARM_W
+#define CONFIG_ENERGY_PZEM_ALARM_W 0
+#endif
+
+_Static_assert(ENERGY_AC_MAX_METERS <= UART_PZEM_MAX_METERS, "More AC meters than the PZEM driver handles");
 
 static hookCallback_onEnergyEvent hookEnergyReadCallback = NULL;
 static hookCallback_onEnergyEvent hookEnergyStateCallback = NULL;
 static energy_data_t callback_data = {0};
+static size_t points_first = 0;
+
+// Tabla de puntos Modbus embebida en el firmware (EMBED_TXTFILES)
+extern const char modbus_points_csv_start[] asm("_binary_modbus_points_csv_start");
 
 static const char *TAG = "energy_module";
 
+// Interpreta la lista de direcciones "1,2,5"; las entradas inválidas se descartan
+static size_t parse_meter_addresses(const char *list, uint8_t *addrs, size_t max)
+{
+    size_t count = 0;
+    const char *p = list;
+
+    while (*p != '\0' && count < max)
+    {
+        char *end = NULL;
+        unsigned long addr = strtoul(p, &end, 10);
+
+        if (end != p && addr >= 1 && addr <= 247)
+            addrs[count++] = (uint8_t)addr;
+        else
+            ESP_LOGW(TAG, "Ignoring PZEM address entry in \"%s\"", list);
+
+        p = (end != p) ? end : p + 1;
+        while (*p == ',' || *p == ' ')
+            ++p;
+    }
+
+    if (count == 0)
+    {
+        ESP_LOGW(TAG, "No valid PZEM address, using 1");
+        addrs[count++] = 1;
+    }
+    return count;
+}
+
+// Los puntos extra quedan a continuación de los de los PZEM, en el orden de la tabla
+static void load_points(void)
+{
+    size_t added = 0;
+    points_first = uart_mb_points_count();
+
+    esp_err_t err = uart_mb_points_load(modbus_points_csv_start, &added);
+    if (err != ESP_OK)
+        ESP_LOGW(TAG, "Modbus points table partially loaded: %s", esp_err_to_name(err));
+
+    if (added > ENERGY_MAX_POINTS)
+    {
+        ESP_LOGW(TAG, "Only the first %d of %u Modbus points are reported", ENERGY_MAX_POINTS, (unsigned)added);
+        added = ENERGY_MAX_POINTS;
+    }
+
+    for (size_t i = 0; i < added; ++i)
+    {
+        uart_mb_point_t point;
+        uart_mb_point_get(points_first + i, &point);
+        callback_data.points[i].key = point.key;
+        callback_data.points[i].unit = point.unit;
+    }
+    callback_data.point_count = (uint8_t)added;
+}
+
 static void energyRead_task(void *arg) 
 {
     while (1) 
     {
-        esp_err_t err = uart_pzem004t_read();
+        esp_err_t err = ESP_OK;
 
-        if(err != ESP_OK) 
-        {
-            ESP_LOGE(TAG, "Failed to read from PZEM004T: %s", esp_err_to_name(err));
-        }
-        else
+        for (uint8_t i = 0; i < callback_data.ac_count; ++i)
         {
-            callback_data.ac_voltage = uart_pzem_voltage_V();
-            callback_data.ac_current = uart_pzem_current_A();
-            callback_data.ac_power = uart_pzem_power_W();
-            callback_data.ac_frequency = uart_pzem_freq_Hz();
-            callback_data.ac_power_factor = uart_pzem_pf();
-
-            ESP_LOGI(TAG, "AC Voltage=%.1f V, AC Current=%.3f A, AC Power=%.1f W, AC freq=%.1f Hz, AC PF=%.2f",
-             callback_data.ac_voltage, callback_data.ac_current, callback_data.ac_power, 
-             callback_data.ac_frequency, callback_data.ac_power_factor);
-        }
+            energy_ac_data_t *ac = &callback_data.ac[i];
+            uart_pzem_reading_t reading;
 
-        int16_t temp_value = 0;
+            err = uart_pzem004t_read(i, &reading);
+            ac->valid = (err == ESP_OK);
 
-        err = i2c_ads1115_read_single_ended(ADS1115_CHANNEL_0, &temp_value);
+            if(err != ESP_OK) 
+            {
+                ESP_LOGE(TAG, "Failed to read from PZEM004T %u: %s", ac->address, esp_err_to_name(err));
+                continue;
+            }
 
-        if(err != ESP_OK) 
+            // La alarma la decide el medidor con su umbral de potencia; acá sólo se informa el cambio
+            if (reading.alarm != ac->alarm)
+            {
+                if (reading.alarm)
+                    ESP_LOGW(TAG, "AC[%u] power above the alarm threshold", ac->address);
+                else
+                    ESP_LOGI(TAG, "AC[%u] power back below the alarm threshold", ac->address);
+            }
+
+            // El driver entrega enteros en milésimas; sólo la salida se pasa a float
+            ac->voltage = reading.voltage_mV / 1000.0f;
+            ac->current = reading.current_mA / 1000.0f;
+            ac->power = reading.power_mW / 1000.0f;
+            ac->frequency = reading.freq_mHz / 1000.0f;
+            ac->power_factor = reading.pf_milli / 1000.0f;
+            ac->energy = (float)reading.energy_Wh;
+            ac->alarm = reading.alarm;
+
+            ESP_LOGI(TAG, "AC[%u] Voltage= %lu mV, Current= %lu mA, Power= %lu mW, Energy= %lu Wh, freq= %lu mHz, PF= %u/1000%s",
+                     ac->address, (unsigned long)reading.voltage_mV, (unsigned long)reading.current_mA,
+                     (unsigned long)reading.power_mW, (unsigned long)reading.energy_Wh,
+                     (unsigned long)reading.freq_mHz, reading.pf_milli, reading.alarm ? ", ALARM" : "");
+        }
+
+        for (uint8_t i = 0; i < callback_data.point_count; ++i)
         {
-            ESP_LOGE(TAG, "Failed to read from ADS1115= %s", esp_err_to_name(err));
+            energy_point_t *pt = &callback_data.points[i];
+            uart_mb_point_t point;
+
+            pt->valid = uart_mb_point_get(points_first + i, &point) == ESP_OK && point.status == ESP_OK;
+            if (pt->valid)
+                pt->value = point.value;
         }
-        else
+
+        for (size_t i = 0; i < uart_mb_slaves_count(); ++i)
         {
-            callback_data.dc_voltage = ((float) temp_value)/100.0;
-            temp_value = 0;
-            ESP_LOGI(TAG, "DC Voltage: %.1f",callback_data.dc_voltage);
+            uart_mb_slave_stats_t stats;
+            if (uart_mb_slave_stats_get(i, &stats) != ESP_OK)
+                continue;
+
+            ESP_LOGI(TAG, "Modbus slave %u: RTT=%lu us (latency %lu+-%lu us), timeout=%lu ms, requests=%lu, timeouts=%lu, CRC errors=%lu, backoff=%lu ms",
+                     stats.slave_addr, (unsigned long)stats.rtt_us, (unsigned long)stats.srtt_us,
+                     (unsigned long)stats.rttvar_us, (unsigned long)stats.timeout_ms,
+                     (unsigned long)stats.requests, (unsigned long)stats.timeouts,
+                     (unsigned long)stats.crc_errors, (unsigned long)stats.backoff_ms);
         }
 
-        err = i2c_ads1115_read_single_ended(ADS1115_CHANNEL_1, &temp_value);
+        energy_dc_reading_t dc = {0};
+
+        err = energy_dc_read(&dc);
 
         if(err != ESP_OK) 
         {
-            ESP_LOGE(TAG, "Failed to read from ADS1115= %s V", esp_err_to_name(err));
+            ESP_LOGE(TAG, "Failed to read from ADS1115= %s", esp_err_to_name(err));
         }
         else
         {
-            callback_data.dc_current = ((float) temp_value)/100.0;
-            callback_data.dc_power = callback_data.dc_current * callback_data.dc_voltage;
+            // El pipeline trabaja en enteros (mV, mA, mW); sólo la salida se pasa a float
+            callback_data.dc_voltage = dc.voltage_mv / 1000.0f;
+            callback_data.dc_current = dc.current_ma / 1000.0f;
+            callback_data.dc_power = dc.power_mw / 1000.0f;
 
-            ESP_LOGI(TAG, "DC Current= %.1f A, DC Power= %.1f ",callback_data.dc_current, callback_data.dc_power );
+            ESP_LOGI(TAG, "DC Voltage= %ld mV, DC Current= %ld mA, DC Power= %ld mW",
+                     (long)dc.voltage_mv, (long)dc.current_ma, (long)dc.power_mw);
         }
 
         if(hookEnergyReadCallback != NULL)
@@ -112,24 +224,59 @@ esp_err_t energy_module_start(void)
 {
     ESP_LOGI(TAG, "Energy module started");
 
-    esp_err_t err_pzem = uart_pzem004t_start(UART_NUM_1, GPIO_NUM_18, GPIO_NUM_19);
+    uint8_t addrs[ENERGY_AC_MAX_METERS];
+    size_t count = parse_meter_addresses(CONFIG_ENERGY_PZEM_ADDRESSES, addrs, ENERGY_AC_MAX_METERS);
+
+    esp_err_t err_pzem = uart_mb_poller_start(UART_NUM_1, GPIO_NUM_18, GPIO_NUM_19, ENERGY_MB_BAUDRATE);
     if(err_pzem != ESP_OK) 
     {
-        ESP_LOGE(TAG, "Failed to start PZEM004T: %s", esp_err_to_name(err_pzem));
+        ESP_LOGE(TAG, "Failed to start Modbus poller: %s", esp_err_to_name(err_pzem));
     }
-    
-    esp_err_t err_i2c = i2c_mgmt_start(I2C_NUM_0, GPIO_NUM_21, GPIO_NUM_22);
+    else
+    {
+        err_pzem = uart_pzem004t_start(addrs, count, CONFIG_ENERGY_PZEM_POLL_MS);
+        if(err_pzem != ESP_OK) 
+        {
+            ESP_LOGE(TAG, "Failed to start PZEM004T: %s", esp_err_to_name(err_pzem));
+        }
+        else
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                callback_data.ac[i].address = addrs[i];
+#if CONFIG_ENERGY_PZEM_ALARM_W > 0
+                if (uart_pzem_alarm_threshold_set(i, CONFIG_ENERGY_PZEM_ALARM_W) == ESP_OK)
+                    ESP_LOGI(TAG, "PZEM004T %u alarm threshold set to %d W", addrs[i], CONFIG_ENERGY_PZEM_ALARM_W);
+#endif
+            }
+            callback_data.ac_count = (uint8_t)count;
+        }
+
+        load_points();
+    }
+
+    i2c_mgmt_handle_t i2c_bus = NULL;
+    esp_err_t err_i2c = i2c_mgmt_start(I2C_NUM_0, GPIO_NUM_21, GPIO_NUM_22, &i2c_bus);
     if(err_i2c != ESP_OK) 
     {
         ESP_LOGE(TAG, "Failed to start I2C Manager: %s", esp_err_to_name(err_i2c));
     }
     else
     {
-        err_i2c = i2c_ads1115_start(0x48, ADS1115_PGA_2V048, ADS1115_DR_128SPS, 100);
+        // Máxima tasa de datos: el pipeline DC promedia varias conversiones por lectura
+        err_i2c = i2c_ads1115_start(i2c_bus, 0x48, ADS1115_PGA_2V048, ADS1115_DR_860SPS, I2C_MGMT_SPEED_FAST, 100);
         if(err_i2c != ESP_OK) 
         {
             ESP_LOGE(TAG, "Failed to start ADS1115: %s", esp_err_to_name(err_i2c));
         }
+        else
+        {
+            err_i2c = energy_dc_start();
+            if(err_i2c != ESP_OK) 
+            {
+                ESP_LOGE(TAG, "Failed to start DC pipeline: %s", esp_err_to_name(err_i2c));
+            }
+        }
     }
 
     esp_err_t err_zb = zigbee_gateway_start();
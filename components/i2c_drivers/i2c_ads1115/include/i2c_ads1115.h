@@ -17,8 +17,11 @@
  * This project is licensed under the MIT License.
  */
 
+#include <stddef.h>
 #include <stdint.h>
 #include "esp_err.h"
+#include "driver/gpio.h"
+#include "i2c_mgmt_driver.h"
 
 /* Ganancia (PGA) -> rango de entrada y tamaño de LSB */
 typedef enum {
@@ -50,21 +53,44 @@ typedef enum {
     ADS1115_CHANNEL_3 = 3
 } ads1115_channel_t; 
 
+/* Input multiplexer (MUX[14:12]): differential pairs AINp - AINn, or single-ended AINx - GND */
+typedef enum {
+    ADS1115_MUX_DIFF_0_1 = 0, // AIN0 - AIN1 (p.ej. shunt de corriente DC)
+    ADS1115_MUX_DIFF_0_3 = 1, // AIN0 - AIN3
+    ADS1115_MUX_DIFF_1_3 = 2, // AIN1 - AIN3
+    ADS1115_MUX_DIFF_2_3 = 3, // AIN2 - AIN3
+    ADS1115_MUX_SINGLE_0 = 4, // AIN0 - GND
+    ADS1115_MUX_SINGLE_1 = 5, // AIN1 - GND
+    ADS1115_MUX_SINGLE_2 = 6, // AIN2 - GND
+    ADS1115_MUX_SINGLE_3 = 7  // AIN3 - GND
+} ads1115_mux_t;
+
+/**
+ * @brief One entry of a multi-channel scan.
+ */
+typedef struct {
+    ads1115_mux_t mux;  /**< Input pair to convert */
+    ads1115_pga_t pga;  /**< Gain for this entry */
+} ads1115_scan_entry_t;
+
 /**
   * @brief Initializes the ADS1115 ADC over I2C.
   * @details This function sets up the ADS1115 by configuring its registers
   * for operation. It also verifies communication with the device.
   * 
+  * @param bus The bus the ADS1115 is connected to (see i2c_mgmt_start()).
   * @param i2c_addr The I2C address of the ADS1115 (0x48 to 0x4B).
   * @param pga The programmable gain amplifier setting (see ads1115_pga_t).
   * @param dr The data rate setting (see ads1115_dr_t).
+  * @param speed_hz The SCL speed used for this device (the ADS1115 supports up to Fast-mode Plus).
   * @param timeout_ms The timeout for I2C operations in milliseconds.
   * @return ESP_OK on success, or an error code on failure.
   * @note This function should be called before any other ADS1115 operations.
   * @note It is expected that the I2C management driver has been initialized before calling this
   * function.
   */
-esp_err_t i2c_ads1115_start(uint8_t i2c_addr, ads1115_pga_t pga, ads1115_dr_t dr, int timeout_ms);
+esp_err_t i2c_ads1115_start(i2c_mgmt_handle_t bus, uint8_t i2c_addr, ads1115_pga_t pga, ads1115_dr_t dr,
+                            uint32_t speed_hz, int timeout_ms);
 
 /**
  * @brief Reads a single-ended value from the specified ADS1115 channel.
@@ -79,6 +105,104 @@ esp_err_t i2c_ads1115_start(uint8_t i2c_addr, ads1115_pga_t pga, ads1115_dr_t dr
  */
 esp_err_t i2c_ads1115_read_single_ended(ads1115_channel_t channel, int16_t *value);
 
+/**
+ * @brief Converts a list of inputs back to back and returns the results as one set.
+ * @details Conversions are pipelined: after the first trigger, every bus transaction reads the
+ *          status and result of the current entry and writes the configuration that starts the
+ *          next one, so a scan of N entries takes N + 1 transactions and no polling. The wait
+ *          between transactions is the conversion time of the configured data rate.
+ * @param entries Inputs to convert, each with its own mux (single-ended or differential) and PGA.
+ * @param count Number of entries.
+ * @param values Where the results are stored, in native ADS1115 format, one per entry.
+ * @return ESP_OK on success, ESP_ERR_TIMEOUT if a conversion never completed,
+ *         ESP_ERR_INVALID_STATE if the driver is not started or is streaming,
+ *         or another error code on failure.
+ */
+esp_err_t i2c_ads1115_scan(const ads1115_scan_entry_t *entries, size_t count, int16_t *values);
+
+/**
+ * @brief Full-scale range of a PGA setting.
+ * @param pga PGA setting.
+ * @return Full-scale range in microvolts (e.g. 2048000 for ADS1115_PGA_2V048).
+ */
+int32_t i2c_ads1115_fsr_uv(ads1115_pga_t pga);
+
+/**
+ * @brief Picks the PGA for the next conversion of an input from the peak of the last one.
+ * @details The gain goes down one step when the peak is above ~91% of full scale (or clipped),
+ *          and up one step when the peak would still be below ~73% of the higher gain's full
+ *          scale. The gap between both thresholds is the hysteresis that keeps a steady input
+ *          from toggling between two ranges.
+ * @param pga PGA used for the last conversion.
+ * @param peak Largest magnitude of the raw results taken with that PGA.
+ * @param lowest_gain Widest range allowed (e.g. ADS1115_PGA_4V096 when VDD is 3.3 V).
+ * @param highest_gain Narrowest range allowed.
+ * @return PGA for the next conversion.
+ */
+ads1115_pga_t i2c_ads1115_autorange(ads1115_pga_t pga, int32_t peak, ads1115_pga_t lowest_gain,
+                                    ads1115_pga_t highest_gain);
+
+/**
+ * @brief Sample delivered by the continuous-conversion stream.
+ */
+typedef struct {
+    int16_t raw;            /**< Conversion result in native ADS1115 format */
+    int64_t timestamp_us;   /**< esp_timer time of the ALERT/RDY edge that announced it */
+} ads1115_sample_t;
+
+/**
+ * @brief Counters of the continuous-conversion stream.
+ */
+typedef struct {
+    uint32_t samples;       /**< Samples read and buffered */
+    uint32_t missed;        /**< Conversions overwritten before they could be read */
+    uint32_t dropped;       /**< Oldest samples discarded because the buffer was full */
+    uint32_t read_errors;   /**< Conversion register reads that failed */
+} ads1115_stream_stats_t;
+
+/**
+ * @brief Starts continuous conversions on a channel, streamed into a ring buffer.
+ * @details The comparator is programmed as a conversion-ready signal, so ALERT/RDY pulses low
+ *          at the end of every conversion at the data rate set in i2c_ads1115_start() (up to
+ *          860 SPS). Each edge wakes a reader task that fetches the conversion register with a
+ *          single 2-byte read; nothing is polled and the bus is free between samples.
+ * @param channel The ADC channel to stream (0 to 3).
+ * @param alert_pin GPIO connected to ALERT/RDY (open-drain; the internal pull-up is enabled).
+ * @param capacity Number of samples the ring buffer holds. When it is full the oldest sample
+ *                 is discarded.
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if the driver is not started or already
+ *         streaming, or another error code on failure.
+ * @note While streaming, i2c_ads1115_read_single_ended() returns ESP_ERR_INVALID_STATE.
+ */
+esp_err_t i2c_ads1115_stream_start(ads1115_channel_t channel, gpio_num_t alert_pin, size_t capacity);
+
+/**
+ * @brief Takes samples from the stream buffer.
+ * @details Waits up to timeout_ms for the first sample, then returns it together with every
+ *          sample already buffered, up to max.
+ * @param samples Where the samples are copied, oldest first.
+ * @param max Capacity of samples.
+ * @param[out] count Number of samples copied.
+ * @param timeout_ms Maximum wait for the first sample; negative waits forever.
+ * @return ESP_OK on success, ESP_ERR_TIMEOUT if no sample arrived, or ESP_ERR_INVALID_STATE
+ *         if the stream is not running.
+ * @note Must not be called concurrently with i2c_ads1115_stream_stop().
+ */
+esp_err_t i2c_ads1115_stream_read(ads1115_sample_t *samples, size_t max, size_t *count, int timeout_ms);
+
+/**
+ * @brief Stops the stream and returns the ADS1115 to single-shot mode.
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t i2c_ads1115_stream_stop(void);
+
+/**
+ * @brief Gets the counters of the current (or last) stream.
+ * @param out Where the counters are copied.
+ * @return ESP_OK on success, or ESP_ERR_INVALID_ARG.
+ */
+esp_err_t i2c_ads1115_stream_get_stats(ads1115_stream_stats_t *out);
+
 
 
 #endif // I2C_ADS1115_DRIVER_H
\ No newline at end of file
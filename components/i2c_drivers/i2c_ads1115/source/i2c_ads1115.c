@@ -1,13 +1,21 @@
 #include "i2c_ads1115.h"
 #include "i2c_mgmt_driver.h"
+#include "i2c_mgmt_sched.h"
 #include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "driver/gpio.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include <string.h>
 
 /* ==== Registros ADS1115 ==== */
 #define ADS1115_REG_CONVERSION   0x00
 #define ADS1115_REG_CONFIG       0x01
+#define ADS1115_REG_LO_THRESH    0x02
+#define ADS1115_REG_HI_THRESH    0x03
 
 /* ==== Bits de CONFIG (datasheet) ==== */
 #define ADS1115_OS_SINGLE        (1u << 15)      // Start single conversion / OS bit
@@ -34,6 +42,7 @@ static inline uint16_t cfg_bits_pga(ads1115_pga_t pga) {
     if (pga < ADS1115_PGA_6V144 || pga > ADS1115_PGA_0V256) pga = ADS1115_PGA_2V048;
     return map[pga];
 }
+#define ADS1115_PGA_MASK         0x0E00
 /* Modo single-shot (bit 8 = 1) */
 #define ADS1115_MODE_SINGLE      0x0100
 /* DR en [7:5] (según enum del header) */
@@ -44,91 +53,186 @@ static inline uint16_t cfg_bits_dr(ads1115_dr_t dr) {
 }
 /* Comparator deshabilitado: cola=11b (bits [1:0]) y valores por defecto seguros */
 #define ADS1115_COMP_DISABLE     0x0003
+/* Comparator como conversion-ready: cola=00b (ALERT tras cada conversión), sin latch, activo bajo */
+#define ADS1115_COMP_RDY         0x0000
+#define ADS1115_MODE_MASK        0x0100
+#define ADS1115_COMP_MASK        0x001F
+/* Umbrales que convierten ALERT/RDY en señal de conversión lista: Hi MSB=1, Lo MSB=0 */
+#define ADS1115_RDY_HI_THRESH    0x8000
+#define ADS1115_RDY_LO_THRESH    0x0000
+/* Umbrales de power-on reset */
+#define ADS1115_POR_HI_THRESH    0x7FFF
+#define ADS1115_POR_LO_THRESH    0x8000
+
+/* Tarea de streaming: debajo del planificador I2C, que ejecuta sus lecturas */
+#define ADS1115_STREAM_TASK_STACK 3072
+#define ADS1115_STREAM_TASK_PRIO  4
 
 /* ==== Estado interno simple (un único ADS1115) ==== */
 static const char *TAG = "i2c_ads1115";
 static struct {
+    i2c_mgmt_handle_t bus;  // bus compartido donde cuelga el ADS1115
     uint8_t  addr;          // dirección I2C 7-bit (0x48..0x4B)
     uint16_t cfg_base;      // config base: PGA, DR, modo, comparator off (sin OS)
+    ads1115_pga_t pga;      // PGA de las lecturas single-ended
     int      timeout_ms;    // timeout por defecto para operaciones I2C/poll
     bool     ready;         // inicializado
+    bool     streaming;     // modo continuo activo: el puntero queda fijo en CONVERSION
 } s_dev = {0};
 
+/* ==== Espera de conversiones (one-shot esp_timer) ==== */
+static struct {
+    esp_timer_handle_t timer;    // vence en el instante pedido
+    SemaphoreHandle_t  expired;  // el callback del timer lo libera
+    SemaphoreHandle_t  lock;     // un solo esperador por vez: el timer es único
+} s_wait = {0};
+
+/* ==== Estado del modo continuo (ALERT/RDY) ==== */
+static struct {
+    gpio_num_t    alert_pin;
+    QueueHandle_t samples;        // buffer circular de ads1115_sample_t
+    TaskHandle_t  task;
+    SemaphoreHandle_t done;       // la tarea avisa que terminó
+    volatile bool stop;
+    volatile int64_t edge_us;     // instante del último flanco de ALERT/RDY
+    portMUX_TYPE  lock;
+    ads1115_stream_stats_t stats;
+} s_stream = { .alert_pin = GPIO_NUM_NC, .lock = portMUX_INITIALIZER_UNLOCKED };
+
 /* ==== Helpers I2C ==== */
+/* Cada acceso a registro es una transacción propia en la clase de energía: el bus
+   queda libre entre el disparo, el sondeo y la lectura, y el tráfico de seguridad
+   encolado se atiende antes. */
 static esp_err_t write_u16(uint8_t addr, uint8_t reg, uint16_t val, int timeout_ms)
 {
     uint8_t frame[3];
     frame[0] = reg;
     frame[1] = (uint8_t)((val >> 8) & 0xFF);
     frame[2] = (uint8_t)(val & 0xFF);
-    return i2c_mgmt_write(addr, frame, sizeof(frame), timeout_ms);
+
+    i2c_mgmt_txn_t txn = {
+        .device_addr = addr,
+        .cls = I2C_MGMT_CLASS_ENERGY,
+        .timeout_ms = timeout_ms,
+        .ops = { { .type = I2C_MGMT_OP_WRITE, .tx = frame, .tx_len = sizeof(frame) } },
+        .ops_count = 1,
+    };
+    return i2c_mgmt_submit_sync(s_dev.bus, &txn);
 }
 
 static esp_err_t read_u16(uint8_t addr, uint8_t reg, uint16_t *out, int timeout_ms)
 {
-    esp_err_t err = i2c_mgmt_write(addr, &reg, 1, timeout_ms);
-    if (err != ESP_OK) return err;
-
+    /* Puntero de registro + lectura en una sola transacción (repeated START) */
     uint8_t buf[2] = {0};
-    size_t len = 2;
-    err = i2c_mgmt_read(addr, buf, &len, timeout_ms);
+    i2c_mgmt_txn_t txn = {
+        .device_addr = addr,
+        .cls = I2C_MGMT_CLASS_ENERGY,
+        .timeout_ms = timeout_ms,
+        .ops = { { .type = I2C_MGMT_OP_WRITE_READ, .tx = &reg, .tx_len = 1, .rx = buf, .rx_len = sizeof(buf) } },
+        .ops_count = 1,
+    };
+    esp_err_t err = i2c_mgmt_submit_sync(s_dev.bus, &txn);
     if (err != ESP_OK) return err;
-    if (len != 2) return ESP_FAIL;
 
     *out = (uint16_t)((buf[0] << 8) | buf[1]);
     return ESP_OK;
 }
 
-/* Espera a que OS=1 (conversión completa); cede CPU en intervalos cortos */
-static esp_err_t wait_conversion_ready(uint8_t addr, int timeout_ms)
+/* Tiempo de conversión según DR, con 10% de margen por la tolerancia del oscilador interno */
+static uint32_t conversion_time_us(void)
 {
-    const int poll_step_ms = 1;
-    int elapsed = 0;
-    while (1) {
-        uint16_t cfg = 0;
-        esp_err_t err = read_u16(addr, ADS1115_REG_CONFIG, &cfg, timeout_ms);
-        if (err != ESP_OK) return err;
-        if (cfg & ADS1115_OS_SINGLE) return ESP_OK; // lista
+    static const uint16_t sps[] = { 8, 16, 32, 64, 128, 250, 475, 860 };
+    uint32_t t = 1000000u / sps[(s_dev.cfg_base >> 5) & 0x7u];
+    return t + t / 10;
+}
+
+static void wait_timer_cb(void *arg)
+{
+    (void)arg;
+    xSemaphoreGive(s_wait.expired);
+}
+
+static esp_err_t wait_init(void)
+{
+    if (s_wait.timer) return ESP_OK;
 
-        if (timeout_ms >= 0 && elapsed >= timeout_ms) return ESP_ERR_TIMEOUT;
-        vTaskDelay(pdMS_TO_TICKS(poll_step_ms));
-        elapsed += poll_step_ms;
+    s_wait.expired = xSemaphoreCreateBinary();
+    s_wait.lock = xSemaphoreCreateMutex();
+    const esp_timer_create_args_t args = { .callback = wait_timer_cb, .name = "ads1115_wait" };
+    if (!s_wait.expired || !s_wait.lock || esp_timer_create(&args, &s_wait.timer) != ESP_OK) {
+        if (s_wait.expired) vSemaphoreDelete(s_wait.expired);
+        if (s_wait.lock) vSemaphoreDelete(s_wait.lock);
+        s_wait.expired = s_wait.lock = NULL;
+        s_wait.timer = NULL;
+        return ESP_ERR_NO_MEM;
     }
+    return ESP_OK;
+}
+
+/* Espera hasta un instante sin redondear a ticks ni ocupar la CPU: un esp_timer one-shot
+   vence en el instante pedido y despierta a la tarea, que queda bloqueada mientras tanto */
+static void wait_until(int64_t deadline_us)
+{
+    int64_t remaining = deadline_us - esp_timer_get_time();
+    if (remaining <= 0) return;
+
+    xSemaphoreTake(s_wait.lock, portMAX_DELAY);
+    (void)xSemaphoreTake(s_wait.expired, 0);
+    if (esp_timer_start_once(s_wait.timer, (uint64_t)remaining) == ESP_OK) {
+        // El margen de dos ticks sólo cubre un timer que no llegó a disparar
+        if (xSemaphoreTake(s_wait.expired, pdMS_TO_TICKS(remaining / 1000) + 2) != pdTRUE)
+            (void)esp_timer_stop(s_wait.timer);
+    } else {
+        vTaskDelay(pdMS_TO_TICKS(remaining / 1000) + 1);
+    }
+    xSemaphoreGive(s_wait.lock);
 }
 
-/* Dispara single-shot en canal dado con la cfg_base actual */
-static esp_err_t trigger_single_shot(int channel, int timeout_ms)
+/* CONFIG de una entrada de barrido: base (DR, single-shot, comparador off) + MUX + PGA + OS */
+static uint16_t scan_config(const ads1115_scan_entry_t *e)
 {
-    uint16_t cfg = s_dev.cfg_base | mux_for_channel(channel) | ADS1115_OS_SINGLE;
-    return write_u16(s_dev.addr, ADS1115_REG_CONFIG, cfg, timeout_ms);
+    return (uint16_t)((s_dev.cfg_base & ~ADS1115_PGA_MASK)
+                      | (((uint16_t)e->mux & 0x7u) << 12)
+                      | cfg_bits_pga(e->pga)
+                      | ADS1115_OS_SINGLE);
 }
 
 /* ==== API pública (según header dado) ==== */
-esp_err_t i2c_ads1115_start(uint8_t i2c_addr, ads1115_pga_t pga, ads1115_dr_t dr, int timeout_ms)
+esp_err_t i2c_ads1115_start(i2c_mgmt_handle_t bus, uint8_t i2c_addr, ads1115_pga_t pga, ads1115_dr_t dr,
+                            uint32_t speed_hz, int timeout_ms)
 {
+    if (!bus) return ESP_ERR_INVALID_ARG;
+
+    esp_err_t err = i2c_mgmt_device_config(bus, i2c_addr, speed_hz, timeout_ms);
+    if (err != ESP_OK) return err;
+    if ((err = wait_init()) != ESP_OK) return err;
+
+#if CONFIG_I2C_MGMT_CALIBRATE_ON_START
+    {
+        static const uint32_t speeds[] = { I2C_MGMT_SPEED_STANDARD, I2C_MGMT_SPEED_FAST, I2C_MGMT_SPEED_FAST_PLUS };
+        i2c_mgmt_calib_result_t results[sizeof(speeds) / sizeof(speeds[0])];
+        (void)i2c_mgmt_calibrate(bus, i2c_addr, ADS1115_REG_CONFIG, 2, speeds, sizeof(speeds) / sizeof(speeds[0]),
+                                 CONFIG_I2C_MGMT_CALIBRATE_ITERATIONS, results);
+    }
+#endif
+
+    s_dev.bus = bus;
     s_dev.addr = i2c_addr;
     s_dev.timeout_ms = timeout_ms;
+    s_dev.pga = pga;
     s_dev.cfg_base = ADS1115_MODE_SINGLE
                    | cfg_bits_pga(pga)
                    | cfg_bits_dr(dr)
                    | ADS1115_COMP_DISABLE;
 
     /* Pequeña verificación de comunicación: leer CONFIG */
-    esp_err_t err = i2c_mgmt_begin_transaction();
-    if (err != ESP_OK) return err;
-
     uint16_t cfg = 0;
-    err = read_u16(s_dev.addr, ADS1115_REG_CONFIG, &cfg, s_dev.timeout_ms);
-
-    {
-        esp_err_t end_err = i2c_mgmt_end_transaction();
-        if (err == ESP_OK) err = end_err;
-    }
+    err = read_u16(s_dev.addr, ADS1115_REG_CONFIG, &cfg, I2C_MGMT_TIMEOUT_DEVICE);
 
     if (err == ESP_OK) {
         s_dev.ready = true;
-        ESP_LOGI(TAG, "ADS1115 @0x%02X: start OK (PGA=%d, DR=%d, timeout=%d ms)",
-                 s_dev.addr, (int)pga, (int)dr, s_dev.timeout_ms);
+        ESP_LOGI(TAG, "ADS1115 @0x%02X: start OK (PGA=%d, DR=%d, %u Hz, timeout=%d ms)",
+                 s_dev.addr, (int)pga, (int)dr, (unsigned)speed_hz, s_dev.timeout_ms);
     } else {
         s_dev.ready = false;
         ESP_LOGE(TAG, "ADS1115 @0x%02X: no responde (err=%s)",
@@ -139,31 +243,336 @@ esp_err_t i2c_ads1115_start(uint8_t i2c_addr, ads1115_pga_t pga, ads1115_dr_t dr
 
 esp_err_t i2c_ads1115_read_single_ended(ads1115_channel_t channel, int16_t *value)
 {
-    if (!s_dev.ready || !value) return ESP_ERR_INVALID_STATE;
+    if (!s_dev.ready || s_dev.streaming || !value) return ESP_ERR_INVALID_STATE;
     if (channel < ADS1115_CHANNEL_0 || channel > ADS1115_CHANNEL_3) return ESP_ERR_INVALID_ARG;
 
-    esp_err_t err = i2c_mgmt_begin_transaction();
+    const ads1115_scan_entry_t entry = { .mux = (ads1115_mux_t)(ADS1115_MUX_SINGLE_0 + channel), .pga = s_dev.pga };
+    return i2c_ads1115_scan(&entry, 1, value);
+}
+
+esp_err_t i2c_ads1115_scan(const ads1115_scan_entry_t *entries, size_t count, int16_t *values)
+{
+    if (!s_dev.ready || s_dev.streaming) return ESP_ERR_INVALID_STATE;
+    if (!entries || !values || count == 0) return ESP_ERR_INVALID_ARG;
+    for (size_t i = 0; i < count; ++i) {
+        if (entries[i].mux < ADS1115_MUX_DIFF_0_1 || entries[i].mux > ADS1115_MUX_SINGLE_3) return ESP_ERR_INVALID_ARG;
+    }
+
+    const uint32_t conv_us = conversion_time_us();
+    const int64_t start_us = esp_timer_get_time();
+    const int64_t limit_us = start_us + (int64_t)s_dev.timeout_ms * 1000 * (int64_t)count;
+
+    /* Disparo del primer canal; a partir de ahí cada transacción lee el resultado del canal
+       actual y, sin soltar el bus, dispara el siguiente */
+    esp_err_t err = write_u16(s_dev.addr, ADS1115_REG_CONFIG, scan_config(&entries[0]), I2C_MGMT_TIMEOUT_DEVICE);
     if (err != ESP_OK) return err;
+    int64_t ready_at = esp_timer_get_time() + conv_us;
 
-    /* 1) Dispara conversión en el canal */
-    if ((err = trigger_single_shot((int)channel, s_dev.timeout_ms)) != ESP_OK) goto out;
+    size_t i = 0;
+    while (i < count) {
+        wait_until(ready_at);
 
-    /* 2) Espera fin de conversión (OS=1) */
-    if ((err = wait_conversion_ready(s_dev.addr, s_dev.timeout_ms)) != ESP_OK) goto out;
+        uint8_t reg_cfg = ADS1115_REG_CONFIG;
+        uint8_t reg_conv = ADS1115_REG_CONVERSION;
+        uint8_t status[2] = {0};
+        uint8_t data[2] = {0};
+        uint8_t next[3] = {0};
+        i2c_mgmt_txn_t txn = {
+            .device_addr = s_dev.addr,
+            .cls = I2C_MGMT_CLASS_ENERGY,
+            .timeout_ms = I2C_MGMT_TIMEOUT_DEVICE,
+            .ops = {
+                { .type = I2C_MGMT_OP_WRITE_READ, .tx = &reg_cfg, .tx_len = 1, .rx = status, .rx_len = sizeof(status) },
+                { .type = I2C_MGMT_OP_WRITE_READ, .tx = &reg_conv, .tx_len = 1, .rx = data, .rx_len = sizeof(data) },
+            },
+            .ops_count = 2,
+        };
+        if (i + 1 < count) {
+            uint16_t cfg = scan_config(&entries[i + 1]);
+            next[0] = ADS1115_REG_CONFIG;
+            next[1] = (uint8_t)(cfg >> 8);
+            next[2] = (uint8_t)(cfg & 0xFF);
+            txn.ops[txn.ops_count++] = (i2c_mgmt_op_t){ .type = I2C_MGMT_OP_WRITE, .tx = next, .tx_len = sizeof(next) };
+        }
 
-    /* 3) Lee el registro de conversión */
-    {
-        uint16_t u16 = 0;
-        err = read_u16(s_dev.addr, ADS1115_REG_CONVERSION, &u16, s_dev.timeout_ms);
-        if (err == ESP_OK) {
-            *value = (int16_t)u16; // formato nativo del ADS1115
+        if ((err = i2c_mgmt_submit_sync(s_dev.bus, &txn)) != ESP_OK) return err;
+
+        if (!(status[0] & (ADS1115_OS_SINGLE >> 8))) {
+            /* Conversión más lenta que lo previsto: el cambio de MUX/PGA la invalidó y el OS
+               escrito no tuvo efecto. Se deja terminar y se repite el canal. */
+            if (esp_timer_get_time() > limit_us) return ESP_ERR_TIMEOUT;
+            ESP_LOGD(TAG, "Scan entry %u not ready, retrying", (unsigned)i);
+            wait_until(esp_timer_get_time() + conv_us);
+            err = write_u16(s_dev.addr, ADS1115_REG_CONFIG, scan_config(&entries[i]), I2C_MGMT_TIMEOUT_DEVICE);
+            if (err != ESP_OK) return err;
+            ready_at = esp_timer_get_time() + conv_us;
+            continue;
         }
+
+        values[i] = (int16_t)((data[0] << 8) | data[1]);
+        ready_at = esp_timer_get_time() + conv_us;
+        i++;
     }
 
-out:
-    {
-        esp_err_t end_err = i2c_mgmt_end_transaction();
-        if (err == ESP_OK) err = end_err;
+    ESP_LOGD(TAG, "Scan of %u entries in %lld us", (unsigned)count, (long long)(esp_timer_get_time() - start_us));
+    return ESP_OK;
+}
+
+/* ==== Auto-rango ==== */
+
+/* Umbrales de auto-rango en cuentas: bajar la ganancia por encima de ~91% del fondo de
+   escala, subirla si con la ganancia siguiente la lectura quedaría por debajo de ~73% */
+#define ADS1115_AUTORANGE_HIGH   30000
+#define ADS1115_AUTORANGE_TARGET 24000
+
+int32_t i2c_ads1115_fsr_uv(ads1115_pga_t pga)
+{
+    static const int32_t fsr_uv[] = { 6144000, 4096000, 2048000, 1024000, 512000, 256000 };
+    if (pga < ADS1115_PGA_6V144 || pga > ADS1115_PGA_0V256) pga = ADS1115_PGA_2V048;
+    return fsr_uv[pga];
+}
+
+ads1115_pga_t i2c_ads1115_autorange(ads1115_pga_t pga, int32_t peak, ads1115_pga_t lowest_gain,
+                                    ads1115_pga_t highest_gain)
+{
+    if (peak < 0) peak = -peak;
+
+    if (peak >= ADS1115_AUTORANGE_HIGH && pga > lowest_gain)
+        return (ads1115_pga_t)(pga - 1);
+
+    if (pga < highest_gain) {
+        /* Lectura prevista con la ganancia siguiente (el paso 6.144 -> 4.096 V no es x2) */
+        int64_t predicted = (int64_t)peak * i2c_ads1115_fsr_uv(pga) / i2c_ads1115_fsr_uv((ads1115_pga_t)(pga + 1));
+        if (predicted < ADS1115_AUTORANGE_TARGET)
+            return (ads1115_pga_t)(pga + 1);
+    }
+    return pga;
+}
+
+/* ==== Modo continuo ==== */
+
+/* Flanco de bajada de ALERT/RDY: una conversión nueva está en el registro */
+static void IRAM_ATTR alert_isr(void *arg)
+{
+    (void)arg;
+    BaseType_t hp_woken = pdFALSE;
+
+    portENTER_CRITICAL_ISR(&s_stream.lock);
+    s_stream.edge_us = esp_timer_get_time();
+    portEXIT_CRITICAL_ISR(&s_stream.lock);
+
+    vTaskNotifyGiveFromISR(s_stream.task, &hp_woken);
+    if (hp_woken) portYIELD_FROM_ISR();
+}
+
+/* Inserta una muestra; si el buffer está lleno se descarta la más vieja */
+static void push_sample(const ads1115_sample_t *sample)
+{
+    if (xQueueSend(s_stream.samples, sample, 0) != pdTRUE) {
+        ads1115_sample_t oldest;
+        (void)xQueueReceive(s_stream.samples, &oldest, 0);
+        (void)xQueueSend(s_stream.samples, sample, 0);
+        portENTER_CRITICAL(&s_stream.lock);
+        s_stream.stats.dropped++;
+        portEXIT_CRITICAL(&s_stream.lock);
     }
+}
+
+/* Por cada flanco lee CONVERSION. El puntero ya apunta ahí, así que alcanza con
+   una lectura de 2 bytes, sin reescribir el puntero ni sondear el OS. */
+static void stream_task(void *arg)
+{
+    (void)arg;
+    uint8_t buf[2];
+    i2c_mgmt_txn_t txn = {
+        .device_addr = s_dev.addr,
+        .cls = I2C_MGMT_CLASS_ENERGY,
+        .timeout_ms = I2C_MGMT_TIMEOUT_DEVICE,
+        .ops = { { .type = I2C_MGMT_OP_READ, .rx = buf, .rx_len = sizeof(buf) } },
+        .ops_count = 1,
+    };
+
+    while (1) {
+        uint32_t edges = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (s_stream.stop) break;
+
+        portENTER_CRITICAL(&s_stream.lock);
+        int64_t edge_us = s_stream.edge_us;
+        /* El registro guarda sólo la última conversión: los flancos acumulados se perdieron */
+        s_stream.stats.missed += edges - 1;
+        portEXIT_CRITICAL(&s_stream.lock);
+
+        esp_err_t err = i2c_mgmt_submit_sync(s_dev.bus, &txn);
+        if (err != ESP_OK) {
+            portENTER_CRITICAL(&s_stream.lock);
+            s_stream.stats.read_errors++;
+            portEXIT_CRITICAL(&s_stream.lock);
+            continue;
+        }
+
+        ads1115_sample_t sample = {
+            .raw = (int16_t)((buf[0] << 8) | buf[1]),
+            .timestamp_us = edge_us,
+        };
+        push_sample(&sample);
+
+        portENTER_CRITICAL(&s_stream.lock);
+        s_stream.stats.samples++;
+        portEXIT_CRITICAL(&s_stream.lock);
+    }
+
+    xSemaphoreGive(s_stream.done);
+    vTaskDelete(NULL);
+}
+
+/* Deja el ADS1115 en single-shot con el comparador apagado (deja de convertir) */
+static esp_err_t stop_continuous(void)
+{
+    esp_err_t err = write_u16(s_dev.addr, ADS1115_REG_CONFIG, s_dev.cfg_base, I2C_MGMT_TIMEOUT_DEVICE);
+    esp_err_t err_lo = write_u16(s_dev.addr, ADS1115_REG_LO_THRESH, ADS1115_POR_LO_THRESH, I2C_MGMT_TIMEOUT_DEVICE);
+    esp_err_t err_hi = write_u16(s_dev.addr, ADS1115_REG_HI_THRESH, ADS1115_POR_HI_THRESH, I2C_MGMT_TIMEOUT_DEVICE);
+    if (err == ESP_OK) err = err_lo;
+    if (err == ESP_OK) err = err_hi;
     return err;
 }
+
+static void stream_release(void)
+{
+    if (s_stream.alert_pin != GPIO_NUM_NC) {
+        (void)gpio_isr_handler_remove(s_stream.alert_pin);
+        s_stream.alert_pin = GPIO_NUM_NC;
+    }
+    if (s_stream.task) {
+        s_stream.stop = true;
+        xTaskNotifyGive(s_stream.task);
+        xSemaphoreTake(s_stream.done, portMAX_DELAY);
+        s_stream.task = NULL;
+    }
+    if (s_stream.samples) {
+        vQueueDelete(s_stream.samples);
+        s_stream.samples = NULL;
+    }
+    if (s_stream.done) {
+        vSemaphoreDelete(s_stream.done);
+        s_stream.done = NULL;
+    }
+}
+
+esp_err_t i2c_ads1115_stream_start(ads1115_channel_t channel, gpio_num_t alert_pin, size_t capacity)
+{
+    if (!s_dev.ready || s_dev.streaming) return ESP_ERR_INVALID_STATE;
+    if (channel < ADS1115_CHANNEL_0 || channel > ADS1115_CHANNEL_3) return ESP_ERR_INVALID_ARG;
+    if (!GPIO_IS_VALID_GPIO(alert_pin) || capacity == 0) return ESP_ERR_INVALID_ARG;
+
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err == ESP_ERR_INVALID_STATE) {
+        err = ESP_OK; // ya instalado por otro módulo
+    } else if (err != ESP_OK) {
+        ESP_LOGE(TAG, "GPIO ISR service install failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    gpio_config_t io = {
+        .pin_bit_mask = 1ULL << alert_pin,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE, // ALERT/RDY es open-drain
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_NEGEDGE,
+    };
+    if ((err = gpio_config(&io)) != ESP_OK) return err;
+
+    memset(&s_stream.stats, 0, sizeof(s_stream.stats));
+    s_stream.stop = false;
+    s_stream.samples = xQueueCreate(capacity, sizeof(ads1115_sample_t));
+    s_stream.done = xSemaphoreCreateBinary();
+    if (!s_stream.samples || !s_stream.done) {
+        stream_release();
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (xTaskCreate(stream_task, "ads1115_stream", ADS1115_STREAM_TASK_STACK, NULL,
+                    ADS1115_STREAM_TASK_PRIO, &s_stream.task) != pdPASS) {
+        s_stream.task = NULL;
+        stream_release();
+        return ESP_ERR_NO_MEM;
+    }
+
+    if ((err = gpio_isr_handler_add(alert_pin, alert_isr, NULL)) != ESP_OK) {
+        stream_release();
+        return err;
+    }
+    s_stream.alert_pin = alert_pin;
+
+    /* Umbrales para RDY, luego CONFIG en modo continuo y por último el puntero queda en
+       CONVERSION para que cada muestra sea una lectura de 2 bytes */
+    uint16_t cfg = (s_dev.cfg_base & ~(ADS1115_MODE_MASK | ADS1115_COMP_MASK))
+                 | mux_for_channel((int)channel) | ADS1115_COMP_RDY;
+    if ((err = write_u16(s_dev.addr, ADS1115_REG_HI_THRESH, ADS1115_RDY_HI_THRESH, I2C_MGMT_TIMEOUT_DEVICE)) != ESP_OK ||
+        (err = write_u16(s_dev.addr, ADS1115_REG_LO_THRESH, ADS1115_RDY_LO_THRESH, I2C_MGMT_TIMEOUT_DEVICE)) != ESP_OK ||
+        (err = write_u16(s_dev.addr, ADS1115_REG_CONFIG, cfg, I2C_MGMT_TIMEOUT_DEVICE)) != ESP_OK) {
+        stream_release();
+        (void)stop_continuous();
+        return err;
+    }
+
+    uint8_t reg = ADS1115_REG_CONVERSION;
+    i2c_mgmt_txn_t txn = {
+        .device_addr = s_dev.addr,
+        .cls = I2C_MGMT_CLASS_ENERGY,
+        .timeout_ms = I2C_MGMT_TIMEOUT_DEVICE,
+        .ops = { { .type = I2C_MGMT_OP_WRITE, .tx = &reg, .tx_len = 1 } },
+        .ops_count = 1,
+    };
+    if ((err = i2c_mgmt_submit_sync(s_dev.bus, &txn)) != ESP_OK) {
+        stream_release();
+        (void)stop_continuous();
+        return err;
+    }
+
+    s_dev.streaming = true;
+    ESP_LOGI(TAG, "ADS1115 @0x%02X: streaming AIN%d, ALERT/RDY on GPIO%d, buffer=%u samples",
+             s_dev.addr, (int)channel, (int)alert_pin, (unsigned)capacity);
+    return ESP_OK;
+}
+
+esp_err_t i2c_ads1115_stream_read(ads1115_sample_t *samples, size_t max, size_t *count, int timeout_ms)
+{
+    if (!samples || !count || max == 0) return ESP_ERR_INVALID_ARG;
+    *count = 0;
+    if (!s_dev.streaming) return ESP_ERR_INVALID_STATE;
+
+    /* Espera la primera muestra; las siguientes se toman sólo si ya están */
+    TickType_t wait = (timeout_ms < 0) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    if (xQueueReceive(s_stream.samples, &samples[0], wait) != pdTRUE) return ESP_ERR_TIMEOUT;
+
+    size_t n = 1;
+    while (n < max && xQueueReceive(s_stream.samples, &samples[n], 0) == pdTRUE)
+        n++;
+
+    *count = n;
+    return ESP_OK;
+}
+
+esp_err_t i2c_ads1115_stream_stop(void)
+{
+    if (!s_dev.streaming) return ESP_ERR_INVALID_STATE;
+
+    stream_release();
+    s_dev.streaming = false;
+
+    esp_err_t err = stop_continuous();
+    ESP_LOGI(TAG, "ADS1115 @0x%02X: streaming stopped (%u samples, %u missed, %u dropped, %u errors)",
+             s_dev.addr, (unsigned)s_stream.stats.samples, (unsigned)s_stream.stats.missed,
+             (unsigned)s_stream.stats.dropped, (unsigned)s_stream.stats.read_errors);
+    return err;
+}
+
+esp_err_t i2c_ads1115_stream_get_stats(ads1115_stream_stats_t *out)
+{
+    if (!out) return ESP_ERR_INVALID_ARG;
+
+    portENTER_CRITICAL(&s_stream.lock);
+    *out = s_stream.stats;
+    portEXIT_CRITICAL(&s_stream.lock);
+    return ESP_OK;
+}
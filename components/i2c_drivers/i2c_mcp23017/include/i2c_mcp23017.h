@@ -21,6 +21,7 @@
 #include <stdbool.h>
 
 #include "esp_err.h"
+#include "i2c_mgmt_driver.h"
  
 // Máscaras de E/S pedidas
 /**
@@ -43,6 +44,14 @@
 #define GPIOB_OUT_MASK 0x30 // B4..B5
 #endif
 
+/**
+ * @brief MCP23017 ports.
+ */
+typedef enum {
+    MCP23017_PORT_A = 0,  /**< GPA0..GPA7 (OLATA) */
+    MCP23017_PORT_B = 1,  /**< GPB0..GPB7 (OLATB) */
+} mcp23017_port_t;
+
 /**
  * @brief Initializes the MCP23017 I/O expander over I2C.
  * @details This function sets up the MCP23017 by configuring its registers
@@ -51,16 +60,23 @@
  * - IODIRB = 0xCF  (GPB0..3 IN, GPB4..5 OUT, GPB6..7 IN)
  * - GPPUA  = 0x0F  (Pull-ups on GPA0..3)
  * - GPPUB  = 0xCF  (Pull-ups on GPB0..3, GPB6..7)
- * - IOCON  = 0x20  (Bank=0, MIRROR=0, SEQOP=1, DISSLW=0, HAEN=1, ODR=0, INTPOL=0)
+ * - IOCON  = 0x20  (Bank=0, MIRROR=0, SEQOP=1, DISSLW=0, HAEN=0, ODR=0, INTPOL=0)
+ * With BANK=0 and SEQOP=1 the register pointer toggles between the A and B register of a
+ * pair, so every A/B pair is written or read in a single two-byte transfer.
+ * The output latches are cleared and read back into a shadow copy, which every later
+ * output update starts from (no OLAT read before each write).
  * 
+ * @param bus The bus the MCP23017 is connected to (see i2c_mgmt_start()).
  * @param i2c_addr The I2C address of the MCP23017 (0x20 to 0x27).
+ * @param speed_hz The SCL speed used for this device (the MCP23017 supports up to Fast-mode Plus
+ *        on this controller).
  * @param timeout_ms The timeout for I2C operations in milliseconds.
  * @return ESP_OK on success, or an error code on failure.
  * @note This function should be called before any other MCP23017 operations.
  * @note It is expected that the I2C management driver has been initialized before calling this
  * function.
  */
-esp_err_t i2c_mcp23017_start(uint8_t i2c_addr, int timeout_ms);
+esp_err_t i2c_mcp23017_start(i2c_mgmt_handle_t bus, uint8_t i2c_addr, uint32_t speed_hz, int timeout_ms);
 
 /**
  * @brief Configures the MCP23017 registers for setting up the internal pull-ups for the inputs pins.
@@ -108,6 +124,52 @@ esp_err_t i2c_mcp23017_write_gpioa_outputs(uint8_t value);
  */
 esp_err_t i2c_mcp23017_write_gpiob_outputs(uint8_t value);
 
+/**
+ * @brief Drives high the given output pins of a port, leaving the others untouched.
+ * @details The new latch value is computed from the shadow copy and written in a single
+ *          I2C transaction; nothing is sent if the outputs already have that value.
+ * @param port Port to update.
+ * @param mask Pins to set. Bits of pins configured as inputs are ignored.
+ * @return ESP_OK on success, or an error code on failure (the shadow copy is not changed).
+ */
+esp_err_t i2c_mcp23017_set_outputs(mcp23017_port_t port, uint8_t mask);
+
+/**
+ * @brief Drives low the given output pins of a port, leaving the others untouched.
+ * @param port Port to update.
+ * @param mask Pins to clear. Bits of pins configured as inputs are ignored.
+ * @return ESP_OK on success, or an error code on failure.
+ * @see i2c_mcp23017_set_outputs()
+ */
+esp_err_t i2c_mcp23017_clear_outputs(mcp23017_port_t port, uint8_t mask);
+
+/**
+ * @brief Inverts the given output pins of a port, leaving the others untouched.
+ * @param port Port to update.
+ * @param mask Pins to toggle. Bits of pins configured as inputs are ignored.
+ * @return ESP_OK on success, or an error code on failure.
+ * @see i2c_mcp23017_set_outputs()
+ */
+esp_err_t i2c_mcp23017_toggle_outputs(mcp23017_port_t port, uint8_t mask);
+
+/**
+ * @brief Sets some output pins and clears others of a port in one I2C transaction.
+ * @param port Port to update.
+ * @param set_mask Pins to drive high.
+ * @param clear_mask Pins to drive low (a pin in both masks ends up low).
+ * @return ESP_OK on success, or an error code on failure.
+ * @see i2c_mcp23017_set_outputs()
+ */
+esp_err_t i2c_mcp23017_modify_outputs(mcp23017_port_t port, uint8_t set_mask, uint8_t clear_mask);
+
+/**
+ * @brief Gets the last value written to the output latch of a port (shadow copy, no I2C access).
+ * @param port Port.
+ * @param value Where the OLAT value is stored.
+ * @return ESP_OK on success, or ESP_ERR_INVALID_ARG / ESP_ERR_INVALID_STATE.
+ */
+esp_err_t i2c_mcp23017_get_outputs(mcp23017_port_t port, uint8_t *value);
+
 /**
  * @brief Reads inputs from the GPIOA port of the MCP23017.
  * @details This function reads a byte value from the GPIOA port of the MCP23017
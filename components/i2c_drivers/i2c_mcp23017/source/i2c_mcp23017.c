@@ -1,8 +1,11 @@
 #include <string.h>
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 
 #include "i2c_mgmt_driver.h"
+#include "i2c_mgmt_sched.h"
 #include "i2c_mcp23017.h"
 
 // Dirección de registros (BANK=0 por defecto)
@@ -28,78 +31,149 @@
 #define MCP23017_OLATA    0x14
 #define MCP23017_OLATB    0x15
 
+// IOCON: BANK=0, SEQOP=1 (puntero alterna dentro del par A/B), resto en 0
+#define MCP23017_IOCON_SEQOP 0x20
+#define IOCON_VALUE          MCP23017_IOCON_SEQOP
+
 static const int MCP23017_I2C_ADDRESS = 0x20; // Dirección I2C del MCP23017 (0x20 a 0x27)
 static const char *TAG = "i2c_mcp23017";
 
+static i2c_mgmt_handle_t mcp23017_bus = NULL;  // Bus donde cuelga el expansor
 static uint8_t mcp23017_i2c_addr = MCP23017_I2C_ADDRESS;
-static int mcp23017_timeout_ms = 1000; // Timeout por defecto en milisegundos
+static const int mcp23017_timeout_ms = I2C_MGMT_TIMEOUT_DEVICE; // Timeout configurado en i2c_mgmt
+static SemaphoreHandle_t olat_mutex = NULL; // Serializa las actualizaciones de OLAT y su copia
+
+// Copia de OLATA/OLATB: las salidas se calculan sobre ella sin leer el registro antes de escribir
+static uint8_t olat_shadow[2] = { 0x00, 0x00 };
+static const uint8_t OLAT_REG[2]  = { MCP23017_OLATA, MCP23017_OLATB };
+static const uint8_t OUT_MASK[2]  = { GPIOA_OUT_MASK, GPIOB_OUT_MASK };
+
+// Cada acceso es una transacción de la clase de seguridad del planificador I2C
+static esp_err_t submit(uint8_t dev_addr, const i2c_mgmt_op_t *op, int timeout_ms)
+{
+    i2c_mgmt_txn_t txn = {
+        .device_addr = dev_addr,
+        .cls = I2C_MGMT_CLASS_SECURITY,
+        .timeout_ms = timeout_ms,
+        .ops = { *op },
+        .ops_count = 1,
+    };
+    return i2c_mgmt_submit_sync(mcp23017_bus, &txn);
+}
 
 static esp_err_t write_reg(uint8_t dev_addr, uint8_t reg, uint8_t val, int timeout_ms)
 {
     uint8_t frame[2] = { reg, val };
-    return i2c_mgmt_write(dev_addr, frame, sizeof(frame), timeout_ms);
+    i2c_mgmt_op_t op = { .type = I2C_MGMT_OP_WRITE, .tx = frame, .tx_len = sizeof(frame) };
+    return submit(dev_addr, &op, timeout_ms);
 }
 
 static esp_err_t read_reg(uint8_t dev_addr, uint8_t reg, uint8_t *val, int timeout_ms)
 {
-    esp_err_t err;
-
-    // Setea el puntero de registro
-    err = i2c_mgmt_write(dev_addr, &reg, 1, timeout_ms);
-    if (err != ESP_OK)
-        return err;
-
-    size_t len = 1;
-    err = i2c_mgmt_read(dev_addr, val, &len, timeout_ms);
+    // Puntero de registro + lectura en una sola transacción (repeated START)
+    i2c_mgmt_op_t op = { .type = I2C_MGMT_OP_WRITE_READ, .tx = &reg, .tx_len = 1, .rx = val, .rx_len = 1 };
+    return submit(dev_addr, &op, timeout_ms);
+}
 
-    if (err != ESP_OK) 
-        return err;
-    return (len == 1) ? ESP_OK : ESP_FAIL;
+// Escritura del par A/B en una sola transferencia. Con BANK=0 y SEQOP=1 el puntero alterna
+// entre el registro A y el B, así que reg debe ser el registro A del par
+static esp_err_t write_reg_pair(uint8_t dev_addr, uint8_t reg, uint8_t val_a, uint8_t val_b, int timeout_ms)
+{
+    uint8_t frame[3] = { reg, val_a, val_b };
+    i2c_mgmt_op_t op = { .type = I2C_MGMT_OP_WRITE, .tx = frame, .tx_len = sizeof(frame) };
+    return submit(dev_addr, &op, timeout_ms);
 }
 
-esp_err_t i2c_mcp23017_start(uint8_t i2c_addr, int timeout_ms)
+// Lectura del par A/B en una sola transferencia (mismo comportamiento de puntero que la escritura)
+static esp_err_t read_reg_pair(uint8_t dev_addr, uint8_t reg, uint8_t vals[2], int timeout_ms)
 {
-    mcp23017_i2c_addr = i2c_addr;
-    mcp23017_timeout_ms = timeout_ms;
+    i2c_mgmt_op_t op = { .type = I2C_MGMT_OP_WRITE_READ, .tx = &reg, .tx_len = 1, .rx = vals, .rx_len = 2 };
+    return submit(dev_addr, &op, timeout_ms);
+}
 
-    esp_err_t err = i2c_mgmt_begin_transaction();
-    if (err != ESP_OK) 
-        return err;
+/**
+ * @brief Aplica set/clear/toggle sobre la copia de OLAT de un puerto y escribe el resultado.
+ * @details Sólo se tocan los bits de salida del puerto. Es una única escritura I2C (ninguna si
+ *          el valor no cambia) y la copia se actualiza sólo si la escritura fue aceptada.
+ */
+static esp_err_t update_olat(mcp23017_port_t port, uint8_t set_mask, uint8_t clear_mask, uint8_t toggle_mask)
+{
+    if (port != MCP23017_PORT_A && port != MCP23017_PORT_B)
+        return ESP_ERR_INVALID_ARG;
+    if (!olat_mutex)
+        return ESP_ERR_INVALID_STATE;
 
-    if ((err = write_reg(mcp23017_i2c_addr, MCP23017_IODIRA, IODIRA_VALUE, mcp23017_timeout_ms)) != ESP_OK) goto out;
-    if ((err = write_reg(mcp23017_i2c_addr, MCP23017_IODIRB, IODIRB_VALUE, mcp23017_timeout_ms)) != ESP_OK) goto out;
+    const uint8_t out_mask = OUT_MASK[port];
+    esp_err_t err = ESP_OK;
 
-    // Limpia OLAT/ GPIO para que salidas arranquen en 0 sin glitch
-    if ((err = write_reg(mcp23017_i2c_addr, MCP23017_OLATA, 0x00, mcp23017_timeout_ms)) != ESP_OK) goto out;
-    if ((err = write_reg(mcp23017_i2c_addr, MCP23017_OLATB, 0x00, mcp23017_timeout_ms)) != ESP_OK) goto out;
+    xSemaphoreTake(olat_mutex, portMAX_DELAY);
 
-out:
+    uint8_t olat = olat_shadow[port];
+    uint8_t new_olat = (uint8_t)((((olat | set_mask) & ~clear_mask) ^ toggle_mask) & out_mask) | (olat & ~out_mask);
+    if (new_olat != olat)
     {
-        esp_err_t end_err = i2c_mgmt_end_transaction();
-        if (err == ESP_OK) err = end_err;
-    }
-    if (err == ESP_OK) {
-        ESP_LOGI(TAG, "MCP23017(0x%02X) init: IODIRA=0x%02X, IODIRB=0x%02X",
-                 mcp23017_i2c_addr, IODIRA_VALUE, IODIRB_VALUE);
+        err = write_reg(mcp23017_i2c_addr, OLAT_REG[port], new_olat, mcp23017_timeout_ms);
+        if (err == ESP_OK)
+            olat_shadow[port] = new_olat;
     }
+
+    xSemaphoreGive(olat_mutex);
     return err;
 }
 
-esp_err_t i2c_mcp23017_set_pullups(uint8_t gppua_mask, uint8_t gppub_mask)
+esp_err_t i2c_mcp23017_start(i2c_mgmt_handle_t bus, uint8_t i2c_addr, uint32_t speed_hz, int timeout_ms)
 {
-    esp_err_t err = i2c_mgmt_begin_transaction();
-    if (err != ESP_OK) 
-        return err;
+    if (!bus)
+        return ESP_ERR_INVALID_ARG;
+
+    mcp23017_bus = bus;
+    mcp23017_i2c_addr = i2c_addr;
 
-    if ((err = write_reg(mcp23017_i2c_addr, MCP23017_GPPUA, gppua_mask, mcp23017_timeout_ms)) != ESP_OK) goto out;
-    if ((err = write_reg(mcp23017_i2c_addr, MCP23017_GPPUB, gppub_mask, mcp23017_timeout_ms)) != ESP_OK) goto out;
+    esp_err_t err = i2c_mgmt_device_config(mcp23017_bus, mcp23017_i2c_addr, speed_hz, timeout_ms);
+    if (err != ESP_OK)
+        return err;
 
+#if CONFIG_I2C_MGMT_CALIBRATE_ON_START
+    {
+        static const uint32_t speeds[] = { I2C_MGMT_SPEED_STANDARD, I2C_MGMT_SPEED_FAST, I2C_MGMT_SPEED_FAST_PLUS };
+        i2c_mgmt_calib_result_t results[sizeof(speeds) / sizeof(speeds[0])];
+        (void)i2c_mgmt_calibrate(mcp23017_bus, mcp23017_i2c_addr, MCP23017_IODIRA, 2, speeds, sizeof(speeds) / sizeof(speeds[0]),
+                                 CONFIG_I2C_MGMT_CALIBRATE_ITERATIONS, results);
+    }
+#endif
 
-out:
+    if (!olat_mutex)
     {
-        esp_err_t end_err = i2c_mgmt_end_transaction();
-        if (err == ESP_OK) err = end_err;
+        olat_mutex = xSemaphoreCreateMutex();
+        if (!olat_mutex)
+            return ESP_ERR_NO_MEM;
     }
+
+    // IOCON explícito: el acceso por pares no depende del estado que haya dejado otro firmware
+    if ((err = write_reg(mcp23017_i2c_addr, MCP23017_IOCON, IOCON_VALUE, mcp23017_timeout_ms)) != ESP_OK) return err;
+
+    if ((err = write_reg_pair(mcp23017_i2c_addr, MCP23017_IODIRA, IODIRA_VALUE, IODIRB_VALUE, mcp23017_timeout_ms)) != ESP_OK) return err;
+
+    // Limpia OLAT/ GPIO para que salidas arranquen en 0 sin glitch
+    if ((err = write_reg_pair(mcp23017_i2c_addr, MCP23017_OLATA, 0x00, 0x00, mcp23017_timeout_ms)) != ESP_OK) return err;
+
+    // La copia de OLAT parte de lo que quedó realmente en el expansor
+    uint8_t olat[2] = { 0 };
+    if ((err = read_reg_pair(mcp23017_i2c_addr, MCP23017_OLATA, olat, mcp23017_timeout_ms)) != ESP_OK) return err;
+
+    xSemaphoreTake(olat_mutex, portMAX_DELAY);
+    olat_shadow[MCP23017_PORT_A] = olat[0];
+    olat_shadow[MCP23017_PORT_B] = olat[1];
+    xSemaphoreGive(olat_mutex);
+
+    ESP_LOGI(TAG, "MCP23017(0x%02X) init: IODIRA=0x%02X, IODIRB=0x%02X, OLATA=0x%02X, OLATB=0x%02X",
+             mcp23017_i2c_addr, IODIRA_VALUE, IODIRB_VALUE, olat[0], olat[1]);
+    return ESP_OK;
+}
+
+esp_err_t i2c_mcp23017_set_pullups(uint8_t gppua_mask, uint8_t gppub_mask)
+{
+    esp_err_t err = write_reg_pair(mcp23017_i2c_addr, MCP23017_GPPUA, gppua_mask, gppub_mask, mcp23017_timeout_ms);
     
     if (err == ESP_OK) 
     {
@@ -111,79 +185,66 @@ out:
 
 esp_err_t i2c_mcp23017_write_gpioa_outputs(uint8_t value)
 {
-    esp_err_t err = i2c_mgmt_begin_transaction();
-    if (err != ESP_OK) return err;
-
-    // Leer OLATA para preservar bits de entrada (0..3)
-    uint8_t olat = 0;
-    if ((err = read_reg(mcp23017_i2c_addr, MCP23017_OLATA, &olat, mcp23017_timeout_ms)) != ESP_OK) goto out;
-
-    uint8_t new_olat = (olat & ~GPIOA_OUT_MASK) | (value & GPIOA_OUT_MASK);
-
-    if ((err = write_reg(mcp23017_i2c_addr, MCP23017_OLATA, new_olat, mcp23017_timeout_ms)) != ESP_OK) goto out;
-
-out:
-    {
-        esp_err_t end_err = i2c_mgmt_end_transaction();
-        if (err == ESP_OK) err = end_err;
-    }
-    return err;
+    // Preserva los bits de entrada (0..3), sólo modifica A4..A7
+    return update_olat(MCP23017_PORT_A, value, (uint8_t)~value, 0);
 }
 
 esp_err_t i2c_mcp23017_write_gpiob_outputs(uint8_t value)
 {
-    esp_err_t err = i2c_mgmt_begin_transaction();
-    if (err != ESP_OK) return err;
-
     // Preserva entradas (0..3 y 6..7), sólo modifica B4..B5
-    uint8_t olat = 0;
-    if ((err = read_reg(mcp23017_i2c_addr, MCP23017_OLATB, &olat, mcp23017_timeout_ms)) != ESP_OK) goto out;
+    return update_olat(MCP23017_PORT_B, value, (uint8_t)~value, 0);
+}
 
-    uint8_t new_olat = (olat & ~GPIOB_OUT_MASK) | (value & GPIOB_OUT_MASK);
+esp_err_t i2c_mcp23017_set_outputs(mcp23017_port_t port, uint8_t mask)
+{
+    return update_olat(port, mask, 0, 0);
+}
 
-    if ((err = write_reg(mcp23017_i2c_addr, MCP23017_OLATB, new_olat, mcp23017_timeout_ms)) != ESP_OK) goto out;
+esp_err_t i2c_mcp23017_clear_outputs(mcp23017_port_t port, uint8_t mask)
+{
+    return update_olat(port, 0, mask, 0);
+}
 
-out:
-    {
-        esp_err_t end_err = i2c_mgmt_end_transaction();
-        if (err == ESP_OK) err = end_err;
-    }
-    return err;
+esp_err_t i2c_mcp23017_toggle_outputs(mcp23017_port_t port, uint8_t mask)
+{
+    return update_olat(port, 0, 0, mask);
 }
 
-esp_err_t i2c_mcp23017_read_gpioa_inputs(uint8_t *value)
+esp_err_t i2c_mcp23017_modify_outputs(mcp23017_port_t port, uint8_t set_mask, uint8_t clear_mask)
 {
-    esp_err_t err = i2c_mgmt_begin_transaction();
-    if (err != ESP_OK) return err;
+    return update_olat(port, set_mask, clear_mask, 0);
+}
+
+esp_err_t i2c_mcp23017_get_outputs(mcp23017_port_t port, uint8_t *value)
+{
+    if (!value || (port != MCP23017_PORT_A && port != MCP23017_PORT_B))
+        return ESP_ERR_INVALID_ARG;
+    if (!olat_mutex)
+        return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(olat_mutex, portMAX_DELAY);
+    *value = olat_shadow[port];
+    xSemaphoreGive(olat_mutex);
+    return ESP_OK;
+}
 
+esp_err_t i2c_mcp23017_read_gpioa_inputs(uint8_t *value)
+{
     uint8_t gpioa = 0;
-    if ((err = read_reg(mcp23017_i2c_addr, MCP23017_GPIOA, &gpioa, mcp23017_timeout_ms)) != ESP_OK) goto out;
+    esp_err_t err = read_reg(mcp23017_i2c_addr, MCP23017_GPIOA, &gpioa, mcp23017_timeout_ms);
+    if (err != ESP_OK) return err;
 
     *value = (gpioa & 0x0F);  // sólo entradas A0..A3
-
-out:
-    {
-        esp_err_t end_err = i2c_mgmt_end_transaction();
-        if (err == ESP_OK) err = end_err;
-    }
-    return err;
+    return ESP_OK;
 }
 
 esp_err_t i2c_mcp23017_read_gpiob_inputs(uint8_t *value)
 {
-    esp_err_t err = i2c_mgmt_begin_transaction();
-    if (err != ESP_OK) return err;
-
     uint8_t gpiob = 0;
-    if ((err = read_reg(mcp23017_i2c_addr, MCP23017_GPIOB, &gpiob, mcp23017_timeout_ms)) != ESP_OK) goto out;
+    esp_err_t err = read_reg(mcp23017_i2c_addr, MCP23017_GPIOB, &gpiob, mcp23017_timeout_ms);
+    if (err != ESP_OK) return err;
 
     // Mantiene bits 0..3 y 6..7. (B4..B5 son salidas → se ignoran)
     *value = (uint8_t)((gpiob & 0x0F) | (gpiob & 0xC0));
-
-out:
-    {
-        esp_err_t end_err = i2c_mgmt_end_transaction();
-        if (err == ESP_OK) err = end_err;
-    }
-    return err;
+    return ESP_OK;
 }
\ No newline at end of file
@@ -25,23 +25,200 @@
 #include "driver/i2c_master.h"   // API nueva (ESP-IDF >= v5)
 #include "driver/gpio.h"
 
+/**
+ * @brief Maximum number of I2C buses managed at the same time.
+ */
+#define I2C_MGMT_MAX_BUSES 2
 
 /**
- * @brief Inicializes the I2C management driver.
- * @param i2c_port The I2C port to use (e.g., I2C_NUM_0).
+ * @brief Handle of a managed I2C bus.
+ * @details Each bus has its own lock, device table, error counters and transaction
+ *          scheduler, so traffic on one bus never waits for another.
+ */
+typedef struct i2c_mgmt_bus_s *i2c_mgmt_handle_t;
+
+/**
+ * @brief Maximum number of register bytes accepted by i2c_mgmt_write_regs().
+ */
+#define I2C_MGMT_MAX_BURST_LEN 32
+
+/**
+ * @brief Common SCL speeds.
+ * @note The ESP32 I2C controller has no High-speed mode (3.4 MHz / 1.7 MHz); Fast-mode Plus is
+ *       the upper limit and whether it works depends on the bus capacitance and pull-ups, see
+ *       i2c_mgmt_calibrate().
+ */
+#define I2C_MGMT_SPEED_STANDARD   100000  // Standard-mode
+#define I2C_MGMT_SPEED_FAST       400000  // Fast-mode
+#define I2C_MGMT_SPEED_FAST_PLUS 1000000  // Fast-mode Plus
+#define I2C_MGMT_SPEED_MAX       I2C_MGMT_SPEED_FAST_PLUS
+
+/**
+ * @brief Timeout value that selects the timeout configured for the device.
+ * @details Pass it as timeout_ms to the transfer functions (or in a scheduler descriptor) to use
+ *          the value given to i2c_mgmt_device_config().
+ */
+#define I2C_MGMT_TIMEOUT_DEVICE 0
+
+/**
+ * @brief Result of a calibration run at one SCL speed.
+ */
+typedef struct {
+    uint32_t speed_hz;   /**< SCL speed tested */
+    uint32_t ok;         /**< Successful probe transactions */
+    uint32_t errors;     /**< Failed probe transactions */
+    uint32_t avg_us;     /**< Average bus time per probe transaction */
+    uint32_t txn_per_s;  /**< Achieved successful transactions per second */
+} i2c_mgmt_calib_result_t;
+
+/**
+ * @brief Bus-wide error and recovery counters.
+ */
+typedef struct {
+    uint32_t bus_errors;         /**< Failed transfers, all devices */
+    uint32_t timeouts;           /**< Failed transfers that timed out */
+    uint32_t bus_recoveries;     /**< Stuck-bus recoveries (bus clear + bus re-creation) */
+    uint32_t recovery_failures;  /**< Recoveries that left a line low or could not re-create the bus */
+    uint32_t breaker_trips;      /**< Times a device circuit breaker opened */
+    uint32_t breaker_rejects;    /**< Transfers rejected without touching the bus */
+} i2c_mgmt_stats_t;
+
+/**
+ * @brief Error counters and circuit breaker state of one device.
+ */
+typedef struct {
+    uint32_t errors;              /**< Failed transfers */
+    uint32_t timeouts;            /**< Failed transfers that timed out */
+    uint32_t consecutive_errors;  /**< Failures since the last successful transfer */
+    uint32_t trips;               /**< Times the circuit breaker opened */
+    uint32_t rejects;             /**< Transfers rejected while the breaker was open */
+    bool open;                    /**< true while the device is backed off */
+} i2c_mgmt_device_stats_t;
+
+
+/**
+ * @brief Inicializes a managed I2C bus, or gets the existing one for the port.
+ * @details The first call for a port creates the bus and its scheduler. Later calls with the
+ *          same port and pins return the same handle, so several modules can share a bus;
+ *          a call with the same port and different pins fails.
+ * @param i2c_port The I2C port to use (e.g., I2C_NUM_0, or LP_I2C_NUM_0 where available).
  * @param sda_pin The GPIO pin for SDA.
  * @param scl_pin The GPIO pin for SCL.
+ * @param[out] ret_bus Handle of the bus, passed to the device drivers.
  *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if the port is in use with other pins,
+ *         ESP_ERR_NO_MEM if I2C_MGMT_MAX_BUSES buses already exist, or another error code.
+ */
+esp_err_t i2c_mgmt_start(i2c_port_t i2c_port, gpio_num_t sda_pin, gpio_num_t scl_pin, i2c_mgmt_handle_t *ret_bus);
+
+/**
+ * @brief Sets the SCL speed and default timeout used for a device.
+ * @details The device handle is created on first use with these settings. If the speed
+ *          changes after the handle exists, the handle is re-created on the next transfer.
+ *          Devices that are never configured use 100 kHz and a 100 ms timeout.
+ * @param bus Bus handle.
+ * @param device_addr 7-bit I2C address of the device.
+ * @param speed_hz SCL speed, up to I2C_MGMT_SPEED_MAX.
+ * @param timeout_ms Timeout applied when a transfer is given I2C_MGMT_TIMEOUT_DEVICE.
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG on bad parameters, or ESP_ERR_NO_MEM if
+ *         the device table is full.
+ * @note Must not be called from inside a transaction.
+ */
+esp_err_t i2c_mgmt_device_config(i2c_mgmt_handle_t bus, uint8_t device_addr, uint32_t speed_hz, int timeout_ms);
+
+/**
+ * @brief Measures throughput and error rate of a device at several SCL speeds.
+ * @details For each speed, performs the given number of register reads (probe_reg, probe_len bytes)
+ *          as individual transactions, and reports how many succeeded and the bus time they took.
+ *          The device configuration is restored at the end. Intended for commissioning, to pick
+ *          the fastest reliable speed for the actual wiring.
+ * @param bus Bus handle.
+ * @param device_addr 7-bit I2C address of a register-addressed device.
+ * @param probe_reg Register read on every iteration. It must be safe to read repeatedly.
+ * @param probe_len Number of bytes read per iteration (1..I2C_MGMT_MAX_BURST_LEN).
+ * @param speeds_hz Speeds to test.
+ * @param speeds_count Number of entries in speeds_hz and results.
+ * @param iterations Number of probe transactions per speed.
+ * @param results Output, one entry per speed.
+ * @return ESP_OK on success, or an error code on failure.
+ * @note Must not be called from inside a transaction.
+ */
+esp_err_t i2c_mgmt_calibrate(i2c_mgmt_handle_t bus, uint8_t device_addr, uint8_t probe_reg, size_t probe_len,
+                             const uint32_t *speeds_hz, size_t speeds_count, uint32_t iterations,
+                             i2c_mgmt_calib_result_t *results);
+
+/**
+ * @brief Gets a snapshot of the bus-wide error and recovery counters.
+ * @param bus Bus handle.
+ * @param out Where the counters are copied.
  * @return ESP_OK on success, or an error code on failure.
  */
-esp_err_t i2c_mgmt_start(i2c_port_t i2c_port, gpio_num_t sda_pin, gpio_num_t scl_pin);
+esp_err_t i2c_mgmt_get_stats(i2c_mgmt_handle_t bus, i2c_mgmt_stats_t *out);
+
+/**
+ * @brief Gets a snapshot of the error counters and circuit breaker state of a device.
+ * @param bus Bus handle.
+ * @param device_addr 7-bit I2C address of the device.
+ * @param out Where the counters are copied.
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the device has never been used or configured.
+ */
+esp_err_t i2c_mgmt_get_device_stats(i2c_mgmt_handle_t bus, uint8_t device_addr, i2c_mgmt_device_stats_t *out);
 
-esp_err_t i2c_mgmt_begin_transaction(void);
+esp_err_t i2c_mgmt_begin_transaction(i2c_mgmt_handle_t bus);
 
-esp_err_t i2c_mgmt_write(uint8_t device_addr, const uint8_t *tx_buffer, size_t tx_len, int timeout_ms);
+esp_err_t i2c_mgmt_write(i2c_mgmt_handle_t bus, uint8_t device_addr, const uint8_t *tx_buffer, size_t tx_len, int timeout_ms);
 
-esp_err_t i2c_mgmt_read(uint8_t device_addr, uint8_t *rx_buffer, size_t *rx_len, int timeout_ms);
+esp_err_t i2c_mgmt_read(i2c_mgmt_handle_t bus, uint8_t device_addr, uint8_t *rx_buffer, size_t *rx_len, int timeout_ms);
+
+/**
+ * @brief Writes and then reads from a device in a single bus transaction.
+ * @details The write and read phases are joined with a repeated START, so no other
+ *          master can take the bus between them and the device is addressed once per phase
+ *          without an intermediate STOP. Typical use is setting a register pointer and
+ *          reading the register contents back.
+ * @param bus Bus handle.
+ * @param device_addr 7-bit I2C address of the device.
+ * @param tx_buffer Bytes to write (e.g. register pointer).
+ * @param tx_len Number of bytes to write.
+ * @param rx_buffer Buffer where the read bytes will be stored.
+ * @param rx_len Number of bytes to read.
+ * @param timeout_ms Timeout for the whole transaction in milliseconds.
+ * @return ESP_OK on success, or an error code on failure.
+ * @note Must be called between i2c_mgmt_begin_transaction() and i2c_mgmt_end_transaction().
+ */
+esp_err_t i2c_mgmt_write_read(i2c_mgmt_handle_t bus, uint8_t device_addr, const uint8_t *tx_buffer, size_t tx_len,
+                              uint8_t *rx_buffer, size_t rx_len, int timeout_ms);
+
+/**
+ * @brief Reads consecutive registers starting at the given register address.
+ * @details Issues the register pointer and the burst read as one repeated-start transaction.
+ *          The device must auto-increment its register pointer for multi-byte reads.
+ * @param bus Bus handle.
+ * @param device_addr 7-bit I2C address of the device.
+ * @param reg First register to read.
+ * @param rx_buffer Buffer where the register values will be stored.
+ * @param rx_len Number of registers (bytes) to read.
+ * @param timeout_ms Timeout for the transaction in milliseconds.
+ * @return ESP_OK on success, or an error code on failure.
+ * @note Must be called between i2c_mgmt_begin_transaction() and i2c_mgmt_end_transaction().
+ */
+esp_err_t i2c_mgmt_read_regs(i2c_mgmt_handle_t bus, uint8_t device_addr, uint8_t reg, uint8_t *rx_buffer, size_t rx_len, int timeout_ms);
+
+/**
+ * @brief Writes consecutive registers starting at the given register address.
+ * @details Sends the register address followed by all the values in a single write transfer.
+ *          The device must auto-increment its register pointer for multi-byte writes.
+ * @param bus Bus handle.
+ * @param device_addr 7-bit I2C address of the device.
+ * @param reg First register to write.
+ * @param tx_buffer Register values to write.
+ * @param tx_len Number of registers (bytes) to write, up to I2C_MGMT_MAX_BURST_LEN.
+ * @param timeout_ms Timeout for the transaction in milliseconds.
+ * @return ESP_OK on success, or an error code on failure.
+ * @note Must be called between i2c_mgmt_begin_transaction() and i2c_mgmt_end_transaction().
+ */
+esp_err_t i2c_mgmt_write_regs(i2c_mgmt_handle_t bus, uint8_t device_addr, uint8_t reg, const uint8_t *tx_buffer, size_t tx_len, int timeout_ms);
 
-esp_err_t i2c_mgmt_end_transaction(void);
+esp_err_t i2c_mgmt_end_transaction(i2c_mgmt_handle_t bus);
 
 #endif // I2C_MGMT_DRIVER_H
\ No newline at end of file
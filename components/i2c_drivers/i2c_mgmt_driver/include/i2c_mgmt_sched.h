@@ -0,0 +1,162 @@
+#ifndef I2C_MGMT_SCHED_H
+#define I2C_MGMT_SCHED_H
+
+/**
+ * @file i2c_mgmt_sched.h
+ * @brief Prioritized I2C transaction scheduler for the I2C management driver.
+ * @details
+ * Every managed bus has its own scheduler. The scheduler owns a service task that executes I2C transaction descriptors
+ * (a short write/read script for one device) on behalf of the drivers. Each
+ * descriptor belongs to a traffic class; pending descriptors of a higher class
+ * are always served before those of a lower class, so a security transaction
+ * never waits behind queued energy ADC reads. Preemption happens at transaction
+ * boundaries: a transaction that already owns the bus runs to completion.
+ *
+ * Completion is reported through a callback or by blocking the caller with
+ * i2c_mgmt_submit_sync(). The driver does not depend on the application framework:
+ * a module that wants an AO event posts it from its own callback.
+ *
+ * @author  Roberto Axt
+ * @date    2025-08-09
+ * @version 0.0
+ *
+ * @par License
+ * This project is licensed under the MIT License.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+#include "i2c_mgmt_driver.h"
+
+/**
+ * @brief Maximum number of operations in a single transaction descriptor.
+ */
+#define I2C_MGMT_TXN_MAX_OPS 4
+
+/**
+ * @brief Traffic classes, ordered from highest to lowest priority.
+ */
+typedef enum {
+    I2C_MGMT_CLASS_SECURITY = 0, /**< Alarm inputs, siren/lights outputs and RFID reader */
+    I2C_MGMT_CLASS_ENERGY   = 1, /**< Energy ADC conversions */
+    I2C_MGMT_CLASS_MAX
+} i2c_mgmt_class_t;
+
+/**
+ * @brief Operation types of a transaction script.
+ */
+typedef enum {
+    I2C_MGMT_OP_WRITE = 0,   /**< Write tx bytes */
+    I2C_MGMT_OP_READ,        /**< Read rx bytes */
+    I2C_MGMT_OP_WRITE_READ,  /**< Write tx bytes, repeated START, read rx bytes */
+} i2c_mgmt_op_type_t;
+
+/**
+ * @brief One step of a transaction script.
+ * @note The buffers are not copied: they must remain valid until the transaction completes.
+ */
+typedef struct {
+    i2c_mgmt_op_type_t type;
+    const uint8_t *tx;
+    size_t tx_len;
+    uint8_t *rx;
+    size_t rx_len;
+} i2c_mgmt_op_t;
+
+typedef struct i2c_mgmt_txn_s i2c_mgmt_txn_t;
+
+/**
+ * @brief Completion callback for a transaction.
+ * @param txn Copy of the transaction descriptor that was executed.
+ * @param result ESP_OK if every operation succeeded, or the error of the failing one.
+ * @param ctx User context given in the descriptor.
+ * @note The callback runs in the scheduler service task and must not block.
+ */
+typedef void (*i2c_mgmt_txn_cb_t)(const i2c_mgmt_txn_t *txn, esp_err_t result, void *ctx);
+
+/**
+ * @brief Transaction descriptor.
+ * @details The operations are executed in order while holding the bus; the script stops
+ *          at the first failing operation.
+ *
+ *          A probe transaction polls a device that may NACK or stretch the clock while it is
+ *          busy (e.g. the PN532 status byte). Its failures are returned to the caller but are
+ *          not counted by the device circuit breaker and never trigger a stuck-bus recovery,
+ *          so repeated "not ready" polls cannot isolate the device or reset the shared bus.
+ */
+struct i2c_mgmt_txn_s {
+    uint8_t device_addr;                     /**< 7-bit address of the target device */
+    i2c_mgmt_class_t cls;                    /**< Traffic class (priority) */
+    int timeout_ms;                          /**< Timeout applied to each operation */
+    i2c_mgmt_op_t ops[I2C_MGMT_TXN_MAX_OPS]; /**< Script */
+    uint8_t ops_count;                       /**< Number of valid entries in ops */
+    bool probe;                              /**< Readiness poll: a failure means "not ready", see below */
+    i2c_mgmt_txn_cb_t on_done;               /**< Optional completion callback */
+    void *ctx;                               /**< Context for on_done */
+};
+
+/**
+ * @brief Latency statistics of a traffic class.
+ * @details Wait time is measured from submission until the transaction gets the bus;
+ *          execution time is the time the transaction holds the bus.
+ */
+typedef struct {
+    uint32_t completed;    /**< Transactions executed successfully */
+    uint32_t failed;       /**< Transactions that ended with an error */
+    uint32_t rejected;     /**< Submissions rejected because the class queue was full */
+    uint32_t wait_avg_us;  /**< Average queueing time */
+    uint32_t wait_max_us;  /**< Worst queueing time */
+    uint32_t exec_avg_us;  /**< Average bus holding time */
+    uint32_t exec_max_us;  /**< Worst bus holding time */
+} i2c_mgmt_class_stats_t;
+
+/**
+ * @brief Starts the scheduler service task of a bus.
+ * @details Called by i2c_mgmt_start(); calling it again is harmless.
+ * @param bus Bus handle.
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t i2c_mgmt_sched_start(i2c_mgmt_handle_t bus);
+
+/**
+ * @brief Queues a transaction for asynchronous execution.
+ * @param bus Bus the device is attached to.
+ * @param txn Transaction descriptor. It is copied, but the operation buffers are not.
+ * @return ESP_OK if queued, ESP_ERR_INVALID_ARG on a malformed descriptor,
+ *         ESP_ERR_INVALID_STATE if the scheduler is not running,
+ *         or ESP_ERR_NO_MEM if the class queue is full.
+ */
+esp_err_t i2c_mgmt_submit(i2c_mgmt_handle_t bus, const i2c_mgmt_txn_t *txn);
+
+/**
+ * @brief Queues a transaction and blocks the caller until it completes.
+ * @details Any on_done callback in the descriptor is also honoured.
+ *          The wait is bounded by the per-operation timeouts of this and the queued
+ *          higher-priority transactions on the same bus.
+ * @param bus Bus the device is attached to.
+ * @param txn Transaction descriptor.
+ * @return The transaction result, or a submission error.
+ */
+esp_err_t i2c_mgmt_submit_sync(i2c_mgmt_handle_t bus, const i2c_mgmt_txn_t *txn);
+
+/**
+ * @brief Gets a snapshot of the latency statistics of a class on a bus.
+ * @param bus Bus handle.
+ * @param cls Traffic class.
+ * @param out Where the statistics are copied.
+ * @return ESP_OK on success, or ESP_ERR_INVALID_ARG.
+ */
+esp_err_t i2c_mgmt_sched_get_stats(i2c_mgmt_handle_t bus, i2c_mgmt_class_t cls, i2c_mgmt_class_stats_t *out);
+
+/**
+ * @brief Clears the latency statistics of every class on a bus.
+ * @param bus Bus handle.
+ */
+void i2c_mgmt_sched_reset_stats(i2c_mgmt_handle_t bus);
+
+#endif // I2C_MGMT_SCHED_H
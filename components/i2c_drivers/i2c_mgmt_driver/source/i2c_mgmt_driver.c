@@ -4,30 +4,108 @@
 #include "freertos/semphr.h"
 #include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
 
 #include "i2c_mgmt_driver.h"
+#include "i2c_mgmt_sched.h"
+#include "i2c_mgmt_priv.h"
 
-#define I2C_MGMT_DEFAULT_SPEED_HZ 100000  // 100 kHz por defecto
+#define I2C_MGMT_DEFAULT_SPEED_HZ I2C_MGMT_SPEED_STANDARD  // 100 kHz por defecto
+#define I2C_MGMT_DEFAULT_TIMEOUT_MS 100   // Timeout por defecto de un dispositivo sin configurar
 #define I2C_MGMT_USE_INTERNAL_PULLUPS 0   // 1 = usa pull-ups internos; 0 = solo externos
+#define I2C_MGMT_CLEAR_HALF_PERIOD_US 5   // Semiperíodo de SCL durante el bus clear (~100 kHz)
+#define I2C_MGMT_CLEAR_PULSES 9           // Pulsos de SCL para liberar un esclavo que retiene SDA
+
+#ifndef CONFIG_I2C_MGMT_BREAKER_THRESHOLD
+#define CONFIG_I2C_MGMT_BREAKER_THRESHOLD 3
+#endif
+#ifndef CONFIG_I2C_MGMT_BREAKER_BACKOFF_MS
+#define CONFIG_I2C_MGMT_BREAKER_BACKOFF_MS 1000
+#endif
+#ifndef CONFIG_I2C_MGMT_BREAKER_BACKOFF_MAX_MS
+#define CONFIG_I2C_MGMT_BREAKER_BACKOFF_MAX_MS 30000
+#endif
 
 static const char *TAG = "i2c_mgmt";
 
-// Estado global (un único bus administrado)
-static i2c_master_bus_handle_t bus = NULL;
-static SemaphoreHandle_t mutex = NULL;
-static TaskHandle_t owner = NULL;
-static bool initialized = false;
+// Registro de buses administrados (uno por puerto)
+static struct i2c_mgmt_bus_s buses[I2C_MGMT_MAX_BUSES] = { 0 };
+static portMUX_TYPE buses_lock = portMUX_INITIALIZER_UNLOCKED;
 
-esp_err_t i2c_mgmt_start(i2c_port_t i2c_port, gpio_num_t sda_pin, gpio_num_t scl_pin)
+/**
+ * @brief Busca el bus de un puerto o reserva una entrada libre para crearlo.
+ * @param[out] created true si la entrada es nueva y el llamador debe crear el bus.
+ */
+static struct i2c_mgmt_bus_s *claim_bus(i2c_port_t i2c_port, bool *created)
 {
-    if (initialized)
+    struct i2c_mgmt_bus_s *found = NULL;
+    struct i2c_mgmt_bus_s *free_slot = NULL;
+
+    portENTER_CRITICAL(&buses_lock);
+    for (size_t i = 0; i < I2C_MGMT_MAX_BUSES; ++i)
+    {
+        if (buses[i].used && buses[i].cfg.i2c_port == i2c_port)
+            found = &buses[i];
+        else if (!buses[i].used && !free_slot)
+            free_slot = &buses[i];
+    }
+    if (!found && free_slot)
+    {
+        memset(free_slot, 0, sizeof(*free_slot));
+        free_slot->used = true;
+        free_slot->cfg.i2c_port = i2c_port;
+        found = free_slot;
+        *created = true;
+    }
+    portEXIT_CRITICAL(&buses_lock);
+
+    return found;
+}
+
+static void release_bus(struct i2c_mgmt_bus_s *bus)
+{
+    portENTER_CRITICAL(&buses_lock);
+    bus->used = false;
+    portEXIT_CRITICAL(&buses_lock);
+}
+
+esp_err_t i2c_mgmt_start(i2c_port_t i2c_port, gpio_num_t sda_pin, gpio_num_t scl_pin, i2c_mgmt_handle_t *ret_bus)
+{
+    if (!ret_bus)
+        return ESP_ERR_INVALID_ARG;
+
+    bool created = false;
+    struct i2c_mgmt_bus_s *bus = claim_bus(i2c_port, &created);
+    if (!bus)
+    {
+        ESP_LOGE(TAG, "No free bus entry for port %d (max %d buses)", (int)i2c_port, I2C_MGMT_MAX_BUSES);
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (!created)
     {
-        ESP_LOGW(TAG, "I2C bus already initialized");
+        // Otro módulo ya usa este puerto: se comparte el bus si los pines coinciden
+        while (bus->used && !bus->ready)
+            vTaskDelay(1);
+
+        if (!bus->used)
+            return ESP_ERR_INVALID_STATE;   // falló la creación en el otro módulo
+
+        if (bus->cfg.sda_io_num != sda_pin || bus->cfg.scl_io_num != scl_pin)
+        {
+            ESP_LOGE(TAG, "Port %d already in use with SDA=%d, SCL=%d", (int)i2c_port,
+                     (int)bus->cfg.sda_io_num, (int)bus->cfg.scl_io_num);
+            return ESP_ERR_INVALID_STATE;
+        }
+
+        ESP_LOGI(TAG, "I2C bus on port %d shared", (int)i2c_port);
+        *ret_bus = bus;
         return ESP_OK;
     }
 
-    i2c_master_bus_config_t bus_cfg = {
-        .i2c_port = i2c_port,                 // I2C_NUM_0 / I2C_NUM_1 según MCU
+    bus->cfg = (i2c_master_bus_config_t){
+        .i2c_port = i2c_port,                 // I2C_NUM_0 / I2C_NUM_1 / LP_I2C_NUM_0 según MCU
         .sda_io_num = sda_pin,
         .scl_io_num = scl_pin,
         .clk_source = I2C_CLK_SRC_DEFAULT,
@@ -36,25 +114,44 @@ esp_err_t i2c_mgmt_start(i2c_port_t i2c_port, gpio_num_t sda_pin, gpio_num_t scl
             .enable_internal_pullup = I2C_MGMT_USE_INTERNAL_PULLUPS ? 1 : 0,
         },
     };
+#ifdef LP_I2C_NUM_0
+    if (i2c_port == LP_I2C_NUM_0)
+        bus->cfg.lp_source_clk = LP_I2C_SCLK_DEFAULT; // el LP I2C usa otro reloj y pines fijos
+#endif
+    bus->sched.acc_lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
 
-    esp_err_t err = i2c_new_master_bus(&bus_cfg, &bus);
+    esp_err_t err = i2c_new_master_bus(&bus->cfg, &bus->master);
     if (err != ESP_OK)
     {
         ESP_LOGE(TAG, "i2c_new_master_bus failed: %s", esp_err_to_name(err));
+        release_bus(bus);
         return err;
     }
 
-    mutex = xSemaphoreCreateMutex();
-    if (!mutex)
+    bus->mutex = xSemaphoreCreateMutex();
+    if (!bus->mutex)
     {
-        ESP_LOGE(TAG, "Failed to create mutex");
-        (void)i2c_del_master_bus(bus);
-        bus = NULL;
+        ESP_LOGE(TAG, "Failed to create bus->mutex");
+        (void)i2c_del_master_bus(bus->master);
+        release_bus(bus);
         return ESP_ERR_NO_MEM;
     }
 
-    owner = NULL;
-    initialized = true;
+    bus->owner = NULL;
+
+    err = i2c_mgmt_sched_start(bus);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to start I2C scheduler: %s", esp_err_to_name(err));
+        vSemaphoreDelete(bus->mutex);
+        (void)i2c_del_master_bus(bus->master);
+        release_bus(bus);
+        return err;
+    }
+
+    bus->ready = true;
+    *ret_bus = bus;
+
     ESP_LOGI(TAG, "I2C bus initialized (port %d, SDA=%d, SCL=%d, %u Hz, pullups=%s)",
              (int)i2c_port, (int)sda_pin, (int)scl_pin,
              (unsigned)I2C_MGMT_DEFAULT_SPEED_HZ,
@@ -62,36 +159,36 @@ esp_err_t i2c_mgmt_start(i2c_port_t i2c_port, gpio_num_t sda_pin, gpio_num_t scl
     return ESP_OK;
 }
 
-esp_err_t i2c_mgmt_begin_transaction(void)
+esp_err_t i2c_mgmt_begin_transaction(i2c_mgmt_handle_t bus)
 {
-    if (!initialized)
+    if (!bus)
         return ESP_ERR_INVALID_STATE;
 
-    if (xSemaphoreTake(mutex, portMAX_DELAY) != pdTRUE)
+    if (xSemaphoreTake(bus->mutex, portMAX_DELAY) != pdTRUE)
         return ESP_ERR_TIMEOUT;
 
-    owner = xTaskGetCurrentTaskHandle();
-    ESP_LOGD(TAG, "I2C bus locked by task: %s", pcTaskGetName(owner));
+    bus->owner = xTaskGetCurrentTaskHandle();
+    ESP_LOGD(TAG, "I2C bus locked by task: %s", pcTaskGetName(bus->owner));
 
     return ESP_OK;
 }
 
-static inline bool owner_ok(void)
+static inline bool owner_ok(i2c_mgmt_handle_t bus)
 {
-    return owner == xTaskGetCurrentTaskHandle();
+    return bus->owner == xTaskGetCurrentTaskHandle();
 }
 
-static esp_err_t create_device(uint8_t dev_addr, i2c_master_dev_handle_t *out)
+static esp_err_t create_device(i2c_mgmt_handle_t bus, uint8_t dev_addr, uint32_t speed_hz, i2c_master_dev_handle_t *out)
 {
     i2c_master_dev_handle_t dev = NULL;
 
     i2c_device_config_t dev_cfg = {
         .dev_addr_length = I2C_ADDR_BIT_LEN_7,
         .device_address  = dev_addr,
-        .scl_speed_hz    = I2C_MGMT_DEFAULT_SPEED_HZ,
+        .scl_speed_hz    = speed_hz,
     };
 
-    esp_err_t err = i2c_master_bus_add_device(bus, &dev_cfg, &dev);
+    esp_err_t err = i2c_master_bus_add_device(bus->master, &dev_cfg, &dev);
 
     if (err != ESP_OK) 
         return err;
@@ -100,18 +197,301 @@ static esp_err_t create_device(uint8_t dev_addr, i2c_master_dev_handle_t *out)
     return ESP_OK;
 }
 
-static void destroy_device(i2c_master_dev_handle_t dev)
+/**
+ * @brief Busca la entrada de una dirección, agregándola con valores por defecto si no existe.
+ * @note Debe llamarse con el bus->mutex del bus tomado.
+ */
+static i2c_mgmt_device_t *find_entry(i2c_mgmt_handle_t bus, uint8_t dev_addr)
+{
+    for (size_t i = 0; i < bus->devices_count; ++i)
+    {
+        if (bus->devices[i].addr == dev_addr)
+            return &bus->devices[i];
+    }
+
+    if (bus->devices_count >= I2C_MGMT_MAX_DEVICES)
+    {
+        ESP_LOGE(TAG, "Device table full, cannot add 0x%02X", dev_addr);
+        return NULL;
+    }
+
+    i2c_mgmt_device_t *entry = &bus->devices[bus->devices_count++];
+    entry->addr = dev_addr;
+    entry->speed_hz = I2C_MGMT_DEFAULT_SPEED_HZ;
+    entry->timeout_ms = I2C_MGMT_DEFAULT_TIMEOUT_MS;
+    entry->handle = NULL;
+    entry->backoff_ms = CONFIG_I2C_MGMT_BREAKER_BACKOFF_MS;
+    entry->retry_at_us = 0;
+    memset(&entry->stats, 0, sizeof(entry->stats));
+    return entry;
+}
+
+/**
+ * @brief Cierra el circuit breaker de una entrada (los contadores acumulados se conservan).
+ */
+static void breaker_reset(i2c_mgmt_device_t *entry)
 {
-    if (dev)
-        (void)i2c_master_bus_rm_device(dev);
+    entry->stats.open = false;
+    entry->stats.consecutive_errors = 0;
+    entry->backoff_ms = CONFIG_I2C_MGMT_BREAKER_BACKOFF_MS;
+    entry->retry_at_us = 0;
+}
+
+/**
+ * @brief Registra el resultado de una transferencia en el circuit breaker del dispositivo.
+ */
+static void breaker_account(i2c_mgmt_handle_t bus, i2c_mgmt_device_t *dev, esp_err_t err)
+{
+    if (err == ESP_OK)
+    {
+        if (dev->stats.open)
+            ESP_LOGI(TAG, "Device 0x%02X responding again, breaker closed", dev->addr);
+        breaker_reset(dev);
+        return;
+    }
+
+    dev->stats.errors++;
+    bus->stats.bus_errors++;
+    if (err == ESP_ERR_TIMEOUT)
+    {
+        dev->stats.timeouts++;
+        bus->stats.timeouts++;
+    }
+    dev->stats.consecutive_errors++;
+
+    int64_t now = esp_timer_get_time();
+    if (dev->stats.open)
+    {
+        // Falló la transferencia de prueba: se duplica la espera
+        dev->backoff_ms *= 2;
+        if (dev->backoff_ms > CONFIG_I2C_MGMT_BREAKER_BACKOFF_MAX_MS)
+            dev->backoff_ms = CONFIG_I2C_MGMT_BREAKER_BACKOFF_MAX_MS;
+        dev->retry_at_us = now + (int64_t)dev->backoff_ms * 1000;
+        ESP_LOGW(TAG, "Device 0x%02X still failing, next retry in %u ms", dev->addr, (unsigned)dev->backoff_ms);
+    }
+    else if (dev->stats.consecutive_errors >= CONFIG_I2C_MGMT_BREAKER_THRESHOLD)
+    {
+        dev->stats.open = true;
+        dev->stats.trips++;
+        bus->stats.breaker_trips++;
+        dev->retry_at_us = now + (int64_t)dev->backoff_ms * 1000;
+        ESP_LOGW(TAG, "Device 0x%02X: %u consecutive errors, breaker open for %u ms", dev->addr,
+                 (unsigned)dev->stats.consecutive_errors, (unsigned)dev->backoff_ms);
+    }
 }
 
-esp_err_t i2c_mgmt_write(uint8_t device_addr, const uint8_t *tx_buffer, size_t tx_len, int timeout_ms)
+/**
+ * @brief Libera un esclavo que retiene SDA (I2C spec, sección 3.1.16).
+ * @details Con el periférico liberado, genera hasta 9 pulsos de SCL por GPIO hasta que SDA
+ *          sube, y luego una condición de STOP.
+ * @return true si ambas líneas quedaron en alto.
+ */
+static bool bus_clear(gpio_num_t sda, gpio_num_t scl)
 {
-    if (!initialized) 
+    gpio_config_t cfg = {
+        .pin_bit_mask = (1ULL << sda) | (1ULL << scl),
+        .mode = GPIO_MODE_INPUT_OUTPUT_OD,
+        .pull_up_en = I2C_MGMT_USE_INTERNAL_PULLUPS ? GPIO_PULLUP_ENABLE : GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    if (gpio_config(&cfg) != ESP_OK)
+        return false;
+
+    gpio_set_level(sda, 1);
+    gpio_set_level(scl, 1);
+    esp_rom_delay_us(I2C_MGMT_CLEAR_HALF_PERIOD_US);
+
+    for (int i = 0; i < I2C_MGMT_CLEAR_PULSES && gpio_get_level(sda) == 0; ++i)
+    {
+        gpio_set_level(scl, 0);
+        esp_rom_delay_us(I2C_MGMT_CLEAR_HALF_PERIOD_US);
+        gpio_set_level(scl, 1);
+        esp_rom_delay_us(I2C_MGMT_CLEAR_HALF_PERIOD_US);
+    }
+
+    // STOP: SDA pasa de bajo a alto con SCL en alto
+    gpio_set_level(scl, 0);
+    esp_rom_delay_us(I2C_MGMT_CLEAR_HALF_PERIOD_US);
+    gpio_set_level(sda, 0);
+    esp_rom_delay_us(I2C_MGMT_CLEAR_HALF_PERIOD_US);
+    gpio_set_level(scl, 1);
+    esp_rom_delay_us(I2C_MGMT_CLEAR_HALF_PERIOD_US);
+    gpio_set_level(sda, 1);
+    esp_rom_delay_us(I2C_MGMT_CLEAR_HALF_PERIOD_US);
+
+    return gpio_get_level(sda) == 1 && gpio_get_level(scl) == 1;
+}
+
+/**
+ * @brief Recupera un bus trabado: descarta los handles, elimina el bus, ejecuta el bus
+ *        clear y vuelve a crear el bus. Debe llamarse con el bus tomado.
+ * @note Los handles de dispositivo se re-crean en el próximo acceso de cada dispositivo.
+ */
+static esp_err_t recover_bus(i2c_mgmt_handle_t bus)
+{
+    bus->stats.bus_recoveries++;
+
+    for (size_t i = 0; i < bus->devices_count; ++i)
+    {
+        if (bus->devices[i].handle)
+        {
+            (void)i2c_master_bus_rm_device(bus->devices[i].handle);
+            bus->devices[i].handle = NULL;
+        }
+    }
+
+    if (bus->master)
+    {
+        (void)i2c_del_master_bus(bus->master);
+        bus->master = NULL;
+    }
+
+    bool released = bus_clear(bus->cfg.sda_io_num, bus->cfg.scl_io_num);
+
+    esp_err_t err = i2c_new_master_bus(&bus->cfg, &bus->master);
+    if (err != ESP_OK || !released)
+    {
+        bus->stats.recovery_failures++;
+        if (err != ESP_OK)
+            bus->master = NULL;
+        bus->retry_at_us = esp_timer_get_time() + (int64_t)CONFIG_I2C_MGMT_BREAKER_BACKOFF_MS * 1000;
+        ESP_LOGE(TAG, "Bus recovery failed (lines %s, new bus: %s)",
+                 released ? "released" : "still held low", esp_err_to_name(err));
+        return err != ESP_OK ? err : ESP_FAIL;
+    }
+
+    ESP_LOGW(TAG, "I2C bus %d recovered (%u recoveries)", (int)bus->cfg.i2c_port, (unsigned)bus->stats.bus_recoveries);
+    return ESP_OK;
+}
+
+/**
+ * @brief Procesa el resultado de una transferencia: circuit breaker y, si el bus quedó
+ *        trabado (timeout o una línea retenida en bajo), recuperación del bus.
+ */
+static void after_transfer(i2c_mgmt_handle_t bus, i2c_mgmt_device_t *dev, esp_err_t err)
+{
+    // Un sondeo fallido sólo significa "no listo": ni breaker ni recuperación del bus
+    if (!bus->probing || err == ESP_OK)
+        breaker_account(bus, dev, err);
+
+#if CONFIG_I2C_MGMT_DISABLE_HANDLE_CACHE
+    // Sin cache: el dispositivo se agrega y se quita en cada transferencia (sólo para medir)
+    if (dev->handle)
+    {
+        (void)i2c_master_bus_rm_device(dev->handle);
+        dev->handle = NULL;
+    }
+#endif
+
+    if (err == ESP_OK || bus->probing)
+        return;
+
+    bool stuck = (err == ESP_ERR_TIMEOUT) ||
+                 gpio_get_level(bus->cfg.sda_io_num) == 0 ||
+                 gpio_get_level(bus->cfg.scl_io_num) == 0;
+    if (stuck)
+    {
+        ESP_LOGW(TAG, "Bus stuck after error with 0x%02X, recovering", dev->addr);
+        (void)recover_bus(bus);
+    }
+}
+
+/**
+ * @brief Cambia velocidad y timeout de una entrada. Debe llamarse con el bus->mutex del bus tomado.
+ */
+static esp_err_t set_entry_config(i2c_mgmt_handle_t bus, uint8_t dev_addr, uint32_t speed_hz, int timeout_ms)
+{
+    i2c_mgmt_device_t *entry = find_entry(bus, dev_addr);
+    if (!entry)
+        return ESP_ERR_NO_MEM;
+
+    if (entry->handle && entry->speed_hz != speed_hz)
+    {
+        (void)i2c_master_bus_rm_device(entry->handle);
+        entry->handle = NULL;
+    }
+
+    // Nueva configuración: el dispositivo vuelve a tener oportunidad
+    breaker_reset(entry);
+    entry->speed_hz = speed_hz;
+    entry->timeout_ms = timeout_ms;
+    return ESP_OK;
+}
+
+/**
+ * @brief Obtiene la entrada de la dirección dada con su handle creado (primer uso).
+ * @details Falla sin tocar el bus si el circuit breaker del dispositivo está abierto, o si
+ *          el bus está caído y aún no corresponde reintentar su recuperación.
+ * @note Debe llamarse con el bus tomado (dentro de una transacción), ya que la tabla
+ *       se protege con el mismo bus->mutex del bus.
+ */
+static esp_err_t get_device(i2c_mgmt_handle_t bus, uint8_t dev_addr, i2c_mgmt_device_t **out)
+{
+    i2c_mgmt_device_t *entry = find_entry(bus, dev_addr);
+    if (!entry)
+        return ESP_ERR_NO_MEM;
+
+    if (entry->stats.open && esp_timer_get_time() < entry->retry_at_us)
+    {
+        entry->stats.rejects++;
+        bus->stats.breaker_rejects++;
+        ESP_LOGD(TAG, "Device 0x%02X rejected, breaker open", dev_addr);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (!bus->master)
+    {
+        if (esp_timer_get_time() < bus->retry_at_us || recover_bus(bus) != ESP_OK)
+            return ESP_ERR_INVALID_STATE;
+    }
+
+    if (!entry->handle)
+    {
+        esp_err_t err = create_device(bus, dev_addr, entry->speed_hz, &entry->handle);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "add_device(0x%02X) failed: %s", dev_addr, esp_err_to_name(err));
+            return err;
+        }
+
+        ESP_LOGD(TAG, "Device 0x%02X added to bus (%u Hz, timeout %d ms, %u/%u)", dev_addr,
+                 (unsigned)entry->speed_hz, entry->timeout_ms,
+                 (unsigned)bus->devices_count, (unsigned)I2C_MGMT_MAX_DEVICES);
+    }
+
+    *out = entry;
+    return ESP_OK;
+}
+
+static inline int resolve_timeout(const i2c_mgmt_device_t *dev, int timeout_ms)
+{
+    return (timeout_ms == I2C_MGMT_TIMEOUT_DEVICE) ? dev->timeout_ms : timeout_ms;
+}
+
+esp_err_t i2c_mgmt_device_config(i2c_mgmt_handle_t bus, uint8_t device_addr, uint32_t speed_hz, int timeout_ms)
+{
+    if (!bus)
+        return ESP_ERR_INVALID_STATE;
+
+    if (speed_hz == 0 || speed_hz > I2C_MGMT_SPEED_MAX || timeout_ms <= 0)
+        return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(bus->mutex, portMAX_DELAY);
+    esp_err_t err = set_entry_config(bus, device_addr, speed_hz, timeout_ms);
+    xSemaphoreGive(bus->mutex);
+
+    if (err == ESP_OK)
+        ESP_LOGI(TAG, "Device 0x%02X: %u Hz, timeout %d ms", device_addr, (unsigned)speed_hz, timeout_ms);
+    return err;
+}
+
+esp_err_t i2c_mgmt_write(i2c_mgmt_handle_t bus, uint8_t device_addr, const uint8_t *tx_buffer, size_t tx_len, int timeout_ms)
+{
+    if (!bus)
         return ESP_ERR_INVALID_STATE;
     
-    if (!owner_ok())
+    if (!owner_ok(bus))
     {
         ESP_LOGE(TAG, "Write called outside of owned transaction");
         return ESP_ERR_INVALID_STATE;
@@ -120,28 +500,25 @@ esp_err_t i2c_mgmt_write(uint8_t device_addr, const uint8_t *tx_buffer, size_t t
     if (!tx_buffer || tx_len == 0)
         return ESP_ERR_INVALID_ARG;
 
-    i2c_master_dev_handle_t dev = NULL;
-    esp_err_t err = create_device(device_addr, &dev);
+    i2c_mgmt_device_t *dev = NULL;
+    esp_err_t err = get_device(bus, device_addr, &dev);
     if (err != ESP_OK)
-    {
-        ESP_LOGE(TAG, "add_device(0x%02X) failed: %s", device_addr, esp_err_to_name(err));
         return err;
-    }
 
-    err = i2c_master_transmit(dev, tx_buffer, tx_len, timeout_ms);
-    if (err != ESP_OK)
+    err = i2c_master_transmit(dev->handle, tx_buffer, tx_len, resolve_timeout(dev, timeout_ms));
+    if (err != ESP_OK && !bus->probing)
         ESP_LOGE(TAG, "transmit to 0x%02X failed: %s", device_addr, esp_err_to_name(err));
+    after_transfer(bus, dev, err);
 
-    destroy_device(dev);
     return err;
 }
 
-esp_err_t i2c_mgmt_read(uint8_t device_addr, uint8_t *rx_buffer, size_t *rx_len, int timeout_ms)
+esp_err_t i2c_mgmt_read(i2c_mgmt_handle_t bus, uint8_t device_addr, uint8_t *rx_buffer, size_t *rx_len, int timeout_ms)
 {
-    if (!initialized) 
+    if (!bus)
         return ESP_ERR_INVALID_STATE;
     
-    if (!owner_ok())
+    if (!owner_ok(bus))
     {
         ESP_LOGE(TAG, "Read called outside of owned transaction");
         return ESP_ERR_INVALID_STATE;
@@ -150,42 +527,196 @@ esp_err_t i2c_mgmt_read(uint8_t device_addr, uint8_t *rx_buffer, size_t *rx_len,
     if(!rx_buffer || !rx_len || *rx_len == 0)
         return ESP_ERR_INVALID_ARG;
     
-    i2c_master_dev_handle_t dev = NULL;
-    esp_err_t err = create_device(device_addr, &dev);
-    if (err != ESP_OK) 
-    {
-        ESP_LOGE(TAG, "add_device(0x%02X) failed: %s", device_addr, esp_err_to_name(err));
+    i2c_mgmt_device_t *dev = NULL;
+    esp_err_t err = get_device(bus, device_addr, &dev);
+    if (err != ESP_OK)
         return err;
-    }
 
     size_t requested = *rx_len;
-    err = i2c_master_receive(dev, rx_buffer, requested, timeout_ms);
+    err = i2c_master_receive(dev->handle, rx_buffer, requested, resolve_timeout(dev, timeout_ms));
+    after_transfer(bus, dev, err);
     if(err != ESP_OK)
     {
-        ESP_LOGE(TAG, "receive from 0x%02X failed: %s", device_addr, esp_err_to_name(err));
-        destroy_device(dev);
+        if (!bus->probing)
+            ESP_LOGE(TAG, "receive from 0x%02X failed: %s", device_addr, esp_err_to_name(err));
         return err;
     }
 
     *rx_len = requested; // la API entrega exactamente lo solicitado si retorna OK
-    destroy_device(dev);
     return ESP_OK;
 }
 
-esp_err_t i2c_mgmt_end_transaction(void)
+esp_err_t i2c_mgmt_write_read(i2c_mgmt_handle_t bus, uint8_t device_addr, const uint8_t *tx_buffer, size_t tx_len,
+                              uint8_t *rx_buffer, size_t rx_len, int timeout_ms)
+{
+    if (!bus)
+        return ESP_ERR_INVALID_STATE;
+    
+    if (!owner_ok(bus))
+    {
+        ESP_LOGE(TAG, "Write-read called outside of owned transaction");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (!tx_buffer || tx_len == 0 || !rx_buffer || rx_len == 0)
+        return ESP_ERR_INVALID_ARG;
+
+    i2c_mgmt_device_t *dev = NULL;
+    esp_err_t err = get_device(bus, device_addr, &dev);
+    if (err != ESP_OK)
+        return err;
+
+    err = i2c_master_transmit_receive(dev->handle, tx_buffer, tx_len, rx_buffer, rx_len, resolve_timeout(dev, timeout_ms));
+    if (err != ESP_OK && !bus->probing)
+        ESP_LOGE(TAG, "transmit_receive with 0x%02X failed: %s", device_addr, esp_err_to_name(err));
+    after_transfer(bus, dev, err);
+
+    return err;
+}
+
+esp_err_t i2c_mgmt_read_regs(i2c_mgmt_handle_t bus, uint8_t device_addr, uint8_t reg, uint8_t *rx_buffer, size_t rx_len, int timeout_ms)
+{
+    return i2c_mgmt_write_read(bus, device_addr, &reg, 1, rx_buffer, rx_len, timeout_ms);
+}
+
+esp_err_t i2c_mgmt_write_regs(i2c_mgmt_handle_t bus, uint8_t device_addr, uint8_t reg, const uint8_t *tx_buffer, size_t tx_len, int timeout_ms)
 {
-    if (!initialized)
+    if (!tx_buffer || tx_len == 0 || tx_len > I2C_MGMT_MAX_BURST_LEN)
+        return ESP_ERR_INVALID_ARG;
+
+    uint8_t frame[I2C_MGMT_MAX_BURST_LEN + 1];
+    frame[0] = reg;
+    memcpy(&frame[1], tx_buffer, tx_len);
+
+    return i2c_mgmt_write(bus, device_addr, frame, tx_len + 1, timeout_ms);
+}
+
+esp_err_t i2c_mgmt_end_transaction(i2c_mgmt_handle_t bus)
+{
+    if (!bus)
         return ESP_ERR_INVALID_STATE;
 
-    if (!owner_ok())
+    if (!owner_ok(bus))
     {
         ESP_LOGE(TAG, "End transaction called by non-owner task");
         return ESP_ERR_INVALID_STATE;
     }
     
-    owner = NULL;
-    xSemaphoreGive(mutex);
-    ESP_LOGD(TAG, "I2C bus released by task: %s", pcTaskGetName(owner));
+    bus->owner = NULL;
+    xSemaphoreGive(bus->mutex);
+    ESP_LOGD(TAG, "I2C bus released by task: %s", pcTaskGetName(bus->owner));
     
     return ESP_OK;
-}
\ No newline at end of file
+}
+
+esp_err_t i2c_mgmt_calibrate(i2c_mgmt_handle_t bus, uint8_t device_addr, uint8_t probe_reg, size_t probe_len,
+                             const uint32_t *speeds_hz, size_t speeds_count, uint32_t iterations,
+                             i2c_mgmt_calib_result_t *results)
+{
+    if (!bus)
+        return ESP_ERR_INVALID_STATE;
+
+    if (!speeds_hz || speeds_count == 0 || !results || iterations == 0 ||
+        probe_len == 0 || probe_len > I2C_MGMT_MAX_BURST_LEN)
+        return ESP_ERR_INVALID_ARG;
+
+    // Configuración actual, para restaurarla al terminar
+    xSemaphoreTake(bus->mutex, portMAX_DELAY);
+    i2c_mgmt_device_t *entry = find_entry(bus, device_addr);
+    uint32_t saved_speed = entry ? entry->speed_hz : I2C_MGMT_DEFAULT_SPEED_HZ;
+    int saved_timeout = entry ? entry->timeout_ms : I2C_MGMT_DEFAULT_TIMEOUT_MS;
+    xSemaphoreGive(bus->mutex);
+
+    if (!entry)
+        return ESP_ERR_NO_MEM;
+
+    uint8_t rx[I2C_MGMT_MAX_BURST_LEN];
+    esp_err_t sweep_err = ESP_OK;
+
+    for (size_t k = 0; k < speeds_count && sweep_err == ESP_OK; ++k)
+    {
+        i2c_mgmt_calib_result_t *r = &results[k];
+        memset(r, 0, sizeof(*r));
+        r->speed_hz = speeds_hz[k];
+
+        if (speeds_hz[k] == 0 || speeds_hz[k] > I2C_MGMT_SPEED_MAX)
+        {
+            r->errors = iterations;
+            continue;
+        }
+
+        int64_t busy_us = 0;
+        for (uint32_t i = 0; i < iterations; ++i)
+        {
+            // Una transacción por iteración: el resto del tráfico sigue circulando
+            if (i2c_mgmt_begin_transaction(bus) != ESP_OK)
+            {
+                // Se corta el barrido, pero la configuración se restaura igual al final
+                sweep_err = ESP_ERR_INVALID_STATE;
+                r->errors += iterations - i;
+                break;
+            }
+
+            esp_err_t err = (i == 0) ? set_entry_config(bus, device_addr, speeds_hz[k], saved_timeout) : ESP_OK;
+            breaker_reset(entry); // se mide cada iteración, sin rechazos del circuit breaker
+
+            int64_t t0 = esp_timer_get_time();
+            if (err == ESP_OK)
+                err = i2c_mgmt_read_regs(bus, device_addr, probe_reg, rx, probe_len, saved_timeout);
+            busy_us += esp_timer_get_time() - t0;
+
+            i2c_mgmt_end_transaction(bus);
+
+            if (err == ESP_OK) r->ok++; else r->errors++;
+        }
+
+        r->avg_us = (uint32_t)(busy_us / iterations);
+        r->txn_per_s = busy_us > 0 ? (uint32_t)(((int64_t)r->ok * 1000000) / busy_us) : 0;
+
+        ESP_LOGI(TAG, "Calibration 0x%02X @ %u Hz: ok=%u err=%u avg=%u us (%u txn/s)",
+                 device_addr, (unsigned)r->speed_hz, (unsigned)r->ok, (unsigned)r->errors,
+                 (unsigned)r->avg_us, (unsigned)r->txn_per_s);
+    }
+
+    xSemaphoreTake(bus->mutex, portMAX_DELAY);
+    esp_err_t err = set_entry_config(bus, device_addr, saved_speed, saved_timeout);
+    xSemaphoreGive(bus->mutex);
+    return (sweep_err != ESP_OK) ? sweep_err : err;
+}
+
+esp_err_t i2c_mgmt_get_stats(i2c_mgmt_handle_t bus, i2c_mgmt_stats_t *out)
+{
+    if (!bus)
+        return ESP_ERR_INVALID_STATE;
+
+    if (!out)
+        return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(bus->mutex, portMAX_DELAY);
+    *out = bus->stats;
+    xSemaphoreGive(bus->mutex);
+    return ESP_OK;
+}
+
+esp_err_t i2c_mgmt_get_device_stats(i2c_mgmt_handle_t bus, uint8_t device_addr, i2c_mgmt_device_stats_t *out)
+{
+    if (!bus)
+        return ESP_ERR_INVALID_STATE;
+
+    if (!out)
+        return ESP_ERR_INVALID_ARG;
+
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    xSemaphoreTake(bus->mutex, portMAX_DELAY);
+    for (size_t i = 0; i < bus->devices_count; ++i)
+    {
+        if (bus->devices[i].addr == device_addr)
+        {
+            *out = bus->devices[i].stats;
+            err = ESP_OK;
+            break;
+        }
+    }
+    xSemaphoreGive(bus->mutex);
+    return err;
+}
@@ -0,0 +1,75 @@
+#ifndef I2C_MGMT_PRIV_H
+#define I2C_MGMT_PRIV_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "i2c_mgmt_driver.h"
+#include "i2c_mgmt_sched.h"
+
+#define I2C_MGMT_MAX_DEVICES 8            // Handles de dispositivo cacheados por bus
+
+/**
+ * @brief Entrada de la tabla de handles de dispositivo.
+ * @details Cada dirección de 7 bits tiene su propia velocidad de SCL y timeout. El
+ *          dispositivo se agrega al bus una única vez (primer uso) y el handle se
+ *          reutiliza en las transferencias siguientes; si cambia la velocidad, el
+ *          handle se descarta y se vuelve a crear en el próximo acceso.
+ */
+typedef struct {
+    uint8_t  addr;
+    uint32_t speed_hz;
+    int      timeout_ms;
+    i2c_master_dev_handle_t handle;
+    // Circuit breaker: tras varios errores seguidos el dispositivo se rechaza sin tocar
+    // el bus hasta retry_at_us; luego se deja pasar una transferencia de prueba.
+    uint32_t backoff_ms;
+    int64_t  retry_at_us;
+    i2c_mgmt_device_stats_t stats;
+} i2c_mgmt_device_t;
+
+/**
+ * @brief Acumuladores internos por clase (los promedios se calculan al leer).
+ */
+typedef struct {
+    uint32_t completed;
+    uint32_t failed;
+    uint32_t rejected;
+    uint64_t wait_sum_us;
+    uint32_t wait_max_us;
+    uint64_t exec_sum_us;
+    uint32_t exec_max_us;
+} i2c_mgmt_sched_acc_t;
+
+/**
+ * @brief Estado del planificador de un bus.
+ */
+typedef struct {
+    QueueHandle_t queues[I2C_MGMT_CLASS_MAX];
+    SemaphoreHandle_t pending;   // cuenta transacciones encoladas en todas las clases
+    TaskHandle_t service_task;
+    i2c_mgmt_sched_acc_t acc[I2C_MGMT_CLASS_MAX];
+    portMUX_TYPE acc_lock;
+} i2c_mgmt_sched_state_t;
+
+/**
+ * @brief Estado de un bus administrado.
+ */
+struct i2c_mgmt_bus_s {
+    bool used;                              // entrada del registro ocupada
+    bool ready;                             // bus creado y listo para usar
+    i2c_master_bus_config_t cfg;            // guardada para re-crear el bus tras un fallo
+    i2c_master_bus_handle_t master;         // NULL si el bus está caído
+    SemaphoreHandle_t mutex;
+    TaskHandle_t owner;
+    bool probing;                           // la transacción en curso es un sondeo (sin breaker ni recuperación)
+    int64_t retry_at_us;                    // próximo intento de re-crear un bus caído
+    i2c_mgmt_stats_t stats;                 // protegido por mutex
+    i2c_mgmt_device_t devices[I2C_MGMT_MAX_DEVICES];
+    size_t devices_count;
+    i2c_mgmt_sched_state_t sched;
+};
+
+#endif // I2C_MGMT_PRIV_H
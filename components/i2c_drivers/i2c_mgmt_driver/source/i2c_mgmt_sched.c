@@ -0,0 +1,269 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "i2c_mgmt_driver.h"
+#include "i2c_mgmt_sched.h"
+#include "i2c_mgmt_priv.h"
+
+#ifndef CONFIG_I2C_MGMT_SCHED_QUEUE_LEN
+#define CONFIG_I2C_MGMT_SCHED_QUEUE_LEN 8
+#endif
+#ifndef CONFIG_I2C_MGMT_SCHED_TASK_PRIO
+#define CONFIG_I2C_MGMT_SCHED_TASK_PRIO 5
+#endif
+#ifndef CONFIG_I2C_MGMT_SCHED_TASK_STACK
+#define CONFIG_I2C_MGMT_SCHED_TASK_STACK 3072
+#endif
+
+static const char *TAG = "i2c_mgmt_sched";
+
+/**
+ * @brief Elemento encolado: copia del descriptor más datos de control.
+ */
+typedef struct {
+    i2c_mgmt_txn_t txn;
+    int64_t submitted_us;
+    SemaphoreHandle_t done;   // sólo para i2c_mgmt_submit_sync()
+    esp_err_t *result;        // sólo para i2c_mgmt_submit_sync()
+} i2c_mgmt_sched_item_t;
+
+static esp_err_t run_script(i2c_mgmt_handle_t bus, const i2c_mgmt_txn_t *txn)
+{
+    esp_err_t err = ESP_OK;
+
+    for (uint8_t i = 0; i < txn->ops_count && err == ESP_OK; ++i)
+    {
+        const i2c_mgmt_op_t *op = &txn->ops[i];
+        switch (op->type)
+        {
+            case I2C_MGMT_OP_WRITE:
+                err = i2c_mgmt_write(bus, txn->device_addr, op->tx, op->tx_len, txn->timeout_ms);
+                break;
+            case I2C_MGMT_OP_READ:
+            {
+                size_t len = op->rx_len;
+                err = i2c_mgmt_read(bus, txn->device_addr, op->rx, &len, txn->timeout_ms);
+                break;
+            }
+            case I2C_MGMT_OP_WRITE_READ:
+                err = i2c_mgmt_write_read(bus, txn->device_addr, op->tx, op->tx_len, op->rx, op->rx_len, txn->timeout_ms);
+                break;
+            default:
+                err = ESP_ERR_INVALID_ARG;
+                break;
+        }
+    }
+    return err;
+}
+
+static void update_stats(i2c_mgmt_sched_state_t *sc, i2c_mgmt_class_t cls, esp_err_t err, uint32_t wait_us, uint32_t exec_us)
+{
+    portENTER_CRITICAL(&sc->acc_lock);
+    i2c_mgmt_sched_acc_t *a = &sc->acc[cls];
+    if (err == ESP_OK) a->completed++; else a->failed++;
+    a->wait_sum_us += wait_us;
+    a->exec_sum_us += exec_us;
+    if (wait_us > a->wait_max_us) a->wait_max_us = wait_us;
+    if (exec_us > a->exec_max_us) a->exec_max_us = exec_us;
+    portEXIT_CRITICAL(&sc->acc_lock);
+}
+
+/**
+ * @brief Toma la transacción pendiente de mayor prioridad.
+ */
+static bool take_next(i2c_mgmt_sched_state_t *sc, i2c_mgmt_sched_item_t *item)
+{
+    for (int cls = 0; cls < I2C_MGMT_CLASS_MAX; ++cls)
+    {
+        if (xQueueReceive(sc->queues[cls], item, 0) == pdTRUE)
+            return true;
+    }
+    return false;
+}
+
+static void sched_task(void *arg)
+{
+    i2c_mgmt_handle_t bus = arg;
+    i2c_mgmt_sched_state_t *sc = &bus->sched;
+    i2c_mgmt_sched_item_t item;
+
+    while (1)
+    {
+        xSemaphoreTake(sc->pending, portMAX_DELAY);
+
+        if (!take_next(sc, &item))
+            continue;
+
+        esp_err_t err = i2c_mgmt_begin_transaction(bus);
+        int64_t locked_us = esp_timer_get_time();
+
+        if (err == ESP_OK)
+        {
+            bus->probing = item.txn.probe;
+            err = run_script(bus, &item.txn);
+            bus->probing = false;
+            esp_err_t end_err = i2c_mgmt_end_transaction(bus);
+            if (err == ESP_OK) err = end_err;
+        }
+        int64_t end_us = esp_timer_get_time();
+
+        uint32_t wait_us = (uint32_t)(locked_us - item.submitted_us);
+        uint32_t exec_us = (uint32_t)(end_us - locked_us);
+        update_stats(sc, item.txn.cls, err, wait_us, exec_us);
+
+        ESP_LOGD(TAG, "txn 0x%02X cls=%d: %s (wait=%u us, exec=%u us)",
+                 item.txn.device_addr, (int)item.txn.cls, esp_err_to_name(err),
+                 (unsigned)wait_us, (unsigned)exec_us);
+
+        if (item.txn.on_done)
+            item.txn.on_done(&item.txn, err, item.txn.ctx);
+
+        if (item.done)
+        {
+            *item.result = err;
+            xSemaphoreGive(item.done);
+        }
+    }
+}
+
+esp_err_t i2c_mgmt_sched_start(i2c_mgmt_handle_t bus)
+{
+    if (!bus)
+        return ESP_ERR_INVALID_ARG;
+
+    i2c_mgmt_sched_state_t *sc = &bus->sched;
+    if (sc->service_task)
+        return ESP_OK;
+
+    for (int cls = 0; cls < I2C_MGMT_CLASS_MAX; ++cls)
+    {
+        sc->queues[cls] = xQueueCreate(CONFIG_I2C_MGMT_SCHED_QUEUE_LEN, sizeof(i2c_mgmt_sched_item_t));
+        if (!sc->queues[cls])
+        {
+            ESP_LOGE(TAG, "Failed to create queue for class %d", cls);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    sc->pending = xSemaphoreCreateCounting(CONFIG_I2C_MGMT_SCHED_QUEUE_LEN * I2C_MGMT_CLASS_MAX, 0);
+    if (!sc->pending)
+    {
+        ESP_LOGE(TAG, "Failed to create pending semaphore");
+        return ESP_ERR_NO_MEM;
+    }
+
+    char name[configMAX_TASK_NAME_LEN];
+    snprintf(name, sizeof(name), "i2c_sched%d", (int)bus->cfg.i2c_port);
+
+    BaseType_t ok = xTaskCreate(sched_task, name, CONFIG_I2C_MGMT_SCHED_TASK_STACK, bus,
+                                CONFIG_I2C_MGMT_SCHED_TASK_PRIO, &sc->service_task);
+    if (ok != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create scheduler task");
+        sc->service_task = NULL;
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "I2C scheduler started on port %d (%d classes, queue=%d)", (int)bus->cfg.i2c_port,
+             (int)I2C_MGMT_CLASS_MAX, (int)CONFIG_I2C_MGMT_SCHED_QUEUE_LEN);
+    return ESP_OK;
+}
+
+static esp_err_t enqueue(i2c_mgmt_handle_t bus, const i2c_mgmt_txn_t *txn, SemaphoreHandle_t done, esp_err_t *result)
+{
+    if (!bus || !txn || txn->cls >= I2C_MGMT_CLASS_MAX || txn->ops_count == 0 || txn->ops_count > I2C_MGMT_TXN_MAX_OPS)
+        return ESP_ERR_INVALID_ARG;
+
+    i2c_mgmt_sched_state_t *sc = &bus->sched;
+    if (!sc->service_task)
+        return ESP_ERR_INVALID_STATE;
+
+    i2c_mgmt_sched_item_t item = {
+        .txn = *txn,
+        .submitted_us = esp_timer_get_time(),
+        .done = done,
+        .result = result,
+    };
+
+    if (xQueueSend(sc->queues[txn->cls], &item, 0) != pdTRUE)
+    {
+        portENTER_CRITICAL(&sc->acc_lock);
+        sc->acc[txn->cls].rejected++;
+        portEXIT_CRITICAL(&sc->acc_lock);
+        ESP_LOGW(TAG, "Queue full for class %d (0x%02X)", (int)txn->cls, txn->device_addr);
+        return ESP_ERR_NO_MEM;
+    }
+
+    xSemaphoreGive(sc->pending);
+    return ESP_OK;
+}
+
+esp_err_t i2c_mgmt_submit(i2c_mgmt_handle_t bus, const i2c_mgmt_txn_t *txn)
+{
+    return enqueue(bus, txn, NULL, NULL);
+}
+
+esp_err_t i2c_mgmt_submit_sync(i2c_mgmt_handle_t bus, const i2c_mgmt_txn_t *txn)
+{
+    if (!bus)
+        return ESP_ERR_INVALID_ARG;
+
+    if (bus->sched.service_task && xTaskGetCurrentTaskHandle() == bus->sched.service_task)
+    {
+        ESP_LOGE(TAG, "Synchronous submit from the scheduler task would deadlock");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    StaticSemaphore_t done_buf;
+    SemaphoreHandle_t done = xSemaphoreCreateBinaryStatic(&done_buf);
+    esp_err_t result = ESP_FAIL;
+
+    esp_err_t err = enqueue(bus, txn, done, &result);
+    if (err == ESP_OK)
+    {
+        // El semáforo y el resultado viven en esta pila: se espera sin timeout para no
+        // abandonarlos mientras el servicio aún puede escribirlos.
+        xSemaphoreTake(done, portMAX_DELAY);
+        err = result;
+    }
+
+    vSemaphoreDelete(done);
+    return err;
+}
+
+esp_err_t i2c_mgmt_sched_get_stats(i2c_mgmt_handle_t bus, i2c_mgmt_class_t cls, i2c_mgmt_class_stats_t *out)
+{
+    if (!bus || cls >= I2C_MGMT_CLASS_MAX || !out)
+        return ESP_ERR_INVALID_ARG;
+
+    portENTER_CRITICAL(&bus->sched.acc_lock);
+    i2c_mgmt_sched_acc_t a = bus->sched.acc[cls];
+    portEXIT_CRITICAL(&bus->sched.acc_lock);
+
+    uint32_t n = a.completed + a.failed;
+    out->completed   = a.completed;
+    out->failed      = a.failed;
+    out->rejected    = a.rejected;
+    out->wait_avg_us = n ? (uint32_t)(a.wait_sum_us / n) : 0;
+    out->wait_max_us = a.wait_max_us;
+    out->exec_avg_us = n ? (uint32_t)(a.exec_sum_us / n) : 0;
+    out->exec_max_us = a.exec_max_us;
+    return ESP_OK;
+}
+
+void i2c_mgmt_sched_reset_stats(i2c_mgmt_handle_t bus)
+{
+    if (!bus)
+        return;
+
+    portENTER_CRITICAL(&bus->sched.acc_lock);
+    memset(bus->sched.acc, 0, sizeof(bus->sched.acc));
+    portEXIT_CRITICAL(&bus->sched.acc_lock);
+}
@@ -21,35 +21,135 @@
 #include <stdbool.h>
 
 #include "esp_err.h"
+#include "driver/gpio.h"
+#include "i2c_mgmt_driver.h"
+
+#define I2C_PN532_MAX_TARGETS 2   /**< Targets the PN532 can handle at once */
+#define I2C_PN532_ID_MAX      10  /**< Longest target identifier (triple size NFCID1) */
+
+/**
+ * @brief Modulation and baud rate used to look for targets (BrTy of InListPassiveTarget).
+ */
+typedef enum {
+    I2C_PN532_TYPE_106A = 0x00,  /**< ISO14443 type A (MIFARE), 106 kbps */
+    I2C_PN532_TYPE_212F = 0x01,  /**< FeliCa, 212 kbps */
+    I2C_PN532_TYPE_424F = 0x02,  /**< FeliCa, 424 kbps */
+    I2C_PN532_TYPE_106B = 0x03,  /**< ISO14443-3 type B, 106 kbps */
+} i2c_pn532_target_type_t;
+
+/**
+ * @brief A target found by i2c_pn532_list_targets().
+ */
+typedef struct {
+    uint8_t tg;                        /**< Logical number given by the PN532 (1 or 2) */
+    i2c_pn532_target_type_t type;      /**< Type it was found with */
+    uint8_t id[I2C_PN532_ID_MAX];      /**< NFCID1 (type A, 4/7/10 bytes), IDm (FeliCa, 8) or PUPI (type B, 4) */
+    uint8_t id_len;                    /**< Length of id */
+    uint8_t sel_res;                   /**< SAK of a type A target, 0 otherwise */
+} i2c_pn532_target_t;
 
 /**
  * @brief Initializes the PN532 NFC module over I2C.
  * @details This function sets up the PN532 module by sending the SAMConfiguration command
  * and waiting for the appropriate acknowledgment. It also reads the response frame to ensure
- * that the module is ready for further operations.
+ * that the module is ready for further operations, and limits the passive activation retries
+ * so a poll without a tag in the field answers right away.
+ * Between a command and its ACK/response the driver waits on the IRQ line when one is given,
+ * or polls the I2C status byte with a short back-off otherwise; the bus is free meanwhile.
  * 
+ * @param bus The bus the PN532 is connected to (see i2c_mgmt_start()).
+ * @param speed_hz The SCL speed used for the PN532 (up to 400 kHz).
+ * @param irq_gpio GPIO connected to the PN532 IRQ output (active low), or GPIO_NUM_NC to poll
+ *        the status byte.
  * @return ESP_OK on success, or an error code on failure.
  * @note This function should be called before any other PN532 operations.
  * @note It is expected that the I2C management driver has been initialized before calling this
  */
-esp_err_t i2c_pn532_start(void);
+esp_err_t i2c_pn532_start(i2c_mgmt_handle_t bus, uint32_t speed_hz, gpio_num_t irq_gpio);
+
+/**
+ * @brief Looks for passive targets of one type (InListPassiveTarget).
+ * @details Up to two targets are activated in a single exchange. The response frame is checked
+ *          (preamble, LEN/LCS, DCS) and each target is decoded by its type, so UIDs of any
+ *          length and the ATS of ISO14443-4 cards are handled.
+ * @param type Modulation and baud rate to look with.
+ * @param max_targets 1 or 2.
+ * @param targets Array of at least max_targets entries where the targets are stored.
+ * @param count Number of targets found (0 if none answered within about 100 ms).
+ * @return ESP_OK on success, ESP_ERR_INVALID_RESPONSE for a malformed frame, ESP_ERR_INVALID_STATE
+ *         while automatic detection runs, or another error code on failure.
+ */
+esp_err_t i2c_pn532_list_targets(i2c_pn532_target_type_t type, uint8_t max_targets,
+                                 i2c_pn532_target_t *targets, size_t *count);
 
 /**
  * @brief Reads the UID of a passive NFC target.
- * @details This function sends the INLIST_PASSIVE_TARGET command to the PN532 module
- * and waits for a response containing the UID of a passive NFC target. The UID is stored
- * in the provided buffer, and its length is returned through the uid_len parameter.
+ * @details Looks for one ISO14443 type A target with i2c_pn532_list_targets() and returns its UID.
  * 
  * @param uid Pointer to a buffer where the UID will be stored.
- * @param uid_len Pointer to a variable that will hold the length of the UID.
+ * @param uid_len In: size of uid. Out: length of the UID, or 0 if no target is found.
  * @return ESP_OK on success, or an error code on failure.
- * @note The uid buffer should be large enough to hold the expected UID length.
- * @note If no target is found, uid_len will be set to 0.
- * @note The function will block until a response is received or a timeout occurs.
+ * @note The UID is 4, 7 or 10 bytes long; a smaller buffer gets the first bytes only.
+ * @note The function blocks until a response is received or about 100 ms pass.
  * @note The PN532 module must be initialized with i2c_pn532_start()
  * before calling this function.
- * @note The expected UID length is typically 4 to 10 bytes, depending on the NFC tag type.
  */
 esp_err_t i2c_pn532_read_passive_target(uint8_t *uid, size_t *uid_len);
 
+/**
+ * @brief Checks whether a target found by the last read is still in the field.
+ * @details Deselects and re-selects the initialized target (InDeselect + InSelect). Only that
+ *          same card answers, with no anticollision and no UID transfer, so it is cheaper than
+ *          another read and a different card in the field is not mistaken for it.
+ * @param tg Logical number of the target (see i2c_pn532_target_t), 1 after
+ *        i2c_pn532_read_passive_target().
+ * @param present Set to true if the target answered.
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE while automatic detection runs, or another
+ *         error code on failure.
+ */
+esp_err_t i2c_pn532_target_present(uint8_t tg, bool *present);
+
+/**
+ * @brief Releases every initialized target (InRelease).
+ * @details The PN532 ends the session with the card and forgets it; call it once the card
+ *          has left the field or when it is no longer of interest.
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE while automatic detection runs, or another
+ *         error code on failure.
+ */
+esp_err_t i2c_pn532_release(void);
+
+/**
+ * @brief Starts automatic card detection (InAutoPoll) on the PN532.
+ * @details The PN532 scans for ISO14443A targets on its own and only raises IRQ when one
+ *          enters the field, so nothing is sent on the bus until a card is presented.
+ *          Read the target with i2c_pn532_autopoll_fetch(); the scan is re-armed after each
+ *          fetch. i2c_pn532_read_passive_target() is not available while it runs.
+ * @param period Time between scans, in units of 150 ms (1 to 15).
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED if the driver was started without an IRQ
+ *         GPIO, or another error code on failure.
+ */
+esp_err_t i2c_pn532_autopoll_start(uint8_t period);
+
+/**
+ * @brief Stops automatic card detection.
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t i2c_pn532_autopoll_stop(void);
+
+/**
+ * @brief Tells whether automatic card detection has found a target (IRQ low). No I2C access.
+ * @return true if a target is waiting to be fetched.
+ */
+bool i2c_pn532_autopoll_pending(void);
+
+/**
+ * @brief Fetches the target found by automatic card detection and re-arms the scan.
+ * @param uid Buffer where the UID is stored.
+ * @param uid_len In: size of uid. Out: length of the UID, or 0 if no target is pending
+ *        (in which case nothing is sent on the bus).
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if automatic detection is not running,
+ *         or another error code on failure.
+ */
+esp_err_t i2c_pn532_autopoll_fetch(uint8_t *uid, size_t *uid_len);
+
  #endif // I2C_PN532_DRIVER_H
\ No newline at end of file
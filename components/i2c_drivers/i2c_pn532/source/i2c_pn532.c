@@ -5,91 +5,232 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
+#include "driver/gpio.h"
 
 #include "i2c_mgmt_driver.h"
+#include "i2c_mgmt_sched.h"
 #include "i2c_pn532.h"
 
-#define PN532_MAX_FRAME  21
-#define PN532_NO_TAG_FOUND 0x80
-#define PN532_UID_OFFSET  14
-#define PN532_UID_SIZE_OFFSET  13
+#define PN532_MAX_FRAME  21   // respuestas de configuración y estado
+#define PN532_MAX_DATA   96   // datos más largos aceptados (InListPassiveTarget con 2 targets)
+#define PN532_FRAME_OVERHEAD 10 // estado + 00 00 FF LEN LCS TFI CMD+1 ... DCS 00
 #define PN532_TIMEOUT_MS 100
-#define PN532_DELAY_MS 50
+
+#define PN532_STATUS_READY        0x01
+#define PN532_ACK_TIMEOUT_MS      20   // el ACK llega ~1 ms después del comando
+#define PN532_RESPONSE_TIMEOUT_MS 100  // con MxRtyPassiveActivation=1 "sin tag" responde en decenas de ms
+#define PN532_POLL_MIN_US         250  // primer back-off del sondeo del byte de estado
+#define PN532_POLL_MAX_BUSY_US    1000 // por encima de esto se cede la CPU (vTaskDelay)
+
+#define PN532_HOST_TO_PN532       0xD4
+#define PN532_PN532_TO_HOST       0xD5
+#define PN532_CMD_IN_DESELECT     0x44
+#define PN532_CMD_IN_LIST_PASSIVE 0x4A
+#define PN532_CMD_IN_RELEASE      0x52
+#define PN532_CMD_IN_SELECT       0x54
+#define PN532_CMD_IN_AUTO_POLL    0x60
+#define PN532_TARGET_ALL          0x00 // Tg=0: todos los targets inicializados
+// Respuesta de InSelect/InDeselect/InRelease: 01 00 00 FF 03 FD D5 CMD+1 Status DCS 00
+#define PN532_STATUS_FRAME        11
+#define PN532_STATUS_ERROR_MASK   0x3F // los bits altos indican NAD/MI, no error
+#define PN532_AUTOPOLL_ENDLESS    0xFF
+#define PN532_AUTOPOLL_TYPE_106A  0x10 // ISO14443 tipo A (Mifare) a 106 kbps
+#define PN532_TFI_ERROR           0x7F // trama de error de aplicación
+
+// Longitud máxima de los datos de un target en la respuesta de InListPassiveTarget
+#define PN532_TARGET_106A_MAX     40   // Tg SENS_RES(2) SEL_RES NFCIDLen NFCID1(<=10) [ATS]
+#define PN532_TARGET_FELICA_MAX   21   // Tg POL_RES(18 o 20)
+#define PN532_TARGET_106B_MAX     24   // Tg ATQB(12) ATTRIB_RES_Len ATTRIB_RES
+#define PN532_SEL_RES_ISO14443_4  0x20 // el PN532 agrega el ATS de estas tarjetas
 
 static const uint8_t ACKNOWLEDGE[]           = {0x01, 0x00, 0x00, 0xFF, 0x00, 0xFF, 0x00};
 static const uint8_t NO_ACKNOWLEDGE[]        = {0x01, 0x00, 0x00, 0xFF, 0xFF, 0x00, 0x00};
 //static const uint8_t FIRMWARE[]              = {0x00, 0x00, 0xFF, 0x02, 0xFE, 0xD4, 0x02, 0x2A, 0x00};
 static const uint8_t SAMCONFIG[]             = {0x00, 0x00, 0xFF, 0x03, 0xFD, 0xD4, 0x14, 0x01, 0x17, 0x00};
 static const uint8_t SAMCONFIG_RESPONSE[]    = {0x01, 0x00, 0x00, 0xFF, 0x02, 0xFE, 0xD5, 0x15, 0x016, 0x00};
-static const uint8_t INLIST_PASSIVE_TARGET[] = {0x00, 0x00, 0xFF, 0x04, 0XFC, 0XD4, 0x4A, 0x01, 0x00, 0xE1, 0x00};
+// RFConfiguration MaxRetries: MxRtyATR=0xFF, MxRtyPSL=0x01, MxRtyPassiveActivation=0x01
+static const uint8_t RFCONFIG_RETRIES[]      = {0x00, 0x00, 0xFF, 0x06, 0xFA, 0xD4, 0x32, 0x05, 0xFF, 0x01, 0x01, 0xF4, 0x00};
+static const uint8_t RFCONFIG_RESPONSE[]     = {0x01, 0x00, 0x00, 0xFF, 0x02, 0xFE, 0xD5, 0x33, 0xF8, 0x00};
 
 static const int PN532_I2C_ADDRESS = 0x24; // Dirección I2C del PN532 (0x48 >> 1)
 
 static const char *TAG = "i2c_pn532";
 
-static esp_err_t pn532_transaction(const char *op_name,
-                                  const uint8_t *cmd, size_t cmd_len,
-                                  int inter_delay,              // p.ej. PN532_DELAY_MS
-                                  int timeout,                  // p.ej. PN532_TIMEOUT_MS
-                                  uint8_t *resp_buf, size_t *resp_len, // si resp_len==NULL no copia
-                                  const uint8_t *expected_resp, size_t expected_len,
-                                  bool match_as_prefix)                // true: expected es prefijo
+static i2c_mgmt_handle_t pn532_bus = NULL; // Bus donde cuelga el PN532
+static gpio_num_t pn532_irq = GPIO_NUM_NC;  // Línea IRQ (activa en bajo) o NC para sondear el estado
+static SemaphoreHandle_t irq_sem = NULL;
+static bool autopoll_active = false;        // InAutoPoll en curso: el PN532 busca tags solo
+static uint8_t autopoll_period = 0;
+
+static void IRAM_ATTR pn532_irq_isr(void *arg)
+{
+    BaseType_t hp_task_woken = pdFALSE;
+    xSemaphoreGiveFromISR(irq_sem, &hp_task_woken);
+    if (hp_task_woken) portYIELD_FROM_ISR();
+}
+
+/**
+ * @brief Ejecuta una única transferencia con el PN532 como transacción de la clase de seguridad.
+ * @details El intercambio comando/ACK/respuesta se hace en transacciones separadas, de modo
+ *          que el bus queda libre mientras el PN532 procesa el comando.
+ */
+static esp_err_t pn532_xfer(i2c_mgmt_op_type_t type, const uint8_t *tx, size_t tx_len,
+                            uint8_t *rx, size_t rx_len, int timeout)
 {
-    // 1) Iniciar transacción
-    if (i2c_mgmt_begin_transaction() != ESP_OK)
+    i2c_mgmt_txn_t txn = {
+        .device_addr = PN532_I2C_ADDRESS,
+        .cls = I2C_MGMT_CLASS_SECURITY,
+        .timeout_ms = timeout,
+        .ops = { { .type = type, .tx = tx, .tx_len = tx_len, .rx = rx, .rx_len = rx_len } },
+        .ops_count = 1,
+    };
+    return i2c_mgmt_submit_sync(pn532_bus, &txn);
+}
+
+/**
+ * @brief Lectura de sondeo: un NACK o timeout mientras el PN532 procesa no cuenta para el
+ *        circuit breaker ni dispara la recuperación del bus.
+ */
+static esp_err_t pn532_poll(uint8_t *rx, size_t rx_len, int timeout)
+{
+    i2c_mgmt_txn_t txn = {
+        .device_addr = PN532_I2C_ADDRESS,
+        .cls = I2C_MGMT_CLASS_SECURITY,
+        .timeout_ms = timeout,
+        .ops = { { .type = I2C_MGMT_OP_READ, .rx = rx, .rx_len = rx_len } },
+        .ops_count = 1,
+        .probe = true,
+    };
+    return i2c_mgmt_submit_sync(pn532_bus, &txn);
+}
+
+/**
+ * @brief Lee una trama (ACK o respuesta) en cuanto el PN532 la tiene lista.
+ * @details Cada lectura I2C del PN532 empieza con el byte de estado, y leerlo solo no consume
+ *          la trama. Sin IRQ se sondea únicamente ese byte, con back-off exponencial (esperas
+ *          activas cortas mientras la trama es inminente y luego un tick por intento), y la
+ *          trama completa se lee una sola vez, cuando el PN532 ya está listo: un "no listo"
+ *          ocupa el bus lo que un byte y no lo que la respuesta más larga. Con IRQ la línea
+ *          indica que está lista y se lee la trama directamente. Cada lectura es su propia
+ *          transacción, así el bus queda libre mientras el PN532 procesa el comando.
+ * @return ESP_OK con la trama en dst, o ESP_ERR_TIMEOUT si no estuvo lista en timeout_ms.
+ */
+static esp_err_t pn532_read_ready(uint8_t *dst, size_t len, int timeout, int timeout_ms)
+{
+    const int64_t deadline = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    uint32_t backoff_us = PN532_POLL_MIN_US;
+
+    for (;;)
     {
-        ESP_LOGE(TAG, "Failed to begin I2C transaction for %s", op_name);
-        return ESP_FAIL;
+        if (pn532_irq != GPIO_NUM_NC)
+        {
+            while (gpio_get_level(pn532_irq) != 0)
+            {
+                int64_t left_us = deadline - esp_timer_get_time();
+                if (left_us <= 0) return ESP_ERR_TIMEOUT;
+                (void)xSemaphoreTake(irq_sem, pdMS_TO_TICKS((left_us + 999) / 1000) + 1);
+            }
+        }
+
+        // Algunos módulos no reconocen la dirección mientras procesan: cuenta como "no listo"
+        uint8_t status = 0;
+        esp_err_t err = (pn532_irq != GPIO_NUM_NC) ? ESP_OK : pn532_poll(&status, 1, timeout);
+        if (err == ESP_OK && (pn532_irq != GPIO_NUM_NC || (status & PN532_STATUS_READY)))
+        {
+            // Listo: la trama se lee una vez, como transferencia normal
+            err = pn532_xfer(I2C_MGMT_OP_READ, NULL, 0, dst, len, timeout);
+            if (err != ESP_OK) return err;
+            if (dst[0] & PN532_STATUS_READY) return ESP_OK;
+        }
+
+        if (esp_timer_get_time() >= deadline) return ESP_ERR_TIMEOUT;
+
+        if (backoff_us <= PN532_POLL_MAX_BUSY_US)
+        {
+            esp_rom_delay_us(backoff_us);
+            backoff_us *= 2;
+        }
+        else
+        {
+            vTaskDelay(1);
+        }
     }
+}
+
+/**
+ * @brief Envía un comando y espera su ACK (pasos 1 y 2 del intercambio).
+ */
+static esp_err_t pn532_send_command(const char *op_name, const uint8_t *cmd, size_t cmd_len, int timeout)
+{
+    // Un flanco viejo en la IRQ no debe adelantar la espera del ACK
+    if (irq_sem) (void)xSemaphoreTake(irq_sem, 0);
 
-    // 2) Enviar comando
-    esp_err_t err = i2c_mgmt_write(PN532_I2C_ADDRESS, cmd, cmd_len, timeout);
+    // 1) Enviar comando
+    esp_err_t err = pn532_xfer(I2C_MGMT_OP_WRITE, cmd, cmd_len, NULL, 0, timeout);
     if (err != ESP_OK) 
     {
-        i2c_mgmt_end_transaction(); // Finalizar transacción en caso de error
         ESP_LOGE(TAG, "Failed to send %s command", op_name);
         return err;
     }
 
-    if (inter_delay) vTaskDelay(inter_delay);
-
-    // 3) Leer ACK
-    size_t ack_len = sizeof(ACKNOWLEDGE);
+    // 2) Leer ACK
     uint8_t ack[sizeof(ACKNOWLEDGE)] = {0};
-    err = i2c_mgmt_read(PN532_I2C_ADDRESS, ack, &ack_len, timeout);
+    err = pn532_read_ready(ack, sizeof(ack), timeout, PN532_ACK_TIMEOUT_MS);
 
     ESP_LOGD(TAG, "%s: Ack Read bytes %02X, %02X, %02X, %02X, %02X, %02X, %02X",
              op_name, ack[0], ack[1], ack[2], ack[3], ack[4], ack[5], ack[6]);
 
     if (err != ESP_OK) 
     {
-        i2c_mgmt_end_transaction(); // Finalizar transacción en caso de error
         ESP_LOGE(TAG, "Failed to read ACK for %s", op_name);
         return err;
     }
     if (memcmp(ack, ACKNOWLEDGE, sizeof(ACKNOWLEDGE)) != 0 ||
         memcmp(ack, NO_ACKNOWLEDGE, sizeof(NO_ACKNOWLEDGE)) == 0) 
     {
-        i2c_mgmt_end_transaction(); // Finalizar transacción en caso de error
         ESP_LOGE(TAG, "Failed to receive valid ACK for %s", op_name);
         return ESP_FAIL;
     }
+    return ESP_OK;
+}
 
-    if (inter_delay) vTaskDelay(inter_delay);
+static esp_err_t pn532_transaction(const char *op_name,
+                                  const uint8_t *cmd, size_t cmd_len,
+                                  int response_timeout,         // p.ej. PN532_RESPONSE_TIMEOUT_MS
+                                  int timeout,                  // p.ej. PN532_TIMEOUT_MS
+                                  uint8_t *resp_buf, size_t *resp_len, // si resp_len==NULL no copia
+                                  const uint8_t *expected_resp, size_t expected_len,
+                                  bool match_as_prefix)                // true: expected es prefijo
+{
+    const int64_t t0 = esp_timer_get_time();
 
-    // 4) Leer respuesta
+    // 1) y 2) Enviar comando y leer ACK
+    esp_err_t err = pn532_send_command(op_name, cmd, cmd_len, timeout);
+    if (err != ESP_OK) return err;
+
+    // 3) Leer respuesta
     uint8_t local_buf[PN532_MAX_FRAME] = {0};
     uint8_t *dst = resp_buf ? resp_buf : local_buf;
     size_t   to_read = resp_len ? *resp_len : PN532_MAX_FRAME;
 
-    if (to_read == 0 || to_read > PN532_MAX_FRAME) 
+    if (to_read == 0 || (!resp_buf && to_read > PN532_MAX_FRAME)) 
         to_read = PN532_MAX_FRAME;
 
-    err = i2c_mgmt_read(PN532_I2C_ADDRESS, dst, &to_read, timeout);
+    err = pn532_read_ready(dst, to_read, timeout, response_timeout);
+    if (err == ESP_ERR_TIMEOUT)
+    {
+        // El PN532 sigue con el comando: un ACK del host lo aborta
+        (void)pn532_xfer(I2C_MGMT_OP_WRITE, &ACKNOWLEDGE[1], sizeof(ACKNOWLEDGE) - 1, NULL, 0, timeout);
+        ESP_LOGD(TAG, "%s: no response in %d ms, aborted", op_name, response_timeout);
+        return err;
+    }
     if (err != ESP_OK)
     {
-        i2c_mgmt_end_transaction(); // Finalizar transacción en caso de error
         ESP_LOGE(TAG, "Failed to read response for %s", op_name);
         return err;
     }
@@ -98,13 +239,12 @@ static esp_err_t pn532_transaction(const char *op_name,
     for (size_t i = 0; i < to_read; ++i)
         ESP_LOGD(TAG, "%s: Resp[%02u]=%02X", op_name, (unsigned)i, dst[i]);
 
-    // 5) Validar respuesta (opcional)
+    // 4) Validar respuesta (opcional)
     if (expected_resp && expected_len > 0) {
         if (match_as_prefix) 
         {
             if (to_read < expected_len || memcmp(dst, expected_resp, expected_len) != 0) 
             {
-                i2c_mgmt_end_transaction(); // Finalizar transacción en caso de error
                 ESP_LOGE(TAG, "%s: response prefix mismatch", op_name);
                 return ESP_FAIL;
             }
@@ -113,88 +253,472 @@ static esp_err_t pn532_transaction(const char *op_name,
         {
             if (to_read != expected_len || memcmp(dst, expected_resp, expected_len) != 0) 
             {
-                i2c_mgmt_end_transaction(); // Finalizar transacción en caso de error
                 ESP_LOGE(TAG, "%s: response mismatch", op_name);
                 return ESP_FAIL;
             }
         }
     }
 
-    // 6) Finalizar transacción
-    if (i2c_mgmt_end_transaction() != ESP_OK)
+    // 5) Copiar longitud leída
+    if (resp_len) *resp_len = to_read;
+
+    ESP_LOGD(TAG, "%s: done in %lld us", op_name, (long long)(esp_timer_get_time() - t0));
+    return ESP_OK;
+}
+
+static esp_err_t pn532_irq_setup(gpio_num_t irq_gpio)
+{
+    if (!irq_sem)
     {
-        ESP_LOGE(TAG, "Failed to end I2C transaction for %s", op_name);
-        return ESP_FAIL;
+        irq_sem = xSemaphoreCreateBinary();
+        if (!irq_sem) return ESP_ERR_NO_MEM;
     }
-    
-    // 7) Copiar longitud leída
-    if (resp_len) *resp_len = to_read;
+
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err == ESP_ERR_INVALID_STATE) err = ESP_OK; // ya instalado por otro módulo
+    if (err != ESP_OK) return err;
+
+    gpio_config_t io = {
+        .pin_bit_mask = 1ULL << irq_gpio,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_NEGEDGE,
+    };
+    if ((err = gpio_config(&io)) != ESP_OK) return err;
+    if ((err = gpio_isr_handler_add(irq_gpio, pn532_irq_isr, NULL)) != ESP_OK) return err;
+
+    pn532_irq = irq_gpio;
     return ESP_OK;
 }
 
-esp_err_t i2c_pn532_start(void)
+esp_err_t i2c_pn532_start(i2c_mgmt_handle_t bus, uint32_t speed_hz, gpio_num_t irq_gpio)
 {
-    ESP_LOGI(TAG, "Initializing PN532 NFC module over I2C");
+    if (!bus) return ESP_ERR_INVALID_ARG;
+    if (irq_gpio != GPIO_NUM_NC && !GPIO_IS_VALID_GPIO(irq_gpio)) return ESP_ERR_INVALID_ARG;
+
+    ESP_LOGI(TAG, "Initializing PN532 NFC module over I2C (%s)",
+             irq_gpio != GPIO_NUM_NC ? "IRQ" : "status polling");
+
+    pn532_bus = bus;
+    esp_err_t err = i2c_mgmt_device_config(pn532_bus, PN532_I2C_ADDRESS, speed_hz, PN532_TIMEOUT_MS);
+    if (err != ESP_OK) return err;
+
+    if (pn532_irq != GPIO_NUM_NC)
+    {
+        (void)gpio_isr_handler_remove(pn532_irq);
+        pn532_irq = GPIO_NUM_NC;
+    }
+    if (irq_gpio != GPIO_NUM_NC && (err = pn532_irq_setup(irq_gpio)) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "PN532 IRQ setup failed: %s", esp_err_to_name(err));
+        return err;
+    }
 
     // Send SAMConfiguration command
     size_t resp_len = sizeof(SAMCONFIG_RESPONSE);
     uint8_t resp[sizeof(SAMCONFIG_RESPONSE)] = {0};
 
-    esp_err_t err = pn532_transaction("SAMConfiguration",
+    err = pn532_transaction("SAMConfiguration",
                                      SAMCONFIG, sizeof(SAMCONFIG),
-                                     PN532_DELAY_MS,
+                                     PN532_RESPONSE_TIMEOUT_MS,
                                      PN532_TIMEOUT_MS,
                                      resp, &resp_len,
                                      SAMCONFIG_RESPONSE, sizeof(SAMCONFIG_RESPONSE),
                                      true);
     if (err != ESP_OK) return err;
 
+    // Un solo intento de activación: sin tag, InListPassiveTarget responde NbTg=0 enseguida
+    // en lugar de quedarse buscando indefinidamente
+    uint8_t rf_resp[sizeof(RFCONFIG_RESPONSE)] = {0};
+    resp_len = sizeof(rf_resp);
+    err = pn532_transaction("RFConfiguration",
+                                     RFCONFIG_RETRIES, sizeof(RFCONFIG_RETRIES),
+                                     PN532_RESPONSE_TIMEOUT_MS,
+                                     PN532_TIMEOUT_MS,
+                                     rf_resp, &resp_len,
+                                     RFCONFIG_RESPONSE, sizeof(RFCONFIG_RESPONSE),
+                                     true);
+    if (err != ESP_OK) return err;
+
     ESP_LOGI(TAG, "PN532 initialized successfully");
     return ESP_OK;
 }
 
-esp_err_t i2c_pn532_read_passive_target(uint8_t *uid, size_t *uid_len)
+/**
+ * @brief Arma una trama normal de comando: 00 00 FF LEN LCS D4 data DCS 00.
+ * @return Longitud de la trama (len + 8 bytes).
+ */
+static size_t pn532_build_frame(const uint8_t *data, size_t len, uint8_t *frame)
 {
- // Aquí se pide la trama completa y luego se interpreta.
-    uint8_t resp[PN532_MAX_FRAME] = {0};
-    size_t  resp_len = PN532_MAX_FRAME;
+    uint8_t len_tfi = (uint8_t)(len + 1);
+    uint8_t sum = PN532_HOST_TO_PN532;
+    size_t n = 0;
 
-    // En muchas implementaciones solo interesa chequear el prefijo de cabecera de respuesta.
-    // Si se conoce un prefijo mínimo de respuesta para InListPassiveTarget, puede usarse.
-    // Si no, se omite expected_resp (pase expected_resp=NULL).
-    const uint8_t *expected_prefix = NULL;
-    size_t expected_prefix_len = 0;
+    frame[n++] = 0x00; frame[n++] = 0x00; frame[n++] = 0xFF;
+    frame[n++] = len_tfi;
+    frame[n++] = (uint8_t)(0x100 - len_tfi);
+    frame[n++] = PN532_HOST_TO_PN532;
+    for (size_t i = 0; i < len; ++i)
+    {
+        frame[n++] = data[i];
+        sum += data[i];
+    }
+    frame[n++] = (uint8_t)(0x100 - sum);
+    frame[n++] = 0x00;
+    return n;
+}
 
-    esp_err_t err = pn532_transaction("InListPassiveTarget",
-                                     INLIST_PASSIVE_TARGET, sizeof(INLIST_PASSIVE_TARGET),
-                                     PN532_DELAY_MS,
-                                     PN532_TIMEOUT_MS,
-                                     resp, &resp_len,
-                                     expected_prefix, expected_prefix_len,
-                                     false);
+/**
+ * @brief Valida una trama de respuesta normal tal como se lee por I2C (byte de estado incluido).
+ * @details Comprueba preámbulo, LEN/LCS, TFI, código de respuesta y DCS, y que la trama entre
+ *          entera en lo leído.
+ * @param buf Bytes leídos.
+ * @param buf_len Cantidad de bytes leídos.
+ * @param cmd Comando al que responde la trama.
+ * @param data Apunta a los datos de la respuesta (sin TFI ni código).
+ * @param data_len Longitud de los datos.
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE si la trama no entró en el buffer, o ESP_ERR_INVALID_RESPONSE.
+ */
+static esp_err_t pn532_parse_frame(const uint8_t *buf, size_t buf_len, uint8_t cmd,
+                                   const uint8_t **data, size_t *data_len)
+{
+    // Estado, y el preámbulo puede traer ceros de más antes de 00 FF
+    size_t i = 1;
+    while (i < buf_len && buf[i] == 0x00) i++;
+    if (i < 2 || i + 3 > buf_len || buf[i] != 0xFF) return ESP_ERR_INVALID_RESPONSE;
+    i++;
+
+    const uint8_t len = buf[i];
+    if ((uint8_t)(len + buf[i + 1]) != 0 || len < 2) return ESP_ERR_INVALID_RESPONSE; // ACK, extendida o LCS mala
+    i += 2;
+    if (i + len + 1 > buf_len) return ESP_ERR_INVALID_SIZE;
+
+    if (buf[i] == PN532_TFI_ERROR) 
+    {
+        ESP_LOGW(TAG, "Error frame in response to 0x%02X", cmd);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    if (buf[i] != PN532_PN532_TO_HOST || buf[i + 1] != (uint8_t)(cmd + 1)) return ESP_ERR_INVALID_RESPONSE;
+
+    uint8_t sum = 0;
+    for (size_t k = 0; k <= len; ++k)
+        sum += buf[i + k];
+    if (sum != 0) 
+    {
+        ESP_LOGW(TAG, "Bad checksum in response to 0x%02X", cmd);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    *data = &buf[i + 2];
+    *data_len = len - 2;
+    return ESP_OK;
+}
+
+/**
+ * @brief Interpreta los datos de un target de InListPassiveTarget (o el TargetData de InAutoPoll).
+ * @return Bytes consumidos, o 0 si los datos están incompletos o son incoherentes.
+ */
+static size_t pn532_parse_target(i2c_pn532_target_type_t type, const uint8_t *d, size_t len,
+                                 i2c_pn532_target_t *target)
+{
+    size_t n;
+
+    memset(target, 0, sizeof(*target));
+    target->type = type;
+    if (len < 2) return 0;
+    target->tg = d[0];
+
+    switch (type)
+    {
+        case I2C_PN532_TYPE_106A:
+            // Tg SENS_RES(2) SEL_RES NFCIDLength NFCID1 [ATS]
+            if (len < 5 || d[4] == 0 || d[4] > I2C_PN532_ID_MAX || 5u + d[4] > len) return 0;
+            target->sel_res = d[3];
+            target->id_len = d[4];
+            memcpy(target->id, &d[5], d[4]);
+            n = 5u + d[4];
+            if ((d[3] & PN532_SEL_RES_ISO14443_4) && n < len)
+            {
+                if (d[n] == 0 || n + d[n] > len) return 0; // ATSLength se cuenta a sí mismo
+                n += d[n];
+            }
+            return n;
+
+        case I2C_PN532_TYPE_212F:
+        case I2C_PN532_TYPE_424F:
+            // Tg POL_RES_Len 01 IDm(8) PMm(8) [SYST_CODE(2)]
+            if (d[1] < 18 || 1u + d[1] > len) return 0;
+            target->id_len = 8;
+            memcpy(target->id, &d[3], 8);
+            return 1u + d[1];
+
+        case I2C_PN532_TYPE_106B:
+            // Tg ATQB(12: 50 PUPI(4) AppData(4) ProtInfo(3)) ATTRIB_RES_Len ATTRIB_RES
+            if (len < 14 || d[1] != 0x50 || 14u + d[13] > len) return 0;
+            target->id_len = 4;
+            memcpy(target->id, &d[2], 4);
+            return 14u + d[13];
+
+        default:
+            return 0;
+    }
+}
+
+esp_err_t i2c_pn532_list_targets(i2c_pn532_target_type_t type, uint8_t max_targets,
+                                 i2c_pn532_target_t *targets, size_t *count)
+{
+    if (!targets || !count || max_targets < 1 || max_targets > I2C_PN532_MAX_TARGETS) return ESP_ERR_INVALID_ARG;
+    if (!pn532_bus) return ESP_ERR_INVALID_STATE;
+    if (autopoll_active) return ESP_ERR_INVALID_STATE;
+    *count = 0;
+
+    // InListPassiveTarget MaxTg BrTy [InitiatorData]
+    uint8_t cmd[8] = { PN532_CMD_IN_LIST_PASSIVE, max_targets, (uint8_t)type };
+    size_t cmd_len = 3;
+    size_t per_target;
+    switch (type)
+    {
+        case I2C_PN532_TYPE_106A:
+            per_target = PN532_TARGET_106A_MAX;
+            break;
+        case I2C_PN532_TYPE_212F:
+        case I2C_PN532_TYPE_424F:
+            // Polling FeliCa: código de sistema FFFF (cualquiera), sin datos extra, slot único
+            cmd[cmd_len++] = 0x00; cmd[cmd_len++] = 0xFF; cmd[cmd_len++] = 0xFF;
+            cmd[cmd_len++] = 0x00; cmd[cmd_len++] = 0x00;
+            per_target = PN532_TARGET_FELICA_MAX;
+            break;
+        case I2C_PN532_TYPE_106B:
+            cmd[cmd_len++] = 0x00; // AFI: todas las familias
+            per_target = PN532_TARGET_106B_MAX;
+            break;
+        default:
+            return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t frame[sizeof(cmd) + 8];
+    size_t frame_len = pn532_build_frame(cmd, cmd_len, frame);
+
+    // Se lee solo lo que puede ocupar la respuesta para este tipo y cantidad de targets
+    uint8_t resp[PN532_FRAME_OVERHEAD + PN532_MAX_DATA] = {0};
+    size_t resp_len = PN532_FRAME_OVERHEAD + 1 + max_targets * per_target;
+    if (resp_len > sizeof(resp)) resp_len = sizeof(resp);
+
+    esp_err_t err = pn532_transaction("InListPassiveTarget", frame, frame_len,
+                                      PN532_RESPONSE_TIMEOUT_MS,
+                                      PN532_TIMEOUT_MS,
+                                      resp, &resp_len,
+                                      NULL, 0,
+                                      false);
+    if (err == ESP_ERR_TIMEOUT)
+    {
+        // Sin respuesta en el plazo: el comando se abortó y se informa "sin tag"
+        return ESP_OK;
+    }
+    if (err != ESP_OK) return err;
+
+    const uint8_t *data;
+    size_t data_len;
+    err = pn532_parse_frame(resp, resp_len, PN532_CMD_IN_LIST_PASSIVE, &data, &data_len);
     if (err != ESP_OK)
     {
-        if (uid_len) *uid_len = 0;
+        ESP_LOGE(TAG, "InListPassiveTarget: invalid response frame (%s)", esp_err_to_name(err));
         return err;
     }
 
-    // Interpretación mínima del código “no tag”
-    if (resp_len > 1 && resp[1] == PN532_NO_TAG_FOUND) 
+    // NbTg y luego los datos de cada target, uno detrás de otro
+    if (data_len < 1 || data[0] > max_targets) return ESP_ERR_INVALID_RESPONSE;
+    size_t pos = 1;
+    for (uint8_t i = 0; i < data[0]; ++i)
+    {
+        size_t used = pn532_parse_target(type, &data[pos], data_len - pos, &targets[i]);
+        if (used == 0)
+        {
+            ESP_LOGE(TAG, "InListPassiveTarget: malformed data for target %u", (unsigned)i + 1);
+            *count = 0;
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        pos += used;
+    }
+
+    *count = data[0];
+    ESP_LOGD(TAG, "InListPassiveTarget: %u target(s)", (unsigned)*count);
+    return ESP_OK;
+}
+
+esp_err_t i2c_pn532_read_passive_target(uint8_t *uid, size_t *uid_len)
+{
+    i2c_pn532_target_t target;
+    size_t count = 0;
+
+    esp_err_t err = i2c_pn532_list_targets(I2C_PN532_TYPE_106A, 1, &target, &count);
+    if (count == 0 || err != ESP_OK)
     {
-        ESP_LOGD(TAG, "No passive target found");
         if (uid_len) *uid_len = 0;
-        return ESP_OK;
+        return err;
     }
 
-    // Extraer UID según el formato de respuesta
-    // https://www.nxp.com/docs/en/user-guide/141520.pdf
     if (uid && uid_len && *uid_len > 0)
     {
-        size_t uid_sz  = resp[PN532_UID_SIZE_OFFSET]; // Longitud del UID en la respuesta
+        size_t uid_sz = target.id_len;
         if (uid_sz > *uid_len) uid_sz = *uid_len; // No exceder el buffer del usuario
-        memcpy(uid, &resp[PN532_UID_OFFSET], uid_sz);
+        memcpy(uid, target.id, uid_sz);
         *uid_len = uid_sz;
     }
+    return ESP_OK;
+}
+
+/**
+ * @brief Envía un comando de gestión de targets (InSelect, InDeselect, InRelease) y devuelve
+ *        el byte de estado de la respuesta.
+ * @return ESP_OK con status cargado, ESP_ERR_TIMEOUT si el PN532 no respondió a tiempo, u otro error.
+ */
+static esp_err_t pn532_target_command(const char *op_name, uint8_t cmd, uint8_t tg, uint8_t *status)
+{
+    const uint8_t params[] = { cmd, tg };
+    uint8_t frame[sizeof(params) + 8];
+    size_t n = pn532_build_frame(params, sizeof(params), frame);
+
+    uint8_t resp[PN532_STATUS_FRAME] = {0};
+    size_t resp_len = sizeof(resp);
+    esp_err_t err = pn532_transaction(op_name, frame, n,
+                                      PN532_RESPONSE_TIMEOUT_MS,
+                                      PN532_TIMEOUT_MS,
+                                      resp, &resp_len,
+                                      NULL, 0,
+                                      false);
+    if (err != ESP_OK) return err;
 
+    const uint8_t *data;
+    size_t data_len;
+    err = pn532_parse_frame(resp, resp_len, cmd, &data, &data_len);
+    if (err != ESP_OK) return err;
+    if (data_len < 1) return ESP_ERR_INVALID_RESPONSE;
+
+    *status = data[0] & PN532_STATUS_ERROR_MASK;
     return ESP_OK;
 }
+
+esp_err_t i2c_pn532_target_present(uint8_t tg, bool *present)
+{
+    if (!present || tg < 1 || tg > I2C_PN532_MAX_TARGETS) return ESP_ERR_INVALID_ARG;
+    if (!pn532_bus) return ESP_ERR_INVALID_STATE;
+    if (autopoll_active) return ESP_ERR_INVALID_STATE;
+
+    // Como libnfc: InDeselect + InSelect sobre el target ya inicializado. Solo responde la
+    // misma tarjeta, sin anticolisión ni transferencia del UID
+    uint8_t status = 0;
+    esp_err_t err = pn532_target_command("InDeselect", PN532_CMD_IN_DESELECT, tg, &status);
+    if (err == ESP_OK && status == 0)
+        err = pn532_target_command("InSelect", PN532_CMD_IN_SELECT, tg, &status);
+
+    if (err == ESP_ERR_TIMEOUT)
+    {
+        *present = false;
+        return ESP_OK;
+    }
+    if (err != ESP_OK) return err;
+
+    *present = (status == 0);
+    ESP_LOGD(TAG, "Target %s (status 0x%02X)", *present ? "present" : "gone", status);
+    return ESP_OK;
+}
+
+esp_err_t i2c_pn532_release(void)
+{
+    if (!pn532_bus) return ESP_ERR_INVALID_STATE;
+    if (autopoll_active) return ESP_ERR_INVALID_STATE;
+
+    uint8_t status = 0;
+    esp_err_t err = pn532_target_command("InRelease", PN532_CMD_IN_RELEASE, PN532_TARGET_ALL, &status);
+    if (err != ESP_OK) return err;
+    return status == 0 ? ESP_OK : ESP_FAIL;
+}
+
+/* Envía InAutoPoll sin límite de sondeos: la respuesta llega recién cuando aparece un tag */
+static esp_err_t autopoll_arm(void)
+{
+    const uint8_t data[] = { PN532_CMD_IN_AUTO_POLL, PN532_AUTOPOLL_ENDLESS,
+                             autopoll_period, PN532_AUTOPOLL_TYPE_106A };
+    uint8_t frame[sizeof(data) + 8];
+    size_t n = pn532_build_frame(data, sizeof(data), frame);
+
+    return pn532_send_command("InAutoPoll", frame, n, PN532_TIMEOUT_MS);
+}
+
+esp_err_t i2c_pn532_autopoll_start(uint8_t period)
+{
+    if (!pn532_bus) return ESP_ERR_INVALID_STATE;
+    if (pn532_irq == GPIO_NUM_NC) return ESP_ERR_NOT_SUPPORTED; // sin IRQ habría que sondear el bus
+    if (period < 1 || period > 15) return ESP_ERR_INVALID_ARG;
+
+    autopoll_period = period;
+    esp_err_t err = autopoll_arm();
+    if (err != ESP_OK) return err;
+
+    autopoll_active = true;
+    ESP_LOGI(TAG, "InAutoPoll started (period %u ms)", (unsigned)period * 150);
+    return ESP_OK;
+}
+
+esp_err_t i2c_pn532_autopoll_stop(void)
+{
+    if (!autopoll_active) return ESP_OK;
+
+    autopoll_active = false;
+    // Un ACK del host aborta InAutoPoll
+    return pn532_xfer(I2C_MGMT_OP_WRITE, &ACKNOWLEDGE[1], sizeof(ACKNOWLEDGE) - 1, NULL, 0, PN532_TIMEOUT_MS);
+}
+
+bool i2c_pn532_autopoll_pending(void)
+{
+    return autopoll_active && gpio_get_level(pn532_irq) == 0;
+}
+
+esp_err_t i2c_pn532_autopoll_fetch(uint8_t *uid, size_t *uid_len)
+{
+    if (!uid || !uid_len) return ESP_ERR_INVALID_ARG;
+    if (!autopoll_active) return ESP_ERR_INVALID_STATE;
+
+    // Mientras la IRQ esté en alto no hay nada que leer: ningún acceso al bus
+    if (!i2c_pn532_autopoll_pending())
+    {
+        *uid_len = 0;
+        return ESP_OK;
+    }
+
+    // NbTg y por target: Type TgLength TargetData (106A como en InListPassiveTarget)
+    uint8_t resp[PN532_FRAME_OVERHEAD + 1 + 2 + PN532_TARGET_106A_MAX] = {0};
+    esp_err_t err = pn532_read_ready(resp, sizeof(resp), PN532_TIMEOUT_MS, PN532_ACK_TIMEOUT_MS);
+
+    // Se rearma el sondeo automático pase lo que pase con la lectura
+    esp_err_t err_arm = autopoll_arm();
+    if (err_arm != ESP_OK)
+        ESP_LOGE(TAG, "Failed to re-arm InAutoPoll: %s", esp_err_to_name(err_arm));
+
+    const uint8_t *data = NULL;
+    size_t data_len = 0;
+    if (err == ESP_OK)
+        err = pn532_parse_frame(resp, sizeof(resp), PN532_CMD_IN_AUTO_POLL, &data, &data_len);
+    if (err != ESP_OK)
+    {
+        *uid_len = 0;
+        return err;
+    }
+
+    i2c_pn532_target_t target;
+    if (data_len < 3 || data[0] == 0 || data[1] != PN532_AUTOPOLL_TYPE_106A || 3u + data[2] > data_len ||
+        pn532_parse_target(I2C_PN532_TYPE_106A, &data[3], data[2], &target) == 0)
+    {
+        ESP_LOGW(TAG, "InAutoPoll: unexpected response (NbTg=%u)", data_len ? data[0] : 0);
+        *uid_len = 0;
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    size_t nfcid_len = target.id_len;
+    if (nfcid_len > *uid_len) nfcid_len = *uid_len; // No exceder el buffer del usuario
+    memcpy(uid, target.id, nfcid_len);
+    *uid_len = nfcid_len;
+    return err_arm;
+}
@@ -0,0 +1,317 @@
+#ifndef I2C_SIM_H
+#define I2C_SIM_H
+
+/**
+ * @file i2c_sim.h
+ * @brief Host-side I2C bus simulator with register-level device models.
+ * @details
+ * For the linux target, the I2C management driver is built against this component
+ * instead of the ESP-IDF I2C master driver. Transfers are delivered to behavioural
+ * models of the devices on the board (MCP23017, ADS1115, PN532), so the drivers and
+ * the security/energy pipelines can run, be benchmarked and be regression-tested on a
+ * workstation.
+ *
+ * Each transfer blocks the caller for its wire time at the device SCL speed plus a
+ * configurable extra latency. Faults (NACK, timeout, SDA held low) can be injected per
+ * address, either for the next N transfers or periodically.
+ *
+ * Typical use: create the models, then call i2c_mgmt_start() and the driver start
+ * functions as on the board.
+ *
+ * Throughput of a device can be measured with i2c_mgmt_calibrate() (or with
+ * CONFIG_I2C_MGMT_CALIBRATE_ON_START) together with i2c_sim_get_stats(). Building once
+ * without and once with CONFIG_I2C_MGMT_DISABLE_HANDLE_CACHE compares the cached device handles
+ * with adding and removing the device on every transfer; dev_adds tells both apart.
+ *
+ * The Unity app in test/host runs these scenarios against the models.
+ *
+ * @author  Roberto Axt
+ * @date    2025-08-09
+ * @version 0.0
+ *
+ * @par License
+ * This project is licensed under the MIT License.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/**
+ * @brief Maximum number of device models attached to the simulated bus.
+ */
+#define I2C_SIM_MAX_DEVICES 8
+
+/**
+ * @brief Callbacks of a device model.
+ * @details Each callback receives one bus phase (from START/repeated START to the next
+ *          START/STOP). Returning an error makes the device NACK its address.
+ */
+typedef struct {
+    esp_err_t (*write)(void *ctx, const uint8_t *data, size_t len);
+    esp_err_t (*read)(void *ctx, uint8_t *data, size_t len);
+    void *ctx;
+} i2c_sim_device_ops_t;
+
+/**
+ * @brief Faults that can be injected on a device address.
+ */
+typedef enum {
+    I2C_SIM_FAULT_NONE = 0,  /**< No fault */
+    I2C_SIM_FAULT_NACK,      /**< The device does not acknowledge its address */
+    I2C_SIM_FAULT_TIMEOUT,   /**< The transfer stalls for its whole timeout (clock stretching) */
+    I2C_SIM_FAULT_SDA_STUCK, /**< The device holds SDA low until the bus is cleared */
+} i2c_sim_fault_t;
+
+/**
+ * @brief Bus counters of the simulator.
+ */
+typedef struct {
+    uint32_t transfers;   /**< Transfers addressed to the bus */
+    uint32_t faults;      /**< Transfers that failed (injected faults, absent devices, stuck bus) */
+    uint32_t bytes_tx;    /**< Data bytes written */
+    uint32_t bytes_rx;    /**< Data bytes read */
+    uint64_t busy_us;     /**< Accumulated simulated bus time */
+    uint32_t bus_clears;  /**< Times a stuck SDA was released by clocking SCL */
+    uint32_t dev_adds;    /**< Device handles added to the bus */
+    uint32_t dev_removes; /**< Device handles removed from the bus */
+} i2c_sim_stats_t;
+
+/**
+ * @brief Attaches a device model at an address.
+ * @param addr 7-bit address.
+ * @param ops Model callbacks (copied).
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if the address is in use,
+ *         or ESP_ERR_NO_MEM if the bus is full.
+ */
+esp_err_t i2c_sim_attach(uint8_t addr, const i2c_sim_device_ops_t *ops);
+
+/**
+ * @brief Detaches the model at an address; the address then NACKs.
+ * @param addr 7-bit address.
+ * @return ESP_OK on success, or ESP_ERR_NOT_FOUND.
+ */
+esp_err_t i2c_sim_detach(uint8_t addr);
+
+/**
+ * @brief Sets a latency added to every transfer on top of its wire time.
+ * @param extra_us Extra microseconds per transfer (driver and interrupt overhead on the target).
+ */
+void i2c_sim_set_latency(uint32_t extra_us);
+
+/**
+ * @brief Sets the time the caller is blocked when a device handle is added to or removed from the bus.
+ * @details Models the allocation and bus locking done by i2c_master_bus_add_device() and
+ *          i2c_master_bus_rm_device() on the target; 0 (default) leaves only the host cost.
+ * @param add_rm_us Microseconds per add or remove.
+ */
+void i2c_sim_set_device_latency(uint32_t add_rm_us);
+
+/**
+ * @brief Makes the next transfers to an address fail.
+ * @param addr 7-bit address.
+ * @param fault Fault to inject.
+ * @param count Number of consecutive transfers affected.
+ * @return ESP_OK on success, or ESP_ERR_NOT_FOUND if nothing is attached at addr.
+ */
+esp_err_t i2c_sim_inject_fault(uint8_t addr, i2c_sim_fault_t fault, uint32_t count);
+
+/**
+ * @brief Makes every period-th transfer to an address fail.
+ * @param addr 7-bit address.
+ * @param fault Fault to inject.
+ * @param period Fault period in transfers; 0 disables the periodic fault.
+ * @return ESP_OK on success, or ESP_ERR_NOT_FOUND if nothing is attached at addr.
+ */
+esp_err_t i2c_sim_set_fault_period(uint8_t addr, i2c_sim_fault_t fault, uint32_t period);
+
+/**
+ * @brief Sets the number of SCL pulses a stuck device needs before it releases SDA.
+ * @param pulses 1 to 9 (default 3). A value above 9 models a device that never releases.
+ */
+void i2c_sim_set_stuck_pulses(uint32_t pulses);
+
+/**
+ * @brief Gets a snapshot of the bus counters.
+ * @param out Where the counters are copied.
+ */
+void i2c_sim_get_stats(i2c_sim_stats_t *out);
+
+/**
+ * @brief Clears the bus counters.
+ */
+void i2c_sim_reset_stats(void);
+
+/* ---------------------------------------------------------------- MCP23017 */
+
+typedef struct i2c_sim_mcp23017_s i2c_sim_mcp23017_t;
+
+/**
+ * @brief Creates an MCP23017 model (BANK=0 register map, power-on reset values) and attaches it.
+ * @details IOCON.SEQOP is honoured: sequential mode auto-increments the register pointer,
+ *          byte mode toggles it within the A/B register pair.
+ * @param addr 7-bit address (0x20..0x27).
+ * @return The model, or NULL on failure.
+ */
+i2c_sim_mcp23017_t *i2c_sim_mcp23017_create(uint8_t addr);
+
+/**
+ * @brief Drives the external level of the port pins.
+ * @details Only pins configured as inputs are affected. Interrupt-on-change is evaluated
+ *          against GPINTEN/INTCON/DEFVAL and latched in INTF/INTCAP.
+ * @param mcp Model.
+ * @param port_a Pin levels of port A.
+ * @param port_b Pin levels of port B.
+ */
+void i2c_sim_mcp23017_set_inputs(i2c_sim_mcp23017_t *mcp, uint8_t port_a, uint8_t port_b);
+
+/**
+ * @brief Gets the output latches.
+ * @param mcp Model.
+ * @param olat_a Where OLATA is stored.
+ * @param olat_b Where OLATB is stored.
+ */
+void i2c_sim_mcp23017_get_outputs(i2c_sim_mcp23017_t *mcp, uint8_t *olat_a, uint8_t *olat_b);
+
+/**
+ * @brief Reads a register without bus side effects.
+ * @param mcp Model.
+ * @param reg Register address (BANK=0).
+ * @return Register value.
+ */
+uint8_t i2c_sim_mcp23017_peek(i2c_sim_mcp23017_t *mcp, uint8_t reg);
+
+/**
+ * @brief Tells whether the INTA/INTB output is asserted.
+ * @param mcp Model.
+ * @param port 0 for INTA, 1 for INTB (IOCON.MIRROR is honoured).
+ * @return true if asserted.
+ */
+bool i2c_sim_mcp23017_int_active(i2c_sim_mcp23017_t *mcp, int port);
+
+/* ----------------------------------------------------------------- ADS1115 */
+
+typedef struct i2c_sim_ads1115_s i2c_sim_ads1115_t;
+
+/**
+ * @brief Creates an ADS1115 model and attaches it.
+ * @details Single-shot conversions take 1/DR seconds from the write that sets OS; the OS
+ *          bit reads 0 until the conversion is done. Continuous mode is also modelled.
+ * @param addr 7-bit address (0x48..0x4B).
+ * @return The model, or NULL on failure.
+ */
+i2c_sim_ads1115_t *i2c_sim_ads1115_create(uint8_t addr);
+
+/**
+ * @brief Sets the voltage of an analog input referred to GND.
+ * @param ads Model.
+ * @param channel AIN0..AIN3.
+ * @param microvolts Input voltage in microvolts.
+ */
+void i2c_sim_ads1115_set_input(i2c_sim_ads1115_t *ads, int channel, int32_t microvolts);
+
+/**
+ * @brief Gets the number of conversions completed by the model.
+ * @param ads Model.
+ * @return Completed conversions.
+ */
+uint32_t i2c_sim_ads1115_conversions(i2c_sim_ads1115_t *ads);
+
+/* ------------------------------------------------------------------ PN532 */
+
+typedef struct i2c_sim_pn532_s i2c_sim_pn532_t;
+
+#define I2C_SIM_PN532_MAX_TAGS 4   /**< Tags the model can hold in the field at once */
+#define I2C_SIM_PN532_UID_MAX  10  /**< Longest identifier of a tag */
+
+/**
+ * @brief A tag in the field of the PN532 model.
+ */
+typedef struct {
+    uint8_t type;                        /**< BrTy it answers to: 0 type A, 1/2 FeliCa, 3 type B */
+    uint8_t uid[I2C_SIM_PN532_UID_MAX];  /**< NFCID1 (type A), IDm (FeliCa) or PUPI (type B) */
+    uint8_t uid_len;                     /**< 4, 7 or 10 for type A, 8 for FeliCa, 4 for type B */
+} i2c_sim_pn532_tag_t;
+
+/**
+ * @brief One step of a scripted tag sequence.
+ */
+typedef struct {
+    uint32_t at_ms;     /**< Time from i2c_sim_pn532_run_script() when the step applies */
+    uint8_t uid[10];    /**< UID of the tag in the field */
+    uint8_t uid_len;    /**< 4, 7 or 10; 0 removes the tag from the field */
+} i2c_sim_pn532_step_t;
+
+/**
+ * @brief Creates a PN532 model (I2C host interface) and attaches it.
+ * @details Command frames are checked (preamble, LCS, DCS) and answered with an ACK
+ *          frame followed by the response frame, each one ready after its delay; reads
+ *          before that return a status byte of 0x00. A 1-byte read returns only the status
+ *          and leaves the frame in place; a longer read returns the frame and consumes it. Supported commands are
+ *          GetFirmwareVersion, SAMConfiguration, RFConfiguration, InListPassiveTarget (MaxTg up
+ *          to 2; type A, FeliCa and type B targets), InDeselect, InSelect, InRelease and
+ *          InAutoPoll (106 kbps type A); an ACK frame from the host aborts the command in
+ *          progress. InSelect succeeds only while the tag listed by InListPassiveTarget is still
+ *          in the field. InListPassiveTarget stays pending until a tag is in the field,
+ *          as with unlimited retries, unless RFConfiguration MaxRetries set a finite
+ *          MxRtyPassiveActivation: then it answers NbTg=0 when no tag is present.
+ * @param addr 7-bit address (0x24).
+ * @return The model, or NULL on failure.
+ */
+i2c_sim_pn532_t *i2c_sim_pn532_create(uint8_t addr);
+
+/**
+ * @brief Sets the processing time of the model.
+ * @param pn Model.
+ * @param ack_delay_us Time from the command frame until the ACK is ready.
+ * @param response_delay_us Time from the ACK until the response is ready.
+ */
+void i2c_sim_pn532_set_timing(i2c_sim_pn532_t *pn, uint32_t ack_delay_us, uint32_t response_delay_us);
+
+/**
+ * @brief Makes the model NACK its address while it has no frame ready.
+ * @details Some PN532 modules do not acknowledge reads while they process a command,
+ *          instead of answering with a status byte of 0x00. Disabled by default.
+ * @param pn Model.
+ * @param enable true to NACK while busy.
+ */
+void i2c_sim_pn532_set_nack_busy(i2c_sim_pn532_t *pn, bool enable);
+
+/**
+ * @brief Places a tag in the field, or removes it when uid_len is 0.
+ * @param pn Model.
+ * @param uid UID bytes.
+ * @param uid_len 4, 7 or 10; 0 removes the tag.
+ * @return ESP_OK on success, or ESP_ERR_INVALID_ARG.
+ */
+esp_err_t i2c_sim_pn532_set_tag(i2c_sim_pn532_t *pn, const uint8_t *uid, size_t uid_len);
+
+/**
+ * @brief Places several tags in the field, replacing the previous ones.
+ * @details InListPassiveTarget answers with the tags of the requested type, in order, up to
+ *          its MaxTg; InAutoPoll reports the first type A tag.
+ * @param pn Model.
+ * @param tags Tags in the field.
+ * @param count Number of tags (0 empties the field, up to I2C_SIM_PN532_MAX_TAGS).
+ * @return ESP_OK on success, or ESP_ERR_INVALID_ARG for a bad identifier length.
+ */
+esp_err_t i2c_sim_pn532_set_tags(i2c_sim_pn532_t *pn, const i2c_sim_pn532_tag_t *tags, size_t count);
+
+/**
+ * @brief Starts a scripted tag sequence; steps are applied as time passes.
+ * @param pn Model.
+ * @param steps Steps sorted by at_ms. The array must remain valid while the script runs.
+ * @param count Number of steps.
+ */
+void i2c_sim_pn532_run_script(i2c_sim_pn532_t *pn, const i2c_sim_pn532_step_t *steps, size_t count);
+
+/**
+ * @brief Tells whether the PN532 has a frame ready (the IRQ line is low).
+ * @param pn Model.
+ * @return true if an ACK or response frame is ready to be read.
+ */
+bool i2c_sim_pn532_ready(i2c_sim_pn532_t *pn);
+
+#endif // I2C_SIM_H
@@ -0,0 +1,567 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+
+#include "driver/gpio.h"
+#include "driver/i2c_master.h"
+#include "i2c_sim.h"
+#include "i2c_sim_priv.h"
+
+#define I2C_SIM_DEFAULT_STUCK_PULSES 3   // Pulsos de SCL que necesita un esclavo trabado
+#define I2C_SIM_BITS_PER_BYTE 9          // 8 bits de datos + ACK/NACK
+#define I2C_SIM_BITS_START_STOP 2        // START + STOP aproximados a un bit cada uno
+
+static const char *TAG = "i2c_sim";
+
+typedef struct {
+    uint8_t addr;
+    bool used;
+    i2c_sim_device_ops_t ops;
+    i2c_sim_fault_t fault;           // falla de los próximos fault_count accesos
+    uint32_t fault_count;
+    i2c_sim_fault_t periodic_fault;  // falla cada fault_period accesos
+    uint32_t fault_period;
+    uint32_t accesses;
+} i2c_sim_slot_t;
+
+struct i2c_master_bus_t {
+    i2c_master_bus_config_t cfg;
+    size_t devices;
+};
+
+struct i2c_master_dev_t {
+    struct i2c_master_bus_t *bus;
+    uint8_t addr;
+    uint32_t speed_hz;
+};
+
+static i2c_sim_slot_t slots[I2C_SIM_MAX_DEVICES] = { 0 };
+static struct i2c_master_bus_t *active_bus = NULL;
+static gpio_num_t bus_sda = GPIO_NUM_NC;   // se conservan al eliminar el bus (bus clear por GPIO)
+static gpio_num_t bus_scl = GPIO_NUM_NC;
+static uint32_t extra_latency_us = 0;
+static uint32_t device_latency_us = 0;
+static uint32_t stuck_pulses_cfg = I2C_SIM_DEFAULT_STUCK_PULSES;
+static uint32_t sda_held_pulses = 0;   // > 0: un esclavo mantiene SDA en bajo
+static uint8_t gpio_levels[I2C_SIM_GPIO_COUNT];
+static bool gpio_levels_init = false;
+static gpio_int_type_t gpio_intr[I2C_SIM_GPIO_COUNT];
+static gpio_isr_t gpio_handlers[I2C_SIM_GPIO_COUNT];
+static void *gpio_handler_args[I2C_SIM_GPIO_COUNT];
+static bool gpio_isr_installed = false;
+static i2c_sim_stats_t stats = { 0 };
+
+SemaphoreHandle_t i2c_sim_lock(void)
+{
+    // Se crea en el primer uso (durante la puesta en marcha, antes de que haya concurrencia)
+    static StaticSemaphore_t lock_buf;
+    static SemaphoreHandle_t lock = NULL;
+    if (!lock)
+        lock = xSemaphoreCreateRecursiveMutexStatic(&lock_buf);
+    return lock;
+}
+
+static i2c_sim_slot_t *find_slot(uint8_t addr)
+{
+    for (size_t i = 0; i < I2C_SIM_MAX_DEVICES; ++i)
+    {
+        if (slots[i].used && slots[i].addr == addr)
+            return &slots[i];
+    }
+    return NULL;
+}
+
+esp_err_t i2c_sim_attach(uint8_t addr, const i2c_sim_device_ops_t *ops)
+{
+    if (!ops || (!ops->write && !ops->read))
+        return ESP_ERR_INVALID_ARG;
+
+    esp_err_t err = ESP_ERR_NO_MEM;
+    I2C_SIM_LOCK();
+    if (find_slot(addr))
+    {
+        err = ESP_ERR_INVALID_STATE;
+    }
+    else
+    {
+        for (size_t i = 0; i < I2C_SIM_MAX_DEVICES; ++i)
+        {
+            if (!slots[i].used)
+            {
+                memset(&slots[i], 0, sizeof(slots[i]));
+                slots[i].used = true;
+                slots[i].addr = addr;
+                slots[i].ops = *ops;
+                err = ESP_OK;
+                break;
+            }
+        }
+    }
+    I2C_SIM_UNLOCK();
+
+    if (err == ESP_OK)
+        ESP_LOGI(TAG, "Model attached at 0x%02X", addr);
+    return err;
+}
+
+esp_err_t i2c_sim_detach(uint8_t addr)
+{
+    I2C_SIM_LOCK();
+    i2c_sim_slot_t *slot = find_slot(addr);
+    if (slot)
+        slot->used = false;
+    I2C_SIM_UNLOCK();
+    return slot ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+void i2c_sim_set_latency(uint32_t extra_us)
+{
+    I2C_SIM_LOCK();
+    extra_latency_us = extra_us;
+    I2C_SIM_UNLOCK();
+}
+
+void i2c_sim_set_device_latency(uint32_t add_rm_us)
+{
+    I2C_SIM_LOCK();
+    device_latency_us = add_rm_us;
+    I2C_SIM_UNLOCK();
+}
+
+esp_err_t i2c_sim_inject_fault(uint8_t addr, i2c_sim_fault_t fault, uint32_t count)
+{
+    I2C_SIM_LOCK();
+    i2c_sim_slot_t *slot = find_slot(addr);
+    if (slot)
+    {
+        slot->fault = fault;
+        slot->fault_count = (fault == I2C_SIM_FAULT_NONE) ? 0 : count;
+    }
+    I2C_SIM_UNLOCK();
+    return slot ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t i2c_sim_set_fault_period(uint8_t addr, i2c_sim_fault_t fault, uint32_t period)
+{
+    I2C_SIM_LOCK();
+    i2c_sim_slot_t *slot = find_slot(addr);
+    if (slot)
+    {
+        slot->periodic_fault = fault;
+        slot->fault_period = (fault == I2C_SIM_FAULT_NONE) ? 0 : period;
+        slot->accesses = 0;
+    }
+    I2C_SIM_UNLOCK();
+    return slot ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+void i2c_sim_set_stuck_pulses(uint32_t pulses)
+{
+    I2C_SIM_LOCK();
+    stuck_pulses_cfg = pulses ? pulses : 1;
+    I2C_SIM_UNLOCK();
+}
+
+void i2c_sim_get_stats(i2c_sim_stats_t *out)
+{
+    if (!out)
+        return;
+    I2C_SIM_LOCK();
+    *out = stats;
+    I2C_SIM_UNLOCK();
+}
+
+void i2c_sim_reset_stats(void)
+{
+    I2C_SIM_LOCK();
+    memset(&stats, 0, sizeof(stats));
+    I2C_SIM_UNLOCK();
+}
+
+/* ------------------------------------------------------------------ GPIO */
+
+static void gpio_init_levels(void)
+{
+    if (gpio_levels_init)
+        return;
+    memset(gpio_levels, 1, sizeof(gpio_levels)); // líneas con pull-up en reposo
+    gpio_levels_init = true;
+}
+
+static bool is_bus_pin(gpio_num_t pin, bool sda)
+{
+    return pin == (sda ? bus_sda : bus_scl);
+}
+
+esp_err_t gpio_config(const gpio_config_t *cfg)
+{
+    if (!cfg || (cfg->pin_bit_mask >> I2C_SIM_GPIO_COUNT) != 0)
+        return ESP_ERR_INVALID_ARG;
+
+    I2C_SIM_LOCK();
+    for (int pin = 0; pin < I2C_SIM_GPIO_COUNT; ++pin)
+        if (cfg->pin_bit_mask & (1ULL << pin))
+            gpio_intr[pin] = cfg->intr_type;
+    I2C_SIM_UNLOCK();
+    return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags)
+{
+    (void)intr_alloc_flags;
+
+    I2C_SIM_LOCK();
+    bool installed = gpio_isr_installed;
+    gpio_isr_installed = true;
+    I2C_SIM_UNLOCK();
+    return installed ? ESP_ERR_INVALID_STATE : ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler, void *args)
+{
+    if (!GPIO_IS_VALID_GPIO(gpio_num))
+        return ESP_ERR_INVALID_ARG;
+
+    I2C_SIM_LOCK();
+    if (!gpio_isr_installed)
+    {
+        I2C_SIM_UNLOCK();
+        return ESP_ERR_INVALID_STATE;
+    }
+    gpio_handlers[gpio_num] = isr_handler;
+    gpio_handler_args[gpio_num] = args;
+    I2C_SIM_UNLOCK();
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio_num)
+{
+    if (!GPIO_IS_VALID_GPIO(gpio_num))
+        return ESP_ERR_INVALID_ARG;
+
+    I2C_SIM_LOCK();
+    gpio_handlers[gpio_num] = NULL;
+    gpio_handler_args[gpio_num] = NULL;
+    I2C_SIM_UNLOCK();
+    return ESP_OK;
+}
+
+/**
+ * @brief Indica si un cambio de nivel dispara la interrupción configurada en el pin.
+ */
+static bool edge_fires(gpio_int_type_t type, uint8_t previous, uint8_t level)
+{
+    switch (type)
+    {
+        case GPIO_INTR_POSEDGE:    return !previous && level;
+        case GPIO_INTR_NEGEDGE:    return previous && !level;
+        case GPIO_INTR_ANYEDGE:    return previous != level;
+        case GPIO_INTR_LOW_LEVEL:  return !level;
+        case GPIO_INTR_HIGH_LEVEL: return level;
+        default:                   return false;
+    }
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio_num)
+{
+    return gpio_set_level(gpio_num, 1);
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    if (!GPIO_IS_VALID_GPIO(gpio_num))
+        return ESP_ERR_INVALID_ARG;
+
+    I2C_SIM_LOCK();
+    gpio_init_levels();
+
+    // Flanco ascendente de SCL durante un bus clear: el esclavo avanza un bit
+    if (is_bus_pin(gpio_num, false) && level && !gpio_levels[gpio_num] && sda_held_pulses)
+    {
+        if (--sda_held_pulses == 0)
+        {
+            stats.bus_clears++;
+            ESP_LOGI(TAG, "SDA released by bus clear");
+        }
+    }
+    uint8_t previous = gpio_levels[gpio_num];
+    gpio_levels[gpio_num] = level ? 1 : 0;
+
+    gpio_isr_t isr = NULL;
+    void *isr_arg = NULL;
+    if (gpio_handlers[gpio_num] && edge_fires(gpio_intr[gpio_num], previous, gpio_levels[gpio_num]))
+    {
+        isr = gpio_handlers[gpio_num];
+        isr_arg = gpio_handler_args[gpio_num];
+    }
+    I2C_SIM_UNLOCK();
+
+    // El handler corre fuera del lock, como una ISR que no ve el estado interno del simulador
+    if (isr)
+        isr(isr_arg);
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    if (!GPIO_IS_VALID_GPIO(gpio_num))
+        return 0;
+
+    I2C_SIM_LOCK();
+    gpio_init_levels();
+    int level = gpio_levels[gpio_num];
+    if (is_bus_pin(gpio_num, true) && sda_held_pulses)
+        level = 0; // open-drain: el esclavo trabado gana
+    I2C_SIM_UNLOCK();
+    return level;
+}
+
+/* ------------------------------------------------------------ I2C master */
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t *bus_config, i2c_master_bus_handle_t *ret_bus_handle)
+{
+    if (!bus_config || !ret_bus_handle)
+        return ESP_ERR_INVALID_ARG;
+
+    I2C_SIM_LOCK();
+    if (active_bus)
+    {
+        I2C_SIM_UNLOCK();
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    struct i2c_master_bus_t *b = calloc(1, sizeof(*b));
+    if (!b)
+    {
+        I2C_SIM_UNLOCK();
+        return ESP_ERR_NO_MEM;
+    }
+    b->cfg = *bus_config;
+    active_bus = b;
+    bus_sda = bus_config->sda_io_num;
+    bus_scl = bus_config->scl_io_num;
+    gpio_init_levels();
+    I2C_SIM_UNLOCK();
+
+    *ret_bus_handle = b;
+    ESP_LOGI(TAG, "Simulated I2C bus created (SDA=%d, SCL=%d)", (int)bus_config->sda_io_num, (int)bus_config->scl_io_num);
+    return ESP_OK;
+}
+
+esp_err_t i2c_del_master_bus(i2c_master_bus_handle_t bus_handle)
+{
+    if (!bus_handle)
+        return ESP_ERR_INVALID_ARG;
+
+    I2C_SIM_LOCK();
+    if (bus_handle->devices)
+    {
+        I2C_SIM_UNLOCK();
+        return ESP_ERR_INVALID_STATE; // igual que el driver real: primero quitar los dispositivos
+    }
+    if (active_bus == bus_handle)
+        active_bus = NULL;
+    I2C_SIM_UNLOCK();
+
+    free(bus_handle);
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_reset(i2c_master_bus_handle_t bus_handle)
+{
+    if (!bus_handle)
+        return ESP_ERR_INVALID_ARG;
+
+    // El driver real genera 9 pulsos de SCL antes de reiniciar el controlador
+    I2C_SIM_LOCK();
+    bool released = sda_held_pulses <= 9;
+    if (sda_held_pulses && released)
+        stats.bus_clears++;
+    sda_held_pulses = released ? 0 : sda_held_pulses - 9;
+    I2C_SIM_UNLOCK();
+    return released ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus_handle, const i2c_device_config_t *dev_config,
+                                    i2c_master_dev_handle_t *ret_handle)
+{
+    if (!bus_handle || !dev_config || !ret_handle || dev_config->scl_speed_hz == 0)
+        return ESP_ERR_INVALID_ARG;
+
+    struct i2c_master_dev_t *dev = calloc(1, sizeof(*dev));
+    if (!dev)
+        return ESP_ERR_NO_MEM;
+
+    dev->bus = bus_handle;
+    dev->addr = (uint8_t)dev_config->device_address;
+    dev->speed_hz = dev_config->scl_speed_hz;
+
+    I2C_SIM_LOCK();
+    bus_handle->devices++;
+    stats.dev_adds++;
+    uint32_t cost_us = device_latency_us;
+    I2C_SIM_UNLOCK();
+
+    if (cost_us)
+        esp_rom_delay_us(cost_us);
+
+    *ret_handle = dev;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_rm_device(i2c_master_dev_handle_t handle)
+{
+    if (!handle)
+        return ESP_ERR_INVALID_ARG;
+
+    I2C_SIM_LOCK();
+    if (handle->bus->devices)
+        handle->bus->devices--;
+    stats.dev_removes++;
+    uint32_t cost_us = device_latency_us;
+    I2C_SIM_UNLOCK();
+
+    if (cost_us)
+        esp_rom_delay_us(cost_us);
+
+    free(handle);
+    return ESP_OK;
+}
+
+/**
+ * @brief Decide si el acceso actual a un dispositivo debe fallar, y con qué falla.
+ */
+static i2c_sim_fault_t next_fault(i2c_sim_slot_t *slot)
+{
+    slot->accesses++;
+
+    if (slot->fault_count)
+    {
+        slot->fault_count--;
+        return slot->fault;
+    }
+    if (slot->fault_period && (slot->accesses % slot->fault_period) == 0)
+        return slot->periodic_fault;
+    return I2C_SIM_FAULT_NONE;
+}
+
+/**
+ * @brief Ejecuta una transferencia: fase de escritura y/o de lectura, con repeated START entre ambas.
+ */
+static esp_err_t sim_xfer(struct i2c_master_dev_t *dev, const uint8_t *tx, size_t tx_len,
+                          uint8_t *rx, size_t rx_len, int timeout_ms)
+{
+    if (!dev || (tx_len && !tx) || (rx_len && !rx) || (tx_len == 0 && rx_len == 0))
+        return ESP_ERR_INVALID_ARG;
+
+    esp_err_t err = ESP_OK;
+    bool stall = false;
+
+    I2C_SIM_LOCK();
+    stats.transfers++;
+
+    i2c_sim_slot_t *slot = find_slot(dev->addr);
+    if (sda_held_pulses)
+    {
+        stall = true; // el controlador no logra generar el START
+    }
+    else if (!slot)
+    {
+        err = ESP_ERR_INVALID_STATE; // NACK de dirección
+    }
+    else
+    {
+        switch (next_fault(slot))
+        {
+            case I2C_SIM_FAULT_NACK:
+                err = ESP_ERR_INVALID_STATE;
+                break;
+            case I2C_SIM_FAULT_TIMEOUT:
+                stall = true;
+                break;
+            case I2C_SIM_FAULT_SDA_STUCK:
+                sda_held_pulses = stuck_pulses_cfg;
+                stall = true;
+                break;
+            default:
+                if (tx_len)
+                    err = slot->ops.write ? slot->ops.write(slot->ops.ctx, tx, tx_len) : ESP_ERR_INVALID_STATE;
+                if (err == ESP_OK && rx_len)
+                    err = slot->ops.read ? slot->ops.read(slot->ops.ctx, rx, rx_len) : ESP_ERR_INVALID_STATE;
+                break;
+        }
+    }
+
+    if (stall || err != ESP_OK)
+    {
+        stats.faults++;
+    }
+    else
+    {
+        stats.bytes_tx += tx_len;
+        stats.bytes_rx += rx_len;
+    }
+
+    // Tiempo en el cable: dirección + datos a 9 bits por byte, START/STOP y repeated START
+    uint32_t bits = I2C_SIM_BITS_PER_BYTE * (uint32_t)(tx_len + rx_len + ((tx_len && rx_len) ? 2 : 1))
+                  + I2C_SIM_BITS_START_STOP + ((tx_len && rx_len) ? 1 : 0);
+    uint32_t wire_us = (uint32_t)(((uint64_t)bits * 1000000u) / dev->speed_hz) + extra_latency_us;
+    if (!stall)
+        stats.busy_us += wire_us;
+    I2C_SIM_UNLOCK();
+
+    if (stall)
+    {
+        vTaskDelay(pdMS_TO_TICKS(timeout_ms > 0 ? timeout_ms : 1));
+        I2C_SIM_LOCK();
+        stats.busy_us += (uint64_t)(timeout_ms > 0 ? timeout_ms : 1) * 1000u;
+        I2C_SIM_UNLOCK();
+        return ESP_ERR_TIMEOUT;
+    }
+
+    esp_rom_delay_us(wire_us);
+    return err;
+}
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t i2c_dev, const uint8_t *write_buffer, size_t write_size,
+                              int xfer_timeout_ms)
+{
+    return sim_xfer(i2c_dev, write_buffer, write_size, NULL, 0, xfer_timeout_ms);
+}
+
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t i2c_dev, uint8_t *read_buffer, size_t read_size,
+                             int xfer_timeout_ms)
+{
+    return sim_xfer(i2c_dev, NULL, 0, read_buffer, read_size, xfer_timeout_ms);
+}
+
+esp_err_t i2c_master_transmit_receive(i2c_master_dev_handle_t i2c_dev, const uint8_t *write_buffer, size_t write_size,
+                                      uint8_t *read_buffer, size_t read_size, int xfer_timeout_ms)
+{
+    if (write_size == 0 || read_size == 0)
+        return ESP_ERR_INVALID_ARG;
+    return sim_xfer(i2c_dev, write_buffer, write_size, read_buffer, read_size, xfer_timeout_ms);
+}
+
+esp_err_t i2c_master_probe(i2c_master_bus_handle_t bus_handle, uint16_t address, int xfer_timeout_ms)
+{
+    if (!bus_handle)
+        return ESP_ERR_INVALID_ARG;
+
+    I2C_SIM_LOCK();
+    bool stuck = sda_held_pulses != 0;
+    bool present = find_slot((uint8_t)address) != NULL;
+    I2C_SIM_UNLOCK();
+
+    if (stuck)
+    {
+        vTaskDelay(pdMS_TO_TICKS(xfer_timeout_ms > 0 ? xfer_timeout_ms : 1));
+        return ESP_ERR_TIMEOUT;
+    }
+    return present ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
@@ -0,0 +1,202 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "i2c_sim.h"
+#include "i2c_sim_priv.h"
+
+#define REG_CONVERSION 0x00
+#define REG_CONFIG     0x01
+#define REG_LO_THRESH  0x02
+#define REG_HI_THRESH  0x03
+
+#define CFG_OS         0x8000
+#define CFG_MODE       0x0100
+#define CFG_DEFAULT    0x8583
+
+static const char *TAG = "i2c_sim_ads1115";
+
+static const uint32_t FSR_UV[8] = { 6144000, 4096000, 2048000, 1024000, 512000, 256000, 256000, 256000 };
+static const uint32_t RATE_SPS[8] = { 8, 16, 32, 64, 128, 250, 475, 860 };
+
+struct i2c_sim_ads1115_s {
+    uint8_t addr;
+    uint8_t pointer;
+    uint16_t config;
+    uint16_t lo_thresh;
+    uint16_t hi_thresh;
+    int16_t conversion;
+    int32_t inputs_uv[4];
+    bool converting;          // conversión single-shot en curso
+    int64_t ready_at_us;      // fin de la conversión en curso (o próxima, en modo continuo)
+    uint32_t conversions;
+};
+
+static uint32_t period_us(uint16_t config)
+{
+    return 1000000u / RATE_SPS[(config >> 5) & 0x7];
+}
+
+/**
+ * @brief Resultado de convertir la entrada seleccionada por MUX con el PGA configurado.
+ */
+static int16_t convert(const i2c_sim_ads1115_t *ads)
+{
+    int32_t uv;
+    switch ((ads->config >> 12) & 0x7)
+    {
+        case 0: uv = ads->inputs_uv[0] - ads->inputs_uv[1]; break;
+        case 1: uv = ads->inputs_uv[0] - ads->inputs_uv[3]; break;
+        case 2: uv = ads->inputs_uv[1] - ads->inputs_uv[3]; break;
+        case 3: uv = ads->inputs_uv[2] - ads->inputs_uv[3]; break;
+        default: uv = ads->inputs_uv[((ads->config >> 12) & 0x7) - 4]; break;
+    }
+
+    int64_t code = ((int64_t)uv * 32768) / (int64_t)FSR_UV[(ads->config >> 9) & 0x7];
+    if (code > 32767) code = 32767;
+    if (code < -32768) code = -32768;
+    return (int16_t)code;
+}
+
+/**
+ * @brief Avanza el estado de conversión hasta el instante actual.
+ */
+static void update(i2c_sim_ads1115_t *ads)
+{
+    int64_t now = esp_timer_get_time();
+
+    if ((ads->config & CFG_MODE) == 0)
+    {
+        // Modo continuo: una conversión por período
+        if (now >= ads->ready_at_us)
+        {
+            uint32_t period = period_us(ads->config);
+            uint32_t done = (uint32_t)((now - ads->ready_at_us) / period) + 1;
+            ads->conversion = convert(ads);
+            ads->conversions += done;
+            ads->ready_at_us += (int64_t)done * period;
+        }
+    }
+    else if (ads->converting && now >= ads->ready_at_us)
+    {
+        ads->conversion = convert(ads);
+        ads->conversions++;
+        ads->converting = false;
+    }
+}
+
+static uint16_t read_register(i2c_sim_ads1115_t *ads, uint8_t reg)
+{
+    switch (reg)
+    {
+        case REG_CONVERSION:
+            return (uint16_t)ads->conversion;
+        case REG_CONFIG:
+        {
+            // OS en lectura: 1 = no hay conversión en curso
+            bool busy = ads->converting || (ads->config & CFG_MODE) == 0;
+            return (uint16_t)((ads->config & ~CFG_OS) | (busy ? 0 : CFG_OS));
+        }
+        case REG_LO_THRESH:
+            return ads->lo_thresh;
+        default:
+            return ads->hi_thresh;
+    }
+}
+
+static esp_err_t ads_write(void *ctx, const uint8_t *data, size_t len)
+{
+    i2c_sim_ads1115_t *ads = ctx;
+
+    update(ads);
+    ads->pointer = data[0] & 0x03;
+    if (len < 3)
+        return ESP_OK; // sólo se fija el puntero
+
+    uint16_t value = (uint16_t)((data[1] << 8) | data[2]);
+    switch (ads->pointer)
+    {
+        case REG_CONFIG:
+        {
+            ads->config = value & ~CFG_OS;
+            int64_t now = esp_timer_get_time();
+            if ((value & CFG_MODE) == 0)
+            {
+                ads->converting = false;
+                ads->ready_at_us = now + period_us(value);
+            }
+            else if ((value & CFG_OS) && !ads->converting)
+            {
+                ads->converting = true;
+                ads->ready_at_us = now + period_us(value);
+            }
+            break;
+        }
+        case REG_LO_THRESH:
+            ads->lo_thresh = value;
+            break;
+        case REG_HI_THRESH:
+            ads->hi_thresh = value;
+            break;
+        default:
+            break; // el registro de conversión es de sólo lectura
+    }
+    return ESP_OK;
+}
+
+static esp_err_t ads_read(void *ctx, uint8_t *data, size_t len)
+{
+    i2c_sim_ads1115_t *ads = ctx;
+
+    update(ads);
+    uint16_t value = read_register(ads, ads->pointer);
+    for (size_t i = 0; i < len; ++i)
+        data[i] = (i % 2 == 0) ? (uint8_t)(value >> 8) : (uint8_t)(value & 0xFF);
+    return ESP_OK;
+}
+
+i2c_sim_ads1115_t *i2c_sim_ads1115_create(uint8_t addr)
+{
+    i2c_sim_ads1115_t *ads = calloc(1, sizeof(*ads));
+    if (!ads)
+        return NULL;
+
+    ads->addr = addr;
+    ads->config = CFG_DEFAULT & ~CFG_OS;
+    ads->lo_thresh = 0x8000;
+    ads->hi_thresh = 0x7FFF;
+
+    i2c_sim_device_ops_t ops = { .write = ads_write, .read = ads_read, .ctx = ads };
+    if (i2c_sim_attach(addr, &ops) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Cannot attach ADS1115 model at 0x%02X", addr);
+        free(ads);
+        return NULL;
+    }
+    return ads;
+}
+
+void i2c_sim_ads1115_set_input(i2c_sim_ads1115_t *ads, int channel, int32_t microvolts)
+{
+    if (!ads || channel < 0 || channel > 3)
+        return;
+
+    I2C_SIM_LOCK();
+    update(ads); // las conversiones ya terminadas conservan la entrada anterior
+    ads->inputs_uv[channel] = microvolts;
+    I2C_SIM_UNLOCK();
+}
+
+uint32_t i2c_sim_ads1115_conversions(i2c_sim_ads1115_t *ads)
+{
+    if (!ads)
+        return 0;
+
+    I2C_SIM_LOCK();
+    update(ads);
+    uint32_t n = ads->conversions;
+    I2C_SIM_UNLOCK();
+    return n;
+}
@@ -0,0 +1,212 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+
+#include "i2c_sim.h"
+#include "i2c_sim_priv.h"
+
+// Mapa de registros con BANK=0
+#define REG_IODIRA   0x00
+#define REG_IPOLA    0x02
+#define REG_GPINTENA 0x04
+#define REG_DEFVALA  0x06
+#define REG_INTCONA  0x08
+#define REG_IOCON    0x0A
+#define REG_IOCON_B  0x0B
+#define REG_GPPUA    0x0C
+#define REG_INTFA    0x0E
+#define REG_INTCAPA  0x10
+#define REG_GPIOA    0x12
+#define REG_OLATA    0x14
+#define REG_COUNT    0x16
+
+#define IOCON_MIRROR 0x40
+#define IOCON_SEQOP  0x20
+
+static const char *TAG = "i2c_sim_mcp23017";
+
+struct i2c_sim_mcp23017_s {
+    uint8_t addr;
+    uint8_t regs[REG_COUNT];
+    uint8_t pointer;
+    uint8_t pins[2];   // nivel externo de los pines de cada puerto
+};
+
+static uint8_t next_pointer(const i2c_sim_mcp23017_t *mcp, uint8_t reg)
+{
+    // SEQOP=1 (modo byte): el puntero alterna dentro del par A/B
+    if (mcp->regs[REG_IOCON] & IOCON_SEQOP)
+        return reg ^ 0x01;
+    return (uint8_t)((reg + 1) % REG_COUNT);
+}
+
+/**
+ * @brief Nivel visto en GPIO: entradas desde el pin (con IPOL), salidas desde OLAT.
+ */
+static uint8_t port_value(const i2c_sim_mcp23017_t *mcp, int port)
+{
+    uint8_t iodir = mcp->regs[REG_IODIRA + port];
+    uint8_t in = (uint8_t)(mcp->pins[port] ^ mcp->regs[REG_IPOLA + port]);
+    return (uint8_t)((in & iodir) | (mcp->regs[REG_OLATA + port] & ~iodir));
+}
+
+/**
+ * @brief Evalúa interrupt-on-change de un puerto con el valor anterior de sus entradas.
+ */
+static void eval_interrupts(i2c_sim_mcp23017_t *mcp, int port, uint8_t previous)
+{
+    uint8_t current = port_value(mcp, port);
+    uint8_t enabled = mcp->regs[REG_GPINTENA + port] & mcp->regs[REG_IODIRA + port];
+    uint8_t intcon = mcp->regs[REG_INTCONA + port];
+
+    uint8_t on_change = (uint8_t)((previous ^ current) & ~intcon);
+    uint8_t on_compare = (uint8_t)((current ^ mcp->regs[REG_DEFVALA + port]) & intcon);
+    uint8_t fired = (uint8_t)((on_change | on_compare) & enabled);
+
+    // INTCAP captura el puerto sólo en la primera interrupción hasta que se limpie
+    if (fired && mcp->regs[REG_INTFA + port] == 0)
+        mcp->regs[REG_INTCAPA + port] = current;
+    mcp->regs[REG_INTFA + port] |= fired;
+}
+
+static void clear_interrupt(i2c_sim_mcp23017_t *mcp, int port)
+{
+    mcp->regs[REG_INTFA + port] = 0;
+    // Comparación contra DEFVAL: la condición persiste mientras el pin siga distinto
+    eval_interrupts(mcp, port, port_value(mcp, port));
+}
+
+static esp_err_t mcp_write(void *ctx, const uint8_t *data, size_t len)
+{
+    i2c_sim_mcp23017_t *mcp = ctx;
+
+    if (data[0] >= REG_COUNT)
+        return ESP_ERR_INVALID_STATE;
+
+    mcp->pointer = data[0];
+    for (size_t i = 1; i < len; ++i)
+    {
+        uint8_t reg = mcp->pointer;
+        switch (reg)
+        {
+            case REG_IOCON:
+            case REG_IOCON_B:
+                mcp->regs[REG_IOCON] = mcp->regs[REG_IOCON_B] = data[i];
+                break;
+            case REG_INTFA:
+            case REG_INTFA + 1:
+            case REG_INTCAPA:
+            case REG_INTCAPA + 1:
+                break; // sólo lectura
+            case REG_GPIOA:
+            case REG_GPIOA + 1:
+                mcp->regs[REG_OLATA + (reg - REG_GPIOA)] = data[i]; // escribir GPIO escribe OLAT
+                break;
+            default:
+                mcp->regs[reg] = data[i];
+                break;
+        }
+        mcp->pointer = next_pointer(mcp, reg);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t mcp_read(void *ctx, uint8_t *data, size_t len)
+{
+    i2c_sim_mcp23017_t *mcp = ctx;
+
+    for (size_t i = 0; i < len; ++i)
+    {
+        uint8_t reg = mcp->pointer;
+        if (reg == REG_GPIOA || reg == REG_GPIOA + 1)
+        {
+            int port = reg - REG_GPIOA;
+            data[i] = port_value(mcp, port);
+            clear_interrupt(mcp, port);
+        }
+        else if (reg == REG_INTCAPA || reg == REG_INTCAPA + 1)
+        {
+            data[i] = mcp->regs[reg];
+            clear_interrupt(mcp, reg - REG_INTCAPA);
+        }
+        else
+        {
+            data[i] = mcp->regs[reg];
+        }
+        mcp->pointer = next_pointer(mcp, reg);
+    }
+    return ESP_OK;
+}
+
+i2c_sim_mcp23017_t *i2c_sim_mcp23017_create(uint8_t addr)
+{
+    i2c_sim_mcp23017_t *mcp = calloc(1, sizeof(*mcp));
+    if (!mcp)
+        return NULL;
+
+    mcp->addr = addr;
+    mcp->regs[REG_IODIRA] = 0xFF;       // valores de power-on reset
+    mcp->regs[REG_IODIRA + 1] = 0xFF;
+    mcp->pins[0] = mcp->pins[1] = 0xFF; // entradas flotantes con pull-up externo
+
+    i2c_sim_device_ops_t ops = { .write = mcp_write, .read = mcp_read, .ctx = mcp };
+    if (i2c_sim_attach(addr, &ops) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Cannot attach MCP23017 model at 0x%02X", addr);
+        free(mcp);
+        return NULL;
+    }
+    return mcp;
+}
+
+void i2c_sim_mcp23017_set_inputs(i2c_sim_mcp23017_t *mcp, uint8_t port_a, uint8_t port_b)
+{
+    if (!mcp)
+        return;
+
+    I2C_SIM_LOCK();
+    const uint8_t levels[2] = { port_a, port_b };
+    for (int port = 0; port < 2; ++port)
+    {
+        uint8_t previous = port_value(mcp, port);
+        mcp->pins[port] = levels[port];
+        eval_interrupts(mcp, port, previous);
+    }
+    I2C_SIM_UNLOCK();
+}
+
+void i2c_sim_mcp23017_get_outputs(i2c_sim_mcp23017_t *mcp, uint8_t *olat_a, uint8_t *olat_b)
+{
+    if (!mcp)
+        return;
+
+    I2C_SIM_LOCK();
+    if (olat_a) *olat_a = mcp->regs[REG_OLATA];
+    if (olat_b) *olat_b = mcp->regs[REG_OLATA + 1];
+    I2C_SIM_UNLOCK();
+}
+
+uint8_t i2c_sim_mcp23017_peek(i2c_sim_mcp23017_t *mcp, uint8_t reg)
+{
+    if (!mcp || reg >= REG_COUNT)
+        return 0;
+
+    I2C_SIM_LOCK();
+    uint8_t value = (reg == REG_GPIOA || reg == REG_GPIOA + 1) ? port_value(mcp, reg - REG_GPIOA) : mcp->regs[reg];
+    I2C_SIM_UNLOCK();
+    return value;
+}
+
+bool i2c_sim_mcp23017_int_active(i2c_sim_mcp23017_t *mcp, int port)
+{
+    if (!mcp || port < 0 || port > 1)
+        return false;
+
+    I2C_SIM_LOCK();
+    bool active = (mcp->regs[REG_IOCON] & IOCON_MIRROR)
+                ? (mcp->regs[REG_INTFA] | mcp->regs[REG_INTFA + 1]) != 0
+                : mcp->regs[REG_INTFA + port] != 0;
+    I2C_SIM_UNLOCK();
+    return active;
+}
@@ -0,0 +1,468 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "i2c_sim.h"
+#include "i2c_sim_priv.h"
+
+#define PN532_HOST_TO_PN532 0xD4
+#define PN532_PN532_TO_HOST 0xD5
+
+#define CMD_GET_FIRMWARE_VERSION 0x02
+#define CMD_SAM_CONFIGURATION    0x14
+#define CMD_RF_CONFIGURATION     0x32
+#define CMD_IN_DESELECT          0x44
+#define CMD_IN_LIST_PASSIVE      0x4A
+#define CMD_IN_RELEASE           0x52
+#define CMD_IN_SELECT            0x54
+#define CMD_IN_AUTO_POLL         0x60
+
+#define RF_CFG_MAX_RETRIES       0x05
+
+#define STATUS_OK                0x00
+#define STATUS_TIMEOUT           0x01 // el target no respondió
+#define STATUS_WRONG_CONTEXT     0x27 // no hay target inicializado
+
+#define PN532_STATUS_READY 0x01
+#define PN532_MAX_DATA     64
+#define PN532_MAX_TG       2
+
+#define BRTY_106A          0x00
+#define BRTY_212F          0x01
+#define BRTY_424F          0x02
+#define BRTY_106B          0x03
+
+#define DEFAULT_ACK_DELAY_US      500
+#define DEFAULT_RESPONSE_DELAY_US 2000
+
+static const char *TAG = "i2c_sim_pn532";
+
+static const uint8_t ACK_FRAME[] = { 0x00, 0x00, 0xFF, 0x00, 0xFF, 0x00 };
+static const uint8_t ERROR_FRAME[] = { 0x00, 0x00, 0xFF, 0x01, 0xFF, 0x7F, 0x81, 0x00 };
+
+typedef enum {
+    PN532_IDLE = 0,
+    PN532_ACK_PENDING,       // ACK listo en ready_at_us
+    PN532_RESPONSE_PENDING,  // respuesta lista en ready_at_us (o al aparecer un tag)
+} pn532_state_t;
+
+struct i2c_sim_pn532_s {
+    uint8_t addr;
+    pn532_state_t state;
+    int64_t ready_at_us;
+    uint32_t ack_delay_us;
+    uint32_t response_delay_us;
+    uint8_t cmd;                         // comando en curso
+    uint8_t mx_rty_passive;              // MxRtyPassiveActivation (0xFF = sin límite)
+    uint8_t frame[PN532_MAX_DATA + 10];  // ACK o respuesta a entregar
+    size_t frame_len;
+    bool error;                          // trama recibida inválida
+    bool nack_busy;                      // no reconoce la dirección mientras procesa
+    uint8_t max_tg;                      // MaxTg de InListPassiveTarget
+    uint8_t brty;                        // BrTy de InListPassiveTarget
+    uint8_t tg;                          // Tg de InSelect/InDeselect
+    i2c_sim_pn532_tag_t tags[I2C_SIM_PN532_MAX_TAGS]; // tags en el campo
+    size_t tag_count;
+    i2c_sim_pn532_tag_t listed[PN532_MAX_TG]; // targets inicializados (uid_len 0 = libre)
+    const i2c_sim_pn532_step_t *script;
+    size_t script_len;
+    size_t script_pos;
+    int64_t script_start_us;
+};
+
+static void apply_script(i2c_sim_pn532_t *pn)
+{
+    int64_t elapsed_ms = (esp_timer_get_time() - pn->script_start_us) / 1000;
+    while (pn->script && pn->script_pos < pn->script_len &&
+           pn->script[pn->script_pos].at_ms <= elapsed_ms)
+    {
+        const i2c_sim_pn532_step_t *step = &pn->script[pn->script_pos++];
+        pn->tag_count = 0;
+        if (step->uid_len == 4 || step->uid_len == 7 || step->uid_len == 10)
+        {
+            pn->tags[0].type = BRTY_106A;
+            pn->tags[0].uid_len = step->uid_len;
+            memcpy(pn->tags[0].uid, step->uid, step->uid_len);
+            pn->tag_count = 1;
+        }
+    }
+}
+
+/**
+ * @brief Arma una trama de respuesta normal: 00 00 FF LEN LCS D5 CMD+1 data DCS 00.
+ */
+static void build_response(i2c_sim_pn532_t *pn, const uint8_t *data, size_t data_len)
+{
+    uint8_t len = (uint8_t)(data_len + 2);
+    uint8_t *f = pn->frame;
+    size_t n = 0;
+    uint8_t sum = PN532_PN532_TO_HOST + (uint8_t)(pn->cmd + 1);
+
+    f[n++] = 0x00; f[n++] = 0x00; f[n++] = 0xFF;
+    f[n++] = len;
+    f[n++] = (uint8_t)(0x100 - len);
+    f[n++] = PN532_PN532_TO_HOST;
+    f[n++] = (uint8_t)(pn->cmd + 1);
+    for (size_t i = 0; i < data_len; ++i)
+    {
+        f[n++] = data[i];
+        sum += data[i];
+    }
+    f[n++] = (uint8_t)(0x100 - sum);
+    f[n++] = 0x00;
+    pn->frame_len = n;
+}
+
+/**
+ * @brief Agrega los datos de un target tipo A: Tg SENS_RES(2) SEL_RES NFCIDLength NFCID1.
+ */
+static size_t put_target_106a(uint8_t *data, uint8_t tg, const i2c_sim_pn532_tag_t *tag)
+{
+    size_t n = 0;
+    data[n++] = tg;
+    data[n++] = 0x00;                                    // SENS_RES
+    data[n++] = (tag->uid_len == 4) ? 0x04 : 0x44;
+    data[n++] = 0x08;                                    // SEL_RES: MIFARE Classic
+    data[n++] = tag->uid_len;                            // NFCIDLength
+    memcpy(&data[n], tag->uid, tag->uid_len);
+    return n + tag->uid_len;
+}
+
+/**
+ * @brief Agrega los datos de un target de InListPassiveTarget según su tipo.
+ */
+static size_t put_target(uint8_t *data, uint8_t tg, const i2c_sim_pn532_tag_t *tag)
+{
+    size_t n = 0;
+    switch (tag->type)
+    {
+        case BRTY_212F:
+        case BRTY_424F:
+            data[n++] = tg;
+            data[n++] = 18;                              // POL_RES_Len
+            data[n++] = 0x01;                            // código de respuesta
+            memcpy(&data[n], tag->uid, 8);               // IDm
+            n += 8;
+            memset(&data[n], 0xFF, 8);                   // PMm
+            return n + 8;
+        case BRTY_106B:
+            data[n++] = tg;
+            data[n++] = 0x50;                            // ATQB
+            memcpy(&data[n], tag->uid, 4);               // PUPI
+            n += 4;
+            memset(&data[n], 0x00, 4);                   // Application Data
+            n += 4;
+            data[n++] = 0x00; data[n++] = 0x81; data[n++] = 0x81; // Protocol Info
+            data[n++] = 0x01;                            // ATTRIB_RES_Len
+            data[n++] = 0x00;                            // ATTRIB_RES
+            return n;
+        default:
+            return put_target_106a(data, tg, tag);
+    }
+}
+
+/**
+ * @brief Tells whether a tag equal to the given one is in the field.
+ */
+static bool tag_in_field(const i2c_sim_pn532_t *pn, const i2c_sim_pn532_tag_t *tag)
+{
+    for (size_t i = 0; i < pn->tag_count; ++i)
+        if (pn->tags[i].type == tag->type && pn->tags[i].uid_len == tag->uid_len &&
+            memcmp(pn->tags[i].uid, tag->uid, tag->uid_len) == 0)
+            return true;
+    return false;
+}
+
+/**
+ * @brief Prepara la respuesta del comando en curso. Devuelve false si aún no puede responder.
+ */
+static bool prepare_response(i2c_sim_pn532_t *pn)
+{
+    uint8_t data[PN532_MAX_DATA];
+    size_t n = 0;
+
+    if (pn->error)
+    {
+        memcpy(pn->frame, ERROR_FRAME, sizeof(ERROR_FRAME));
+        pn->frame_len = sizeof(ERROR_FRAME);
+        return true;
+    }
+
+    switch (pn->cmd)
+    {
+        case CMD_GET_FIRMWARE_VERSION:
+            data[n++] = 0x32; // IC PN532
+            data[n++] = 0x01; // versión
+            data[n++] = 0x06; // revisión
+            data[n++] = 0x07; // ISO18092, ISO14443 A y B
+            break;
+        case CMD_IN_LIST_PASSIVE:
+        {
+            apply_script(pn);
+            memset(pn->listed, 0, sizeof(pn->listed));
+            uint8_t nbtg = 0;
+            n = 1;
+            for (size_t i = 0; i < pn->tag_count && nbtg < pn->max_tg; ++i)
+            {
+                if (pn->tags[i].type != pn->brty)
+                    continue;
+                pn->listed[nbtg] = pn->tags[i];
+                nbtg++;
+                n += put_target(&data[n], nbtg, &pn->tags[i]);
+            }
+            if (nbtg == 0 && pn->mx_rty_passive == 0xFF)
+                return false; // espera indefinidamente
+            data[0] = nbtg;   // NbTg = 0: reintentos agotados sin tag
+            break;
+        }
+        case CMD_IN_AUTO_POLL:
+        {
+            apply_script(pn);
+            const i2c_sim_pn532_tag_t *tag = NULL;
+            for (size_t i = 0; i < pn->tag_count && !tag; ++i)
+                if (pn->tags[i].type == BRTY_106A)
+                    tag = &pn->tags[i];
+            if (!tag)
+                return false; // sigue buscando hasta que aparezca un tag
+            data[n++] = 0x01;                         // NbTg
+            data[n++] = 0x10;                         // Type: 106 kbps tipo A
+            data[n++] = (uint8_t)(5 + tag->uid_len);  // longitud de TargetData
+            n += put_target_106a(&data[n], 0x01, tag);
+            break;
+        }
+        case CMD_IN_RELEASE:
+            memset(pn->listed, 0, sizeof(pn->listed));
+            data[n++] = STATUS_OK;
+            break;
+        case CMD_IN_DESELECT:
+            data[n++] = (pn->tg == 0 || (pn->tg <= PN532_MAX_TG && pn->listed[pn->tg - 1].uid_len))
+                        ? STATUS_OK : STATUS_WRONG_CONTEXT;
+            break;
+        case CMD_IN_SELECT:
+            // Solo responde el mismo tag que se inicializó, si sigue en el campo
+            apply_script(pn);
+            if (pn->tg == 0 || pn->tg > PN532_MAX_TG || pn->listed[pn->tg - 1].uid_len == 0)
+                data[n++] = STATUS_WRONG_CONTEXT;
+            else if (tag_in_field(pn, &pn->listed[pn->tg - 1]))
+                data[n++] = STATUS_OK;
+            else
+                data[n++] = STATUS_TIMEOUT;
+            break;
+        default:
+            break; // SAMConfiguration, RFConfiguration: respuesta sin datos
+    }
+
+    build_response(pn, data, n);
+    return true;
+}
+
+/**
+ * @brief Avanza la máquina de estados hasta el instante actual.
+ * @return true si hay una trama lista para leer.
+ */
+static bool frame_ready(i2c_sim_pn532_t *pn)
+{
+    if (pn->state == PN532_IDLE)
+        return false;
+    if (esp_timer_get_time() < pn->ready_at_us)
+        return false;
+    if (pn->state == PN532_RESPONSE_PENDING && pn->frame_len == 0)
+        return prepare_response(pn);
+    return true;
+}
+
+static esp_err_t pn_write(void *ctx, const uint8_t *data, size_t len)
+{
+    i2c_sim_pn532_t *pn = ctx;
+
+    // Un ACK del host aborta el comando en curso
+    if (len == sizeof(ACK_FRAME) && memcmp(data, ACK_FRAME, len) == 0)
+    {
+        pn->state = PN532_IDLE;
+        pn->frame_len = 0;
+        ESP_LOGD(TAG, "Command aborted by host ACK");
+        return ESP_OK;
+    }
+
+    // Un comando nuevo aborta el anterior, como en el PN532
+    pn->state = PN532_ACK_PENDING;
+    pn->ready_at_us = esp_timer_get_time() + pn->ack_delay_us;
+    memcpy(pn->frame, ACK_FRAME, sizeof(ACK_FRAME));
+    pn->frame_len = sizeof(ACK_FRAME);
+    pn->error = true;
+    pn->cmd = 0;
+
+    // 00 00 FF LEN LCS D4 CMD ... DCS 00
+    if (len < 8 || data[0] != 0x00 || data[1] != 0x00 || data[2] != 0xFF)
+        goto out;
+
+    uint8_t flen = data[3];
+    if ((uint8_t)(flen + data[4]) != 0 || flen < 2 || (size_t)flen + 7 > len)
+        goto out;
+
+    uint8_t sum = 0;
+    for (size_t i = 0; i <= flen; ++i)
+        sum += data[5 + i];
+    if (sum != 0 || data[5] != PN532_HOST_TO_PN532)
+        goto out;
+
+    pn->cmd = data[6];
+    pn->error = false;
+
+    // RFConfiguration MaxRetries: 05 MxRtyATR MxRtyPSL MxRtyPassiveActivation
+    if (pn->cmd == CMD_RF_CONFIGURATION && flen >= 6 && data[7] == RF_CFG_MAX_RETRIES)
+        pn->mx_rty_passive = data[10];
+
+    // InListPassiveTarget MaxTg BrTy ...
+    if (pn->cmd == CMD_IN_LIST_PASSIVE)
+    {
+        pn->max_tg = (flen >= 4 && data[7] >= 1 && data[7] <= PN532_MAX_TG) ? data[7] : 1;
+        pn->brty = (flen >= 4) ? data[8] : BRTY_106A;
+    }
+
+    // InSelect/InDeselect Tg
+    if ((pn->cmd == CMD_IN_SELECT || pn->cmd == CMD_IN_DESELECT) && flen >= 3)
+        pn->tg = data[7];
+
+out:
+    if (pn->error)
+        ESP_LOGW(TAG, "Malformed command frame (%u bytes)", (unsigned)len);
+    else
+        ESP_LOGD(TAG, "Command 0x%02X", pn->cmd);
+    return ESP_OK;
+}
+
+static esp_err_t pn_read(void *ctx, uint8_t *data, size_t len)
+{
+    i2c_sim_pn532_t *pn = ctx;
+
+    memset(data, 0, len);
+    if (!frame_ready(pn))
+        return pn->nack_busy ? ESP_ERR_INVALID_STATE : ESP_OK; // NACK o status 0x00: no listo
+
+    data[0] = PN532_STATUS_READY;
+
+    // Leer sólo el byte de estado no consume la trama: el host sondea y después la lee entera
+    if (len == 1)
+        return ESP_OK;
+
+    size_t n = (len - 1 < pn->frame_len) ? len - 1 : pn->frame_len;
+    memcpy(&data[1], pn->frame, n);
+
+    // Leer la trama la consume
+    if (pn->state == PN532_ACK_PENDING)
+    {
+        pn->state = PN532_RESPONSE_PENDING;
+        pn->ready_at_us = esp_timer_get_time() + pn->response_delay_us;
+        pn->frame_len = 0;
+    }
+    else
+    {
+        pn->state = PN532_IDLE;
+    }
+    return ESP_OK;
+}
+
+i2c_sim_pn532_t *i2c_sim_pn532_create(uint8_t addr)
+{
+    i2c_sim_pn532_t *pn = calloc(1, sizeof(*pn));
+    if (!pn)
+        return NULL;
+
+    pn->addr = addr;
+    pn->ack_delay_us = DEFAULT_ACK_DELAY_US;
+    pn->response_delay_us = DEFAULT_RESPONSE_DELAY_US;
+    pn->mx_rty_passive = 0xFF;
+
+    i2c_sim_device_ops_t ops = { .write = pn_write, .read = pn_read, .ctx = pn };
+    if (i2c_sim_attach(addr, &ops) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Cannot attach PN532 model at 0x%02X", addr);
+        free(pn);
+        return NULL;
+    }
+    return pn;
+}
+
+void i2c_sim_pn532_set_timing(i2c_sim_pn532_t *pn, uint32_t ack_delay_us, uint32_t response_delay_us)
+{
+    if (!pn)
+        return;
+
+    I2C_SIM_LOCK();
+    pn->ack_delay_us = ack_delay_us;
+    pn->response_delay_us = response_delay_us;
+    I2C_SIM_UNLOCK();
+}
+
+void i2c_sim_pn532_set_nack_busy(i2c_sim_pn532_t *pn, bool enable)
+{
+    if (!pn)
+        return;
+
+    I2C_SIM_LOCK();
+    pn->nack_busy = enable;
+    I2C_SIM_UNLOCK();
+}
+
+esp_err_t i2c_sim_pn532_set_tag(i2c_sim_pn532_t *pn, const uint8_t *uid, size_t uid_len)
+{
+    if (uid_len == 0)
+        return i2c_sim_pn532_set_tags(pn, NULL, 0);
+    if (!uid || uid_len > I2C_SIM_PN532_UID_MAX)
+        return ESP_ERR_INVALID_ARG;
+
+    i2c_sim_pn532_tag_t tag = { .type = BRTY_106A, .uid_len = (uint8_t)uid_len };
+    memcpy(tag.uid, uid, uid_len);
+    return i2c_sim_pn532_set_tags(pn, &tag, 1);
+}
+
+esp_err_t i2c_sim_pn532_set_tags(i2c_sim_pn532_t *pn, const i2c_sim_pn532_tag_t *tags, size_t count)
+{
+    if (!pn || (count && !tags) || count > I2C_SIM_PN532_MAX_TAGS)
+        return ESP_ERR_INVALID_ARG;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint8_t len = tags[i].uid_len;
+        bool ok = (tags[i].type == BRTY_106A) ? (len == 4 || len == 7 || len == 10) :
+                  (tags[i].type == BRTY_212F || tags[i].type == BRTY_424F) ? (len == 8) :
+                  (tags[i].type == BRTY_106B) ? (len == 4) : false;
+        if (!ok)
+            return ESP_ERR_INVALID_ARG;
+    }
+
+    I2C_SIM_LOCK();
+    if (count)
+        memcpy(pn->tags, tags, count * sizeof(*tags));
+    pn->tag_count = count;
+    I2C_SIM_UNLOCK();
+    return ESP_OK;
+}
+
+void i2c_sim_pn532_run_script(i2c_sim_pn532_t *pn, const i2c_sim_pn532_step_t *steps, size_t count)
+{
+    if (!pn)
+        return;
+
+    I2C_SIM_LOCK();
+    pn->script = steps;
+    pn->script_len = steps ? count : 0;
+    pn->script_pos = 0;
+    pn->script_start_us = esp_timer_get_time();
+    I2C_SIM_UNLOCK();
+}
+
+bool i2c_sim_pn532_ready(i2c_sim_pn532_t *pn)
+{
+    if (!pn)
+        return false;
+
+    I2C_SIM_LOCK();
+    apply_script(pn);
+    bool ready = frame_ready(pn);
+    I2C_SIM_UNLOCK();
+    return ready;
+}
@@ -0,0 +1,17 @@
+#ifndef I2C_SIM_PRIV_H
+#define I2C_SIM_PRIV_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+/**
+ * @brief Mutex del simulador: protege el estado del bus y de todos los modelos.
+ * @details Los callbacks de los modelos se invocan con el mutex tomado; las funciones
+ *          públicas de cada modelo lo toman antes de tocar su estado.
+ */
+SemaphoreHandle_t i2c_sim_lock(void);
+
+#define I2C_SIM_LOCK()   xSemaphoreTakeRecursive(i2c_sim_lock(), portMAX_DELAY)
+#define I2C_SIM_UNLOCK() xSemaphoreGiveRecursive(i2c_sim_lock())
+
+#endif // I2C_SIM_PRIV_H
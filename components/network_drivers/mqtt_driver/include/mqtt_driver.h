@@ -67,6 +67,8 @@ esp_err_t mqtt_client_publish(const char *topic, const char *payload, int qos);
  * @brief Subscribe to an MQTT topic with a message handler.
  * @details This function subscribes to the specified MQTT topic and registers a handler function
  *          that will be called when messages are received on that topic.
+ *          Messages whose payload does not fit in MAX_PAYLOAD_SIZE (with the terminator), or
+ *          that the client delivers in fragments, are dropped and never reach the handler.
  * 
  * @param topic The MQTT topic to subscribe to.
  * @param handler The function to handle incoming messages on the subscribed topic.
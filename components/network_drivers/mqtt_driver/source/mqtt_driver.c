@@ -262,6 +262,23 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
             ESP_LOGI(TAG, "MQTT_EVENT_PUBLISHED, msg_id=%d", (int)event->msg_id);
             break;
         case MQTT_EVENT_DATA:
+            // esp-mqtt entrega en trozos los mensajes que no entran en su buffer (los siguientes
+            // llegan sin tópico). Un mensaje partido o más largo que el buffer se descarta entero:
+            // un comando cortado puede leerse como otro comando válido
+            if (event->current_data_offset != 0 || event->data_len < event->total_data_len)
+            {
+                if (event->current_data_offset == 0)
+                    ESP_LOGE(TAG, "Fragmented message on %.*s (%d bytes) dropped",
+                             event->topic_len, event->topic, event->total_data_len);
+                break;
+            }
+            if (event->topic_len >= MAX_TOPIC_SIZE || event->data_len >= MAX_PAYLOAD_SIZE)
+            {
+                ESP_LOGE(TAG, "Message on %.*s too long (%d bytes, max %d), dropped",
+                         event->topic_len, event->topic, event->data_len, MAX_PAYLOAD_SIZE - 1);
+                break;
+            }
+
             ESP_LOGD(TAG, "Message received with topic: %.*s", event->topic_len, event->topic);
 
             for (int i = 0; i < MAX_SUBSCRIBE_MSG; ++i)
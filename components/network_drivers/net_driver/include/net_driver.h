@@ -39,4 +39,13 @@ esp_err_t eth_net_start(esp_ip4_addr_t ip, esp_ip4_addr_t gw, esp_ip4_addr_t mas
  */
 esp_err_t eth_net_ready(void);
 
+/**
+ * @brief Get the Ethernet network interface.
+ * 
+ * @details Servers that bind to the Ethernet interface (e.g. Modbus TCP) take it from here.
+ * 
+ * @return esp_netif_t* The interface created by eth_net_start(), or NULL if it was not started.
+ */
+esp_netif_t *eth_net_netif(void);
+
 #endif // NET_DRIVER_H
\ No newline at end of file
@@ -11,6 +11,7 @@
 
 static const char *TAG = "net_driver";
 static EventGroupHandle_t net_event_group = NULL;
+static esp_netif_t *eth_netif = NULL;
 #define NET_READY_BIT BIT0
 
 static void eth_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
@@ -39,6 +40,7 @@ esp_err_t eth_net_start(esp_ip4_addr_t ip, esp_ip4_addr_t gw, esp_ip4_addr_t mas
 
     esp_netif_config_t cfg = ESP_NETIF_DEFAULT_ETH();
     esp_netif_t *eth_netifs = esp_netif_new(&cfg);
+    eth_netif = eth_netifs;
 
     ESP_ERROR_CHECK(esp_netif_dhcpc_stop(eth_netifs));
 
@@ -74,6 +76,11 @@ esp_err_t eth_net_ready(void)
     return ESP_FAIL;
 }
 
+esp_netif_t *eth_net_netif(void)
+{
+    return eth_netif;
+}
+
 static void eth_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
 {
     uint8_t mac_addr[6] = {0};
@@ -22,7 +22,8 @@
 enum { SEC_MONITORING_STATE = 0, SEC_VALIDATION_STATE = 1, SEC_ALARM_STATE = 2, SEC_NORMAL_STATE = 3 };
 enum { INTRUSION_DETECTED_EVENT = 0, PANIC_BUTTON_PRESSED_EVENT = 1, TURN_LIGHTS_ON_EVENT = 2, 
        TURN_LIGHTS_OFF_EVENT = 3, TURN_SIREN_ON_EVENT = 4, TURN_SIREN_OFF_EVENT = 5, VALID_TAG_EVENT = 6,
-       INVALID_TAG_EVENT = 7, READ_TAG_TIMEOUT_EVENT = 8, WORKING_TIMEOUT_EVENT = 9, MAX_EVENT = 10 };
+       INVALID_TAG_EVENT = 7, READ_TAG_TIMEOUT_EVENT = 8, WORKING_TIMEOUT_EVENT = 9, TAG_REMOVED_EVENT = 10,
+       MAX_EVENT = 11 };
 
 // Function prototypes for action handlers
 
@@ -88,6 +89,15 @@ ao_fsm_state_t security_monitoringState_turnSirenOn_action(ao_fsm_t *fsm, const
  */
 ao_fsm_state_t security_monitoringState_turnSirenOff_action(ao_fsm_t *fsm, const ao_evt_t *event);
 
+/**
+ * @brief Action function for handling tag removed event in monitoring state.
+ * @param fsm Pointer to the finite state machine instance.
+ * @param event Pointer to the event that triggered the action.
+ * @return The next state of the FSM after handling the event: Monitoring
+ * @note This function is called when the tag presented earlier leaves the reader field while in
+ *       the monitoring state. It does not change the state.
+ */
+ao_fsm_state_t security_monitoringState_tagRemovedEvent_action(ao_fsm_t *fsm, const ao_evt_t *event);
 // ---------------------------------------------------------------------------------------------------------
 
 // Validation State Function Prototipe
@@ -122,6 +132,15 @@ ao_fsm_state_t security_validationState_validTagEvent_action(ao_fsm_t *fsm, cons
  */
 ao_fsm_state_t security_validationState_tagReadTimeoutEvent_action(ao_fsm_t *fsm, const ao_evt_t *event);
 
+/**
+ * @brief Action function for handling tag removed event in validation state.
+ * @param fsm Pointer to the finite state machine instance.
+ * @param event Pointer to the event that triggered the action.
+ * @return The next state of the FSM after handling the event: Validation
+ * @note This function is called when the tag presented earlier leaves the reader field while in
+ *       the validation state. It does not change the state.
+ */
+ao_fsm_state_t security_validationState_tagRemovedEvent_action(ao_fsm_t *fsm, const ao_evt_t *event);
 // ---------------------------------------------------------------------------------------------------------
 
 // Alarm State Function Prototipe
@@ -166,6 +185,16 @@ ao_fsm_state_t security_alarmState_turnLightsOff_action(ao_fsm_t *fsm, const ao_
  *       It transitions the FSM back to the alarm state.
  */
 ao_fsm_state_t security_alarmState_turnSirenOff_action(ao_fsm_t *fsm, const ao_evt_t *event);
+
+/**
+ * @brief Action function for handling tag removed event in alarm state.
+ * @param fsm Pointer to the finite state machine instance.
+ * @param event Pointer to the event that triggered the action.
+ * @return The next state of the FSM after handling the event: Alarm
+ * @note This function is called when the tag presented earlier leaves the reader field while in
+ *       the alarm state. It does not change the state.
+ */
+ao_fsm_state_t security_alarmState_tagRemovedEvent_action(ao_fsm_t *fsm, const ao_evt_t *event);
 // ---------------------------------------------------------------------------------------------------------
 
 // Normal State Function Prototipe
@@ -230,6 +259,16 @@ ao_fsm_state_t security_normalState_turnSirenOn_action(ao_fsm_t *fsm, const ao_e
  */
 ao_fsm_state_t security_normalState_turnSirenOff_action(ao_fsm_t *fsm, const ao_evt_t *event);
 
+/**
+ * @brief Action function for handling tag removed event in normal state.
+ * @param fsm Pointer to the finite state machine instance.
+ * @param event Pointer to the event that triggered the action.
+ * @return The next state of the FSM after handling the event: Normal
+ * @note This function is called when the tag presented earlier leaves the reader field while in
+ *       the normal state. It does not change the state.
+ */
+ao_fsm_state_t security_normalState_tagRemovedEvent_action(ao_fsm_t *fsm, const ao_evt_t *event);
+
 /**
  * @brief State transition table for the Security AO FSM.
  * @details This table defines the state transitions for the Security AO FSM,
@@ -240,6 +279,7 @@ static ao_fsm_transition_t security_fsm_transitions[] =
     // Monitoring State
     { SEC_MONITORING_STATE, INTRUSION_DETECTED_EVENT,   security_monitoringState_intrusionDetected_action },
     { SEC_MONITORING_STATE, PANIC_BUTTON_PRESSED_EVENT, security_monitoringState_panicButtonPressed_action },
+    { SEC_MONITORING_STATE, TAG_REMOVED_EVENT,          security_monitoringState_tagRemovedEvent_action },
 
     // Global Commands on Monitoring
     // { SEC_MONITORING_STATE, TURN_LIGHTS_ON_EVENT,       security_monitoringState_turnLightsOn_action  },
@@ -251,10 +291,12 @@ static ao_fsm_transition_t security_fsm_transitions[] =
     { SEC_VALIDATION_STATE, INVALID_TAG_EVENT,          security_validationState_invalidTagEvent_action },
     { SEC_VALIDATION_STATE, VALID_TAG_EVENT,            security_validationState_validTagEvent_action },
     { SEC_VALIDATION_STATE, READ_TAG_TIMEOUT_EVENT,     security_validationState_tagReadTimeoutEvent_action },
+    { SEC_VALIDATION_STATE, TAG_REMOVED_EVENT,          security_validationState_tagRemovedEvent_action },
 
     // Alarm State
     { SEC_ALARM_STATE,      INVALID_TAG_EVENT,          security_alarmState_invalidTagEvent_action },
     { SEC_ALARM_STATE,      VALID_TAG_EVENT,            security_alarmState_validTagEvent_action },
+    { SEC_ALARM_STATE,      TAG_REMOVED_EVENT,          security_alarmState_tagRemovedEvent_action },
 
     // Global Commands on Alarm
     // { SEC_ALARM_STATE,      TURN_LIGHTS_OFF_EVENT,      security_alarmState_turnLightsOff_action },
@@ -262,6 +304,7 @@ static ao_fsm_transition_t security_fsm_transitions[] =
 
     // Normal    
     { SEC_NORMAL_STATE,     WORKING_TIMEOUT_EVENT,      security_normalState_workingTimeoutEvent_action },
+    { SEC_NORMAL_STATE,     TAG_REMOVED_EVENT,          security_normalState_tagRemovedEvent_action },
 
     // Silent Alarm - return to Normal State
     { SEC_NORMAL_STATE,     PANIC_BUTTON_PRESSED_EVENT, security_normalState_panicButtonPressed_action },
@@ -0,0 +1,120 @@
+#ifndef SECURITY_AUTH_H
+#define SECURITY_AUTH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+/**
+ * @file security_auth.h
+ * @brief Authorization store for RFID tags.
+ * @details Authorized UIDs (4, 7 or 10 bytes) are kept in an open-addressing hash table
+ *          with linear probing, so a lookup costs the same with ten entries or thousands.
+ *          Each entry can carry a validity window. The table lives in a dedicated NVS
+ *          partition, split in fixed-size chunks: adding or removing an entry rewrites only
+ *          the chunks it touched, so deltas can be applied at runtime without a reboot.
+ *
+ * @author Roberto Axt
+ * @version 1.0
+ * @date 2025-11-10
+ *
+ * @par License
+ * This file is part of the SMEM-MP project and is licensed under the MIT License.
+ */
+
+#define SECURITY_AUTH_UID_MAX 10  /**< Longest UID (ISO14443A triple size) */
+
+/**
+ * @brief One authorized tag.
+ */
+typedef struct {
+    uint8_t uid[SECURITY_AUTH_UID_MAX];  /**< UID bytes */
+    uint8_t uid_len;                     /**< 4, 7 or 10 */
+    uint32_t valid_from;                 /**< UNIX time from which the tag is valid, 0 = no lower bound */
+    uint32_t valid_until;                /**< UNIX time after which the tag is no longer valid, 0 = no upper bound */
+} security_auth_entry_t;
+
+/**
+ * @brief Result of an authorization lookup.
+ */
+typedef enum {
+    SECURITY_AUTH_GRANTED = 0,    /**< Known tag inside its validity window */
+    SECURITY_AUTH_UNKNOWN,        /**< Tag not in the store */
+    SECURITY_AUTH_NOT_YET_VALID,  /**< Known tag, window not started */
+    SECURITY_AUTH_EXPIRED,        /**< Known tag, window over */
+    SECURITY_AUTH_NO_CLOCK,       /**< Known tag with a window, but the clock is not set yet */
+} security_auth_result_t;
+
+/**
+ * @brief Opens the store partition and loads the table.
+ * @details On the first start (no table stored yet) the store is seeded with the given
+ *          entries. If the table size changed in the configuration, the stored entries are
+ *          rehashed into the new table.
+ * @param defaults Entries for a fresh store (may be NULL).
+ * @param count Number of default entries.
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t security_auth_start(const security_auth_entry_t *defaults, size_t count);
+
+/**
+ * @brief Stores the changes of an open batch and releases the table.
+ * @details The store can be started again afterwards, which reloads the table from NVS.
+ *          No other call may be in progress.
+ * @return ESP_OK on success, or an NVS error code (the table is released anyway).
+ */
+esp_err_t security_auth_stop(void);
+
+/**
+ * @brief Checks whether a tag is authorized now.
+ * @param uid UID bytes.
+ * @param uid_len UID length.
+ * @return The lookup result. Entries without a window do not depend on the clock.
+ */
+security_auth_result_t security_auth_check(const uint8_t *uid, size_t uid_len);
+
+/**
+ * @brief Starts a batch of changes.
+ * @details Until security_auth_batch_end(), add, remove and clear change the table in RAM
+ *          (lookups see them right away) but do not write NVS. The touched chunks are then
+ *          written and committed once, instead of once per change.
+ */
+void security_auth_batch_begin(void);
+
+/**
+ * @brief Ends a batch of changes and stores the chunks it touched.
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if the store is not started, or an NVS
+ *         error code.
+ */
+esp_err_t security_auth_batch_end(void);
+
+/**
+ * @brief Adds a tag, or updates its validity window if it is already stored.
+ * @param entry Entry to store.
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for a bad UID length or window,
+ *         ESP_ERR_NO_MEM if the store is full, or an NVS error code (not inside a batch).
+ */
+esp_err_t security_auth_add(const security_auth_entry_t *entry);
+
+/**
+ * @brief Removes a tag.
+ * @param uid UID bytes.
+ * @param uid_len UID length.
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the tag is not stored, or an NVS error code
+ *         (not inside a batch).
+ */
+esp_err_t security_auth_remove(const uint8_t *uid, size_t uid_len);
+
+/**
+ * @brief Removes every tag.
+ * @return ESP_OK on success, or an NVS error code (not inside a batch).
+ */
+esp_err_t security_auth_clear(void);
+
+/**
+ * @brief Gets the number of stored tags.
+ * @return Number of entries.
+ */
+size_t security_auth_count(void);
+
+#endif // SECURITY_AUTH_H
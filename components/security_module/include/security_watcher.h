@@ -19,6 +19,8 @@
 
 #include "ao_fsm.h"
 
+#define SECURITY_WATCHER_INTERVAL_MS 1500  /**< Period of the device readers (security_tagReader() ...) */
+
 /**
  * @brief Starts the devices involved in the security watcher.
  * @details This function initializes and starts the devices involved in the security watcher,
@@ -76,4 +78,16 @@ void security_turnSiren_on(void);
  */
 void security_turnSiren_off(void);
 
+/**
+ * @brief Turns on the security lights and siren together.
+ * @details Both outputs change in a single write to the I/O expander.
+ */
+void security_turnLightsAndSiren_on(void);
+
+/**
+ * @brief Turns off the security lights and siren together.
+ * @details Both outputs change in a single write to the I/O expander.
+ */
+void security_turnLightsAndSiren_off(void);
+
 #endif // SECURITY_WATCHER_H
\ No newline at end of file
@@ -87,6 +87,30 @@ static void security_start_working_timer(ao_fsm_t *fsm)
     }
 }
 
+/**
+ * @brief Handles a tag removed event without changing the state.
+ * @param fsm Pointer to the finite state machine instance.
+ * @param event Pointer to the event that triggered the action.
+ * @param state Current state, which is also the next one.
+ * @param action_name Name of the calling action, for the error log.
+ * @return The same state.
+ */
+static ao_fsm_state_t security_tagRemoved(ao_fsm_t *fsm, const ao_evt_t *event, ao_fsm_state_t state, const char *action_name)
+{
+    if(fsm == NULL || event == NULL || event->type != TAG_REMOVED_EVENT) 
+    {
+        ESP_LOGE(TAG, "Invalid parameters in %s", action_name);
+        return state;
+    }
+    ESP_LOGD(TAG, "Tag removed from the reader in state %d.", (int)state);
+
+    // Notify tag removed event
+    if(security_onEvent_callbacks[TAG_REMOVED_EVENT] != NULL)
+        security_onEvent_callbacks[TAG_REMOVED_EVENT]();
+
+    return state;
+}
+
 // ---------------------------------------------------------------------------------------------------------
 
 // Monitoring State Function Definition
@@ -207,6 +231,11 @@ ao_fsm_state_t security_monitoringState_turnSirenOff_action(ao_fsm_t *fsm, const
     return SEC_MONITORING_STATE;
 }
 
+ao_fsm_state_t security_monitoringState_tagRemovedEvent_action(ao_fsm_t *fsm, const ao_evt_t *event)
+{
+    return security_tagRemoved(fsm, event, SEC_MONITORING_STATE, __func__);
+}
+
 // ---------------------------------------------------------------------------------------------------------
 
 // Validation State Function Definition
@@ -225,8 +254,7 @@ ao_fsm_state_t security_validationState_invalidTagEvent_action(ao_fsm_t *fsm, co
     security_stop_timer(workingTimerHandle);
 
     // Activate siren and lights.
-    security_turnLights_on();
-    security_turnSiren_on();
+    security_turnLightsAndSiren_on();
 
     // Notify invalid tag event
     if(security_onEvent_callbacks[INVALID_TAG_EVENT] != NULL)
@@ -248,8 +276,7 @@ ao_fsm_state_t security_validationState_validTagEvent_action(ao_fsm_t *fsm, cons
     security_stop_timer(tagReadTimerHandle);
 
     // Deactivate siren and lights.
-    security_turnLights_off();
-    security_turnSiren_off();
+    security_turnLightsAndSiren_off();
 
     // Start working timer
     security_start_working_timer(fsm);
@@ -274,8 +301,7 @@ ao_fsm_state_t security_validationState_tagReadTimeoutEvent_action(ao_fsm_t *fsm
     security_stop_timer(tagReadTimerHandle);
 
     // Activate siren and lights.
-    security_turnLights_on();
-    security_turnSiren_on();
+    security_turnLightsAndSiren_on();
 
     // Notify tag read timeout event
     if(security_onEvent_callbacks[READ_TAG_TIMEOUT_EVENT] != NULL)
@@ -284,6 +310,11 @@ ao_fsm_state_t security_validationState_tagReadTimeoutEvent_action(ao_fsm_t *fsm
     return SEC_ALARM_STATE;
 }
 
+ao_fsm_state_t security_validationState_tagRemovedEvent_action(ao_fsm_t *fsm, const ao_evt_t *event)
+{
+    return security_tagRemoved(fsm, event, SEC_VALIDATION_STATE, __func__);
+}
+
 // ---------------------------------------------------------------------------------------------------------
 
 // Alarm State Function Definition
@@ -314,8 +345,7 @@ ao_fsm_state_t security_alarmState_validTagEvent_action(ao_fsm_t *fsm, const ao_
     ESP_LOGI(TAG, "Valid tag event received in ALARM_STATE. Transitioning to NORMAL_STATE.");
 
     // Deactivate siren and lights.
-    security_turnLights_off();
-    security_turnSiren_off();
+    security_turnLightsAndSiren_off();
 
     // Start working timer
     security_start_working_timer(fsm);
@@ -364,6 +394,12 @@ ao_fsm_state_t security_alarmState_turnSirenOff_action(ao_fsm_t *fsm, const ao_e
     
     return SEC_ALARM_STATE;
 }
+
+ao_fsm_state_t security_alarmState_tagRemovedEvent_action(ao_fsm_t *fsm, const ao_evt_t *event)
+{
+    return security_tagRemoved(fsm, event, SEC_ALARM_STATE, __func__);
+}
+
 // ---------------------------------------------------------------------------------------------------------
 
 // Normal State Function Definition
@@ -479,4 +515,9 @@ ao_fsm_state_t security_normalState_turnSirenOff_action(ao_fsm_t *fsm, const ao_
         security_onEvent_callbacks[TURN_SIREN_OFF_EVENT]();
     
     return SEC_NORMAL_STATE;
-}
\ No newline at end of file
+}
+
+ao_fsm_state_t security_normalState_tagRemovedEvent_action(ao_fsm_t *fsm, const ao_evt_t *event)
+{
+    return security_tagRemoved(fsm, event, SEC_NORMAL_STATE, __func__);
+}
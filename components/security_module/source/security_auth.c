@@ -0,0 +1,477 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+
+#include "security_auth.h"
+
+#ifndef CONFIG_SECURITY_AUTH_TABLE_SLOTS
+#define CONFIG_SECURITY_AUTH_TABLE_SLOTS 2048
+#endif
+#ifndef CONFIG_SECURITY_AUTH_PARTITION
+#define CONFIG_SECURITY_AUTH_PARTITION "sec_auth"
+#endif
+
+#define AUTH_SLOTS          CONFIG_SECURITY_AUTH_TABLE_SLOTS
+#define AUTH_SLOT_MASK      (AUTH_SLOTS - 1)
+#define AUTH_CAPACITY       (AUTH_SLOTS / 4 * 3)  // factor de carga máximo 0.75
+#define AUTH_CHUNK_SLOTS    64                    // slots por blob de NVS
+#define AUTH_CHUNKS         (AUTH_SLOTS / AUTH_CHUNK_SLOTS)
+#define AUTH_NVS_NAMESPACE  "auth"
+#define AUTH_NVS_META       "meta"
+#define AUTH_META_VERSION   1
+#define AUTH_CLOCK_SET      1704067200  // 2024-01-01: antes de esto el reloj no está sincronizado
+
+_Static_assert((AUTH_SLOTS & AUTH_SLOT_MASK) == 0 && AUTH_SLOTS >= AUTH_CHUNK_SLOTS,
+               "SECURITY_AUTH_TABLE_SLOTS must be a power of two >= 64");
+
+static const char *TAG = "security_auth";
+
+/* Slot tal como se guarda en NVS (20 bytes); uid_len = 0 es un slot libre */
+typedef struct {
+    uint32_t valid_from;
+    uint32_t valid_until;
+    uint8_t uid_len;
+    uint8_t uid[SECURITY_AUTH_UID_MAX];
+    uint8_t reserved;
+} auth_slot_t;
+
+typedef struct {
+    uint16_t version;
+    uint16_t chunk_slots;
+    uint32_t slots;
+} auth_meta_t;
+
+static auth_slot_t *table = NULL;
+static size_t count = 0;
+static uint8_t dirty[(AUTH_CHUNKS + 7) / 8];  // chunks a reescribir en NVS
+static bool batch = false;                    // los cambios se guardan en security_auth_batch_end()
+static nvs_handle_t nvs = 0;
+static SemaphoreHandle_t lock = NULL;
+
+static bool valid_uid_len(size_t len)
+{
+    return len == 4 || len == 7 || len == 10;
+}
+
+/* FNV-1a de 32 bits; la longitud entra en el hash para separar UIDs de distinto tamaño */
+static uint32_t uid_hash(const uint8_t *uid, size_t len)
+{
+    uint32_t h = 2166136261u ^ (uint32_t)len;
+    for (size_t i = 0; i < len; ++i)
+    {
+        h ^= uid[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void mark_dirty(size_t slot)
+{
+    size_t chunk = slot / AUTH_CHUNK_SLOTS;
+    dirty[chunk / 8] |= (uint8_t)(1u << (chunk % 8));
+}
+
+/* Devuelve el slot del UID, o el primer slot libre de su secuencia de sondeo con *found = false */
+static size_t probe(const uint8_t *uid, size_t len, bool *found)
+{
+    size_t i = uid_hash(uid, len) & AUTH_SLOT_MASK;
+    for (;;)
+    {
+        const auth_slot_t *s = &table[i];
+        if (s->uid_len == 0)
+        {
+            *found = false;
+            return i;
+        }
+        if (s->uid_len == len && memcmp(s->uid, uid, len) == 0)
+        {
+            *found = true;
+            return i;
+        }
+        i = (i + 1) & AUTH_SLOT_MASK;
+    }
+}
+
+static bool insert_slot(const auth_slot_t *slot)
+{
+    bool found;
+    size_t i = probe(slot->uid, slot->uid_len, &found);
+    if (!found && count >= AUTH_CAPACITY)
+        return false;
+
+    table[i] = *slot;
+    mark_dirty(i);
+    if (!found) count++;
+    return true;
+}
+
+/**
+ * @brief Borra el slot i con desplazamiento hacia atrás (sin lápidas).
+ * @details Los elementos siguientes de la secuencia que quedarían inalcanzables se corren al
+ *          hueco, así la tabla nunca se degrada y las búsquedas siguen en O(1).
+ */
+static void delete_slot(size_t i)
+{
+    size_t j = i;
+    for (;;)
+    {
+        j = (j + 1) & AUTH_SLOT_MASK;
+        if (table[j].uid_len == 0)
+            break;
+
+        size_t home = uid_hash(table[j].uid, table[j].uid_len) & AUTH_SLOT_MASK;
+        // Si home está cíclicamente en (i, j] el elemento sigue alcanzable donde está
+        bool reachable = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+        if (reachable)
+            continue;
+
+        table[i] = table[j];
+        mark_dirty(i);
+        i = j;
+    }
+    memset(&table[i], 0, sizeof(table[i]));
+    mark_dirty(i);
+    count--;
+}
+
+static esp_err_t save_dirty(void)
+{
+    esp_err_t err = ESP_OK;
+    char key[8];
+
+    for (size_t c = 0; c < AUTH_CHUNKS && err == ESP_OK; ++c)
+    {
+        if (!(dirty[c / 8] & (1u << (c % 8))))
+            continue;
+        snprintf(key, sizeof(key), "t%03u", (unsigned)c);
+        err = nvs_set_blob(nvs, key, &table[c * AUTH_CHUNK_SLOTS], AUTH_CHUNK_SLOTS * sizeof(auth_slot_t));
+        if (err == ESP_OK)
+            dirty[c / 8] &= (uint8_t)~(1u << (c % 8));
+    }
+    if (err == ESP_OK)
+        err = nvs_commit(nvs);
+    if (err != ESP_OK)
+        ESP_LOGE(TAG, "Failed to store tags: %s", esp_err_to_name(err));
+    return err;
+}
+
+// Dentro de un lote sólo se marcan los chunks; se escriben todos juntos al cerrarlo
+static esp_err_t store_changes(void)
+{
+    return batch ? ESP_OK : save_dirty();
+}
+
+static esp_err_t open_partition(void)
+{
+    esp_err_t err = nvs_flash_init_partition(CONFIG_SECURITY_AUTH_PARTITION);
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND)
+    {
+        ESP_LOGW(TAG, "Erasing partition %s (%s)", CONFIG_SECURITY_AUTH_PARTITION, esp_err_to_name(err));
+        if ((err = nvs_flash_erase_partition(CONFIG_SECURITY_AUTH_PARTITION)) == ESP_OK)
+            err = nvs_flash_init_partition(CONFIG_SECURITY_AUTH_PARTITION);
+    }
+    if (err != ESP_OK)
+        return err;
+
+    return nvs_open_from_partition(CONFIG_SECURITY_AUTH_PARTITION, AUTH_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+}
+
+/**
+ * @brief Lee un chunk guardado en dst.
+ * @return true si el blob existe y tiene el tamaño esperado; si no, dst queda en cero.
+ */
+static bool read_chunk(size_t c, auth_slot_t *dst)
+{
+    char key[8];
+    snprintf(key, sizeof(key), "t%03u", (unsigned)c);
+    size_t len = AUTH_CHUNK_SLOTS * sizeof(auth_slot_t);
+    if (nvs_get_blob(nvs, key, dst, &len) != ESP_OK || len != AUTH_CHUNK_SLOTS * sizeof(auth_slot_t))
+    {
+        memset(dst, 0, AUTH_CHUNK_SLOTS * sizeof(auth_slot_t));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Copia la tabla guardada tal cual, slot por slot.
+ * @return true si se cargó completa; false si faltó un chunk o había un slot inválido, en cuyo
+ *         caso quedarían huecos dentro de las secuencias de sondeo y hay que reconstruirla.
+ */
+static bool load_in_place(void)
+{
+    bool intact = true;
+    for (size_t c = 0; c < AUTH_CHUNKS; ++c)
+    {
+        auth_slot_t *dst = &table[c * AUTH_CHUNK_SLOTS];
+        if (!read_chunk(c, dst))
+        {
+            intact = false;
+            continue;
+        }
+        for (size_t s = 0; s < AUTH_CHUNK_SLOTS; ++s)
+        {
+            if (dst[s].uid_len == 0)
+                continue;
+            if (!valid_uid_len(dst[s].uid_len))
+                intact = false;
+            else
+                count++;
+        }
+    }
+    return intact;
+}
+
+/**
+ * @brief Reconstruye la tabla reinsertando las entradas válidas de una tabla de slots slots.
+ * @details Se usa al cambiar el tamaño y cuando hubo que descartar entradas: cada entrada vuelve
+ *          a su secuencia de sondeo, así ninguna queda inalcanzable detrás de un hueco.
+ */
+static esp_err_t rebuild_table(uint32_t slots)
+{
+    auth_slot_t *buf = malloc(AUTH_CHUNK_SLOTS * sizeof(auth_slot_t));
+    if (!buf)
+        return ESP_ERR_NO_MEM;
+
+    memset(table, 0, AUTH_SLOTS * sizeof(auth_slot_t));
+    count = 0;
+
+    const size_t chunks = slots / AUTH_CHUNK_SLOTS;
+    for (size_t c = 0; c < chunks; ++c)
+    {
+        (void)read_chunk(c, buf);
+        for (size_t s = 0; s < AUTH_CHUNK_SLOTS; ++s)
+        {
+            if (!valid_uid_len(buf[s].uid_len))
+                continue;
+            if (!insert_slot(&buf[s]))
+                ESP_LOGW(TAG, "Table full while rebuilding, tag dropped");
+        }
+
+        // Los chunks que sobran de una tabla más grande se borran
+        if (c >= AUTH_CHUNKS)
+        {
+            char key[8];
+            snprintf(key, sizeof(key), "t%03u", (unsigned)c);
+            (void)nvs_erase_key(nvs, key);
+        }
+    }
+    free(buf);
+    return ESP_OK;
+}
+
+/**
+ * @brief Carga la tabla guardada. Si fue guardada con otro tamaño o está dañada, la reconstruye.
+ * @return ESP_OK si había tabla, ESP_ERR_NVS_NOT_FOUND si el almacén es nuevo.
+ */
+static esp_err_t load_table(void)
+{
+    auth_meta_t meta;
+    size_t len = sizeof(meta);
+    esp_err_t err = nvs_get_blob(nvs, AUTH_NVS_META, &meta, &len);
+    if (err != ESP_OK || len != sizeof(meta) || meta.version != AUTH_META_VERSION ||
+        meta.chunk_slots != AUTH_CHUNK_SLOTS)
+        return ESP_ERR_NVS_NOT_FOUND;
+
+    if (meta.slots == AUTH_SLOTS)
+    {
+        if (load_in_place())
+            return ESP_OK;
+        ESP_LOGW(TAG, "Stored table damaged, rebuilding it");
+    }
+    else
+    {
+        ESP_LOGW(TAG, "Table resized from %lu to %d slots", (unsigned long)meta.slots, AUTH_SLOTS);
+    }
+
+    if ((err = rebuild_table(meta.slots)) != ESP_OK)
+        return err;
+
+    memset(dirty, 0xFF, sizeof(dirty));
+    meta.slots = AUTH_SLOTS;
+    if ((err = nvs_set_blob(nvs, AUTH_NVS_META, &meta, sizeof(meta))) != ESP_OK) return err;
+    return save_dirty();
+}
+
+static void release(void)
+{
+    free(table);
+    table = NULL;
+    count = 0;
+    if (lock) vSemaphoreDelete(lock);
+    lock = NULL;
+    if (nvs) nvs_close(nvs);
+    nvs = 0;
+}
+
+esp_err_t security_auth_start(const security_auth_entry_t *defaults, size_t n)
+{
+    if (table) return ESP_OK;
+
+    lock = xSemaphoreCreateMutex();
+    table = calloc(AUTH_SLOTS, sizeof(auth_slot_t));
+    if (!lock || !table)
+    {
+        release();
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = open_partition();
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Cannot open partition %s: %s", CONFIG_SECURITY_AUTH_PARTITION, esp_err_to_name(err));
+        release();
+        return err;
+    }
+
+    err = load_table();
+    if (err == ESP_ERR_NVS_NOT_FOUND)
+    {
+        ESP_LOGI(TAG, "New tag store, seeding %u default tags", (unsigned)n);
+        for (size_t i = 0; defaults && i < n; ++i)
+        {
+            if (!valid_uid_len(defaults[i].uid_len))
+                continue;
+            auth_slot_t slot = { .valid_from = defaults[i].valid_from, .valid_until = defaults[i].valid_until,
+                                 .uid_len = defaults[i].uid_len };
+            memcpy(slot.uid, defaults[i].uid, slot.uid_len);
+            (void)insert_slot(&slot);
+        }
+
+        auth_meta_t meta = { .version = AUTH_META_VERSION, .chunk_slots = AUTH_CHUNK_SLOTS, .slots = AUTH_SLOTS };
+        memset(dirty, 0xFF, sizeof(dirty));
+        err = nvs_set_blob(nvs, AUTH_NVS_META, &meta, sizeof(meta));
+        if (err == ESP_OK)
+            err = save_dirty();
+    }
+    if (err != ESP_OK)
+    {
+        release();
+        return err;
+    }
+
+    ESP_LOGI(TAG, "Tag store ready: %u tags, %d slots (%u KB)", (unsigned)count, AUTH_SLOTS,
+             (unsigned)(AUTH_SLOTS * sizeof(auth_slot_t) / 1024));
+    return ESP_OK;
+}
+
+esp_err_t security_auth_stop(void)
+{
+    if (!table) return ESP_OK;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    esp_err_t err = batch ? save_dirty() : ESP_OK;
+    batch = false;
+    xSemaphoreGive(lock);
+    release();
+    return err;
+}
+
+security_auth_result_t security_auth_check(const uint8_t *uid, size_t uid_len)
+{
+    if (!table || !uid || !valid_uid_len(uid_len))
+        return SECURITY_AUTH_UNKNOWN;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool found;
+    size_t i = probe(uid, uid_len, &found);
+    auth_slot_t slot = table[i];
+    xSemaphoreGive(lock);
+
+    if (!found)
+        return SECURITY_AUTH_UNKNOWN;
+    if (slot.valid_from == 0 && slot.valid_until == 0)
+        return SECURITY_AUTH_GRANTED;
+
+    time_t now = time(NULL);
+    if (now < AUTH_CLOCK_SET)
+        return SECURITY_AUTH_NO_CLOCK;
+    if (slot.valid_from && now < (time_t)slot.valid_from)
+        return SECURITY_AUTH_NOT_YET_VALID;
+    if (slot.valid_until && now > (time_t)slot.valid_until)
+        return SECURITY_AUTH_EXPIRED;
+    return SECURITY_AUTH_GRANTED;
+}
+
+void security_auth_batch_begin(void)
+{
+    if (!table) return;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    batch = true;
+    xSemaphoreGive(lock);
+}
+
+esp_err_t security_auth_batch_end(void)
+{
+    if (!table) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    batch = false;
+    esp_err_t err = save_dirty();
+    xSemaphoreGive(lock);
+    return err;
+}
+
+esp_err_t security_auth_add(const security_auth_entry_t *entry)
+{
+    if (!entry || !valid_uid_len(entry->uid_len)) return ESP_ERR_INVALID_ARG;
+    if (entry->valid_from && entry->valid_until && entry->valid_until < entry->valid_from) return ESP_ERR_INVALID_ARG;
+    if (!table) return ESP_ERR_INVALID_STATE;
+
+    auth_slot_t slot = { .valid_from = entry->valid_from, .valid_until = entry->valid_until, .uid_len = entry->uid_len };
+    memcpy(slot.uid, entry->uid, entry->uid_len);
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    esp_err_t err = insert_slot(&slot) ? store_changes() : ESP_ERR_NO_MEM;
+    xSemaphoreGive(lock);
+    return err;
+}
+
+esp_err_t security_auth_remove(const uint8_t *uid, size_t uid_len)
+{
+    if (!uid || !valid_uid_len(uid_len)) return ESP_ERR_INVALID_ARG;
+    if (!table) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool found;
+    size_t i = probe(uid, uid_len, &found);
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    if (found)
+    {
+        delete_slot(i);
+        err = store_changes();
+    }
+    xSemaphoreGive(lock);
+    return err;
+}
+
+esp_err_t security_auth_clear(void)
+{
+    if (!table) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    memset(table, 0, AUTH_SLOTS * sizeof(auth_slot_t));
+    count = 0;
+    memset(dirty, 0xFF, sizeof(dirty));
+    esp_err_t err = store_changes();
+    xSemaphoreGive(lock);
+    return err;
+}
+
+size_t security_auth_count(void)
+{
+    if (!table) return 0;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    size_t n = count;
+    xSemaphoreGive(lock);
+    return n;
+}
@@ -11,7 +11,6 @@
 #include "security_ao_fsm.h"
 #include "security_watcher.h"
 
-#define WATCHER_INTERVAL_MS 1500
 
 static const char *TAG = "security_module";
 
@@ -85,7 +84,7 @@ esp_err_t security_watchers_start(ao_fsm_t* security_fsm)
 {
     ESP_LOGI(TAG, "Starting security watchers...");
 
-    ao_fsm_watcher_t* watcher = ao_fsm_watcher_start(security_fsm, WATCHER_INTERVAL_MS);
+    ao_fsm_watcher_t* watcher = ao_fsm_watcher_start(security_fsm, SECURITY_WATCHER_INTERVAL_MS);
 
     if(watcher == NULL) 
     {
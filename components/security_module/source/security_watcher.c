@@ -1,71 +1,137 @@
 #include <string.h>
+#include <stdio.h>
 
 #include "esp_log.h"
 #include "esp_err.h"
+#include "esp_timer.h"
 
 #include "security_watcher.h"
 #include "security_ao_fsm.h"
 #include "i2c_mgmt_driver.h"
 #include "i2c_mcp23017.h"
 #include "i2c_pn532.h"
+#include "security_auth.h"
+
+#ifndef CONFIG_SECURITY_PN532_I2C_PORT
+#define CONFIG_SECURITY_PN532_I2C_PORT 0
+#endif
+#ifndef CONFIG_SECURITY_PN532_I2C_SDA
+#define CONFIG_SECURITY_PN532_I2C_SDA 21
+#endif
+#ifndef CONFIG_SECURITY_PN532_I2C_SCL
+#define CONFIG_SECURITY_PN532_I2C_SCL 22
+#endif
+#ifndef CONFIG_SECURITY_PN532_IRQ_GPIO
+#define CONFIG_SECURITY_PN532_IRQ_GPIO -1
+#endif
+#ifndef CONFIG_SECURITY_PN532_AUTOPOLL
+#define CONFIG_SECURITY_PN532_AUTOPOLL 0
+#endif
+#ifndef CONFIG_SECURITY_PN532_AUTOPOLL_PERIOD
+#define CONFIG_SECURITY_PN532_AUTOPOLL_PERIOD 2
+#endif
+#ifndef CONFIG_SECURITY_TAG_DEPARTURE_MISSES
+#define CONFIG_SECURITY_TAG_DEPARTURE_MISSES 2
+#endif
+#ifndef CONFIG_SECURITY_TAG_INVALID_STRIKES
+#define CONFIG_SECURITY_TAG_INVALID_STRIKES 3
+#endif
+#ifndef CONFIG_SECURITY_TAG_LOCKOUT_MS
+#define CONFIG_SECURITY_TAG_LOCKOUT_MS 5000
+#endif
+#ifndef CONFIG_SECURITY_TAG_LOCKOUT_MAX_MS
+#define CONFIG_SECURITY_TAG_LOCKOUT_MAX_MS 60000
+#endif
 
 static const char *TAG = "security_watcher";
 
-#define TAG_SIZE 4
-#define MAX_VALID_TAGS 3
 #define PANIC_BUTTON_MASK 0x01  // Assuming panic button is connected to GPA0
 #define PIR_SENSOR_MASK   0x02  // Assuming PIR sensor is connected to GPA1
-#define LIGHTS_MASK       0x04  // Assuming lights control is connected to GPA4
-#define SIREN_MASK        0x05  // Assuming siren control is connected to GPA5 
+#define LIGHTS_MASK       0x10  // Assuming lights control is connected to GPA4
+#define SIREN_MASK        0x20  // Assuming siren control is connected to GPA5
 
-uint8_t valid_tags[MAX_VALID_TAGS][TAG_SIZE] = {
-    { 0xFF, 0xFF, 0xFF, 0xFF },
-    { 0xEA, 0xEE, 0x85, 0x6A },
-    { 0x40, 0x8B, 0xE6, 0x30 }
-};
+// Con InAutoPoll un tag quieto se informa una vez por búsqueda del PN532, que se rearma en cada
+// ciclo del watcher: entre dos informes pasa el mayor de ambos periodos. La salida se decide por
+// el tiempo desde el último informe, con medio ciclo de margen para la búsqueda y el jitter
+#define AUTOPOLL_PERIOD_MS       (CONFIG_SECURITY_PN532_AUTOPOLL_PERIOD * 150)
+#define TAG_REPORT_INTERVAL_MS   (AUTOPOLL_PERIOD_MS > SECURITY_WATCHER_INTERVAL_MS ? AUTOPOLL_PERIOD_MS : SECURITY_WATCHER_INTERVAL_MS)
+#define TAG_AUTOPOLL_DEPARTURE_US \
+    ((int64_t)(CONFIG_SECURITY_TAG_DEPARTURE_MISSES * TAG_REPORT_INTERVAL_MS + SECURITY_WATCHER_INTERVAL_MS / 2) * 1000)
+
+static bool tag_autopoll = false; // el PN532 detecta los tags por su cuenta (InAutoPoll + IRQ)
 
 /**
- * @brief Validates a tag against the list of valid tags.
- * @details This function checks if the provided tag matches any of the valid tags.
- * @param tag Pointer to the tag data to validate.
- * @param len Length of the tag data. Must be equal to TAG_SIZE.
- * @return true if the tag is valid, false otherwise.
+ * @brief Seguimiento del tag presente en el lector.
+ * @details Una presentación genera un solo evento de llegada (VALID/INVALID_TAG_EVENT) y uno
+ *          de salida (TAG_REMOVED_EVENT). Mientras el tag sigue en el campo no se vuelve a
+ *          validar ni a publicar nada.
  */
-static bool security_tagValidation(uint8_t* tag, size_t len)
+static struct {
+    uint8_t uid[SECURITY_AUTH_UID_MAX];
+    size_t uid_len;        // 0 = no hay tag presente
+    uint8_t tg;            // número lógico del target en el PN532
+    uint8_t misses;        // ciclos consecutivos sin ver el tag (sondeo desde el host)
+    int64_t last_seen_us;  // último informe del tag (InAutoPoll)
+} tag_presence;
+
+static uint8_t tag_invalid_strikes = 0; // tags inválidos seguidos
+static int64_t tag_lockout_until = 0;   // hasta cuándo se ignoran los tags (us de esp_timer)
+
+// Tags con los que se siembra el almacén la primera vez; después se gestionan por MQTT
+static const security_auth_entry_t DEFAULT_TAGS[] = {
+    { .uid = { 0xFF, 0xFF, 0xFF, 0xFF }, .uid_len = 4 },
+    { .uid = { 0xEA, 0xEE, 0x85, 0x6A }, .uid_len = 4 },
+    { .uid = { 0x40, 0x8B, 0xE6, 0x30 }, .uid_len = 4 },
+};
+
+esp_err_t security_watcher_devices_start(void)
 {
-    if(tag == NULL || len != TAG_SIZE) 
+    esp_err_t err = security_auth_start(DEFAULT_TAGS, sizeof(DEFAULT_TAGS) / sizeof(DEFAULT_TAGS[0]));
+    if(err != ESP_OK) 
     {
-        ESP_LOGE(TAG, "Invalid parameters in security_tagValidation");
-        return false;
+        ESP_LOGE(TAG, "Failed to start tag store. err=%s (0x%x)", esp_err_to_name(err), err);
+        return err;
     }
 
-    for(int i = 0; i < MAX_VALID_TAGS; i++) 
-        if(memcmp(tag, valid_tags[i], TAG_SIZE) == 0) 
-            return true;
-
-    return false;
-}
-
-esp_err_t security_watcher_devices_start(void)
-{
     ESP_LOGI(TAG, "Initializing I2C manager for security watcher devices");
-    esp_err_t err = i2c_mgmt_start(I2C_NUM_0, GPIO_NUM_21, GPIO_NUM_22);
+    i2c_mgmt_handle_t mcp_bus = NULL;
+    err = i2c_mgmt_start(I2C_NUM_0, GPIO_NUM_21, GPIO_NUM_22, &mcp_bus);
     if(err != ESP_OK) 
     {
         ESP_LOGE(TAG, "Failed to start I2C manager. err=%s (0x%x)", esp_err_to_name(err), err);
         return err;
     }
 
+    // El PN532 puede ir en un bus propio (p.ej. LP I2C en el C6); por defecto comparte el del MCP23017
+    i2c_mgmt_handle_t pn532_bus = NULL;
+    err = i2c_mgmt_start((i2c_port_t)CONFIG_SECURITY_PN532_I2C_PORT, (gpio_num_t)CONFIG_SECURITY_PN532_I2C_SDA,
+                         (gpio_num_t)CONFIG_SECURITY_PN532_I2C_SCL, &pn532_bus);
+    if(err != ESP_OK) 
+    {
+        ESP_LOGE(TAG, "Failed to start PN532 I2C bus. err=%s (0x%x)", esp_err_to_name(err), err);
+        return err;
+    }
+
     ESP_LOGI(TAG, "PN532 NFC module initialized");
-    err = i2c_pn532_start();
+    err = i2c_pn532_start(pn532_bus, I2C_MGMT_SPEED_STANDARD, (gpio_num_t)CONFIG_SECURITY_PN532_IRQ_GPIO);
     if(err != ESP_OK) 
     {
         ESP_LOGE(TAG, "Failed to start PN532 RFID reader. err=%s (0x%x)", esp_err_to_name(err), err);
         return err;
     }
 
+#if CONFIG_SECURITY_PN532_AUTOPOLL
+    // El PN532 busca tags solo y avisa por IRQ; si no se puede, se sigue sondeando desde el host
+    err = i2c_pn532_autopoll_start(CONFIG_SECURITY_PN532_AUTOPOLL_PERIOD);
+    tag_autopoll = (err == ESP_OK);
+    if(err != ESP_OK) 
+    {
+        ESP_LOGW(TAG, "PN532 automatic detection unavailable, polling instead. err=%s (0x%x)", esp_err_to_name(err), err);
+    }
+#endif
+
     ESP_LOGI(TAG, "MCP23017 I/O expander initialized");
-    err = i2c_mcp23017_start(0x20, 1000);
+    err = i2c_mcp23017_start(mcp_bus, 0x20, I2C_MGMT_SPEED_FAST, 50);
     if(err != ESP_OK) 
     {
         ESP_LOGE(TAG, "Failed to start MCP23017 I/O expander. err=%s (0x%x)", esp_err_to_name(err), err);
@@ -81,11 +147,120 @@ esp_err_t security_watcher_devices_start(void)
     return ESP_OK;
 }
 
+/**
+ * @brief Comprueba si el tag seguido sigue en el campo.
+ * @details Sin InAutoPoll se re-selecciona el target (InDeselect + InSelect), más barato que otra
+ *          lectura. Con InAutoPoll el PN532 vuelve a informar el tag en cada búsqueda; si informa
+ *          otro distinto, queda en tag/tag_len para tratarlo como llegada.
+ * @return true si el tag seguido sigue presente.
+ */
+static bool security_tagStillPresent(uint8_t* tag, size_t* tag_len)
+{
+    esp_err_t err;
+    bool present = false;
+
+    if(tag_autopoll) 
+    {
+        err = i2c_pn532_autopoll_fetch(tag, tag_len);
+        if(err == ESP_OK && *tag_len != 0) 
+            present = (*tag_len == tag_presence.uid_len && memcmp(tag, tag_presence.uid, *tag_len) == 0);
+    }
+    else
+    {
+        *tag_len = 0;
+        err = i2c_pn532_target_present(tag_presence.tg, &present);
+    }
+
+    if(err != ESP_OK) 
+    {
+        // Un error de bus no cuenta como salida
+        ESP_LOGE(TAG, "Failed to check tag presence. err=%s (0x%x)", esp_err_to_name(err), err);
+        *tag_len = 0;
+        return true;
+    }
+    return present;
+}
+
+/**
+ * @brief Decide si el tag seguido, que no se vio en este ciclo, dejó el campo.
+ * @details Sondeando desde el host cada ciclo es una comprobación: bastan
+ *          CONFIG_SECURITY_TAG_DEPARTURE_MISSES fallos seguidos. Con InAutoPoll un ciclo sin
+ *          informe no dice nada si la búsqueda del PN532 es más lenta que el watcher, así que
+ *          cuenta el tiempo desde el último informe (TAG_AUTOPOLL_DEPARTURE_US).
+ */
+static bool security_tagDeparted(void)
+{
+    if(tag_autopoll) 
+        return esp_timer_get_time() - tag_presence.last_seen_us > TAG_AUTOPOLL_DEPARTURE_US;
+    return ++tag_presence.misses >= CONFIG_SECURITY_TAG_DEPARTURE_MISSES;
+}
+
+/**
+ * @brief Registra un intento con tag inválido y bloquea el lector si se repiten.
+ * @details Desde CONFIG_SECURITY_TAG_INVALID_STRIKES intentos seguidos el lector ignora los tags
+ *          durante un tiempo que se duplica con cada intento nuevo, hasta CONFIG_SECURITY_TAG_LOCKOUT_MAX_MS.
+ */
+static void security_tagInvalidStrike(void)
+{
+    if(tag_invalid_strikes < UINT8_MAX) 
+        tag_invalid_strikes++;
+    if(tag_invalid_strikes < CONFIG_SECURITY_TAG_INVALID_STRIKES) 
+        return;
+
+    uint32_t shift = tag_invalid_strikes - CONFIG_SECURITY_TAG_INVALID_STRIKES;
+    int64_t lockout_ms = CONFIG_SECURITY_TAG_LOCKOUT_MAX_MS;
+    if(shift < 16 && ((int64_t)CONFIG_SECURITY_TAG_LOCKOUT_MS << shift) < lockout_ms) 
+        lockout_ms = (int64_t)CONFIG_SECURITY_TAG_LOCKOUT_MS << shift;
+
+    tag_lockout_until = esp_timer_get_time() + lockout_ms * 1000;
+    ESP_LOGW(TAG, "%u invalid tags in a row, ignoring the reader for %lld ms",
+             (unsigned)tag_invalid_strikes, (long long)lockout_ms);
+}
+
 void security_tagReader(ao_fsm_t* fsm)
 {
-    uint8_t tag[TAG_SIZE] = {0};
-    size_t tag_len = TAG_SIZE;
-    esp_err_t err = i2c_pn532_read_passive_target(tag, &tag_len);
+    // Con dos tarjetas juntas se resuelven ambas en un solo InListPassiveTarget
+    i2c_pn532_target_t targets[I2C_PN532_MAX_TARGETS] = {0};
+    size_t count = 0;
+    esp_err_t err = ESP_OK;
+
+    if(tag_presence.uid_len != 0) 
+    {
+        size_t tag_len = sizeof(targets[0].id);
+        if(security_tagStillPresent(targets[0].id, &tag_len)) 
+        {
+            tag_presence.misses = 0;
+            tag_presence.last_seen_us = esp_timer_get_time();
+            return;
+        }
+        if(tag_len == 0 && !security_tagDeparted()) 
+            return;
+
+        // Salida: el tag dejó el campo (o con InAutoPoll apareció otro)
+        ESP_LOGI(TAG, "Tag removed from the reader");
+        tag_presence.uid_len = 0;
+        if(!tag_autopoll) 
+            (void)i2c_pn532_release();
+        ao_fsm_post(fsm, TAG_REMOVED_EVENT, NULL, 0);
+
+        if(tag_len == 0) 
+            return;
+        targets[0].id_len = (uint8_t)tag_len;
+        targets[0].tg = 1;
+        count = 1;
+    }
+    else if(tag_autopoll) 
+    {
+        size_t tag_len = sizeof(targets[0].id);
+        err = i2c_pn532_autopoll_fetch(targets[0].id, &tag_len);
+        targets[0].id_len = (uint8_t)tag_len;
+        targets[0].tg = 1;
+        count = (tag_len != 0);
+    }
+    else
+    {
+        err = i2c_pn532_list_targets(I2C_PN532_TYPE_106A, I2C_PN532_MAX_TARGETS, targets, &count);
+    }
 
     if(err != ESP_OK) 
     {
@@ -93,20 +268,55 @@ void security_tagReader(ao_fsm_t* fsm)
         return;
     }
 
-    if(tag_len != 0 && tag_len == TAG_SIZE) 
+    if(count == 0) 
+        return;
+
+    if(esp_timer_get_time() < tag_lockout_until) 
     {
-       bool is_valid = security_tagValidation(tag, TAG_SIZE);
+        // Bloqueado por intentos inválidos: no se sigue el tag, cuenta como nuevo al terminar
+        ESP_LOGD(TAG, "Tag ignored, reader locked out");
+        if(!tag_autopoll) 
+            (void)i2c_pn532_release();
+        return;
+    }
 
-       if(is_valid) 
-       {
-           ESP_LOGI(TAG, "Valid tag read: %02X %02X %02X %02X", tag[0], tag[1], tag[2], tag[3]);
-           ao_fsm_post(fsm, VALID_TAG_EVENT, NULL, 0);
-       } 
-       else 
-       {
-           ESP_LOGW(TAG, "Invalid tag read: %02X %02X %02X %02X", tag[0], tag[1], tag[2], tag[3]);
-           ao_fsm_post(fsm, INVALID_TAG_EVENT, NULL, 0);
-       }
+    // Si hay dos tarjetas, manda la autorizada
+    size_t chosen = 0;
+    security_auth_result_t result = security_auth_check(targets[0].id, targets[0].id_len);
+    for(size_t i = 1; i < count && result != SECURITY_AUTH_GRANTED; i++) 
+    {
+        security_auth_result_t other = security_auth_check(targets[i].id, targets[i].id_len);
+        if(other == SECURITY_AUTH_GRANTED) 
+        {
+            chosen = i;
+            result = other;
+        }
+    }
+    const i2c_pn532_target_t *tag = &targets[chosen];
+
+    // Llegada: un solo evento por presentación
+    memcpy(tag_presence.uid, tag->id, tag->id_len);
+    tag_presence.uid_len = tag->id_len;
+    tag_presence.tg = tag->tg;
+    tag_presence.misses = 0;
+    tag_presence.last_seen_us = esp_timer_get_time();
+
+    char uid_str[3 * SECURITY_AUTH_UID_MAX] = {0};
+    for(size_t i = 0; i < tag->id_len; i++) 
+        snprintf(&uid_str[3 * i], sizeof(uid_str) - 3 * i, "%02X ", tag->id[i]);
+    uid_str[3 * tag->id_len - 1] = '\0';
+
+    if(result == SECURITY_AUTH_GRANTED) 
+    {
+        ESP_LOGI(TAG, "Valid tag read: %s (%u in field)", uid_str, (unsigned)count);
+        tag_invalid_strikes = 0;
+        ao_fsm_post(fsm, VALID_TAG_EVENT, NULL, 0);
+    } 
+    else 
+    {
+        ESP_LOGW(TAG, "Invalid tag read: %s (reason %d, %u in field)", uid_str, (int)result, (unsigned)count);
+        security_tagInvalidStrike();
+        ao_fsm_post(fsm, INVALID_TAG_EVENT, NULL, 0);
     }
 }
 
@@ -167,60 +377,51 @@ void security_pirSensorReader(ao_fsm_t* fsm)
 }
 
 
-void security_turnLights_on(void)
+// Cada salida es una sola escritura de OLATA; las demás salidas del puerto no se tocan
+static void set_alarm_outputs(uint8_t set_mask, uint8_t clear_mask, const char *what)
 {
-    ESP_LOGI(TAG, "Turning on security lights");
-    uint8_t gpioa4_state = 0;
-
-    gpioa4_state |= (1<<LIGHTS_MASK); // Set lights bit high
-    esp_err_t err = i2c_mcp23017_write_gpioa_outputs(gpioa4_state);
+    esp_err_t err = i2c_mcp23017_modify_outputs(MCP23017_PORT_A, set_mask, clear_mask);
 
     if(err != ESP_OK) 
     {
-        ESP_LOGE(TAG, "Failed to turn on security lights. err=%s (0x%x)", esp_err_to_name(err), err);
+        ESP_LOGE(TAG, "Failed to turn %s. err=%s (0x%x)", what, esp_err_to_name(err), err);
     }
 }
 
+void security_turnLights_on(void)
+{
+    ESP_LOGI(TAG, "Turning on security lights");
+    set_alarm_outputs(LIGHTS_MASK, 0, "on security lights");
+}
+
 void security_turnLights_off(void)
 {
     ESP_LOGI(TAG, "Turning off security lights");
-    uint8_t gpioa4_state = 0;
-
-    gpioa4_state &= ~(1<<LIGHTS_MASK); // Set lights bit low
-    esp_err_t err = i2c_mcp23017_write_gpioa_outputs(gpioa4_state);
-
-    if(err != ESP_OK) 
-    {
-        ESP_LOGE(TAG, "Failed to turn off security lights. err=%s (0x%x)", esp_err_to_name(err), err);
-    }
+    set_alarm_outputs(0, LIGHTS_MASK, "off security lights");
 }
 
 void security_turnSiren_on(void)
 {
     ESP_LOGI(TAG, "Turning on security siren");
-    uint8_t gpioa5_state = 0;
-
-    gpioa5_state |= (1<<SIREN_MASK); // Set siren bit high
-    esp_err_t err = i2c_mcp23017_write_gpioa_outputs(gpioa5_state);
-
-    if(err != ESP_OK) 
-    {
-        ESP_LOGE(TAG, "Failed to turn on security siren. err=%s (0x%x)", esp_err_to_name(err), err);
-    }
+    set_alarm_outputs(SIREN_MASK, 0, "on security siren");
 }
 
 void security_turnSiren_off(void)
 {
     ESP_LOGI(TAG, "Turning off security siren");
-    uint8_t gpioa5_state = 0;
+    set_alarm_outputs(0, SIREN_MASK, "off security siren");
+}
 
-    gpioa5_state &= ~(1<<SIREN_MASK); // Set siren bit low
-    esp_err_t err = i2c_mcp23017_write_gpioa_outputs(gpioa5_state);
+void security_turnLightsAndSiren_on(void)
+{
+    ESP_LOGI(TAG, "Turning on security lights and siren");
+    set_alarm_outputs(LIGHTS_MASK | SIREN_MASK, 0, "on security lights and siren");
+}
 
-    if(err != ESP_OK) 
-    {
-        ESP_LOGE(TAG, "Failed to turn off security siren. err=%s (0x%x)", esp_err_to_name(err), err);
-    }
+void security_turnLightsAndSiren_off(void)
+{
+    ESP_LOGI(TAG, "Turning off security lights and siren");
+    set_alarm_outputs(0, LIGHTS_MASK | SIREN_MASK, "off security lights and siren");
 }
 
 
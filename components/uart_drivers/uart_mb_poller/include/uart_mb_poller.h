@@ -0,0 +1,181 @@
+#ifndef UART_MB_POLLER_H
+#define UART_MB_POLLER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "driver/uart.h"
+#include "driver/gpio.h"
+#include "esp_err.h"
+#include "mbcontroller.h"
+
+/**
+ * @file uart_mb_poller.h
+ * @brief Descriptor-driven cyclic acquisition for the Modbus RTU slaves on one segment.
+ * @details The registers to acquire are described as points (slave, register type, address,
+ *          data type, scale, unit and poll period). The poller keeps its own point table, not
+ *          the parameter descriptor table of the Modbus master, and merges the points of one
+ *          slave, function and period that lie close together into a single raw read request.
+ *          A service task issues the requests that are due back to back: the next one goes out
+ *          as soon as the previous response ends, so the only idle time on the line is the RTU
+ *          inter-frame gap (t3.5) that the Modbus stack enforces. Each response is decoded
+ *          right away into the point table as scaled integers, which readers copy at any time
+ *          without touching the bus.
+ *
+ *          Points can also be loaded from a text table, one per line:
+ *          @code
+ *          # key, unit, slave, function, register, type, scale_num, scale_den, period_ms
+ *          pump.flow, l/h, 7, 4, 0x0010, u32_abcd, 1, 10, 5000
+ *          @endcode
+ *          function is 3 (holding) or 4 (input); type is u16, i16, u32_abcd, u32_cdab, i32_abcd or
+ *          i32_cdab (abcd = high word first, cdab = low word first).
+ *
+ *          The poller measures every request. The latency of each slave (round-trip time minus
+ *          the line time of both frames) is smoothed as in TCP (EWMA of the mean with gain 1/8
+ *          and of the deviation with gain 1/4), and the response timeout of the next request is
+ *          the line time of its response plus the mean plus four deviations, clamped between
+ *          CONFIG_UART_MB_TIMEOUT_MIN_MS and CONFIG_UART_MB_TIMEOUT_MAX_MS. A timeout doubles the
+ *          latency allowance until the slave answers again, and a slave that stays silent is
+ *          skipped for a pause that doubles up to CONFIG_UART_MB_BACKOFF_MAX_MS.
+ *
+ * @author Roberto Axt
+ * @version 1.2
+ * @date 2025-11-19
+ *
+ * @par License
+ * This file is part of the SMEM-MP project and is licensed under the MIT License.
+ */
+
+#define UART_MB_POLL_MAX_REGS    32  /**< Largest merged read request, in registers */
+#define UART_MB_POINT_KEY_MAX    24  /**< Longest point key, with the terminator */
+#define UART_MB_POINT_UNIT_MAX   8   /**< Longest point unit, with the terminator */
+#define UART_MB_SLAVES_MAX       32  /**< Slaves with statistics (slaves of the points) */
+
+/**
+ * @brief Description of a point.
+ * @details The decoded value is raw * scale_num / scale_den, as an integer in the given unit.
+ */
+typedef struct {
+    const char *key;          /**< Unique name (copied) */
+    const char *unit;         /**< Unit of the decoded value (copied) */
+    uint8_t slave_addr;       /**< Slave address (1 to 247) */
+    mb_param_type_t reg_type; /**< MB_PARAM_HOLDING or MB_PARAM_INPUT */
+    uint16_t reg_start;       /**< First register */
+    mb_descr_type_t type;     /**< PARAM_TYPE_U16, PARAM_TYPE_I16_AB, PARAM_TYPE_U32_ABCD, PARAM_TYPE_U32_CDAB,
+                                   PARAM_TYPE_I32_ABCD or PARAM_TYPE_I32_CDAB */
+    int32_t scale_num;        /**< Scale numerator */
+    int32_t scale_den;        /**< Scale denominator, not 0 */
+    uint32_t period_ms;       /**< Time between two reads; 0 reads on every pass */
+} uart_mb_point_desc_t;
+
+/**
+ * @brief Latest value of a point.
+ */
+typedef struct {
+    const char *key;      /**< Point key */
+    const char *unit;     /**< Point unit */
+    int32_t value;        /**< Scaled value of the last successful read */
+    esp_err_t status;     /**< Result of the last read, ESP_ERR_INVALID_STATE before the first */
+    int64_t updated_us;   /**< esp_timer time of the last successful read, 0 if never */
+} uart_mb_point_t;
+
+/**
+ * @brief Link statistics of a slave.
+ */
+typedef struct {
+    uint8_t slave_addr;         /**< Slave address */
+    uint32_t rtt_us;            /**< Round-trip time of the last answered request, 0 if none */
+    uint32_t srtt_us;           /**< Smoothed latency (round-trip time minus line time) */
+    uint32_t rttvar_us;         /**< Smoothed latency deviation */
+    uint32_t timeout_ms;        /**< Response timeout of the last request */
+    uint32_t requests;          /**< Requests sent */
+    uint32_t timeouts;          /**< Requests without response */
+    uint32_t crc_errors;        /**< Responses rejected (bad CRC or frame, exception) */
+    uint32_t backoff_ms;        /**< Current pause of a silent slave, 0 if it answers */
+} uart_mb_slave_stats_t;
+
+/**
+ * @brief Creates the Modbus RTU master on a UART and starts the acquisition task.
+ * @details The task stays idle until points are added.
+ * @param uart_num UART port of the RS-485 segment.
+ * @param tx_io_num GPIO for UART TX.
+ * @param rx_io_num GPIO for UART RX.
+ * @param baudrate Line speed.
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if already started, or another error code.
+ */
+esp_err_t uart_mb_poller_start(uart_port_t uart_num, gpio_num_t tx_io_num, gpio_num_t rx_io_num,
+                               uint32_t baudrate);
+
+/**
+ * @brief Adds points to the acquisition.
+ * @details The merged requests are rebuilt; the new
+ *          points are read on the next pass.
+ * @param points Points to add.
+ * @param count Number of points.
+ * @param first Index of the first added point (may be NULL). The others follow in order.
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for a bad or duplicated point, ESP_ERR_NO_MEM
+ *         if the table is full (CONFIG_UART_MB_POINTS_MAX), or ESP_ERR_INVALID_STATE if the
+ *         poller is not started.
+ */
+esp_err_t uart_mb_points_add(const uart_mb_point_desc_t *points, size_t count, size_t *first);
+
+/**
+ * @brief Adds the points of a text table (see the file description).
+ * @details Empty lines and lines starting with '#' are skipped. A bad line is logged and
+ *          skipped, the rest of the table is still loaded.
+ * @param table Text of the table.
+ * @param added Number of points added (may be NULL).
+ * @return ESP_OK if every line was loaded, ESP_ERR_INVALID_ARG if some line was skipped, or
+ *         the error of uart_mb_points_add().
+ */
+esp_err_t uart_mb_points_load(const char *table, size_t *added);
+
+/**
+ * @brief Looks a point up by key.
+ * @param key Point key.
+ * @param index Where the index is stored.
+ * @return ESP_OK on success, or ESP_ERR_NOT_FOUND.
+ */
+esp_err_t uart_mb_points_find(const char *key, size_t *index);
+
+/**
+ * @brief Gets the number of points.
+ * @return Number of points.
+ */
+size_t uart_mb_points_count(void);
+
+/**
+ * @brief Copies the latest value of a point.
+ * @param index Point index, in the order the points were added.
+ * @param point Where the value is copied.
+ * @return ESP_OK on success, or ESP_ERR_INVALID_ARG.
+ */
+esp_err_t uart_mb_point_get(size_t index, uart_mb_point_t *point);
+
+/**
+ * @brief Gets the number of slaves with statistics.
+ * @return Number of slaves, one per slave address used by the points.
+ */
+size_t uart_mb_slaves_count(void);
+
+/**
+ * @brief Copies the link statistics of a slave.
+ * @param index Slave index, from 0 to uart_mb_slaves_count() - 1.
+ * @param stats Where the statistics are copied.
+ * @return ESP_OK on success, or ESP_ERR_INVALID_ARG.
+ */
+esp_err_t uart_mb_slave_stats_get(size_t index, uart_mb_slave_stats_t *stats);
+
+/**
+ * @brief Sends a one-off request (a write, a vendor command) between two polled requests.
+ * @details The request waits for the one in progress and never overlaps a polled one. It uses
+ *          the response timeout of its slave and counts in its statistics, but it is sent even
+ *          if the slave is paused.
+ * @param request Request to send.
+ * @param data Buffer for the request data or the response.
+ * @return Result of mbc_master_send_request(), or ESP_ERR_INVALID_STATE if not started.
+ */
+esp_err_t uart_mb_poller_request(mb_param_request_t *request, void *data);
+
+#endif // UART_MB_POLLER_H
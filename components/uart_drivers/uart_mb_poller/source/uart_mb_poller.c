@@ -0,0 +1,862 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "mbc_master.h"
+#include "port_common.h"
+
+#include "uart_mb_poller.h"
+
+#ifndef CONFIG_UART_MB_POLLER_TASK_PRIO
+#define CONFIG_UART_MB_POLLER_TASK_PRIO 4
+#endif
+
+#ifndef CONFIG_UART_MB_POLLER_TASK_STACK
+#define CONFIG_UART_MB_POLLER_TASK_STACK 3072
+#endif
+
+#ifndef CONFIG_UART_MB_POINTS_MAX
+#define CONFIG_UART_MB_POINTS_MAX 64
+#endif
+
+#ifndef CONFIG_UART_MB_POLLER_MERGE_GAP
+#define CONFIG_UART_MB_POLLER_MERGE_GAP 6
+#endif
+
+#ifndef CONFIG_UART_MB_TIMEOUT_MIN_MS
+#define CONFIG_UART_MB_TIMEOUT_MIN_MS 100
+#endif
+
+#ifndef CONFIG_UART_MB_TIMEOUT_MAX_MS
+#define CONFIG_UART_MB_TIMEOUT_MAX_MS 1000
+#endif
+
+#ifndef CONFIG_UART_MB_BACKOFF_MAX_MS
+#define CONFIG_UART_MB_BACKOFF_MAX_MS 60000
+#endif
+
+#if CONFIG_UART_MB_TIMEOUT_MIN_MS > CONFIG_UART_MB_TIMEOUT_MAX_MS
+#error "CONFIG_UART_MB_TIMEOUT_MIN_MS must not exceed CONFIG_UART_MB_TIMEOUT_MAX_MS"
+#endif
+
+#define MB_BACKOFF_FAILS     3     // timeouts seguidos antes de pausar un esclavo
+#define MB_BACKOFF_MIN_MS    1000
+#define MB_BITS_PER_CHAR     10    // 8N1
+#define MB_INIT_WAIT_MS 100
+#define MB_FUNC_READ_HOLDING 0x03
+#define MB_FUNC_READ_INPUT   0x04
+#define MB_FUNC_WRITE_MULTIPLE 0x10
+#define MB_SLAVE_ADDR_MAX    247
+#define POINTS_FIELDS        9
+#define POINTS_LINE_MAX      128
+
+/**
+ * @brief Merged read request.
+ */
+typedef struct {
+    uint8_t slave_addr;
+    uint8_t slave;       /**< Index in the slave table */
+    uint8_t command;
+    uint16_t reg_start;
+    uint16_t reg_count;
+    uint32_t period_ms;
+    int64_t next_us;     /**< Time the block is due, 0 = right away */
+    esp_err_t status;    /**< Result of the last request */
+} poll_block_t;
+
+/**
+ * @brief Point with its decoded value.
+ */
+typedef struct {
+    uart_mb_point_desc_t desc;            /**< key/unit point to the arrays below */
+    char key[UART_MB_POINT_KEY_MAX];
+    char unit[UART_MB_POINT_UNIT_MAX];
+    uint16_t block;                       /**< Block that reads the point */
+    uint16_t offset;                      /**< First register of the point inside the block */
+    int32_t value;
+    esp_err_t status;
+    int64_t updated_us;
+} point_t;
+
+/**
+ * @brief Link state of a slave.
+ */
+typedef struct {
+    uart_mb_slave_stats_t stats;
+    bool sampled;               /**< srtt/rttvar hold at least one sample */
+    uint32_t rto_us;            /**< Latency allowance of the next request */
+    uint16_t failures;          /**< Consecutive timeouts */
+    int64_t backoff_until_us;   /**< Skipped until this time while silent */
+} slave_t;
+
+static const char *TAG = "uart_mb_poller";
+
+static void *mbc_handle = NULL;
+static TaskHandle_t poller_handle = NULL;
+
+static point_t points[CONFIG_UART_MB_POINTS_MAX];
+static poll_block_t blocks[CONFIG_UART_MB_POINTS_MAX];
+static slave_t slaves[UART_MB_SLAVES_MAX];
+static size_t point_count = 0;
+static size_t block_count = 0;
+static size_t slave_count = 0;
+static uint32_t line_baudrate = 0;
+
+// El mutex serializa las peticiones sobre el bus y protege las tablas de puntos, bloques y
+// esclavos; el spinlock protege los valores decodificados y las estadísticas que se copian
+// desde otras tareas
+static SemaphoreHandle_t bus_mutex = NULL;
+static portMUX_TYPE points_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint16_t point_regs(mb_descr_type_t type)
+{
+    switch (type)
+    {
+        case PARAM_TYPE_U16:
+        case PARAM_TYPE_I16_AB:
+            return 1;
+        case PARAM_TYPE_U32_ABCD:
+        case PARAM_TYPE_U32_CDAB:
+        case PARAM_TYPE_I32_ABCD:
+        case PARAM_TYPE_I32_CDAB:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+static uint8_t point_command(mb_param_type_t reg_type)
+{
+    return reg_type == MB_PARAM_HOLDING ? MB_FUNC_READ_HOLDING : MB_FUNC_READ_INPUT;
+}
+
+// El stack entrega cada registro como un uint16_t en el orden del host
+static int64_t point_raw(const uint16_t *regs, mb_descr_type_t type)
+{
+    switch (type)
+    {
+        case PARAM_TYPE_U16:      return regs[0];
+        case PARAM_TYPE_I16_AB:   return (int16_t)regs[0];
+        case PARAM_TYPE_U32_ABCD: return ((uint32_t)regs[0] << 16) | regs[1];
+        case PARAM_TYPE_U32_CDAB: return ((uint32_t)regs[1] << 16) | regs[0];
+        case PARAM_TYPE_I32_ABCD: return (int32_t)(((uint32_t)regs[0] << 16) | regs[1]);
+        case PARAM_TYPE_I32_CDAB: return (int32_t)(((uint32_t)regs[1] << 16) | regs[0]);
+        default:                  return 0;
+    }
+}
+
+static int32_t point_scale(int64_t raw, const uart_mb_point_desc_t *desc)
+{
+    int64_t v = raw * desc->scale_num / desc->scale_den;
+    if (v > INT32_MAX) return INT32_MAX;
+    if (v < INT32_MIN) return INT32_MIN;
+    return (int32_t)v;
+}
+
+static bool point_valid(const uart_mb_point_desc_t *desc)
+{
+    return desc->key != NULL && desc->key[0] != '\0' && strlen(desc->key) < UART_MB_POINT_KEY_MAX &&
+           desc->unit != NULL && strlen(desc->unit) < UART_MB_POINT_UNIT_MAX &&
+           desc->slave_addr >= 1 && desc->slave_addr <= MB_SLAVE_ADDR_MAX &&
+           (desc->reg_type == MB_PARAM_HOLDING || desc->reg_type == MB_PARAM_INPUT) &&
+           point_regs(desc->type) != 0 &&
+           (uint32_t)desc->reg_start + point_regs(desc->type) <= 0x10000 &&
+           desc->scale_den != 0;
+}
+
+static int find_point(const char *key, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (strcmp(points[i].key, key) == 0)
+            return (int)i;
+    }
+    return -1;
+}
+
+static int find_slave(uint8_t slave_addr)
+{
+    for (size_t i = 0; i < slave_count; ++i)
+    {
+        if (slaves[i].stats.slave_addr == slave_addr)
+            return (int)i;
+    }
+    return -1;
+}
+
+// Los esclavos no se quitan nunca: los puntos tampoco
+static int add_slave(uint8_t slave_addr)
+{
+    int found = find_slave(slave_addr);
+    if (found >= 0 || slave_count >= UART_MB_SLAVES_MAX)
+        return found;
+
+    slave_t *s = &slaves[slave_count];
+    memset(s, 0, sizeof(*s));
+    s->stats.slave_addr = slave_addr;
+    s->stats.timeout_ms = CONFIG_UART_MB_TIMEOUT_MAX_MS;
+    s->rto_us = CONFIG_UART_MB_TIMEOUT_MAX_MS * 1000;
+    return (int)slave_count++;
+}
+
+static uint32_t line_us(uint32_t bytes)
+{
+    return (uint32_t)((uint64_t)bytes * MB_BITS_PER_CHAR * 1000000 / line_baudrate);
+}
+
+// Largo en bytes de la petición y de la respuesta esperada, con dirección y CRC
+static void frame_bytes(const mb_param_request_t *req, uint32_t *request, uint32_t *response)
+{
+    switch (req->command)
+    {
+        case MB_FUNC_READ_HOLDING:
+        case MB_FUNC_READ_INPUT:
+            *request = 8;
+            *response = 5 + 2 * (uint32_t)req->reg_size;
+            break;
+        case MB_FUNC_WRITE_MULTIPLE:
+            *request = 9 + 2 * (uint32_t)req->reg_size;
+            *response = 8;
+            break;
+        default:
+            *request = 8;
+            *response = 8;
+            break;
+    }
+}
+
+/**
+ * @brief Sends a request with the response timeout of its slave and updates the statistics.
+ *        Called with bus_mutex taken.
+ * @details The latency sample (round-trip time minus the line time of both frames) does not
+ *          depend on the request size, so the blocks of one slave share the estimate. Only
+ *          answered requests are sampled; a timeout doubles the allowance instead (Karn).
+ */
+static esp_err_t send_request(mb_param_request_t *req, void *data)
+{
+    int index = req->slave_addr ? find_slave(req->slave_addr) : -1;
+    slave_t *s = index >= 0 ? &slaves[index] : NULL;
+    uint32_t request_bytes, response_bytes;
+    frame_bytes(req, &request_bytes, &response_bytes);
+
+    uint32_t timeout_ms = CONFIG_UART_MB_TIMEOUT_MAX_MS;
+    if (s)
+    {
+        uint64_t ms = ((uint64_t)line_us(response_bytes) + s->rto_us + 999) / 1000;
+        timeout_ms = ms < CONFIG_UART_MB_TIMEOUT_MIN_MS ? CONFIG_UART_MB_TIMEOUT_MIN_MS
+                   : ms > CONFIG_UART_MB_TIMEOUT_MAX_MS ? CONFIG_UART_MB_TIMEOUT_MAX_MS
+                   : (uint32_t)ms;
+    }
+
+    // El timer del puerto lee el valor al armar cada espera de respuesta. esp-modbus no tiene
+    // API pública para acotar una petición, así que se usa su interfaz interna, cuyo layout
+    // sólo se verificó con la versión fijada en idf_component.yml
+#if !defined(UART_MB_ESP_MODBUS_MAJOR) || UART_MB_ESP_MODBUS_MAJOR != 2 || \
+    UART_MB_ESP_MODBUS_MINOR != 1 || UART_MB_ESP_MODBUS_PATCH != 1
+#error "mbm_controller_iface_t only verified against esp-modbus 2.1.1"
+#endif
+    mbm_controller_iface_t *iface = (mbm_controller_iface_t *)mbc_handle;
+    mb_port_timer_set_response_time(iface->mb_base->port_obj, timeout_ms);
+
+    int64_t start = esp_timer_get_time();
+    esp_err_t err = mbc_master_send_request(mbc_handle, req, data);
+    int64_t now = esp_timer_get_time();
+
+    if (s == NULL)
+        return err;
+
+    uart_mb_slave_stats_t *st = &s->stats;
+    bool paused = false;
+
+    portENTER_CRITICAL(&points_lock);
+    st->timeout_ms = timeout_ms;
+    ++st->requests;
+
+    if (err == ESP_ERR_TIMEOUT)
+    {
+        ++st->timeouts;
+        uint32_t rto = s->rto_us > CONFIG_UART_MB_TIMEOUT_MIN_MS * 1000 ? s->rto_us
+                                                                        : CONFIG_UART_MB_TIMEOUT_MIN_MS * 1000;
+        s->rto_us = rto < CONFIG_UART_MB_TIMEOUT_MAX_MS * 500 ? rto * 2 : CONFIG_UART_MB_TIMEOUT_MAX_MS * 1000;
+        if (++s->failures >= MB_BACKOFF_FAILS)
+        {
+            st->backoff_ms = st->backoff_ms == 0 ? MB_BACKOFF_MIN_MS
+                           : st->backoff_ms < CONFIG_UART_MB_BACKOFF_MAX_MS / 2 ? st->backoff_ms * 2
+                           : CONFIG_UART_MB_BACKOFF_MAX_MS;
+            s->backoff_until_us = now + (int64_t)st->backoff_ms * 1000;
+            paused = s->failures == MB_BACKOFF_FAILS;
+        }
+    }
+    else
+    {
+        s->failures = 0;
+        st->backoff_ms = 0;
+        s->backoff_until_us = 0;
+
+        if (err == ESP_ERR_INVALID_RESPONSE)
+        {
+            ++st->crc_errors;
+        }
+        else if (err == ESP_OK)
+        {
+            uint32_t rtt = (uint32_t)(now - start);
+            uint32_t line = line_us(request_bytes + response_bytes);
+            int32_t sample = rtt > line ? (int32_t)(rtt - line) : 0;
+
+            // RFC 6298: rttvar = 3/4 rttvar + 1/4 |srtt - R|, srtt = 7/8 srtt + 1/8 R
+            if (!s->sampled)
+            {
+                st->srtt_us = (uint32_t)sample;
+                st->rttvar_us = (uint32_t)sample / 2;
+                s->sampled = true;
+            }
+            else
+            {
+                int32_t delta = sample - (int32_t)st->srtt_us;
+                st->rttvar_us = (uint32_t)((int32_t)st->rttvar_us + ((delta < 0 ? -delta : delta) -
+                                                                    (int32_t)st->rttvar_us) / 4);
+                st->srtt_us = (uint32_t)((int32_t)st->srtt_us + delta / 8);
+            }
+            st->rtt_us = rtt;
+            s->rto_us = st->srtt_us + 4 * st->rttvar_us;
+        }
+    }
+    portEXIT_CRITICAL(&points_lock);
+
+    if (paused)
+        ESP_LOGW(TAG, "Slave %u silent after %d timeouts, paused", st->slave_addr, MB_BACKOFF_FAILS);
+
+    return err;
+}
+
+// Orden de agrupamiento: esclavo, función, periodo y registro
+static bool point_before(const point_t *a, const point_t *b)
+{
+    if (a->desc.slave_addr != b->desc.slave_addr) return a->desc.slave_addr < b->desc.slave_addr;
+    if (a->desc.reg_type != b->desc.reg_type) return a->desc.reg_type < b->desc.reg_type;
+    if (a->desc.period_ms != b->desc.period_ms) return a->desc.period_ms < b->desc.period_ms;
+    return a->desc.reg_start < b->desc.reg_start;
+}
+
+/**
+ * @brief Rebuilds the merged requests. Called with bus_mutex taken.
+ * @details Points of the same slave, function and period are merged while the registers in
+ *          between are at most CONFIG_UART_MB_POLLER_MERGE_GAP: a few extra registers cost
+ *          less line time than another request with its own frame overhead and t3.5 gaps.
+ */
+static esp_err_t rebuild(void)
+{
+    static uint16_t order[CONFIG_UART_MB_POINTS_MAX];
+
+    for (size_t i = 0; i < point_count; ++i)
+    {
+        size_t j = i;
+        while (j > 0 && point_before(&points[i], &points[order[j - 1]]))
+        {
+            order[j] = order[j - 1];
+            --j;
+        }
+        order[j] = (uint16_t)i;
+    }
+
+    block_count = 0;
+    for (size_t k = 0; k < point_count; ++k)
+    {
+        point_t *p = &points[order[k]];
+        uint8_t command = point_command(p->desc.reg_type);
+        uint32_t start = p->desc.reg_start;
+        uint32_t end = start + point_regs(p->desc.type);
+        poll_block_t *blk = block_count ? &blocks[block_count - 1] : NULL;
+
+        if (blk && blk->slave_addr == p->desc.slave_addr && blk->command == command &&
+            blk->period_ms == p->desc.period_ms)
+        {
+            uint32_t blk_end = (uint32_t)blk->reg_start + blk->reg_count;
+            uint32_t new_end = end > blk_end ? end : blk_end;
+
+            if (start <= blk_end + CONFIG_UART_MB_POLLER_MERGE_GAP &&
+                new_end - blk->reg_start <= UART_MB_POLL_MAX_REGS)
+            {
+                blk->reg_count = (uint16_t)(new_end - blk->reg_start);
+                p->block = (uint16_t)(block_count - 1);
+                continue;
+            }
+        }
+
+        int slave = add_slave(p->desc.slave_addr);
+        if (slave < 0)
+        {
+            ESP_LOGE(TAG, "Slave table full (%d slaves)", UART_MB_SLAVES_MAX);
+            return ESP_ERR_NO_MEM;
+        }
+
+        blocks[block_count] = (poll_block_t){
+            .slave_addr = p->desc.slave_addr,
+            .slave      = (uint8_t)slave,
+            .command    = command,
+            .reg_start  = (uint16_t)start,
+            .reg_count  = (uint16_t)(end - start),
+            .period_ms  = p->desc.period_ms,
+            .next_us    = 0,
+            .status     = ESP_ERR_INVALID_STATE
+        };
+        p->block = (uint16_t)block_count++;
+    }
+
+    for (size_t i = 0; i < point_count; ++i)
+        points[i].offset = points[i].desc.reg_start - blocks[points[i].block].reg_start;
+
+    ESP_LOGI(TAG, "%u points in %u requests", (unsigned)point_count, (unsigned)block_count);
+    return ESP_OK;
+}
+
+// Lee un bloque y decodifica sus puntos. Se llama con bus_mutex tomado
+static void poll_block(size_t index)
+{
+    poll_block_t *blk = &blocks[index];
+    mb_param_request_t req = {
+        .slave_addr = blk->slave_addr,
+        .command    = blk->command,
+        .reg_start  = blk->reg_start,
+        .reg_size   = blk->reg_count
+    };
+    uint16_t regs[UART_MB_POLL_MAX_REGS];
+
+    esp_err_t err = send_request(&req, regs);
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&points_lock);
+    for (size_t i = 0; i < point_count; ++i)
+    {
+        point_t *p = &points[i];
+        if (p->block != index)
+            continue;
+
+        p->status = err;
+        if (err == ESP_OK)
+        {
+            p->value = point_scale(point_raw(&regs[p->offset], p->desc.type), &p->desc);
+            p->updated_us = now;
+        }
+    }
+    portEXIT_CRITICAL(&points_lock);
+
+    // Sólo se informan los cambios, un esclavo ausente no inunda el log en cada ciclo
+    if (err != blk->status && err != ESP_OK)
+        ESP_LOGW(TAG, "Slave %u fn 0x%02X reg 0x%04X: %s", blk->slave_addr, blk->command,
+                 blk->reg_start, esp_err_to_name(err));
+    else if (err != blk->status && blk->status != ESP_ERR_INVALID_STATE)
+        ESP_LOGI(TAG, "Slave %u fn 0x%02X reg 0x%04X answering again", blk->slave_addr,
+                 blk->command, blk->reg_start);
+    blk->status = err;
+}
+
+static void poller_task(void *arg)
+{
+    while (1)
+    {
+        int64_t start_us = esp_timer_get_time();
+        int64_t next_us = INT64_MAX;
+        size_t polled = 0;
+
+        // Los bloques vencidos se piden uno tras otro: el stack sólo intercala el silencio t3.5
+        for (size_t i = 0; ; ++i)
+        {
+            xSemaphoreTake(bus_mutex, portMAX_DELAY);
+            if (i >= block_count)
+            {
+                xSemaphoreGive(bus_mutex);
+                break;
+            }
+
+            poll_block_t *blk = &blocks[i];
+            int64_t now = esp_timer_get_time();
+            int64_t paused_until = slaves[blk->slave].backoff_until_us;
+
+            // Un esclavo en pausa no se consulta; su bloque queda vencido para el fin de la pausa
+            if (now >= blk->next_us && now < paused_until)
+            {
+                blk->next_us = paused_until;
+            }
+            else if (now >= blk->next_us)
+            {
+                poll_block(i);
+                int64_t due = (blk->next_us ? blk->next_us : now) + (int64_t)blk->period_ms * 1000;
+                blk->next_us = due > now ? due : now;
+                ++polled;
+            }
+            if (blk->next_us < next_us)
+                next_us = blk->next_us;
+            xSemaphoreGive(bus_mutex);
+        }
+
+        if (polled)
+            ESP_LOGD(TAG, "%u requests in %lld us", (unsigned)polled,
+                     (long long)(esp_timer_get_time() - start_us));
+
+        // Espera hasta el próximo bloque vencido; agregar puntos despierta la tarea
+        TickType_t wait = portMAX_DELAY;
+        if (next_us != INT64_MAX)
+        {
+            int64_t now = esp_timer_get_time();
+            wait = next_us > now ? pdMS_TO_TICKS((next_us - now + 999) / 1000) + 1 : 0;
+        }
+
+        if (wait == 0)
+            taskYIELD();
+        else
+            ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
+
+esp_err_t uart_mb_poller_start(uart_port_t uart_num, gpio_num_t tx_io_num, gpio_num_t rx_io_num,
+                               uint32_t baudrate)
+{
+    esp_err_t err = ESP_OK;
+
+    if (mbc_handle != NULL)
+        return ESP_ERR_INVALID_STATE;
+
+    mb_communication_info_t comm_info = {
+        .ser_opts.port = uart_num,
+        .ser_opts.mode = MB_RTU,
+        .ser_opts.baudrate = baudrate,
+        .ser_opts.parity = MB_PARITY_NONE,
+        .ser_opts.uid = 0,
+        .ser_opts.response_tout_ms = CONFIG_UART_MB_TIMEOUT_MAX_MS,
+        .ser_opts.data_bits = UART_DATA_8_BITS,
+        .ser_opts.stop_bits = UART_STOP_BITS_1
+    };
+
+    void *handle = NULL;
+    err = mbc_master_create_serial(&comm_info, &handle);
+    if (err != ESP_OK || handle == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to create Modbus master controller: %s", esp_err_to_name(err));
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    err = uart_set_pin(uart_num, tx_io_num, rx_io_num, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to set UART pins: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    err = mbc_master_start(handle);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to start Modbus master: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    err = uart_set_mode(uart_num, UART_MODE_UART);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to set UART mode: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    bus_mutex = xSemaphoreCreateMutex();
+    if (bus_mutex == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to create bus mutex");
+        return ESP_ERR_NO_MEM;
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(MB_INIT_WAIT_MS));
+    line_baudrate = baudrate;
+    mbc_handle = handle;
+
+    BaseType_t ok = xTaskCreate(poller_task, TAG, CONFIG_UART_MB_POLLER_TASK_STACK, NULL,
+                                CONFIG_UART_MB_POLLER_TASK_PRIO, &poller_handle);
+    if (ok != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create poller task");
+        poller_handle = NULL;
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Modbus RTU master started at UART%d, %lu baud, TX:%d RX:%d", uart_num,
+             (unsigned long)baudrate, tx_io_num, rx_io_num);
+    return ESP_OK;
+}
+
+esp_err_t uart_mb_points_add(const uart_mb_point_desc_t *desc, size_t count, size_t *first)
+{
+    if (desc == NULL || count == 0)
+        return ESP_ERR_INVALID_ARG;
+
+    if (poller_handle == NULL)
+        return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(bus_mutex, portMAX_DELAY);
+
+    size_t base = point_count;
+    esp_err_t err = ESP_OK;
+
+    if (base + count > CONFIG_UART_MB_POINTS_MAX)
+    {
+        ESP_LOGE(TAG, "Point table full (%u + %u)", (unsigned)base, (unsigned)count);
+        err = ESP_ERR_NO_MEM;
+    }
+
+    for (size_t i = 0; i < count && err == ESP_OK; ++i)
+    {
+        if (!point_valid(&desc[i]) || find_point(desc[i].key, base + i) >= 0)
+        {
+            ESP_LOGE(TAG, "Invalid or duplicated point \"%s\"", desc[i].key ? desc[i].key : "");
+            err = ESP_ERR_INVALID_ARG;
+            break;
+        }
+
+        point_t *p = &points[base + i];
+        memset(p, 0, sizeof(*p));
+        p->desc = desc[i];
+        strcpy(p->key, desc[i].key);
+        strcpy(p->unit, desc[i].unit);
+        p->desc.key = p->key;
+        p->desc.unit = p->unit;
+        p->status = ESP_ERR_INVALID_STATE;
+    }
+
+    if (err == ESP_OK)
+    {
+        point_count = base + count;
+        err = rebuild();
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to rebuild the poll requests: %s", esp_err_to_name(err));
+            point_count = base;
+            if (base > 0)
+                rebuild();
+        }
+    }
+
+    xSemaphoreGive(bus_mutex);
+
+    if (err != ESP_OK)
+        return err;
+
+    if (first)
+        *first = base;
+
+    xTaskNotifyGive(poller_handle);
+    return ESP_OK;
+}
+
+static char *trim(char *s)
+{
+    while (*s == ' ' || *s == '\t')
+        ++s;
+
+    char *end = s + strlen(s);
+    while (end > s && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'))
+        --end;
+    *end = '\0';
+    return s;
+}
+
+static bool parse_long(const char *s, long min, long max, long *out)
+{
+    char *end = NULL;
+    long v = strtol(s, &end, 0);
+    if (end == s || *end != '\0' || v < min || v > max)
+        return false;
+    *out = v;
+    return true;
+}
+
+static bool parse_type(const char *s, mb_descr_type_t *type)
+{
+    static const struct {
+        const char *name;
+        mb_descr_type_t type;
+    } types[] = {
+        { "u16",      PARAM_TYPE_U16 },
+        { "i16",      PARAM_TYPE_I16_AB },
+        { "u32_abcd", PARAM_TYPE_U32_ABCD },
+        { "u32_cdab", PARAM_TYPE_U32_CDAB },
+        { "i32_abcd", PARAM_TYPE_I32_ABCD },
+        { "i32_cdab", PARAM_TYPE_I32_CDAB },
+    };
+
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); ++i)
+    {
+        if (strcmp(s, types[i].name) == 0)
+        {
+            *type = types[i].type;
+            return true;
+        }
+    }
+    return false;
+}
+
+// key, unit, slave, function, register, type, scale_num, scale_den, period_ms
+static bool parse_point(char *line, uart_mb_point_desc_t *desc)
+{
+    char *fields[POINTS_FIELDS];
+    size_t n = 0;
+    char *tok = line;
+
+    while (tok != NULL && n < POINTS_FIELDS)
+    {
+        char *comma = strchr(tok, ',');
+        if (comma)
+            *comma = '\0';
+        fields[n++] = trim(tok);
+        tok = comma ? comma + 1 : NULL;
+    }
+
+    long slave, function, reg, num, den, period;
+    if (n != POINTS_FIELDS || tok != NULL ||
+        !parse_long(fields[2], 1, MB_SLAVE_ADDR_MAX, &slave) ||
+        !parse_long(fields[3], MB_FUNC_READ_HOLDING, MB_FUNC_READ_INPUT, &function) ||
+        !parse_long(fields[4], 0, 0xFFFF, &reg) ||
+        !parse_type(fields[5], &desc->type) ||
+        !parse_long(fields[6], INT32_MIN, INT32_MAX, &num) ||
+        !parse_long(fields[7], INT32_MIN, INT32_MAX, &den) ||
+        !parse_long(fields[8], 0, 86400000, &period))
+        return false;
+
+    desc->key = fields[0];
+    desc->unit = fields[1];
+    desc->slave_addr = (uint8_t)slave;
+    desc->reg_type = function == MB_FUNC_READ_HOLDING ? MB_PARAM_HOLDING : MB_PARAM_INPUT;
+    desc->reg_start = (uint16_t)reg;
+    desc->scale_num = (int32_t)num;
+    desc->scale_den = (int32_t)den;
+    desc->period_ms = (uint32_t)period;
+    return point_valid(desc);
+}
+
+esp_err_t uart_mb_points_load(const char *table, size_t *added)
+{
+    if (table == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    esp_err_t result = ESP_OK;
+    size_t loaded = 0;
+    unsigned line_no = 0;
+
+    for (const char *p = table; *p != '\0'; )
+    {
+        const char *eol = strchr(p, '\n');
+        size_t len = eol ? (size_t)(eol - p) : strlen(p);
+        char line[POINTS_LINE_MAX];
+        ++line_no;
+
+        if (len >= sizeof(line))
+        {
+            ESP_LOGW(TAG, "Points line %u too long, skipped", line_no);
+            result = ESP_ERR_INVALID_ARG;
+        }
+        else
+        {
+            memcpy(line, p, len);
+            line[len] = '\0';
+            char *text = trim(line);
+
+            if (text[0] != '\0' && text[0] != '#')
+            {
+                uart_mb_point_desc_t desc;
+                esp_err_t err = parse_point(text, &desc) ? uart_mb_points_add(&desc, 1, NULL)
+                                                         : ESP_ERR_INVALID_ARG;
+                if (err == ESP_OK)
+                {
+                    ++loaded;
+                }
+                else
+                {
+                    ESP_LOGW(TAG, "Points line %u skipped: %s", line_no, esp_err_to_name(err));
+                    result = err;
+                    // Con la tabla llena o el poller detenido no tiene sentido seguir
+                    if (err != ESP_ERR_INVALID_ARG)
+                        break;
+                }
+            }
+        }
+
+        p += len;
+        if (*p == '\n')
+            ++p;
+    }
+
+    if (added)
+        *added = loaded;
+    return result;
+}
+
+esp_err_t uart_mb_points_find(const char *key, size_t *index)
+{
+    if (key == NULL || index == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    if (bus_mutex == NULL)
+        return ESP_ERR_NOT_FOUND;
+
+    xSemaphoreTake(bus_mutex, portMAX_DELAY);
+    int found = find_point(key, point_count);
+    xSemaphoreGive(bus_mutex);
+
+    if (found < 0)
+        return ESP_ERR_NOT_FOUND;
+
+    *index = (size_t)found;
+    return ESP_OK;
+}
+
+size_t uart_mb_points_count(void)
+{
+    return point_count;
+}
+
+esp_err_t uart_mb_point_get(size_t index, uart_mb_point_t *point)
+{
+    if (point == NULL || index >= point_count)
+        return ESP_ERR_INVALID_ARG;
+
+    const point_t *p = &points[index];
+
+    portENTER_CRITICAL(&points_lock);
+    point->key = p->key;
+    point->unit = p->unit;
+    point->value = p->value;
+    point->status = p->status;
+    point->updated_us = p->updated_us;
+    portEXIT_CRITICAL(&points_lock);
+    return ESP_OK;
+}
+
+size_t uart_mb_slaves_count(void)
+{
+    return slave_count;
+}
+
+esp_err_t uart_mb_slave_stats_get(size_t index, uart_mb_slave_stats_t *stats)
+{
+    if (stats == NULL || index >= slave_count)
+        return ESP_ERR_INVALID_ARG;
+
+    portENTER_CRITICAL(&points_lock);
+    *stats = slaves[index].stats;
+    portEXIT_CRITICAL(&points_lock);
+    return ESP_OK;
+}
+
+esp_err_t uart_mb_poller_request(mb_param_request_t *request, void *data)
+{
+    if (mbc_handle == NULL)
+        return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(bus_mutex, portMAX_DELAY);
+    esp_err_t err = send_request(request, data);
+    xSemaphoreGive(bus_mutex);
+    return err;
+}
@@ -1,8 +1,10 @@
 #ifndef UART_PZEM004T_H
 #define UART_PZEM004T_H
 
-#include "driver/uart.h"
-#include "driver/gpio.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 #include "esp_err.h"
 
 /**
@@ -12,75 +14,84 @@
  *          interfacing with the PZEM004T energy monitor via UART.
  * 
  * @author Roberto Axt
- * @date 2025-11-02
+ * @date 2025-11-20
  * 
  * @par License
  * This file is part of the SMEM-MP project and is licensed under the MIT License.
  */
 
-/**
- * @brief Initializes the UART PZEM004T driver.
- * @param uart_num The UART port number to use.
- * @param tx_io_num The GPIO number for UART TX.
- * @param rx_io_num The GPIO number for UART RX.
- * @return esp_err_t Returns ESP_OK on success, or an error code on failure.
- */
-esp_err_t uart_pzem004t_start(uart_port_t uart_num, gpio_num_t tx_io_num, gpio_num_t rx_io_num);
+#define UART_PZEM_MAX_METERS 8  /**< Meters sharing one RS-485 segment */
 
 /**
- * @brief Reads data from the PZEM004T device.
- * @param None
- * @return esp_err_t Returns ESP_OK on success, or an error code on failure.
+ * @brief Measurements of one meter, in fixed point.
+ * @details Current, power and energy are 32-bit registers in the meter (low word first) and
+ *          are decoded in full. The values are the raw readings times an integer scale, so no
+ *          float operation is involved.
  */
-esp_err_t uart_pzem004t_read(void);
- 
+typedef struct {
+    uint32_t voltage_mV;  /**< Voltage in millivolts (resolution 100 mV) */
+    uint32_t current_mA;  /**< Current in milliamperes */
+    uint32_t power_mW;    /**< Active power in milliwatts (resolution 100 mW) */
+    uint32_t energy_Wh;   /**< Accumulated energy in watt-hours */
+    uint32_t freq_mHz;    /**< Frequency in millihertz (resolution 100 mHz) */
+    uint16_t pf_milli;    /**< Power factor in thousandths (resolution 10) */
+    bool alarm;           /**< Power above the alarm threshold of the meter */
+} uart_pzem_reading_t;
+
 /**
- * @brief Resets the PZEM004T device.
- * @param None
+ * @brief Adds the measurement registers of the meters to the Modbus acquisition.
+ * @details All the meters share the RS-485 segment started with uart_mb_poller_start(); each
+ *          needs its own slave address, set beforehand through the PZEM address register.
+ *          Their registers are described as points named "pzem<address>.<measure>" (see
+ *          uart_mb_poller.h), so the poller reads each meter in a single request.
+ * @param addrs Slave addresses of the meters (1 to 247).
+ * @param count Number of meters (1 to UART_PZEM_MAX_METERS).
+ * @param period_ms Time between two reads of each meter.
  * @return esp_err_t Returns ESP_OK on success, or an error code on failure.
  */
-esp_err_t uart_pzem_reset(void);
- 
-/**
- * @brief 
- * @param None
- * @return float
- */
-float uart_pzem_voltage_V(void);
+esp_err_t uart_pzem004t_start(const uint8_t *addrs, size_t count, uint32_t period_ms);
 
 /**
- * @brief 
- * @param None
- * @return float
+ * @brief Gets the latest measurements of a meter.
+ * @details The values come from the last poll; no request is sent.
+ * @param meter Index of the meter in the address list given to uart_pzem004t_start().
+ * @param reading Where the measurements are stored.
+ * @return esp_err_t Returns ESP_OK on success, ESP_ERR_INVALID_ARG for a bad index, or the
+ *         error of the last poll (ESP_ERR_INVALID_STATE before the first one).
  */
-float uart_pzem_current_A(void);
-
+esp_err_t uart_pzem004t_read(size_t meter, uart_pzem_reading_t *reading);
+ 
 /**
- * @brief 
- * @param None
- * @return float
+ * @brief Resets the energy counter of a meter.
+ * @param meter Index of the meter.
+ * @return esp_err_t Returns ESP_OK on success, or an error code on failure.
  */
-float uart_pzem_power_W(void);
+esp_err_t uart_pzem_reset(size_t meter);
 
 /**
- * @brief 
- * @param None
- * @return float
+ * @brief Gets the power alarm threshold of a meter.
+ * @details The meter compares the active power with the threshold by itself and raises the
+ *          alarm flag of uart_pzem_reading_t, so overloads are detected by the hardware.
+ * @param meter Index of the meter.
+ * @param watts Where the threshold in watts is stored.
+ * @return esp_err_t Returns ESP_OK on success, or an error code on failure.
  */
-float uart_pzem_energy_Wh(void);
+esp_err_t uart_pzem_alarm_threshold_get(size_t meter, uint16_t *watts);
 
 /**
- * @brief 
- * @param None
- * @return float
+ * @brief Sets the power alarm threshold of a meter.
+ * @details The meter keeps the threshold across power cycles.
+ * @param meter Index of the meter.
+ * @param watts Threshold in watts.
+ * @return esp_err_t Returns ESP_OK on success, or an error code on failure.
  */
-float uart_pzem_freq_Hz(void);
+esp_err_t uart_pzem_alarm_threshold_set(size_t meter, uint16_t watts);
 
 /**
- * @brief 
- * @param None
- * @return float
+ * @brief Gets the slave address of a meter.
+ * @param meter Index of the meter.
+ * @return The address, or 0 for a bad index.
  */
-float uart_pzem_pf(void);
+uint8_t uart_pzem004t_address(size_t meter);
 
 #endif // UART_PZEM004T_H
@@ -1,160 +1,183 @@
+#include <stdio.h>
+
 #include "esp_log.h"
-#include "driver/uart.h"
 #include "mbcontroller.h"
 
 #include "uart_pzem004t.h"
+#include "uart_mb_poller.h"
 
-#define MB_DEV_SPEED 9600
-#define MB_RESPONSE_TIMEOUT_MS 2000
-#define MB_RESPONSE_SIZE 20
-#define MB_INIT_WAIT_MS 100
-#define PZEM_SLAVE_ADDR 1
+#define PZEM_CMD_RESET_ENERGY  0x42
+#define PZEM_CMD_READ_HOLDING  0x03
+#define PZEM_CMD_WRITE_SINGLE  0x06
+#define PZEM_REG_ALARM_THRESHOLD 0x0001
+#define PZEM_ALARM_ON          0xFFFF
 
 static const char *TAG = "uart_pzem004t";
 
-static void *mbc_master_handle = NULL;
-
-static float voltage_V = 0;
-static float current_A = 0;
-static float power_W   = 0;
-static float energy_Wh = 0;
-static float freq_Hz   = 0;
-static float pf        = 0;
-
-static inline uint32_t u16_from_regs(uint8_t lo, uint8_t hi)
-{
-    return ((uint32_t)hi << 8) | lo;
-}
-
-// Parse and print one PZEM frame (20 data bytes = 10 registers)
-static void pzem_parse_and_log(const uint8_t *rx, size_t len)
+/**
+ * @brief Measurements of a meter, in the order of its points.
+ */
+typedef enum {
+    PZEM_VOLTAGE = 0,
+    PZEM_CURRENT,
+    PZEM_POWER,
+    PZEM_ENERGY,
+    PZEM_FREQUENCY,
+    PZEM_PF,
+    PZEM_ALARM,
+    PZEM_POINTS
+} pzem_point_t;
+
+// Mapa de registros de entrada según el datasheet; los valores quedan en milésimas de la unidad.
+// Corriente, potencia y energía ocupan dos registros con la palabra baja primero (CDAB)
+static const struct {
+    const char *name;
+    const char *unit;
+    uint16_t reg;
+    mb_descr_type_t type;
+    int32_t scale_num;
+} pzem_map[PZEM_POINTS] = {
+    [PZEM_VOLTAGE]   = { "voltage",   "mV",  0x0000, PARAM_TYPE_U16,      100 },  // 0.1 V
+    [PZEM_CURRENT]   = { "current",   "mA",  0x0001, PARAM_TYPE_U32_CDAB, 1 },    // 0.001 A
+    [PZEM_POWER]     = { "power",     "mW",  0x0003, PARAM_TYPE_U32_CDAB, 100 },  // 0.1 W
+    [PZEM_ENERGY]    = { "energy",    "Wh",  0x0005, PARAM_TYPE_U32_CDAB, 1 },    // 1 Wh
+    [PZEM_FREQUENCY] = { "frequency", "mHz", 0x0007, PARAM_TYPE_U16,      100 },  // 0.1 Hz
+    [PZEM_PF]        = { "pf",        "m",   0x0008, PARAM_TYPE_U16,      10 },   // 0.01
+    [PZEM_ALARM]     = { "alarm",     "",    0x0009, PARAM_TYPE_U16,      1 },    // 0xFFFF = alarma
+};
+
+static uint8_t meter_addrs[UART_PZEM_MAX_METERS] = {0};
+static size_t meter_first[UART_PZEM_MAX_METERS] = {0};
+static size_t meter_count = 0;
+
+esp_err_t uart_pzem004t_start(const uint8_t *addrs, size_t count, uint32_t period_ms)
 {
-    // Data Response frame should be:
-    ESP_LOGD(TAG, "PZEM004T data received: %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x",
-         rx[0], rx[1], rx[2], rx[3], rx[4], rx[5], rx[6], rx[7], rx[8], rx[9], rx[10], rx[11], rx[12], rx[13], rx[14], rx[15], rx[16], rx[17], rx[18], rx[19]);
-    // Map per datasheet    
-    voltage_V = (float)u16_from_regs(rx[0], rx[1]) * 0.1f;
-    current_A = (float)u16_from_regs(rx[2], rx[3]) * 0.001f;
-    power_W = (float)u16_from_regs(rx[6], rx[7]) * 0.1f;
-    energy_Wh = (float)u16_from_regs(rx[8], rx[9]);
-    freq_Hz = (float)u16_from_regs(rx[14], rx[15]) * 0.1f;
-    pf = (float)u16_from_regs(rx[16], rx[17]) * 0.01f;
-
-    ESP_LOGD(TAG, "V=%.1f V, I=%.3f A, P=%.1f W, E=%.0f Wh, f=%.1f Hz, PF=%.2f",
-             voltage_V, current_A, power_W, energy_Wh, freq_Hz, pf);
-}
-
-esp_err_t uart_pzem004t_start(uart_port_t uart_num, gpio_num_t tx_io_num, gpio_num_t rx_io_num)
-{
-    esp_err_t err = ESP_OK;
-
-    mb_communication_info_t comm_info = {
-        .ser_opts.port = uart_num,
-        .ser_opts.mode = MB_RTU,
-        .ser_opts.baudrate = MB_DEV_SPEED,
-        .ser_opts.parity = MB_PARITY_NONE,
-        .ser_opts.uid = 0,
-        .ser_opts.response_tout_ms = MB_RESPONSE_TIMEOUT_MS,
-        .ser_opts.data_bits = UART_DATA_8_BITS,
-        .ser_opts.stop_bits = UART_STOP_BITS_1
-    };
+    if (addrs == NULL || count == 0 || count > UART_PZEM_MAX_METERS)
+        return ESP_ERR_INVALID_ARG;
 
-    // Initialize Modbus controller
-    err = mbc_master_create_serial(&comm_info, &mbc_master_handle);
-    if (err != ESP_OK || mbc_master_handle == NULL) 
+    for (size_t m = 0; m < count; ++m)
     {
-        ESP_LOGE(TAG, "Failed to create Modbus master controller: %s", esp_err_to_name(err));
-        return ESP_ERR_INVALID_STATE;
+        char keys[PZEM_POINTS][UART_MB_POINT_KEY_MAX];
+        uart_mb_point_desc_t desc[PZEM_POINTS];
+
+        for (int i = 0; i < PZEM_POINTS; ++i)
+        {
+            snprintf(keys[i], sizeof(keys[i]), "pzem%u.%s", addrs[m], pzem_map[i].name);
+            desc[i] = (uart_mb_point_desc_t){
+                .key        = keys[i],
+                .unit       = pzem_map[i].unit,
+                .slave_addr = addrs[m],
+                .reg_type   = MB_PARAM_INPUT,
+                .reg_start  = pzem_map[i].reg,
+                .type       = pzem_map[i].type,
+                .scale_num  = pzem_map[i].scale_num,
+                .scale_den  = 1,
+                .period_ms  = period_ms
+            };
+        }
+
+        esp_err_t err = uart_mb_points_add(desc, PZEM_POINTS, &meter_first[m]);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to add PZEM004T %u: %s", addrs[m], esp_err_to_name(err));
+            return err;
+        }
+        meter_addrs[m] = addrs[m];
+        meter_count = m + 1;
     }
 
-    // Set UART pins
-    err = uart_set_pin(uart_num, tx_io_num, rx_io_num, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
-    if (err != ESP_OK)
-    {
-        ESP_LOGE(TAG, "Failed to set UART pins: %s", esp_err_to_name(err));
-        return err;
-    }
-
-    err = mbc_master_start(mbc_master_handle);
-    if (err != ESP_OK)
-    {
-        ESP_LOGE(TAG, "Failed to start Modbus master: %s", esp_err_to_name(err));
-        return err;
-    }
-    
-    err = uart_set_mode(uart_num, UART_MODE_UART);
-    if (err != ESP_OK)
-    {
-        ESP_LOGE(TAG, "Failed to set UART mode: %s", esp_err_to_name(err));
-        return err;
-    }
-
-    ESP_LOGI(TAG, "UART PZEM004T initialized successfully at UART1, TX:%d RX:%d", tx_io_num, rx_io_num);
-
-    vTaskDelay(pdMS_TO_TICKS(MB_INIT_WAIT_MS));
+    ESP_LOGI(TAG, "%u PZEM004T meters polled every %lu ms", (unsigned)count, (unsigned long)period_ms);
     return ESP_OK;
 }
 
-esp_err_t uart_pzem004t_read(void)
+esp_err_t uart_pzem004t_read(size_t meter, uart_pzem_reading_t *reading)
 {
-    mb_param_request_t req = {
-        .slave_addr = PZEM_SLAVE_ADDR,
-        .command    = 0x04,      // Read Input Registers
-        .reg_start  = 0x0000,
-        .reg_size   = 10         // 10 registers: 0x0000..0x0009
-    };
+    if (reading == NULL || meter >= meter_count)
+        return ESP_ERR_INVALID_ARG;
 
-    // Reply buffer: addr(1)+func(1)+bytecnt(1)+data(20)+crc(2) = 25 bytes
-    uint8_t rx[MB_RESPONSE_SIZE] = {0};
-    esp_err_t err = mbc_master_send_request(mbc_master_handle, &req, rx);
-    if (err != ESP_OK)
+    int32_t values[PZEM_POINTS];
+    for (int i = 0; i < PZEM_POINTS; ++i)
     {
-        ESP_LOGE(TAG, "send_request failed: %s (0x%x)", esp_err_to_name(err), err);
-        return err;
+        uart_mb_point_t point;
+        esp_err_t err = uart_mb_point_get(meter_first[meter] + i, &point);
+        if (err != ESP_OK)
+            return err;
+
+        if (point.status != ESP_OK)
+            return point.status;
+
+        values[i] = point.value;
     }
 
-    pzem_parse_and_log(rx, sizeof(rx));
+    // Los puntos ya vienen escalados a enteros; ningún valor medido es negativo
+    reading->voltage_mV = (uint32_t)values[PZEM_VOLTAGE];
+    reading->current_mA = (uint32_t)values[PZEM_CURRENT];
+    reading->power_mW = (uint32_t)values[PZEM_POWER];
+    reading->energy_Wh = (uint32_t)values[PZEM_ENERGY];
+    reading->freq_mHz = (uint32_t)values[PZEM_FREQUENCY];
+    reading->pf_milli = (uint16_t)values[PZEM_PF];
+    reading->alarm = values[PZEM_ALARM] == PZEM_ALARM_ON;
+
+    ESP_LOGD(TAG, "PZEM %u: V=%lu mV, I=%lu mA, P=%lu mW, E=%lu Wh, f=%lu mHz, PF=%u/1000%s",
+             meter_addrs[meter], (unsigned long)reading->voltage_mV, (unsigned long)reading->current_mA,
+             (unsigned long)reading->power_mW, (unsigned long)reading->energy_Wh,
+             (unsigned long)reading->freq_mHz, reading->pf_milli, reading->alarm ? ", ALARM" : "");
     return ESP_OK;
 }
 
-esp_err_t uart_pzem_reset(void)
+esp_err_t uart_pzem_reset(size_t meter)
 {
+    if (meter >= meter_count)
+        return ESP_ERR_INVALID_ARG;
+
     mb_param_request_t req = {
-        .slave_addr = PZEM_SLAVE_ADDR,
-        .command    = 0x42,
+        .slave_addr = meter_addrs[meter],
+        .command    = PZEM_CMD_RESET_ENERGY,
         .reg_start  = 0,
         .reg_size   = 0
     };
     uint8_t rx[8] = {0};
-    return mbc_master_send_request(mbc_master_handle, &req, rx);
+    return uart_mb_poller_request(&req, rx);
 }
 
-inline float uart_pzem_voltage_V(void)
+esp_err_t uart_pzem_alarm_threshold_get(size_t meter, uint16_t *watts)
 {
-    return voltage_V;
-}
+    if (meter >= meter_count || watts == NULL)
+        return ESP_ERR_INVALID_ARG;
 
-inline float uart_pzem_current_A(void)
-{
-    return current_A;
+    mb_param_request_t req = {
+        .slave_addr = meter_addrs[meter],
+        .command    = PZEM_CMD_READ_HOLDING,
+        .reg_start  = PZEM_REG_ALARM_THRESHOLD,
+        .reg_size   = 1
+    };
+    uint16_t value = 0;
+    esp_err_t err = uart_mb_poller_request(&req, &value);
+    if (err == ESP_OK)
+        *watts = value;
+    return err;
 }
 
-inline float uart_pzem_power_W(void)
+esp_err_t uart_pzem_alarm_threshold_set(size_t meter, uint16_t watts)
 {
-    return power_W;
-}
+    if (meter >= meter_count)
+        return ESP_ERR_INVALID_ARG;
 
-inline float uart_pzem_energy_Wh(void)
-{
-    return energy_Wh;
+    mb_param_request_t req = {
+        .slave_addr = meter_addrs[meter],
+        .command    = PZEM_CMD_WRITE_SINGLE,
+        .reg_start  = PZEM_REG_ALARM_THRESHOLD,
+        .reg_size   = 1
+    };
+    uint16_t value = watts;
+    esp_err_t err = uart_mb_poller_request(&req, &value);
+    if (err != ESP_OK)
+        ESP_LOGE(TAG, "Failed to set the alarm threshold of PZEM %u: %s", meter_addrs[meter],
+                 esp_err_to_name(err));
+    return err;
 }
 
-inline float uart_pzem_freq_Hz(void)
+uint8_t uart_pzem004t_address(size_t meter)
 {
-    return freq_Hz;
+    return meter < meter_count ? meter_addrs[meter] : 0;
 }
-
-inline float uart_pzem_pf(void)
-{
-    return pf;
-}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "esp_timer.h"
+#include "unity.h"
+
+#include "i2c_ads1115.h"
+#include "test_board.h"
+
+#define SCAN_ENTRIES 32
+#define SCAN_RUNS    10
+#define LSB_4V096_UV 125  // ±4.096 V / 32768
+
+static double thread_cpu_ms(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+/*
+ * Barrido single-shot de 32 entradas a 128 SPS: la espera de cada conversión debe bloquear la
+ * tarea (timer one-shot) y no consumir CPU, que era casi todo el tiempo del barrido.
+ */
+TEST_CASE("ads1115 scan blocks while converting", "[ads1115][bench]")
+{
+    const test_board_t *b = test_board();
+    for (int c = 0; c < 4; ++c)
+        i2c_sim_ads1115_set_input(b->ads, c, 500000 + c * 100000);
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_ads1115_start(b->bus, TEST_ADS1115_ADDR, ADS1115_PGA_4V096, ADS1115_DR_128SPS,
+                                                I2C_MGMT_SPEED_FAST, 50));
+
+    ads1115_scan_entry_t entries[SCAN_ENTRIES];
+    int16_t values[SCAN_ENTRIES];
+    for (int i = 0; i < SCAN_ENTRIES; ++i)
+        entries[i] = (ads1115_scan_entry_t){ .mux = (ads1115_mux_t)(ADS1115_MUX_SINGLE_0 + i % 4), .pga = ADS1115_PGA_4V096 };
+
+    double cpu0 = thread_cpu_ms();
+    int64_t t0 = esp_timer_get_time();
+    for (int s = 0; s < SCAN_RUNS; ++s)
+        TEST_ASSERT_EQUAL(ESP_OK, i2c_ads1115_scan(entries, SCAN_ENTRIES, values));
+    double cpu = (thread_cpu_ms() - cpu0) / SCAN_RUNS;
+    double wall = (esp_timer_get_time() - t0) / 1000.0 / SCAN_RUNS;
+    printf("32-entry scan: wall %.1f ms, caller CPU %.1f ms\n", wall, cpu);
+
+    for (int i = 0; i < SCAN_ENTRIES; ++i)
+        TEST_ASSERT_INT_WITHIN(2, (500000 + (i % 4) * 100000) / LSB_4V096_UV, values[i]);
+    TEST_ASSERT_TRUE_MESSAGE(cpu < wall / 4, "the scan spins while waiting for conversions");
+}
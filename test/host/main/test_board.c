@@ -0,0 +1,20 @@
+#include "unity.h"
+
+#include "test_board.h"
+
+static test_board_t board;
+
+const test_board_t *test_board(void)
+{
+    if (board.bus)
+        return &board;
+
+    board.mcp = i2c_sim_mcp23017_create(TEST_MCP23017_ADDR);
+    board.ads = i2c_sim_ads1115_create(TEST_ADS1115_ADDR);
+    board.pn = i2c_sim_pn532_create(TEST_PN532_ADDR);
+    TEST_ASSERT_NOT_NULL(board.mcp);
+    TEST_ASSERT_NOT_NULL(board.ads);
+    TEST_ASSERT_NOT_NULL(board.pn);
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_mgmt_start(0, GPIO_NUM_21, GPIO_NUM_22, &board.bus));
+    return &board;
+}
@@ -0,0 +1,38 @@
+#ifndef TEST_BOARD_H
+#define TEST_BOARD_H
+
+/**
+ * @file test_board.h
+ * @brief Simulated board shared by the host tests.
+ * @details The device models sit at the addresses of the real board and the bus is started
+ *          once. Each test starts the drivers it needs and leaves the models in their default
+ *          configuration (no faults, no extra latency, empty PN532 field) when it finishes.
+ *
+ * @par License
+ * This project is licensed under the MIT License.
+ */
+
+#include "i2c_mgmt_driver.h"
+#include "i2c_sim.h"
+
+#define TEST_MCP23017_ADDR 0x20
+#define TEST_ADS1115_ADDR  0x48
+#define TEST_PN532_ADDR    0x24
+
+/**
+ * @brief Models and bus of the simulated board.
+ */
+typedef struct {
+    i2c_mgmt_handle_t bus;
+    i2c_sim_mcp23017_t *mcp;
+    i2c_sim_ads1115_t *ads;
+    i2c_sim_pn532_t *pn;
+} test_board_t;
+
+/**
+ * @brief Gets the simulated board, creating the models and starting the bus on the first call.
+ * @return The board; the test fails if it cannot be set up.
+ */
+const test_board_t *test_board(void);
+
+#endif // TEST_BOARD_H
@@ -0,0 +1,14 @@
+#include <stdlib.h>
+
+#include "unity.h"
+
+/*
+ * Corre todos los TEST_CASE y termina el proceso con la cantidad de fallas, para que
+ * `idf.py monitor` o un script de CI puedan usar el código de salida.
+ */
+void app_main(void)
+{
+    UNITY_BEGIN();
+    unity_run_all_tests();
+    exit(UNITY_END());
+}
@@ -0,0 +1,48 @@
+#include <stdio.h>
+
+#include "sdkconfig.h"
+#include "unity.h"
+
+#include "test_board.h"
+
+#define CALIB_ITERATIONS   2000
+#define CALIB_PROBE_REG    0x00  // IODIRA
+#define DEVICE_ADD_RM_US   50    // costo supuesto de agregar/quitar un handle en el target
+
+static const uint32_t calib_speeds[] = { I2C_MGMT_SPEED_STANDARD, I2C_MGMT_SPEED_FAST, I2C_MGMT_SPEED_FAST_PLUS };
+#define CALIB_SPEEDS (sizeof(calib_speeds) / sizeof(calib_speeds[0]))
+
+/*
+ * Benchmark del cache de handles: compilar también con sdkconfig.nocache para comparar.
+ * Con cache cada velocidad agrega el dispositivo una sola vez; sin cache, una vez por transferencia.
+ */
+TEST_CASE("device handles are added once per speed", "[i2c_mgmt][bench]")
+{
+    const test_board_t *b = test_board();
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_mgmt_device_config(b->bus, TEST_MCP23017_ADDR, I2C_MGMT_SPEED_FAST, 100));
+
+    i2c_mgmt_calib_result_t results[CALIB_SPEEDS];
+    i2c_sim_stats_t st;
+    i2c_sim_set_device_latency(DEVICE_ADD_RM_US);
+    i2c_sim_reset_stats();
+    esp_err_t err = i2c_mgmt_calibrate(b->bus, TEST_MCP23017_ADDR, CALIB_PROBE_REG, 2, calib_speeds, CALIB_SPEEDS,
+                                       CALIB_ITERATIONS, results);
+    i2c_sim_get_stats(&st);
+    i2c_sim_set_device_latency(0);
+    TEST_ASSERT_EQUAL(ESP_OK, err);
+
+    for (size_t i = 0; i < CALIB_SPEEDS; ++i)
+    {
+        printf("add/remove %u us, %lu Hz: %lu txn/s, %lu us per txn\n", DEVICE_ADD_RM_US,
+               (unsigned long)results[i].speed_hz, (unsigned long)results[i].txn_per_s, (unsigned long)results[i].avg_us);
+        TEST_ASSERT_EQUAL_UINT32(CALIB_ITERATIONS, results[i].ok);
+    }
+    printf("transfers %lu, device adds %lu, removes %lu\n", (unsigned long)st.transfers,
+           (unsigned long)st.dev_adds, (unsigned long)st.dev_removes);
+
+#if CONFIG_I2C_MGMT_DISABLE_HANDLE_CACHE
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(CALIB_SPEEDS * CALIB_ITERATIONS, st.dev_adds);
+#else
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(CALIB_SPEEDS + 1, st.dev_adds);
+#endif
+}
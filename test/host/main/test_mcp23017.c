@@ -0,0 +1,66 @@
+#include "unity.h"
+
+#include "i2c_mcp23017.h"
+#include "test_board.h"
+
+#define MCP23017_REG_IODIRA 0x00
+#define MCP23017_REG_IODIRB 0x01
+#define MCP23017_REG_IOCON  0x0A
+#define MCP23017_IOCON_SEQOP 0x20  // byte mode: el puntero alterna dentro del par A/B
+
+static void start_mcp23017(void)
+{
+    const test_board_t *b = test_board();
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_mcp23017_start(b->bus, TEST_MCP23017_ADDR, I2C_MGMT_SPEED_FAST, 100));
+}
+
+TEST_CASE("mcp23017 start sets IOCON and the pin directions", "[mcp23017]")
+{
+    start_mcp23017();
+    const test_board_t *b = test_board();
+
+    TEST_ASSERT_EQUAL_HEX8(MCP23017_IOCON_SEQOP, i2c_sim_mcp23017_peek(b->mcp, MCP23017_REG_IOCON));
+    TEST_ASSERT_EQUAL_HEX8(IODIRA_VALUE, i2c_sim_mcp23017_peek(b->mcp, MCP23017_REG_IODIRA));
+    TEST_ASSERT_EQUAL_HEX8(IODIRB_VALUE, i2c_sim_mcp23017_peek(b->mcp, MCP23017_REG_IODIRB));
+}
+
+TEST_CASE("mcp23017 output masks update the latches from the shadow", "[mcp23017]")
+{
+    start_mcp23017();
+    const test_board_t *b = test_board();
+    uint8_t olat_a, olat_b, shadow;
+    i2c_sim_stats_t st;
+
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_mcp23017_set_outputs(MCP23017_PORT_A, 0x30));
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_mcp23017_clear_outputs(MCP23017_PORT_A, 0x10));
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_mcp23017_toggle_outputs(MCP23017_PORT_B, 0x30));
+    i2c_sim_mcp23017_get_outputs(b->mcp, &olat_a, &olat_b);
+    TEST_ASSERT_EQUAL_HEX8(0x20, olat_a);
+    TEST_ASSERT_EQUAL_HEX8(0x30, olat_b);
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_mcp23017_get_outputs(MCP23017_PORT_A, &shadow));
+    TEST_ASSERT_EQUAL_HEX8(olat_a, shadow);
+
+    // Sin cambios no se escribe nada; un cambio es una sola escritura
+    i2c_sim_reset_stats();
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_mcp23017_set_outputs(MCP23017_PORT_A, 0x20));
+    i2c_sim_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(0, st.transfers);
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_mcp23017_modify_outputs(MCP23017_PORT_A, 0x10, 0x20));
+    i2c_sim_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(1, st.transfers);
+
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_mcp23017_clear_outputs(MCP23017_PORT_A, 0xFF));
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_mcp23017_clear_outputs(MCP23017_PORT_B, 0xFF));
+}
+
+TEST_CASE("mcp23017 reads only the input pins", "[mcp23017]")
+{
+    start_mcp23017();
+    const test_board_t *b = test_board();
+    uint8_t value;
+
+    i2c_sim_mcp23017_set_inputs(b->mcp, 0xA5, 0xFF);
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_mcp23017_read_gpioa_inputs(&value));
+    TEST_ASSERT_EQUAL_HEX8(0x05, value);
+    i2c_sim_mcp23017_set_inputs(b->mcp, 0x00, 0x00);
+}
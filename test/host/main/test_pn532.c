@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "unity.h"
+
+#include "i2c_pn532.h"
+#include "test_board.h"
+
+#define PN532_READS      20
+#define PN532_IRQ_GPIO   GPIO_NUM_4
+#define IDLE_FETCHES     50
+#define ARRIVAL_FETCHES  20
+
+static const uint8_t uid4[] = { 0x01, 0x02, 0x03, 0x04 };
+static const uint8_t uid7[] = { 0x04, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 };
+
+static volatile bool irq_mirror_run;
+static volatile bool irq_mirror_done;
+
+/* El modelo no maneja un pin: esta tarea copia su estado "listo" a la línea IRQ (activa en bajo) */
+static void irq_mirror_task(void *arg)
+{
+    i2c_sim_pn532_t *pn = arg;
+    while (irq_mirror_run)
+    {
+        gpio_set_level(PN532_IRQ_GPIO, i2c_sim_pn532_ready(pn) ? 0 : 1);
+        vTaskDelay(1);
+    }
+    gpio_set_level(PN532_IRQ_GPIO, 1);
+    irq_mirror_done = true;
+    vTaskDelete(NULL);
+}
+
+static void pn532_defaults(const test_board_t *b)
+{
+    i2c_sim_pn532_set_tag(b->pn, NULL, 0);
+    i2c_sim_pn532_set_nack_busy(b->pn, false);
+    i2c_sim_pn532_set_timing(b->pn, 1000, 15000);
+}
+
+/*
+ * Módulos que no reconocen la dirección mientras procesan: los sondeos "no listo" no deben
+ * abrir el breaker de 0x24 ni disparar recuperaciones del bus compartido.
+ */
+TEST_CASE("pn532 busy NACKs neither trip the breaker nor recover the bus", "[pn532]")
+{
+    const test_board_t *b = test_board();
+    pn532_defaults(b);
+    i2c_sim_pn532_set_nack_busy(b->pn, true);
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_pn532_start(b->bus, I2C_MGMT_SPEED_STANDARD, GPIO_NUM_NC));
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_sim_pn532_set_tag(b->pn, uid4, sizeof(uid4)));
+
+    i2c_mgmt_stats_t before, after;
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_mgmt_get_stats(b->bus, &before));
+    int ok = 0;
+    for (int i = 0; i < PN532_READS; ++i)
+    {
+        uint8_t uid[10];
+        size_t uid_len = sizeof(uid);
+        bool present = false;
+        if (i2c_pn532_read_passive_target(uid, &uid_len) == ESP_OK && uid_len == sizeof(uid4))
+            ok++;
+        (void)i2c_pn532_target_present(1, &present);
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_mgmt_get_stats(b->bus, &after));
+    pn532_defaults(b);
+
+    printf("reads %d/%d, breaker trips %lu, bus recoveries %lu\n", ok, PN532_READS,
+           (unsigned long)(after.breaker_trips - before.breaker_trips),
+           (unsigned long)(after.bus_recoveries - before.bus_recoveries));
+    TEST_ASSERT_EQUAL(PN532_READS, ok);
+    TEST_ASSERT_EQUAL_UINT32(before.breaker_trips, after.breaker_trips);
+    TEST_ASSERT_EQUAL_UINT32(before.bus_recoveries, after.bus_recoveries);
+}
+
+/*
+ * Sin IRQ se sondea sólo el byte de estado y la trama se lee una vez: con una respuesta que
+ * tarda 40 ms, la ocupación del bus por lectura no crece con la cantidad de sondeos.
+ */
+TEST_CASE("pn532 status polling reads each frame once", "[pn532][bench]")
+{
+    const test_board_t *b = test_board();
+    pn532_defaults(b);
+    i2c_sim_pn532_set_timing(b->pn, 1000, 40000);
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_pn532_start(b->bus, I2C_MGMT_SPEED_STANDARD, GPIO_NUM_NC));
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_sim_pn532_set_tag(b->pn, uid7, sizeof(uid7)));
+
+    i2c_sim_stats_t st;
+    i2c_sim_reset_stats();
+    int64_t t0 = esp_timer_get_time();
+    int ok = 0;
+    for (int i = 0; i < PN532_READS; ++i)
+    {
+        uint8_t uid[10];
+        size_t uid_len = sizeof(uid);
+        if (i2c_pn532_read_passive_target(uid, &uid_len) == ESP_OK && uid_len == sizeof(uid7))
+            ok++;
+    }
+    int64_t wall_us = (esp_timer_get_time() - t0) / PN532_READS;
+    i2c_sim_get_stats(&st);
+    pn532_defaults(b);
+
+    uint32_t busy_us = (uint32_t)(st.busy_us / PN532_READS);
+    printf("per read: wall %.1f ms, %lu transfers, %lu bytes read, bus busy %.2f ms\n", wall_us / 1000.0,
+           (unsigned long)(st.transfers / PN532_READS), (unsigned long)(st.bytes_rx / PN532_READS), busy_us / 1000.0);
+    TEST_ASSERT_EQUAL(PN532_READS, ok);
+    TEST_ASSERT_LESS_THAN_UINT32(15000, busy_us);  // leyendo la trama en cada sondeo eran ~35 ms
+}
+
+/*
+ * InAutoPoll: mientras no hay tarjeta no se envía nada por el bus; una tarjeta presentada se
+ * lee al bajar la IRQ y el sondeo automático queda rearmado.
+ */
+TEST_CASE("pn532 autopoll stays off the bus until a card arrives", "[pn532]")
+{
+    const test_board_t *b = test_board();
+    pn532_defaults(b);
+    irq_mirror_run = true;
+    irq_mirror_done = false;
+    TEST_ASSERT_EQUAL(pdPASS, xTaskCreate(irq_mirror_task, "pn532_irq", 4096, b->pn, 5, NULL));
+    vTaskDelay(pdMS_TO_TICKS(5));
+
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_pn532_start(b->bus, I2C_MGMT_SPEED_STANDARD, PN532_IRQ_GPIO));
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_pn532_autopoll_start(1));
+    vTaskDelay(pdMS_TO_TICKS(10));
+
+    uint8_t uid[10];
+    size_t uid_len;
+    i2c_sim_stats_t st;
+    i2c_sim_reset_stats();
+    for (int i = 0; i < IDLE_FETCHES; ++i)
+    {
+        uid_len = sizeof(uid);
+        TEST_ASSERT_EQUAL(ESP_OK, i2c_pn532_autopoll_fetch(uid, &uid_len));
+        TEST_ASSERT_EQUAL(0, uid_len);
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    i2c_sim_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(0, st.transfers);
+
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_sim_pn532_set_tag(b->pn, uid7, sizeof(uid7)));
+    int fetches = 0;
+    uid_len = 0;
+    while (uid_len == 0 && fetches < ARRIVAL_FETCHES)
+    {
+        vTaskDelay(pdMS_TO_TICKS(50));
+        uid_len = sizeof(uid);
+        TEST_ASSERT_EQUAL(ESP_OK, i2c_pn532_autopoll_fetch(uid, &uid_len));
+        fetches++;
+    }
+    printf("idle fetches %d: %lu transfers; card fetched after %d fetches\n", IDLE_FETCHES,
+           (unsigned long)st.transfers, fetches);
+
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_pn532_autopoll_stop());
+    irq_mirror_run = false;
+    while (!irq_mirror_done)
+        vTaskDelay(1);
+    pn532_defaults(b);
+
+    TEST_ASSERT_EQUAL(sizeof(uid7), uid_len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(uid7, uid, sizeof(uid7));
+}
@@ -0,0 +1,164 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_private/partition_linux.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "sdkconfig.h"
+#include "unity.h"
+
+#include "security_auth.h"
+
+/* Formato guardado por security_auth.c: chunks "t%03u" de 64 slots de 20 bytes en el namespace "auth" */
+#define AUTH_NAMESPACE     "auth"
+#define AUTH_CHUNK_SLOTS   64
+#define AUTH_SLOT_SIZE     20
+#define AUTH_SLOT_UID_LEN  8   // offset de uid_len dentro del slot
+#define AUTH_SLOT_UID      9   // offset del UID
+
+#define REBUILD_TAGS       1530  // casi lleno con 2048 slots: secuencias de sondeo largas
+#define REBUILD_LOST_CHUNK "t005"
+#define REBUILD_BAD_CHUNK  "t010"
+#define REBUILD_BAD_SLOTS  16
+
+#define BATCH_MESSAGES     100
+#define BATCH_LINES        10
+
+static void fresh_store(void)
+{
+    (void)security_auth_stop();
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_flash_erase_partition(CONFIG_SECURITY_AUTH_PARTITION));
+    TEST_ASSERT_EQUAL(ESP_OK, security_auth_start(NULL, 0));
+    TEST_ASSERT_EQUAL(0, security_auth_count());
+}
+
+static security_auth_entry_t tag4(uint32_t n)
+{
+    security_auth_entry_t e = { .uid_len = 4 };
+    memcpy(e.uid, &n, sizeof(n));
+    return e;
+}
+
+static security_auth_entry_t tag7(uint32_t n)
+{
+    security_auth_entry_t e = { .uid_len = 7 };
+    memcpy(e.uid, &n, sizeof(n));
+    e.uid[6] = 0x5A;
+    return e;
+}
+
+/* Marca como perdidos los tags de 4 bytes de los slots indicados de un chunk */
+static void mark_lost(const uint8_t *chunk, const bool *slots, bool *lost)
+{
+    for (size_t s = 0; s < AUTH_CHUNK_SLOTS; ++s)
+    {
+        const uint8_t *slot = &chunk[s * AUTH_SLOT_SIZE];
+        if (!slots[s] || slot[AUTH_SLOT_UID_LEN] != 4)
+            continue;
+        uint32_t n;
+        memcpy(&n, &slot[AUTH_SLOT_UID], sizeof(n));
+        if (n < REBUILD_TAGS)
+            lost[n] = true;
+    }
+}
+
+/*
+ * Un chunk que falta o un slot con uid_len inválido dejan huecos dentro de las secuencias de
+ * sondeo: al cargar, la tabla se reconstruye y todos los tags que sobrevivieron se encuentran.
+ */
+TEST_CASE("auth store rebuilds a damaged table without losing reachable tags", "[security_auth]")
+{
+    static bool lost[REBUILD_TAGS];
+    static uint8_t chunk[AUTH_CHUNK_SLOTS * AUTH_SLOT_SIZE];
+    bool all_slots[AUTH_CHUNK_SLOTS], bad_slots[AUTH_CHUNK_SLOTS] = { false };
+    memset(lost, 0, sizeof(lost));
+    memset(all_slots, 1, sizeof(all_slots));
+
+    fresh_store();
+    security_auth_batch_begin();
+    for (uint32_t i = 0; i < REBUILD_TAGS; ++i)
+    {
+        security_auth_entry_t e = tag4(i);
+        TEST_ASSERT_EQUAL(ESP_OK, security_auth_add(&e));
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, security_auth_batch_end());
+    TEST_ASSERT_EQUAL(ESP_OK, security_auth_stop());
+
+    // Daño: un chunk borrado y REBUILD_BAD_SLOTS slots de otro con uid_len inválido
+    nvs_handle_t h;
+    size_t len = sizeof(chunk);
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_open_from_partition(CONFIG_SECURITY_AUTH_PARTITION, AUTH_NAMESPACE, NVS_READWRITE, &h));
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_get_blob(h, REBUILD_LOST_CHUNK, chunk, &len));
+    mark_lost(chunk, all_slots, lost);
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_erase_key(h, REBUILD_LOST_CHUNK));
+    len = sizeof(chunk);
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_get_blob(h, REBUILD_BAD_CHUNK, chunk, &len));
+    for (size_t s = 0; s < AUTH_CHUNK_SLOTS; s += AUTH_CHUNK_SLOTS / REBUILD_BAD_SLOTS)
+        bad_slots[s] = true;
+    mark_lost(chunk, bad_slots, lost);
+    for (size_t s = 0; s < AUTH_CHUNK_SLOTS; ++s)
+        if (bad_slots[s])
+            chunk[s * AUTH_SLOT_SIZE + AUTH_SLOT_UID_LEN] = 9;
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_set_blob(h, REBUILD_BAD_CHUNK, chunk, sizeof(chunk)));
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_commit(h));
+    nvs_close(h);
+
+    TEST_ASSERT_EQUAL(ESP_OK, security_auth_start(NULL, 0));
+    size_t survivors = 0, granted = 0;
+    for (uint32_t i = 0; i < REBUILD_TAGS; ++i)
+    {
+        security_auth_entry_t e = tag4(i);
+        survivors += !lost[i];
+        granted += !lost[i] && security_auth_check(e.uid, e.uid_len) == SECURITY_AUTH_GRANTED;
+    }
+    printf("%d tags, %u lost with the damage: %u of %u survivors granted\n", REBUILD_TAGS,
+           (unsigned)(REBUILD_TAGS - survivors), (unsigned)granted, (unsigned)survivors);
+    TEST_ASSERT_EQUAL(survivors, security_auth_count());
+    TEST_ASSERT_EQUAL(survivors, granted);
+    TEST_ASSERT_EQUAL(ESP_OK, security_auth_stop());
+}
+
+static size_t add_messages(bool batched)
+{
+    esp_partition_clear_stats();
+    for (uint32_t m = 0; m < BATCH_MESSAGES; ++m)
+    {
+        if (batched)
+            security_auth_batch_begin();
+        for (uint32_t l = 0; l < BATCH_LINES; ++l)
+        {
+            security_auth_entry_t e = tag7(m * BATCH_LINES + l);
+            TEST_ASSERT_EQUAL(ESP_OK, security_auth_add(&e));
+        }
+        if (batched)
+            TEST_ASSERT_EQUAL(ESP_OK, security_auth_batch_end());
+    }
+    return esp_partition_get_write_bytes();
+}
+
+/*
+ * Un mensaje Tags de varias líneas se guarda con un solo commit: se escribe menos flash y
+ * lo guardado es lo mismo que línea por línea.
+ */
+TEST_CASE("auth store batches the lines of a message", "[security_auth][bench]")
+{
+    fresh_store();
+    size_t per_line = add_messages(false);
+    TEST_ASSERT_EQUAL(ESP_OK, security_auth_clear());
+    size_t batched = add_messages(true);
+    printf("%d tags in %d messages: %u KB written per line, %u KB batched\n", BATCH_MESSAGES * BATCH_LINES,
+           BATCH_MESSAGES, (unsigned)(per_line / 1024), (unsigned)(batched / 1024));
+    TEST_ASSERT_LESS_THAN(per_line, batched);
+
+    // Lo guardado en lote sobrevive a un reinicio
+    TEST_ASSERT_EQUAL(ESP_OK, security_auth_stop());
+    TEST_ASSERT_EQUAL(ESP_OK, security_auth_start(NULL, 0));
+    TEST_ASSERT_EQUAL(BATCH_MESSAGES * BATCH_LINES, security_auth_count());
+    for (uint32_t i = 0; i < BATCH_MESSAGES * BATCH_LINES; ++i)
+    {
+        security_auth_entry_t e = tag7(i);
+        TEST_ASSERT_EQUAL(SECURITY_AUTH_GRANTED, security_auth_check(e.uid, e.uid_len));
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, security_auth_stop());
+}